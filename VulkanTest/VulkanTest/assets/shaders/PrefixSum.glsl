@@ -0,0 +1,72 @@
+#type compute
+#version 460
+
+/*
+ * Inclusive prefix sum (scan) of 32-bit unsigned integers.
+ *
+ * Arrays larger than one work group are scanned in levels (see PrefixSum on the host):
+ *   1. Scan each block of WORK_GROUP_SIZE values in place, writing each block's total to blockSums.
+ *   2. Scan blockSums the same way, and so on, until a level fits into a single work group.
+ *   3. From that level down, the ADD_BLOCK_SUMS variant adds the scanned total of every previous block to each value.
+ * So the size is only bound by the work group count of one dispatch, not by WORK_GROUP_SIZE * WORK_GROUP_SIZE.
+ */
+
+#define WORK_GROUP_SIZE 256
+
+layout(local_size_x = WORK_GROUP_SIZE) in;
+
+layout(std430, set = 0, binding = 0) buffer Values {
+	uint values[];
+};
+
+layout(std430, set = 0, binding = 1) buffer BlockSums {
+	uint blockSums[];
+};
+
+layout(push_constant) uniform PushConstants {
+	uint count;
+} pc;
+
+#ifndef ADD_BLOCK_SUMS
+
+shared uint scratch[WORK_GROUP_SIZE];
+
+void main() {
+	uint index = gl_GlobalInvocationID.x;
+	uint local = gl_LocalInvocationID.x;
+
+	scratch[local] = index < pc.count ? values[index] : 0;
+
+	barrier();
+
+	// Hillis-Steele scan inside the work group
+	for (uint offset = 1; offset < WORK_GROUP_SIZE; offset <<= 1) {
+		uint addend = local >= offset ? scratch[local - offset] : 0;
+
+		barrier();
+
+		scratch[local] += addend;
+
+		barrier();
+	}
+
+	if (index < pc.count)
+		values[index] = scratch[local];
+
+	if (local == WORK_GROUP_SIZE - 1)
+		blockSums[gl_WorkGroupID.x] = scratch[local];
+}
+
+#else
+
+void main() {
+	uint index = gl_GlobalInvocationID.x;
+
+	// The first block has nothing before it
+	if (gl_WorkGroupID.x == 0 || index >= pc.count)
+		return;
+
+	values[index] += blockSums[gl_WorkGroupID.x - 1];
+}
+
+#endif
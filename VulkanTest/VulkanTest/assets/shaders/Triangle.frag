@@ -1,15 +1,32 @@
 #version 460
 
+#ifdef BINDLESS
+#extension GL_EXT_nonuniform_qualifier : require
+#endif
+
 // in values
 layout(location = 0) in vec3 fragColor;
 layout(location = 1) in vec2 fragTexCoord;
 
 // uniform values
+#ifdef BINDLESS
+layout(set = 1, binding = 0) uniform sampler2D textures[];
+
+layout(push_constant) uniform PushConstants {
+	uint textureIndex;
+} pc;
+#else
 layout(binding = 1) uniform sampler2D texSampler;
+#endif
 
 // out values
 layout(location = 0) out vec4 outColor;
 
 void main() {
+#ifdef BINDLESS
+	// The index is the same for the whole draw, so it doesn't need nonuniformEXT
+	outColor = texture(textures[pc.textureIndex], fragTexCoord);
+#else
 	outColor = texture(texSampler, fragTexCoord);
+#endif
 }
\ No newline at end of file
@@ -0,0 +1,220 @@
+﻿#define VULKAN_HPP_NO_CONSTRUCTORS
+
+#include "BindlessTextures.h"
+
+#include <algorithm>
+
+#include "Core/Log.h"
+
+/**
+ * \brief Creates the descriptor set of the texture array, sized to what the device allows, and fills slot 0.
+ * \param device The logical device, created with the descriptor indexing features enabled.
+ * \param physical_device The physical device, whose limits cap the size of the array.
+ * \param default_texture The texture of slot 0, e.g. a placeholder.
+ */
+BindlessTextures::BindlessTextures(const vk::Device device,
+                                   const vk::PhysicalDevice physical_device,
+                                   const Texture& default_texture) : m_device(device)
+{
+	const auto properties = physical_device.getProperties2<vk::PhysicalDeviceProperties2,
+	                                                       vk::PhysicalDeviceDescriptorIndexingProperties>();
+
+	const auto& limits = properties.get<vk::PhysicalDeviceDescriptorIndexingProperties>();
+
+	m_capacity = std::min({
+		s_maxTextures,
+		limits.maxDescriptorSetUpdateAfterBindSampledImages,
+		limits.maxDescriptorSetUpdateAfterBindSamplers,
+		limits.maxPerStageDescriptorUpdateAfterBindSampledImages,
+		limits.maxPerStageDescriptorUpdateAfterBindSamplers
+	});
+
+	vk::DescriptorSetLayoutBinding binding{
+		.binding = 0,
+		.descriptorType = vk::DescriptorType::eCombinedImageSampler,
+		.descriptorCount = m_capacity,
+		.stageFlags = vk::ShaderStageFlagBits::eFragment,
+		.pImmutableSamplers = nullptr
+	};
+
+	// Slots that no draw uses may be empty, and may be written while frames using other slots are in flight
+	vk::DescriptorBindingFlags binding_flags = vk::DescriptorBindingFlagBits::ePartiallyBound |
+	                                           vk::DescriptorBindingFlagBits::eUpdateAfterBind |
+	                                           vk::DescriptorBindingFlagBits::eUpdateUnusedWhilePending;
+
+	vk::DescriptorSetLayoutBindingFlagsCreateInfo binding_flags_info{
+		.bindingCount = 1,
+		.pBindingFlags = &binding_flags
+	};
+
+	vk::DescriptorSetLayoutCreateInfo layout_info{
+		.pNext = &binding_flags_info,
+		.flags = vk::DescriptorSetLayoutCreateFlagBits::eUpdateAfterBindPool,
+		.bindingCount = 1,
+		.pBindings = &binding
+	};
+
+	if (device.createDescriptorSetLayout(&layout_info, nullptr, &m_layout) != vk::Result::eSuccess)
+		throw std::runtime_error("Failed to create bindless descriptor set layout!");
+
+	vk::DescriptorPoolSize pool_size{
+		.type = vk::DescriptorType::eCombinedImageSampler,
+		.descriptorCount = m_capacity
+	};
+
+	vk::DescriptorPoolCreateInfo pool_info{
+		.flags = vk::DescriptorPoolCreateFlagBits::eUpdateAfterBind,
+		.maxSets = 1,
+		.poolSizeCount = 1,
+		.pPoolSizes = &pool_size
+	};
+
+	if (device.createDescriptorPool(&pool_info, nullptr, &m_pool) != vk::Result::eSuccess)
+		throw std::runtime_error("Failed to create bindless descriptor pool!");
+
+	vk::DescriptorSetAllocateInfo alloc_info{
+		.descriptorPool = m_pool,
+		.descriptorSetCount = 1,
+		.pSetLayouts = &m_layout
+	};
+
+	if (device.allocateDescriptorSets(&alloc_info, &m_set) != vk::Result::eSuccess)
+		throw std::runtime_error("Failed to allocate bindless descriptor set!");
+
+	Write(s_defaultIndex, default_texture);
+
+	VK_CORE_TRACE("Bindless texture array with {0} slots", m_capacity);
+}
+
+BindlessTextures::~BindlessTextures()
+{
+	m_device.destroyDescriptorPool(m_pool, nullptr);
+	m_device.destroyDescriptorSetLayout(m_layout, nullptr);
+}
+
+/**
+ * \brief Writes a texture into a free slot of the array.
+ * \param texture The texture, which must stay alive until its slot is unregistered.
+ * \return The index that shaders sample the texture with.
+ */
+uint32_t BindlessTextures::Register(const Texture& texture)
+{
+	uint32_t index;
+
+	if (!m_freeIndices.empty()) {
+		index = m_freeIndices.back();
+		m_freeIndices.pop_back();
+	} else if (m_nextIndex < m_capacity)
+		index = m_nextIndex++;
+	else
+		throw std::runtime_error("Bindless texture array is full!");
+
+	Write(index, texture);
+
+	return index;
+}
+
+/**
+ * \brief Releases the slot of a texture. The slot is reused once the frames in flight are done with it.
+ * \param index The index that Register returned.
+ */
+void BindlessTextures::Unregister(const uint32_t index)
+{
+	if (index != s_defaultIndex)
+		m_retiredIndices.emplace_back(index, m_frame);
+}
+
+/**
+ * \brief Advances the frame counter, and makes slots released long enough ago available again.
+ */
+void BindlessTextures::BeginFrame()
+{
+	m_frame++;
+
+	std::erase_if(m_retiredIndices, [this](const std::pair<uint32_t, uint64_t>& retired)
+	{
+		if (retired.second + s_reuseDelayFrames > m_frame)
+			return false;
+
+		m_freeIndices.push_back(retired.first);
+
+		return true;
+	});
+}
+
+/**
+ * \brief Binds the texture array, once per command buffer rather than once per draw.
+ * \param command_buffer The command buffer being recorded.
+ * \param pipeline_layout A pipeline layout that has the array layout at the given set.
+ * \param set The set number of the array in the shaders.
+ */
+void BindlessTextures::Bind(const vk::CommandBuffer command_buffer,
+                            const vk::PipelineLayout pipeline_layout,
+                            const uint32_t set) const
+{
+	command_buffer.bindDescriptorSets(vk::PipelineBindPoint::eGraphics, pipeline_layout, set, 1, &m_set, 0, nullptr);
+}
+
+/**
+ * \brief Selects the texture that the next draws sample.
+ * \param command_buffer The command buffer being recorded.
+ * \param pipeline_layout A pipeline layout created with GetPushConstantRange.
+ * \param index The index that Register returned.
+ */
+void BindlessTextures::PushTextureIndex(const vk::CommandBuffer command_buffer,
+                                        const vk::PipelineLayout pipeline_layout,
+                                        const uint32_t index)
+{
+	const BindlessPushConstants push_constants{.textureIndex = index};
+
+	command_buffer.pushConstants(pipeline_layout, vk::ShaderStageFlagBits::eFragment, 0, sizeof(push_constants),
+	                             &push_constants);
+}
+
+vk::PushConstantRange BindlessTextures::GetPushConstantRange()
+{
+	return vk::PushConstantRange{
+		.stageFlags = vk::ShaderStageFlagBits::eFragment,
+		.offset = 0,
+		.size = sizeof(BindlessPushConstants)
+	};
+}
+
+/**
+ * \brief Checks whether the device has every descriptor indexing feature that the texture array relies on.
+ * \param physical_device The device to check.
+ * \return Whether bindless textures can be used.
+ */
+bool BindlessTextures::IsSupported(const vk::PhysicalDevice physical_device)
+{
+	const auto features = physical_device.getFeatures2<vk::PhysicalDeviceFeatures2,
+	                                                   vk::PhysicalDeviceDescriptorIndexingFeatures>();
+
+	const auto& indexing = features.get<vk::PhysicalDeviceDescriptorIndexingFeatures>();
+
+	return indexing.shaderSampledImageArrayNonUniformIndexing &&
+	       indexing.descriptorBindingSampledImageUpdateAfterBind &&
+	       indexing.descriptorBindingUpdateUnusedWhilePending &&
+	       indexing.descriptorBindingPartiallyBound &&
+	       indexing.runtimeDescriptorArray;
+}
+
+void BindlessTextures::Write(const uint32_t index, const Texture& texture) const
+{
+	vk::DescriptorImageInfo image_info{
+		.sampler = texture.m_textureSampler,
+		.imageView = texture.m_textureImageView,
+		.imageLayout = vk::ImageLayout::eShaderReadOnlyOptimal
+	};
+
+	vk::WriteDescriptorSet descriptor_write{
+		.dstSet = m_set,
+		.dstBinding = 0,
+		.dstArrayElement = index,
+		.descriptorCount = 1,
+		.descriptorType = vk::DescriptorType::eCombinedImageSampler,
+		.pImageInfo = &image_info
+	};
+
+	m_device.updateDescriptorSets(1, &descriptor_write, 0, nullptr);
+}
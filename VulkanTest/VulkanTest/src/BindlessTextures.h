@@ -0,0 +1,76 @@
+﻿#pragma once
+#include <vector>
+#include <vulkan/vulkan.hpp>
+
+#include "Texture.h"
+
+// Pushed before every draw, so switching textures doesn't need a descriptor set bind
+struct BindlessPushConstants
+{
+	uint32_t textureIndex = 0;
+};
+
+/**
+ * \brief One descriptor set holding a large, partially bound array of combined image samplers,
+ * which shaders index with the texture index of the draw. Registering a texture writes a single array slot.
+ */
+class BindlessTextures
+{
+public:
+	static constexpr uint32_t s_maxTextures = 16384;
+
+	// Slot 0 always holds the texture given at creation, so an index is never left pointing at nothing
+	static constexpr uint32_t s_defaultIndex = 0;
+
+	// Freed slots are only reused after every frame that could still sample them has completed
+	static constexpr uint64_t s_reuseDelayFrames = 3;
+
+	BindlessTextures(vk::Device device, vk::PhysicalDevice physical_device, const Texture& default_texture);
+
+	~BindlessTextures();
+
+	BindlessTextures(const BindlessTextures&) = delete;
+
+	BindlessTextures& operator=(const BindlessTextures&) = delete;
+
+	uint32_t Register(const Texture& texture);
+
+	void Unregister(uint32_t index);
+
+	void BeginFrame();
+
+	void Bind(vk::CommandBuffer command_buffer, vk::PipelineLayout pipeline_layout, uint32_t set) const;
+
+	static void PushTextureIndex(vk::CommandBuffer command_buffer, vk::PipelineLayout pipeline_layout, uint32_t index);
+
+	[[nodiscard]] vk::DescriptorSetLayout GetLayout() const { return m_layout; }
+
+	[[nodiscard]] uint32_t GetCapacity() const { return m_capacity; }
+
+	static vk::PushConstantRange GetPushConstantRange();
+
+	static bool IsSupported(vk::PhysicalDevice physical_device);
+
+private:
+	void Write(uint32_t index, const Texture& texture) const;
+
+	vk::Device m_device;
+
+	uint32_t m_capacity;
+
+	vk::DescriptorSetLayout m_layout;
+
+	vk::DescriptorPool m_pool;
+
+	vk::DescriptorSet m_set;
+
+	// Slots at and above this index were never handed out
+	uint32_t m_nextIndex = s_defaultIndex + 1;
+
+	std::vector<uint32_t> m_freeIndices;
+
+	// Released slots, and the frame they were released in
+	std::vector<std::pair<uint32_t, uint64_t>> m_retiredIndices;
+
+	uint64_t m_frame = 0;
+};
@@ -159,3 +159,27 @@ void Buffer::CopyBufferToImage(const vk::Device device,
 
 	EndSingleTimeCommands(device, command_pool, queue, command_buffer);
 }
+
+/**
+ * \brief Copies several regions of a buffer into an image with a single submission, e.g. every level of a mip chain.
+ * \param device The logical device.
+ * \param command_pool The command pool that the copy command is allocated from.
+ * \param queue The queue that the copy is submitted to.
+ * \param buffer The source buffer.
+ * \param image The destination image, in the transfer destination layout.
+ * \param regions The regions to copy.
+ */
+void Buffer::CopyBufferToImage(const vk::Device device,
+                               const vk::CommandPool command_pool,
+                               const vk::Queue& queue,
+                               const vk::Buffer buffer,
+                               const vk::Image image,
+                               const std::vector<vk::BufferImageCopy>& regions)
+{
+	vk::CommandBuffer command_buffer = BeginSingleTimeCommands(device, command_pool);
+
+	command_buffer.copyBufferToImage(buffer, image, vk::ImageLayout::eTransferDstOptimal,
+	                                 static_cast<uint32_t>(regions.size()), regions.data());
+
+	EndSingleTimeCommands(device, command_pool, queue, command_buffer);
+}
@@ -7,7 +7,7 @@
 #include "Vertex.h"
 
 template < typename T >
-concept vertex_or_index = std::same_as<T, Vertex> || std::same_as<T, uint16_t>;
+concept vertex_or_index = vertex_struct<T> || index_type<T>;
 
 class Buffer
 {
@@ -61,12 +61,29 @@ private:
 	                              uint32_t width,
 	                              uint32_t height);
 
+	static void CopyBufferToImage(vk::Device device,
+	                              vk::CommandPool command_pool,
+	                              const vk::Queue& queue,
+	                              vk::Buffer buffer,
+	                              vk::Image image,
+	                              const std::vector<vk::BufferImageCopy>& regions);
+
+	friend class Image;
+
+	friend class PrefixSum;
+
 	friend class Texture;
+
+	friend class TextureAtlas;
+
+	friend class TextureResidency;
+
+	friend class TextureUploadBatch;
 };
 
 /**
  * \brief Creates a buffer for a two kinds of primitive inputs: Vertices or Indices
- * \tparam T Either a Vertex object, or a uint16_t.
+ * \tparam T Either a vertex struct that lists its fields (see VertexLayout), or an index (uint16_t, uint32_t).
  * \param primitive_buffer The buffer where its data will be written to.
  * \param buffer_memory The type of memory that the buffer will have.
  * \param device The logical device that handles the creation of the buffer, and allocation of its memory.
@@ -103,10 +120,10 @@ void Buffer::CreatePrimitiveBuffer(vk::Buffer& primitive_buffer,
 
 	vk::BufferUsageFlagBits type_flag;
 
-	if (std::is_same_v<std::decay_t<decltype(primitives[0])>, Vertex>)
-		type_flag = vk::BufferUsageFlagBits::eVertexBuffer;
-	else
+	if constexpr (std::is_integral_v<T>)
 		type_flag = vk::BufferUsageFlagBits::eIndexBuffer;
+	else
+		type_flag = vk::BufferUsageFlagBits::eVertexBuffer;
 
 	CreateBuffer(device, physical_device, buffer_size,
 	             vk::BufferUsageFlagBits::eTransferDst | type_flag,
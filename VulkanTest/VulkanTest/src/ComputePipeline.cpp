@@ -0,0 +1,252 @@
+﻿#define VULKAN_HPP_NO_CONSTRUCTORS
+
+#include "ComputePipeline.h"
+
+#include <algorithm>
+#include <string>
+
+#include "Core/Assert.h"
+
+/**
+ * \brief Creates a compute pipeline, along with a layout built from the reflection data of the shader.
+ * \param compute_pipeline The vk::Pipeline object reference to be allocated.
+ * \param pipeline_layout The vk::PipelineLayout object reference that is allocated and later used.
+ * \param descriptor_set_layouts The descriptor set layouts of every set that the shader uses, one per set index.
+ * \param device The logical device that will handle object creations.
+ * \param shader A shader that has a compute stage.
+ * \param shader_module_cache The cache that owns the shader module of the compute stage.
+ * \param max_variable_descriptor_count The upper bound of runtime sized descriptor arrays, see CreateDescriptorSetLayouts.
+ */
+void ComputePipeline::CreateComputePipeline(vk::Pipeline& compute_pipeline,
+                                            vk::PipelineLayout& pipeline_layout,
+                                            std::vector<vk::DescriptorSetLayout>& descriptor_set_layouts,
+                                            const vk::Device device,
+                                            const OpenGLShader& shader,
+                                            ShaderModuleCache& shader_module_cache,
+                                            const uint32_t max_variable_descriptor_count)
+{
+	VK_CORE_ASSERT(shader.HasStage(vk::ShaderStageFlagBits::eCompute), "Shader has no compute stage!");
+
+	const ShaderReflection& reflection = shader.GetReflection();
+
+	CreateDescriptorSetLayouts(descriptor_set_layouts, device, reflection, max_variable_descriptor_count);
+
+	// Pipeline layout
+	vk::PipelineLayoutCreateInfo pipeline_layout_info{
+		.setLayoutCount = static_cast<uint32_t>(descriptor_set_layouts.size()),
+		.pSetLayouts = descriptor_set_layouts.data(),
+		.pushConstantRangeCount = static_cast<uint32_t>(reflection.pushConstantRanges.size()),
+		.pPushConstantRanges = reflection.pushConstantRanges.data()
+	};
+
+	if (device.createPipelineLayout(&pipeline_layout_info, nullptr, &pipeline_layout) != vk::Result::eSuccess)
+		throw std::runtime_error("Failed to create compute pipeline layout!");
+
+	const vk::ShaderModule compute_shader_module = shader_module_cache.GetOrCreate(
+		shader.GetVulkanSpirv(vk::ShaderStageFlagBits::eCompute));
+
+	vk::ComputePipelineCreateInfo pipeline_info{
+		.stage{
+			.stage = vk::ShaderStageFlagBits::eCompute,
+			.module = compute_shader_module,
+			.pName = "main"
+		},
+		.layout = pipeline_layout,
+		// optional
+		.basePipelineHandle = VK_NULL_HANDLE,
+		// optional
+		.basePipelineIndex = -1
+	};
+
+	if (device.createComputePipelines(VK_NULL_HANDLE, 1, &pipeline_info, nullptr, &compute_pipeline) !=
+	    vk::Result::eSuccess)
+		throw std::runtime_error("Failed to create compute pipeline!");
+}
+
+/**
+ * \brief Creates one descriptor set layout per set index used by a shader.
+ * \param descriptor_set_layouts The created layouts, indexed by set. Sets that the shader skips get an empty layout.
+ * \param device The logical device that will handle object creations.
+ * \param reflection The reflection data of the shader.
+ * \param max_variable_descriptor_count The upper bound of a runtime sized descriptor array (e.g. buffers[]),
+ * whose reflected count is 0. Such a binding gets a variable count, so the real size is given when its set is
+ * allocated (vk::DescriptorSetVariableDescriptorCountAllocateInfo), and needs descriptor indexing on the device.
+ */
+void ComputePipeline::CreateDescriptorSetLayouts(std::vector<vk::DescriptorSetLayout>& descriptor_set_layouts,
+                                                 const vk::Device device,
+                                                 const ShaderReflection& reflection,
+                                                 const uint32_t max_variable_descriptor_count)
+{
+	const uint32_t set_count = reflection.GetSetCount();
+
+	descriptor_set_layouts.resize(set_count);
+
+	for (uint32_t set = 0; set < set_count; set++) {
+
+		std::vector<vk::DescriptorSetLayoutBinding> bindings;
+		std::vector<vk::DescriptorBindingFlags> binding_flags;
+
+		// Only the binding with the highest number of a set may have a variable count
+		uint32_t highest_binding = 0;
+		bool has_variable_count = false;
+
+		for (const auto& resource : reflection.bindings) {
+			if (resource.set != set)
+				continue;
+
+			const bool variable_count = resource.count == 0;
+
+			if (variable_count && max_variable_descriptor_count == 0)
+				throw std::invalid_argument("Descriptor array " + resource.name +
+				                            " is runtime sized, but has no upper bound!");
+
+			if (variable_count && has_variable_count)
+				throw std::invalid_argument("Set " + std::to_string(set) + " has more than one runtime sized array!");
+
+			has_variable_count |= variable_count;
+			highest_binding = std::max(highest_binding, resource.binding);
+
+			bindings.push_back(vk::DescriptorSetLayoutBinding{
+				.binding = resource.binding,
+				.descriptorType = resource.type,
+				.descriptorCount = variable_count ? max_variable_descriptor_count : resource.count,
+				.stageFlags = resource.stages,
+				// optional
+				.pImmutableSamplers = nullptr
+			});
+
+			binding_flags.push_back(variable_count ?
+				                        vk::DescriptorBindingFlagBits::eVariableDescriptorCount |
+				                        vk::DescriptorBindingFlagBits::ePartiallyBound :
+				                        vk::DescriptorBindingFlags{});
+		}
+
+		for (size_t i = 0; i < bindings.size(); i++)
+			if (binding_flags[i] & vk::DescriptorBindingFlagBits::eVariableDescriptorCount &&
+			    bindings[i].binding != highest_binding)
+				throw std::invalid_argument("Runtime sized descriptor arrays have to be the last binding of their set!");
+
+		vk::DescriptorSetLayoutBindingFlagsCreateInfo binding_flags_info{
+			.bindingCount = static_cast<uint32_t>(binding_flags.size()),
+			.pBindingFlags = binding_flags.data()
+		};
+
+		vk::DescriptorSetLayoutCreateInfo layout_info{
+			.pNext = has_variable_count ? &binding_flags_info : nullptr,
+			.bindingCount = static_cast<uint32_t>(bindings.size()),
+			.pBindings = bindings.data()
+		};
+
+		if (device.createDescriptorSetLayout(&layout_info, nullptr, &descriptor_set_layouts[set]) !=
+		    vk::Result::eSuccess)
+			throw std::runtime_error("Failed to create descriptor set layout!");
+	}
+}
+
+/**
+ * \brief Records a dispatch of a number of work groups.
+ */
+void ComputePipeline::Dispatch(const vk::CommandBuffer command_buffer,
+                               const uint32_t group_count_x,
+                               const uint32_t group_count_y,
+                               const uint32_t group_count_z)
+{
+	command_buffer.dispatch(group_count_x, group_count_y, group_count_z);
+}
+
+/**
+ * \brief Records a dispatch that covers at least a number of invocations,
+ * rounding up to whole work groups of the shader's local size.
+ * \param command_buffer The command buffer that the dispatch is recorded into.
+ * \param reflection The reflection data of the bound compute shader.
+ * \param invocation_count_x The number of invocations needed along x (e.g. the element count).
+ * \param invocation_count_y The number of invocations needed along y.
+ * \param invocation_count_z The number of invocations needed along z.
+ */
+void ComputePipeline::DispatchInvocations(const vk::CommandBuffer command_buffer,
+                                          const ShaderReflection& reflection,
+                                          const uint32_t invocation_count_x,
+                                          const uint32_t invocation_count_y,
+                                          const uint32_t invocation_count_z)
+{
+	const auto& [local_x, local_y, local_z] = reflection.localSize;
+
+	Dispatch(command_buffer,
+	         (invocation_count_x + local_x - 1) / local_x,
+	         (invocation_count_y + local_y - 1) / local_y,
+	         (invocation_count_z + local_z - 1) / local_z);
+}
+
+/**
+ * \brief Records a memory barrier on a range of a buffer.
+ * \param command_buffer The command buffer that the barrier is recorded into.
+ * \param buffer The buffer that is being written to, then read from.
+ * \param src_access The kind of access that has to be finished.
+ * \param dst_access The kind of access that has to wait.
+ * \param src_stage The pipeline stage that does the first access.
+ * \param dst_stage The pipeline stage that does the second access.
+ * \param offset The start of the range inside the buffer.
+ * \param size The size of the range inside the buffer.
+ */
+void ComputePipeline::BufferBarrier(const vk::CommandBuffer command_buffer,
+                                    const vk::Buffer buffer,
+                                    const vk::AccessFlags src_access,
+                                    const vk::AccessFlags dst_access,
+                                    const vk::PipelineStageFlags src_stage,
+                                    const vk::PipelineStageFlags dst_stage,
+                                    const vk::DeviceSize offset,
+                                    const vk::DeviceSize size)
+{
+	vk::BufferMemoryBarrier barrier{
+		.srcAccessMask = src_access,
+		.dstAccessMask = dst_access,
+		.srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED,
+		.dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED,
+		.buffer = buffer,
+		.offset = offset,
+		.size = size
+	};
+
+	command_buffer.pipelineBarrier(src_stage, dst_stage, {}, 0, nullptr, 1, &barrier, 0, nullptr);
+}
+
+void ComputePipeline::ComputeToComputeBarrier(const vk::CommandBuffer command_buffer, const vk::Buffer buffer)
+{
+	BufferBarrier(command_buffer, buffer,
+	              vk::AccessFlagBits::eShaderWrite, vk::AccessFlagBits::eShaderRead | vk::AccessFlagBits::eShaderWrite,
+	              vk::PipelineStageFlagBits::eComputeShader, vk::PipelineStageFlagBits::eComputeShader);
+}
+
+void ComputePipeline::ComputeToTransferBarrier(const vk::CommandBuffer command_buffer, const vk::Buffer buffer)
+{
+	BufferBarrier(command_buffer, buffer,
+	              vk::AccessFlagBits::eShaderWrite, vk::AccessFlagBits::eTransferRead,
+	              vk::PipelineStageFlagBits::eComputeShader, vk::PipelineStageFlagBits::eTransfer);
+}
+
+void ComputePipeline::ComputeToHostBarrier(const vk::CommandBuffer command_buffer, const vk::Buffer buffer)
+{
+	BufferBarrier(command_buffer, buffer,
+	              vk::AccessFlagBits::eShaderWrite, vk::AccessFlagBits::eHostRead,
+	              vk::PipelineStageFlagBits::eComputeShader, vk::PipelineStageFlagBits::eHost);
+}
+
+void ComputePipeline::ComputeToVertexInputBarrier(const vk::CommandBuffer command_buffer, const vk::Buffer buffer)
+{
+	BufferBarrier(command_buffer, buffer,
+	              vk::AccessFlagBits::eShaderWrite,
+	              vk::AccessFlagBits::eVertexAttributeRead | vk::AccessFlagBits::eIndexRead,
+	              vk::PipelineStageFlagBits::eComputeShader, vk::PipelineStageFlagBits::eVertexInput);
+}
+
+void ComputePipeline::Destroy(const vk::Device device,
+                              const vk::Pipeline compute_pipeline,
+                              const vk::PipelineLayout pipeline_layout,
+                              const std::vector<vk::DescriptorSetLayout>& descriptor_set_layouts)
+{
+	device.destroyPipeline(compute_pipeline, nullptr);
+	device.destroyPipelineLayout(pipeline_layout, nullptr);
+
+	for (const auto descriptor_set_layout : descriptor_set_layouts)
+		device.destroyDescriptorSetLayout(descriptor_set_layout, nullptr);
+}
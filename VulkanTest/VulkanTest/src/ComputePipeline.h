@@ -0,0 +1,54 @@
+﻿#pragma once
+
+#include "OpenGLShader.h"
+#include "ShaderModuleCache.h"
+
+class ComputePipeline
+{
+public:
+	static void CreateComputePipeline(vk::Pipeline& compute_pipeline,
+	                                  vk::PipelineLayout& pipeline_layout,
+	                                  std::vector<vk::DescriptorSetLayout>& descriptor_set_layouts,
+	                                  vk::Device device,
+	                                  const OpenGLShader& shader,
+	                                  ShaderModuleCache& shader_module_cache,
+	                                  uint32_t max_variable_descriptor_count = 0);
+
+	static void CreateDescriptorSetLayouts(std::vector<vk::DescriptorSetLayout>& descriptor_set_layouts,
+	                                       vk::Device device,
+	                                       const ShaderReflection& reflection,
+	                                       uint32_t max_variable_descriptor_count = 0);
+
+	static void Dispatch(vk::CommandBuffer command_buffer,
+	                     uint32_t group_count_x,
+	                     uint32_t group_count_y = 1,
+	                     uint32_t group_count_z = 1);
+
+	static void DispatchInvocations(vk::CommandBuffer command_buffer,
+	                                const ShaderReflection& reflection,
+	                                uint32_t invocation_count_x,
+	                                uint32_t invocation_count_y = 1,
+	                                uint32_t invocation_count_z = 1);
+
+	static void BufferBarrier(vk::CommandBuffer command_buffer,
+	                          vk::Buffer buffer,
+	                          vk::AccessFlags src_access,
+	                          vk::AccessFlags dst_access,
+	                          vk::PipelineStageFlags src_stage,
+	                          vk::PipelineStageFlags dst_stage,
+	                          vk::DeviceSize offset = 0,
+	                          vk::DeviceSize size = VK_WHOLE_SIZE);
+
+	static void ComputeToComputeBarrier(vk::CommandBuffer command_buffer, vk::Buffer buffer);
+
+	static void ComputeToTransferBarrier(vk::CommandBuffer command_buffer, vk::Buffer buffer);
+
+	static void ComputeToHostBarrier(vk::CommandBuffer command_buffer, vk::Buffer buffer);
+
+	static void ComputeToVertexInputBarrier(vk::CommandBuffer command_buffer, vk::Buffer buffer);
+
+	static void Destroy(vk::Device device,
+	                    vk::Pipeline compute_pipeline,
+	                    vk::PipelineLayout pipeline_layout,
+	                    const std::vector<vk::DescriptorSetLayout>& descriptor_set_layouts);
+};
@@ -0,0 +1,38 @@
+﻿#pragma once
+
+#include <cstdint>
+#include <span>
+#include <string_view>
+
+/**
+ * \brief 64 bit FNV-1a. It is the same between runs and builds, unlike std::hash, so it can key files on disk.
+ */
+class Fnv1a
+{
+public:
+	static constexpr uint64_t s_offsetBasis = 14695981039346656037ull;
+
+	static constexpr uint64_t s_prime = 1099511628211ull;
+
+	// Goes over whole words instead of single bytes, e.g. for SPIR-V
+	static constexpr uint64_t Hash(const std::span<const uint32_t> words, uint64_t hash = s_offsetBasis)
+	{
+		for (const uint32_t word : words)
+			hash = Combine(hash, word);
+
+		return hash;
+	}
+
+	static constexpr uint64_t Hash(const std::string_view text, uint64_t hash = s_offsetBasis)
+	{
+		for (const char c : text)
+			hash = Combine(hash, static_cast<uint8_t>(c));
+
+		return hash;
+	}
+
+	static constexpr uint64_t Combine(const uint64_t hash, const uint64_t value)
+	{
+		return (hash ^ value) * s_prime;
+	}
+};
@@ -0,0 +1,222 @@
+﻿#include "MappedFile.h"
+
+#include <utility>
+
+#include "Log.h"
+
+#ifdef VK_PLATFORM_WINDOWS
+#define WIN32_LEAN_AND_MEAN
+#define NOMINMAX
+#include <Windows.h>
+#else
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#endif
+
+/**
+ * \brief Maps a whole file into memory for reading.
+ * \param file_path The location of the file.
+ */
+MappedFile::MappedFile(const std::string& file_path)
+{
+#ifdef VK_PLATFORM_WINDOWS
+	HANDLE file = CreateFileA(file_path.c_str(), GENERIC_READ, FILE_SHARE_READ, nullptr, OPEN_EXISTING,
+	                          FILE_ATTRIBUTE_NORMAL, nullptr);
+
+	if (file == INVALID_HANDLE_VALUE) {
+		VK_CORE_ERROR("Could not open file '{0}'", file_path);
+		return;
+	}
+
+	m_fileHandle = file;
+
+	LARGE_INTEGER file_size;
+
+	if (!GetFileSizeEx(file, &file_size)) {
+		VK_CORE_ERROR("Could not read from file '{0}'", file_path);
+		Close();
+		return;
+	}
+
+	m_size = static_cast<size_t>(file_size.QuadPart);
+
+	// Empty files cannot be mapped, but they are still valid files
+	if (m_size == 0) {
+		m_isOpen = true;
+		return;
+	}
+
+	m_mappingHandle = CreateFileMappingA(file, nullptr, PAGE_READONLY, 0, 0, nullptr);
+
+	if (m_mappingHandle)
+		m_data = static_cast<const char*>(MapViewOfFile(m_mappingHandle, FILE_MAP_READ, 0, 0, 0));
+#else
+	m_fileDescriptor = open(file_path.c_str(), O_RDONLY);
+
+	if (m_fileDescriptor == -1) {
+		VK_CORE_ERROR("Could not open file '{0}'", file_path);
+		return;
+	}
+
+	struct stat file_stat{};
+
+	if (fstat(m_fileDescriptor, &file_stat) != 0) {
+		VK_CORE_ERROR("Could not read from file '{0}'", file_path);
+		Close();
+		return;
+	}
+
+	m_size = static_cast<size_t>(file_stat.st_size);
+
+	// Empty files cannot be mapped, but they are still valid files
+	if (m_size == 0) {
+		m_isOpen = true;
+		return;
+	}
+
+	if (void* mapping = mmap(nullptr, m_size, PROT_READ, MAP_PRIVATE, m_fileDescriptor, 0); mapping != MAP_FAILED)
+		m_data = static_cast<const char*>(mapping);
+#endif
+
+	if (!m_data) {
+		VK_CORE_ERROR("Could not map file '{0}'", file_path);
+		Close();
+		return;
+	}
+
+	m_isOpen = true;
+}
+
+MappedFile::~MappedFile()
+{
+	Close();
+}
+
+MappedFile::MappedFile(MappedFile&& other) noexcept
+{
+	*this = std::move(other);
+}
+
+MappedFile& MappedFile::operator=(MappedFile&& other) noexcept
+{
+	if (this != &other) {
+		Close();
+
+		m_isOpen = std::exchange(other.m_isOpen, false);
+		m_data = std::exchange(other.m_data, nullptr);
+		m_size = std::exchange(other.m_size, 0);
+
+#ifdef VK_PLATFORM_WINDOWS
+		m_fileHandle = std::exchange(other.m_fileHandle, nullptr);
+		m_mappingHandle = std::exchange(other.m_mappingHandle, nullptr);
+#else
+		m_fileDescriptor = std::exchange(other.m_fileDescriptor, -1);
+#endif
+	}
+
+	return *this;
+}
+
+/**
+ * \brief Hints the OS about how the mapping is going to be read. Only a hint, failures are ignored.
+ * Sequential reads make the kernel read ahead aggressively, which matters for files that are decoded or copied once
+ * from front to back on a cold page cache. Windows has no access pattern hints, so the pages are prefetched instead.
+ * \param access How the mapping is about to be read.
+ */
+void MappedFile::Advise(const Access access) const
+{
+	if (!m_data)
+		return;
+
+#ifdef VK_PLATFORM_WINDOWS
+	if (access == Access::Sequential || access == Access::WillNeed) {
+		WIN32_MEMORY_RANGE_ENTRY range{
+			.VirtualAddress = const_cast<char*>(m_data),
+			.NumberOfBytes = m_size
+		};
+
+		PrefetchVirtualMemory(GetCurrentProcess(), 1, &range, 0);
+	}
+#else
+	int advice = MADV_NORMAL;
+
+	switch (access) {
+		case Access::Normal:
+			advice = MADV_NORMAL;
+			break;
+		case Access::Sequential:
+			advice = MADV_SEQUENTIAL;
+			break;
+		case Access::Random:
+			advice = MADV_RANDOM;
+			break;
+		case Access::WillNeed:
+			advice = MADV_WILLNEED;
+			break;
+	}
+
+	madvise(const_cast<char*>(m_data), m_size, advice);
+#endif
+}
+
+/**
+ * \brief Drops the cached pages of a file, so that the next read of it comes from the disk. Meant for measuring cold
+ * loads. On Windows the cache is only purged while nothing else has the file open or mapped.
+ * \param file_path The location of the file.
+ * \return Whether the OS accepted the request.
+ */
+bool MappedFile::Evict(const std::string& file_path)
+{
+#ifdef VK_PLATFORM_WINDOWS
+	// Opening a file without buffering makes the cache manager flush and purge what it holds of it
+	HANDLE file = CreateFileA(file_path.c_str(), GENERIC_READ, FILE_SHARE_READ, nullptr, OPEN_EXISTING,
+	                          FILE_FLAG_NO_BUFFERING, nullptr);
+
+	if (file == INVALID_HANDLE_VALUE)
+		return false;
+
+	CloseHandle(file);
+	return true;
+#else
+	const int file_descriptor = open(file_path.c_str(), O_RDONLY);
+
+	if (file_descriptor == -1)
+		return false;
+
+	const bool evicted = posix_fadvise(file_descriptor, 0, 0, POSIX_FADV_DONTNEED) == 0;
+
+	close(file_descriptor);
+	return evicted;
+#endif
+}
+
+void MappedFile::Close()
+{
+#ifdef VK_PLATFORM_WINDOWS
+	if (m_data)
+		UnmapViewOfFile(m_data);
+
+	if (m_mappingHandle)
+		CloseHandle(m_mappingHandle);
+
+	if (m_fileHandle)
+		CloseHandle(m_fileHandle);
+
+	m_fileHandle = nullptr;
+	m_mappingHandle = nullptr;
+#else
+	if (m_data)
+		munmap(const_cast<char*>(m_data), m_size);
+
+	if (m_fileDescriptor != -1)
+		close(m_fileDescriptor);
+
+	m_fileDescriptor = -1;
+#endif
+
+	m_isOpen = false;
+	m_data = nullptr;
+	m_size = 0;
+}
@@ -0,0 +1,65 @@
+﻿#pragma once
+
+#include <cstddef>
+#include <string>
+#include <string_view>
+
+#include "Base.h"
+
+/**
+ * \brief A read-only view of an entire file that is mapped into memory instead of being copied into a buffer.
+ * Any views taken from it are only valid for as long as the mapped file is alive.
+ */
+class MappedFile
+{
+public:
+	// How the mapping is about to be read, so the OS can read ahead or drop pages behind the reader
+	enum class Access
+	{
+		Normal,
+		Sequential,
+		Random,
+		WillNeed
+	};
+
+	explicit MappedFile(const std::string& file_path);
+
+	~MappedFile();
+
+	MappedFile(const MappedFile&) = delete;
+
+	MappedFile& operator=(const MappedFile&) = delete;
+
+	MappedFile(MappedFile&& other) noexcept;
+
+	MappedFile& operator=(MappedFile&& other) noexcept;
+
+	[[nodiscard]] bool IsOpen() const { return m_isOpen; }
+
+	[[nodiscard]] const char* GetData() const { return m_data; }
+
+	[[nodiscard]] size_t GetSize() const { return m_size; }
+
+	[[nodiscard]] std::string_view GetView() const { return {m_data, m_size}; }
+
+	void Advise(Access access) const;
+
+	static bool Evict(const std::string& file_path);
+
+private:
+	void Close();
+
+	bool m_isOpen = false;
+
+	const char* m_data = nullptr;
+
+	size_t m_size = 0;
+
+#ifdef VK_PLATFORM_WINDOWS
+	void* m_fileHandle = nullptr;
+
+	void* m_mappingHandle = nullptr;
+#else
+	int m_fileDescriptor = -1;
+#endif
+};
@@ -11,21 +11,27 @@
  * \param render_pass A render pass that determines coloring.
  * \param device The logical device that will handle object creations.
  * \param swap_chain_extent The extents of the current screen.
- * \param descriptor_set_layout The descriptor set layout used so that shaders know what uniforms to use.
+ * \param descriptor_set_layouts The layout of every descriptor set, in set order, so that shaders know what uniforms to use.
  * \param shader The shaders that are being used for the pipeline.
+ * \param shader_module_cache The cache that owns the shader modules, which are shared between pipelines.
+ * \param push_constant_ranges The push constants that the shaders read, if any.
+ * \param vertex_input The bindings and attributes of the vertex streams, usually VertexLayout::GetInputState().
  */
 void GraphicsPipeline::CreateGraphicsPipeline(vk::Pipeline& graphics_pipeline,
                                               vk::PipelineLayout& pipeline_layout,
                                               vk::RenderPass render_pass,
                                               const vk::Device device,
                                               vk::Extent2D swap_chain_extent,
-                                              const vk::DescriptorSetLayout descriptor_set_layout,
-                                              const OpenGLShader& shader)
+                                              const std::vector<vk::DescriptorSetLayout>& descriptor_set_layouts,
+                                              const OpenGLShader& shader,
+                                              ShaderModuleCache& shader_module_cache,
+                                              const std::vector<vk::PushConstantRange>& push_constant_ranges,
+                                              const vk::PipelineVertexInputStateCreateInfo& vertex_input)
 {
-	vk::ShaderModule vert_shader_module = OpenGLShader::CreateShaderModule(device, shader,
-	                                                                       vk::ShaderStageFlagBits::eVertex);
-	vk::ShaderModule frag_shader_module = OpenGLShader::CreateShaderModule(device, shader,
-	                                                                       vk::ShaderStageFlagBits::eFragment);
+	const vk::ShaderModule vert_shader_module = shader_module_cache.GetOrCreate(
+		shader.GetVulkanSpirv(vk::ShaderStageFlagBits::eVertex));
+	const vk::ShaderModule frag_shader_module = shader_module_cache.GetOrCreate(
+		shader.GetVulkanSpirv(vk::ShaderStageFlagBits::eFragment));
 
 	vk::PipelineShaderStageCreateInfo vert_shader_stage_info{
 		.stage = vk::ShaderStageFlagBits::eVertex,
@@ -41,17 +47,6 @@ void GraphicsPipeline::CreateGraphicsPipeline(vk::Pipeline& graphics_pipeline,
 
 	vk::PipelineShaderStageCreateInfo shader_stages[] = {vert_shader_stage_info, frag_shader_stage_info};
 
-	auto binding_description = Vertex::GetBindingDescription();
-	auto attribute_descriptions = Vertex::GetAttributeDescriptions();
-
-	vk::PipelineVertexInputStateCreateInfo vertex_input_info{
-		.vertexBindingDescriptionCount = 1,
-		// optional
-		.pVertexBindingDescriptions = &binding_description,
-		.vertexAttributeDescriptionCount = static_cast<uint32_t>(attribute_descriptions.size()),
-		.pVertexAttributeDescriptions = attribute_descriptions.data() // optional
-	};
-
 	// Viewports and scissors
 	vk::PipelineInputAssemblyStateCreateInfo input_assembly{
 		.topology = vk::PrimitiveTopology::eTriangleList,
@@ -150,13 +145,13 @@ void GraphicsPipeline::CreateGraphicsPipeline(vk::Pipeline& graphics_pipeline,
 	// Pipeline layout
 	vk::PipelineLayoutCreateInfo pipeline_layout_info{
 		// optional
-		.setLayoutCount = 1,
+		.setLayoutCount = static_cast<uint32_t>(descriptor_set_layouts.size()),
 		// optional
-		.pSetLayouts = &descriptor_set_layout,
+		.pSetLayouts = descriptor_set_layouts.data(),
 		// optional
-		.pushConstantRangeCount = 0,
+		.pushConstantRangeCount = static_cast<uint32_t>(push_constant_ranges.size()),
 		// optional
-		.pPushConstantRanges = nullptr
+		.pPushConstantRanges = push_constant_ranges.data()
 	};
 
 	// building the pipeline layout
@@ -167,7 +162,7 @@ void GraphicsPipeline::CreateGraphicsPipeline(vk::Pipeline& graphics_pipeline,
 	vk::GraphicsPipelineCreateInfo pipeline_info{
 		.stageCount = 2,
 		.pStages = shader_stages,
-		.pVertexInputState = &vertex_input_info,
+		.pVertexInputState = &vertex_input,
 		.pInputAssemblyState = &input_assembly,
 		.pViewportState = &viewport_state,
 		.pRasterizationState = &rasterizer,
@@ -191,9 +186,6 @@ void GraphicsPipeline::CreateGraphicsPipeline(vk::Pipeline& graphics_pipeline,
 		throw std::runtime_error("Failed to create graphics pipeline!");
 
 	// End of Code
-	// Since shader modules get converted to machine code, they can be destroyed
-	device.destroyShaderModule(frag_shader_module, nullptr);
-	device.destroyShaderModule(vert_shader_module, nullptr);
 }
 
 void GraphicsPipeline::CreateRenderPass(vk::RenderPass& render_pass,
@@ -1,6 +1,8 @@
 ﻿#pragma once
 
 #include "OpenGLShader.h"
+#include "ShaderModuleCache.h"
+#include "Vertex.h"
 
 class GraphicsPipeline
 {
@@ -10,8 +12,12 @@ public:
 	                                   vk::RenderPass render_pass,
 	                                   vk::Device device,
 	                                   vk::Extent2D swap_chain_extent,
-	                                   vk::DescriptorSetLayout descriptor_set_layout,
-	                                   const OpenGLShader& shader);
+	                                   const std::vector<vk::DescriptorSetLayout>& descriptor_set_layouts,
+	                                   const OpenGLShader& shader,
+	                                   ShaderModuleCache& shader_module_cache,
+	                                   const std::vector<vk::PushConstantRange>& push_constant_ranges = {},
+	                                   const vk::PipelineVertexInputStateCreateInfo& vertex_input =
+		                                   VertexLayout<Vertex>::GetInputState());
 
 	static void CreateRenderPass(vk::RenderPass& render_pass, vk::Device device, vk::Format swap_chain_image_format);
 };
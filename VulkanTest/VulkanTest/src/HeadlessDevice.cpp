@@ -0,0 +1,132 @@
+﻿#define VULKAN_HPP_NO_CONSTRUCTORS
+
+#include "HeadlessDevice.h"
+
+#include <optional>
+#include <vector>
+
+#include "HostImageCopy.h"
+#include "PhysicalDevice.h"
+#include "ValidationLayers.h"
+#include "Core/Log.h"
+
+/**
+ * \brief Creates the instance, and a device from the first GPU with a queue family for graphics and compute.
+ * \param host_image_copy Whether to enable host image copies when the device supports them, whether or not they
+ * are preferred on it, see HostImageCopy::IsEnabled.
+ */
+HeadlessDevice::HeadlessDevice(const bool host_image_copy)
+{
+	const bool validation = ValidationLayers::enable_validation_layers &&
+	                        ValidationLayers::CheckValidationLayerSupport();
+
+	vk::ApplicationInfo application_info{
+		.pApplicationName = "Headless",
+		.applicationVersion = VK_MAKE_API_VERSION(0, 1, 3, 0),
+		.pEngineName = "No Engine",
+		.engineVersion = VK_MAKE_API_VERSION(0, 1, 3, 0),
+		.apiVersion = VK_API_VERSION_1_3
+	};
+
+	const auto layer_count = static_cast<uint32_t>(ValidationLayers::validation_layers.size());
+
+	vk::InstanceCreateInfo instance_info{
+		.pApplicationInfo = &application_info,
+		.enabledLayerCount = validation ? layer_count : 0,
+		.ppEnabledLayerNames = validation ? ValidationLayers::validation_layers.data() : nullptr
+	};
+
+	if (createInstance(&instance_info, nullptr, &m_instance) != vk::Result::eSuccess)
+		throw std::runtime_error("Failed to create instance!");
+
+	uint32_t device_count = 0;
+	m_instance.enumeratePhysicalDevices(&device_count, nullptr);
+
+	std::vector<vk::PhysicalDevice> devices(device_count);
+	m_instance.enumeratePhysicalDevices(&device_count, devices.data());
+
+	// Every device with graphics has a family that also does compute, nothing has to be presented
+	constexpr vk::QueueFlags required_flags = vk::QueueFlagBits::eGraphics | vk::QueueFlagBits::eCompute;
+
+	std::optional<uint32_t> queue_family;
+
+	for (const auto candidate : devices) {
+		uint32_t family_count = 0;
+		candidate.getQueueFamilyProperties(&family_count, nullptr);
+
+		std::vector<vk::QueueFamilyProperties> families(family_count);
+		candidate.getQueueFamilyProperties(&family_count, families.data());
+
+		for (uint32_t family = 0; family < family_count && !queue_family; family++)
+			if ((families[family].queueFlags & required_flags) == required_flags)
+				queue_family = family;
+
+		if (queue_family) {
+			m_physicalDevice = candidate;
+			break;
+		}
+	}
+
+	if (!queue_family) {
+		Destroy();
+		throw std::runtime_error("Failed to find a GPU with a graphics and compute queue!");
+	}
+
+	float queue_priority = 1.0f;
+
+	vk::DeviceQueueCreateInfo queue_info{
+		.queueFamilyIndex = queue_family.value(),
+		.queueCount = 1,
+		.pQueuePriorities = &queue_priority
+	};
+
+	std::vector<const char*> extensions;
+
+	const void* features = host_image_copy ?
+		                       HostImageCopy::AddDeviceFeatures(m_physicalDevice, extensions, nullptr, false) :
+		                       nullptr;
+
+	vk::DeviceCreateInfo device_info{
+		.pNext = features,
+		.queueCreateInfoCount = 1,
+		.pQueueCreateInfos = &queue_info,
+		.enabledExtensionCount = static_cast<uint32_t>(extensions.size()),
+		.ppEnabledExtensionNames = extensions.data()
+	};
+
+	if (m_physicalDevice.createDevice(&device_info, nullptr, &m_device) != vk::Result::eSuccess) {
+		Destroy();
+		throw std::runtime_error("Failed to create Logical Device!");
+	}
+
+	if (host_image_copy)
+		HostImageCopy::Load(m_device);
+
+	m_device.getQueue(queue_family.value(), 0, &m_queue);
+
+	vk::CommandPoolCreateInfo pool_info{
+		.queueFamilyIndex = queue_family.value()
+	};
+
+	if (m_device.createCommandPool(&pool_info, nullptr, &m_commandPool) != vk::Result::eSuccess) {
+		Destroy();
+		throw std::runtime_error("Failed to create command pool!");
+	}
+
+	VK_CORE_INFO("Headless device on {0}", PhysicalDevice::GetProperties(m_physicalDevice).deviceName.data());
+}
+
+HeadlessDevice::~HeadlessDevice()
+{
+	Destroy();
+}
+
+void HeadlessDevice::Destroy()
+{
+	if (m_device) {
+		m_device.destroyCommandPool(m_commandPool, nullptr);
+		m_device.destroy(nullptr);
+	}
+
+	m_instance.destroy(nullptr);
+}
@@ -0,0 +1,39 @@
+﻿#pragma once
+#include <vulkan/vulkan.hpp>
+
+/**
+ * \brief An instance and device without a window or swap chain, with one queue that takes graphics, compute and
+ * transfer work. Used to test and measure parts of the engine on their own.
+ */
+class HeadlessDevice
+{
+public:
+	explicit HeadlessDevice(bool host_image_copy = false);
+
+	~HeadlessDevice();
+
+	HeadlessDevice(const HeadlessDevice&) = delete;
+
+	HeadlessDevice& operator=(const HeadlessDevice&) = delete;
+
+	[[nodiscard]] vk::Device GetDevice() const { return m_device; }
+
+	[[nodiscard]] vk::PhysicalDevice GetPhysicalDevice() const { return m_physicalDevice; }
+
+	[[nodiscard]] vk::Queue GetQueue() const { return m_queue; }
+
+	[[nodiscard]] vk::CommandPool GetCommandPool() const { return m_commandPool; }
+
+private:
+	void Destroy();
+
+	vk::Instance m_instance;
+
+	vk::PhysicalDevice m_physicalDevice;
+
+	vk::Device m_device;
+
+	vk::Queue m_queue;
+
+	vk::CommandPool m_commandPool;
+};
@@ -10,8 +10,10 @@
 #include "LogicalDevice.h"
 #include "OpenGLShader.h"
 #include "PhysicalDevice.h"
+#include "SamplerCache.h"
 #include "SwapChain.h"
 #include "ValidationLayers.h"
+#include "VertexQuantizer.h"
 #include "VkUniform.h"
 
 void HelloTriangleApplication::Run()
@@ -53,45 +55,69 @@ void HelloTriangleApplication::InitVulkan()
 
 	PhysicalDevice::PickPhysicalDevice(m_physicalDevice, m_instance, m_surface, m_window);
 
-	LogicalDevice::CreateLogicalDevice(m_device, m_physicalDevice, m_graphicsQueue, m_presentQueue);
+	LogicalDevice::CreateLogicalDevice(m_device, m_physicalDevice, m_graphicsQueue, m_presentQueue, m_transferQueue);
 
 	SwapChain::CreateSwapChain(m_swapChain, m_swapChainImages, m_swapChainImageFormat, m_swapChainExtent,
 	                           m_physicalDevice, m_device, m_surface, m_window);
 
 	SwapChain::CreateImageViews(m_swapChainImageViews, m_device, m_swapChainImages, m_swapChainImageFormat);
 
-	const OpenGLShader triangle_shader("Triangle", "assets/shaders/Triangle.vert", "assets/shaders/Triangle.frag");
+	// The texture is decoded in the background, and the placeholder is drawn until it is resident
+	m_textureStreamer = std::make_unique<TextureStreamer>(m_device, m_physicalDevice, m_graphicsQueue,
+	                                                      m_transferQueue);
+
+	// Draws select their texture with a push constant when the device supports descriptor indexing
+	if (BindlessTextures::IsSupported(m_physicalDevice))
+		m_bindlessTextures = std::make_unique<BindlessTextures>(m_device, m_physicalDevice,
+		                                                        m_textureStreamer->GetPlaceholder());
+
+	ShaderDefines triangle_defines;
+
+	if (m_bindlessTextures)
+		triangle_defines["BINDLESS"] = "1";
+
+	// The shader and its modules are kept for the whole run, so swap chain recreation does not rebuild them
+	m_triangleShader = std::make_unique<OpenGLShader>("Triangle", "assets/shaders/Triangle.vert",
+	                                                  "assets/shaders/Triangle.frag", triangle_defines);
+
+	m_shaderModuleCache = std::make_unique<ShaderModuleCache>(m_device);
 
 	GraphicsPipeline::CreateRenderPass(m_renderPass, m_device, m_swapChainImageFormat);
 
-	VkUniform::CreateDescriptorSetLayout(m_device, m_descriptorSetLayout);
+	// Every texture of the triangle uses the default sampler, so it is fixed in the layout
+	VkUniform::CreateDescriptorSetLayout(m_device, m_descriptorSetLayout,
+	                                     SamplerCache::GetDefault(m_device, m_physicalDevice));
 
-	GraphicsPipeline::CreateGraphicsPipeline(m_graphicsPipeline, m_pipelineLayout, m_renderPass, m_device,
-	                                         m_swapChainExtent, m_descriptorSetLayout, triangle_shader);
+	CreateGraphicsPipeline();
 
 	SwapChain::CreateFrameBuffers(m_swapChainFrameBuffers, m_device, m_swapChainImageViews, m_swapChainExtent,
 	                              m_renderPass);
 
 	PhysicalDevice::CreateCommandPool(m_commandPool, m_physicalDevice, m_device);
 
-	m_testTexture = std::make_unique<Texture>("texture.jpg", m_device, m_physicalDevice, m_commandPool,
-	                                          m_graphicsQueue);
+	m_testTexture = m_textureStreamer->Load("texture.jpg");
 
-	m_testTexture->CreateTextureImageView(m_device);
+	// The quad is drawn from 12 byte vertices, the shader reads them as floats as before
+	const QuantizedVertices<QuantizedVertex> quantized = VertexQuantizer::Quantize<QuantizedVertex>(m_vertices);
 
-	m_testTexture->CreateTextureSampler(m_device, m_physicalDevice);
+	if (!quantized.IsWithinBounds())
+		throw std::runtime_error("The quad vertices are over their quantization tolerance!");
 
-	Buffer::CreatePrimitiveBuffer(m_vertexBuffer, m_vertexBufferMemory, m_device, m_physicalDevice, m_vertices,
-	                              m_commandPool, m_graphicsQueue);
+	Buffer::CreatePrimitiveBuffer(m_vertexBuffer, m_vertexBufferMemory, m_device, m_physicalDevice,
+	                              quantized.vertices, m_commandPool, m_graphicsQueue);
 
 	Buffer::CreatePrimitiveBuffer(m_indexBuffer, m_indexBufferMemory, m_device, m_physicalDevice, m_indices,
 	                              m_commandPool, m_graphicsQueue);
 
 	Buffer::CreateUniformBuffers(m_uniformBuffers, m_uniformBuffersMemory, m_device, m_physicalDevice);
 
+	VkUniform::MapUniformBuffers(m_device, m_uniformBuffersMemory, m_uniformBuffersMapped);
+
+	m_transformHandles = VkUniform::GetTransformHandles(*m_triangleShader);
+
 	VkUniform::CreateDescriptorPool(m_device, m_descriptorPool);
 
-	VkUniform::CreateDescriptorSets(m_device, m_descriptorSets, *m_testTexture, m_descriptorSetLayout,
+	VkUniform::CreateDescriptorSets(m_device, m_descriptorSets, m_testTexture->Get(), m_descriptorSetLayout,
 	                                m_descriptorPool, m_uniformBuffers);
 
 	CreateCommandBuffers();
@@ -179,17 +205,30 @@ void HelloTriangleApplication::RecreateSwapChain()
 
 	SwapChain::CreateImageViews(m_swapChainImageViews, m_device, m_swapChainImages, m_swapChainImageFormat);
 
-	const OpenGLShader triangle_shader("Triangle", "assets/shaders/Triangle.vert", "assets/shaders/Triangle.frag");
-
 	GraphicsPipeline::CreateRenderPass(m_renderPass, m_device, m_swapChainImageFormat);
 
-	GraphicsPipeline::CreateGraphicsPipeline(m_graphicsPipeline, m_pipelineLayout, m_renderPass, m_device,
-	                                         m_swapChainExtent, m_descriptorSetLayout, triangle_shader);
+	CreateGraphicsPipeline();
 
 	SwapChain::CreateFrameBuffers(m_swapChainFrameBuffers, m_device, m_swapChainImageViews, m_swapChainExtent,
 	                              m_renderPass);
 }
 
+void HelloTriangleApplication::CreateGraphicsPipeline()
+{
+	std::vector descriptor_set_layouts = {m_descriptorSetLayout};
+	std::vector<vk::PushConstantRange> push_constant_ranges;
+
+	if (m_bindlessTextures) {
+		descriptor_set_layouts.push_back(m_bindlessTextures->GetLayout());
+		push_constant_ranges.push_back(BindlessTextures::GetPushConstantRange());
+	}
+
+	GraphicsPipeline::CreateGraphicsPipeline(m_graphicsPipeline, m_pipelineLayout, m_renderPass, m_device,
+	                                         m_swapChainExtent, descriptor_set_layouts, *m_triangleShader,
+	                                         *m_shaderModuleCache, push_constant_ranges,
+	                                         VertexLayout<QuantizedVertex>::GetInputState());
+}
+
 void HelloTriangleApplication::CleanUpSwapChain()
 {
 	// Destroy swap chain frame buffers
@@ -263,11 +302,17 @@ void HelloTriangleApplication::RecordCommandBuffer(const vk::CommandBuffer comma
 
 	command_buffer.bindVertexBuffers(0, 1, vertex_buffers, offsets);
 
-	command_buffer.bindIndexBuffer(m_indexBuffer, 0, vk::IndexType::eUint16);
+	command_buffer.bindIndexBuffer(m_indexBuffer, 0, GetIndexType<decltype(m_indices)::value_type>());
 
 	command_buffer.bindDescriptorSets(vk::PipelineBindPoint::eGraphics, m_pipelineLayout, 0, 1,
 	                                  &m_descriptorSets[m_currentFrame], 0, nullptr);
 
+	// The texture array is bound once, after which every draw only pushes the index of its texture
+	if (m_bindlessTextures) {
+		m_bindlessTextures->Bind(command_buffer, m_pipelineLayout, 1);
+		BindlessTextures::PushTextureIndex(command_buffer, m_pipelineLayout, m_testTextureIndex);
+	}
+
 	command_buffer.drawIndexed(m_indices.size(), 1, 0, 0, 0);
 
 	// End recording commands
@@ -327,7 +372,28 @@ void HelloTriangleApplication::DrawFrame()
 	if (result != vk::Result::eSuccess && result != vk::Result::eSuboptimalKHR)
 		throw std::runtime_error("Failed to acquire swap chain image!");
 
-	VkUniform::UpdateUniformBuffer(m_device, m_currentFrame, m_swapChainExtent, m_uniformBuffersMemory);
+	if (m_bindlessTextures)
+		m_bindlessTextures->BeginFrame();
+
+	for (const std::shared_ptr<StreamedTexture>& texture : m_textureStreamer->Update()) {
+		if (texture != m_testTexture)
+			continue;
+
+		// Writing a new slot leaves the one that frames in flight sample untouched
+		if (m_bindlessTextures)
+			m_testTextureIndex = m_bindlessTextures->Register(texture->Get());
+		else
+			m_staleTextureDescriptors = (1u << MAX_FRAMES_IN_FLIGHT) - 1;
+	}
+
+	// The fence above guarantees that this frame's descriptor set is no longer in use
+	if (m_staleTextureDescriptors & 1u << m_currentFrame) {
+		VkUniform::UpdateTextureDescriptor(m_device, m_descriptorSets[m_currentFrame], m_testTexture->Get());
+		m_staleTextureDescriptors &= ~(1u << m_currentFrame);
+	}
+
+	VkUniform::UpdateUniformBuffer(m_currentFrame, m_swapChainExtent, *m_triangleShader, m_transformHandles,
+	                               m_uniformBuffersMapped);
 
 	m_device.resetFences(1, &m_inFlightFences[m_currentFrame]);
 
@@ -399,10 +465,15 @@ void HelloTriangleApplication::CleanUp()
 {
 	CleanUpSwapChain();
 
-	m_testTexture->Destroy(m_device);
+	m_bindlessTextures.reset();
+
+	// Destroys the streamed textures and the placeholder
+	m_testTexture.reset();
+	m_textureStreamer.reset();
 
 	// Destroy the uniform buffers and the memory related to them
 	for (size_t i = 0; i < MAX_FRAMES_IN_FLIGHT; i++) {
+		m_device.unmapMemory(m_uniformBuffersMemory[i]);
 		m_device.destroyBuffer(m_uniformBuffers[i], nullptr);
 		m_device.freeMemory(m_uniformBuffersMemory[i], nullptr);
 	}
@@ -431,6 +502,12 @@ void HelloTriangleApplication::CleanUp()
 	// Destroy command pool
 	m_device.destroyCommandPool(m_commandPool, nullptr);
 
+	// Destroy shader modules
+	m_shaderModuleCache.reset();
+
+	// Destroy the samplers, which every texture and layout using them is done with by now
+	SamplerCache::Destroy(m_device);
+
 	// Destroy Logical Device
 	m_device.destroy(nullptr);
 
@@ -9,7 +9,12 @@
 #include<vector>
 #include<GLFW/glfw3.h>
 
+#include "BindlessTextures.h"
+#include "OpenGLShader.h"
+#include "ShaderModuleCache.h"
 #include "Texture.h"
+#include "TextureStreamer.h"
+#include "VkUniform.h"
 #include"Vertex.h"
 
 constexpr uint32_t WIDTH = 800;
@@ -18,6 +23,8 @@ constexpr uint32_t HEIGHT = 600;
 
 constexpr int MAX_FRAMES_IN_FLIGHT = 2;
 
+static_assert(MAX_FRAMES_IN_FLIGHT <= ShaderUniforms::s_maxFramesInFlight, "Uniform dirty state only covers 32 frames");
+
 #pragma once
 class HelloTriangleApplication
 {
@@ -39,6 +46,8 @@ private:
 
 	void CleanUpSwapChain();
 
+	void CreateGraphicsPipeline();
+
 	void CreateCommandBuffers();
 
 	void RecordCommandBuffer(vk::CommandBuffer command_buffer, uint32_t image_index);
@@ -69,6 +78,8 @@ private:
 
 	vk::Queue m_presentQueue;
 
+	vk::Queue m_transferQueue;
+
 	vk::SwapchainKHR m_swapChain;
 
 	std::vector<vk::Image> m_swapChainImages;
@@ -103,6 +114,10 @@ private:
 
 	std::vector<vk::DeviceMemory> m_uniformBuffersMemory;
 
+	std::vector<void*> m_uniformBuffersMapped;
+
+	VkUniform::TransformHandles m_transformHandles;
+
 	vk::DescriptorPool m_descriptorPool;
 
 	std::vector<vk::DescriptorSet> m_descriptorSets;
@@ -119,7 +134,21 @@ private:
 
 	uint32_t m_currentFrame = 0;
 
-	std::unique_ptr<Texture> m_testTexture = nullptr;
+	std::unique_ptr<TextureStreamer> m_textureStreamer = nullptr;
+
+	std::shared_ptr<StreamedTexture> m_testTexture = nullptr;
+
+	// One bit per frame in flight whose descriptor set still points at the placeholder of the test texture
+	uint32_t m_staleTextureDescriptors = 0;
+
+	// Only created when the device supports descriptor indexing
+	std::unique_ptr<BindlessTextures> m_bindlessTextures = nullptr;
+
+	uint32_t m_testTextureIndex = BindlessTextures::s_defaultIndex;
+
+	std::unique_ptr<OpenGLShader> m_triangleShader = nullptr;
+
+	std::unique_ptr<ShaderModuleCache> m_shaderModuleCache = nullptr;
 
 	const std::vector<Vertex> m_vertices = {
 		{{-0.5f, -0.5f}, {1.0f, 0.0f, 0.0f}, {1.0f, 0.0f}},
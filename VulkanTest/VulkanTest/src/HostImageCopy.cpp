@@ -0,0 +1,430 @@
+﻿#define VULKAN_HPP_NO_CONSTRUCTORS
+
+#include "HostImageCopy.h"
+
+#include <algorithm>
+#include <cstring>
+#include <random>
+
+#include "HeadlessDevice.h"
+#include "PhysicalDevice.h"
+#include "Texture.h"
+#include "TextureUploadBatch.h"
+#include "Core/Log.h"
+#include "Core/Timer.h"
+
+/*
+ * The vendored Vulkan headers predate VK_EXT_host_image_copy, so the part of it that is used is declared here,
+ * as in the registry. Names differ from the ones of newer headers, so both can be included together.
+ */
+namespace
+{
+	constexpr const char* s_extensionName = "VK_EXT_host_image_copy";
+
+	constexpr auto s_structureTypeFeatures = static_cast<VkStructureType>(1000270000);
+	constexpr auto s_structureTypeProperties = static_cast<VkStructureType>(1000270001);
+	constexpr auto s_structureTypeMemoryToImageCopy = static_cast<VkStructureType>(1000270002);
+	constexpr auto s_structureTypeCopyMemoryToImageInfo = static_cast<VkStructureType>(1000270005);
+	constexpr auto s_structureTypeLayoutTransitionInfo = static_cast<VkStructureType>(1000270006);
+
+	constexpr VkImageUsageFlags s_imageUsageHostTransfer = 0x00400000;
+	constexpr VkFormatFeatureFlags2 s_formatFeatureHostTransfer = 0x400000000000ull;
+
+	struct HostImageCopyFeatures
+	{
+		VkStructureType sType;
+		void* pNext;
+		VkBool32 hostImageCopy;
+	};
+
+	struct HostImageCopyProperties
+	{
+		VkStructureType sType;
+		void* pNext;
+		uint32_t copySrcLayoutCount;
+		VkImageLayout* pCopySrcLayouts;
+		uint32_t copyDstLayoutCount;
+		VkImageLayout* pCopyDstLayouts;
+		uint8_t optimalTilingLayoutUUID[VK_UUID_SIZE];
+		VkBool32 identicalMemoryTypeRequirements;
+	};
+
+	struct MemoryToImageCopy
+	{
+		VkStructureType sType;
+		const void* pNext;
+		const void* pHostPointer;
+		uint32_t memoryRowLength;
+		uint32_t memoryImageHeight;
+		VkImageSubresourceLayers imageSubresource;
+		VkOffset3D imageOffset;
+		VkExtent3D imageExtent;
+	};
+
+	struct CopyMemoryToImageInfo
+	{
+		VkStructureType sType;
+		const void* pNext;
+		VkFlags flags;
+		VkImage dstImage;
+		VkImageLayout dstImageLayout;
+		uint32_t regionCount;
+		const MemoryToImageCopy* pRegions;
+	};
+
+	struct HostImageLayoutTransitionInfo
+	{
+		VkStructureType sType;
+		const void* pNext;
+		VkImage image;
+		VkImageLayout oldLayout;
+		VkImageLayout newLayout;
+		VkImageSubresourceRange subresourceRange;
+	};
+
+	using PFN_TransitionImageLayout = VkResult (VKAPI_PTR*)(VkDevice device,
+	                                                        uint32_t transition_count,
+	                                                        const HostImageLayoutTransitionInfo* transitions);
+
+	using PFN_CopyMemoryToImage = VkResult (VKAPI_PTR*)(VkDevice device, const CopyMemoryToImageInfo* copy_info);
+
+	PFN_TransitionImageLayout s_transitionImageLayout = nullptr;
+
+	PFN_CopyMemoryToImage s_copyMemoryToImage = nullptr;
+
+	// Chained into the device create info, so it has to outlive the device creation
+	HostImageCopyFeatures s_features{
+		.sType = s_structureTypeFeatures,
+		.pNext = nullptr,
+		.hostImageCopy = VK_TRUE
+	};
+}
+
+/**
+ * \brief Checks whether a device can copy into images from the host, straight into the layout textures are sampled in.
+ */
+bool HostImageCopy::IsSupported(const vk::PhysicalDevice physical_device)
+{
+	uint32_t extension_count;
+	physical_device.enumerateDeviceExtensionProperties(nullptr, &extension_count, nullptr);
+
+	std::vector<vk::ExtensionProperties> extensions(extension_count);
+	physical_device.enumerateDeviceExtensionProperties(nullptr, &extension_count, extensions.data());
+
+	const bool has_extension = std::ranges::any_of(extensions, [](const vk::ExtensionProperties& extension)
+	{
+		return strcmp(extension.extensionName, s_extensionName) == 0;
+	});
+
+	if (!has_extension)
+		return false;
+
+	HostImageCopyFeatures features{
+		.sType = s_structureTypeFeatures
+	};
+
+	VkPhysicalDeviceFeatures2 features_2{
+		.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_FEATURES_2,
+		.pNext = &features
+	};
+
+	vkGetPhysicalDeviceFeatures2(physical_device, &features_2);
+
+	if (!features.hostImageCopy)
+		return false;
+
+	// The first query only gets how many layouts there are
+	HostImageCopyProperties properties{
+		.sType = s_structureTypeProperties
+	};
+
+	VkPhysicalDeviceProperties2 properties_2{
+		.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_PROPERTIES_2,
+		.pNext = &properties
+	};
+
+	vkGetPhysicalDeviceProperties2(physical_device, &properties_2);
+
+	std::vector<VkImageLayout> destination_layouts(properties.copyDstLayoutCount);
+	properties.pCopyDstLayouts = destination_layouts.data();
+
+	vkGetPhysicalDeviceProperties2(physical_device, &properties_2);
+
+	return std::ranges::find(destination_layouts, VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL) !=
+	       destination_layouts.end();
+}
+
+/**
+ * \brief Checks whether uploads should bypass staging on a device, which is the case when it supports host copies
+ * and its image memory is host memory or shares the bus with it.
+ */
+bool HostImageCopy::IsPreferred(const vk::PhysicalDevice physical_device)
+{
+	return IsUnifiedMemory(physical_device) && IsSupported(physical_device);
+}
+
+/**
+ * \brief Adds the extension and its feature to the device that is about to be created, if the device prefers it.
+ * \param physical_device The physical device that the logical device is created from.
+ * \param extensions The device extensions, which get the extension added.
+ * \param next The current head of the feature chain of the device create info.
+ * \param only_if_preferred Whether to skip devices that support it but are faster with staging, see IsPreferred.
+ * \return The new head of the chain.
+ */
+const void* HostImageCopy::AddDeviceFeatures(const vk::PhysicalDevice physical_device,
+                                             std::vector<const char*>& extensions,
+                                             const void* next,
+                                             const bool only_if_preferred)
+{
+	s_requested = only_if_preferred ? IsPreferred(physical_device) : IsSupported(physical_device);
+
+	if (!s_requested)
+		return next;
+
+	extensions.push_back(s_extensionName);
+
+	s_features.pNext = const_cast<void*>(next);
+
+	return &s_features;
+}
+
+/**
+ * \brief Loads the functions of the extension, once the device was created with the features from AddDeviceFeatures.
+ */
+void HostImageCopy::Load(const vk::Device device)
+{
+	s_enabled = false;
+
+	if (!s_requested)
+		return;
+
+	s_transitionImageLayout = reinterpret_cast<PFN_TransitionImageLayout>(
+		device.getProcAddr("vkTransitionImageLayoutEXT"));
+
+	s_copyMemoryToImage = reinterpret_cast<PFN_CopyMemoryToImage>(device.getProcAddr("vkCopyMemoryToImageEXT"));
+
+	s_enabled = s_transitionImageLayout && s_copyMemoryToImage;
+
+	VK_CORE_INFO("Host image copy {0}", s_enabled ? "enabled, textures are uploaded without staging" : "unavailable");
+}
+
+/**
+ * \brief Checks whether optimal tiled images of a format can be written from the host.
+ */
+bool HostImageCopy::SupportsFormat(const vk::PhysicalDevice physical_device, const vk::Format format)
+{
+	VkFormatProperties3 properties_3{
+		.sType = VK_STRUCTURE_TYPE_FORMAT_PROPERTIES_3
+	};
+
+	VkFormatProperties2 properties_2{
+		.sType = VK_STRUCTURE_TYPE_FORMAT_PROPERTIES_2,
+		.pNext = &properties_3
+	};
+
+	vkGetPhysicalDeviceFormatProperties2(physical_device, static_cast<VkFormat>(format), &properties_2);
+
+	return properties_3.optimalTilingFeatures & s_formatFeatureHostTransfer;
+}
+
+/**
+ * \brief Gets the usage that images written from the host have to be created with.
+ */
+vk::ImageUsageFlags HostImageCopy::GetImageUsage()
+{
+	return vk::ImageUsageFlags(s_imageUsageHostTransfer);
+}
+
+/**
+ * \brief Writes every level and layer of a new image from host memory, and leaves it ready to be sampled.
+ * Nothing is submitted, the image can be used as soon as this returns.
+ * \param device The logical device, created with the extension enabled.
+ * \param image The image, created with the usage from GetImageUsage and still in the undefined layout.
+ * \param mip_levels The number of levels of the image.
+ * \param layer_count The number of layers of the image.
+ * \param data The pixels, laid out like a staging buffer.
+ * \param regions The copies into the image, with offsets into the pixels.
+ */
+void HostImageCopy::Upload(const vk::Device device,
+                           const vk::Image image,
+                           const uint32_t mip_levels,
+                           const uint32_t layer_count,
+                           const uint8_t* data,
+                           const std::vector<vk::BufferImageCopy>& regions)
+{
+	if (!s_enabled)
+		throw std::runtime_error("Host image copy is not enabled on this device!");
+
+	// Host copies can write into the final layout directly, so there is only one transition
+	const HostImageLayoutTransitionInfo transition{
+		.sType = s_structureTypeLayoutTransitionInfo,
+		.pNext = nullptr,
+		.image = image,
+		.oldLayout = VK_IMAGE_LAYOUT_UNDEFINED,
+		.newLayout = VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL,
+		.subresourceRange{
+			.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT,
+			.baseMipLevel = 0,
+			.levelCount = mip_levels,
+			.baseArrayLayer = 0,
+			.layerCount = layer_count
+		}
+	};
+
+	if (s_transitionImageLayout(device, 1, &transition) != VK_SUCCESS)
+		throw std::runtime_error("Failed to transition image on the host!");
+
+	std::vector<MemoryToImageCopy> copies;
+	copies.reserve(regions.size());
+
+	for (const vk::BufferImageCopy& region : regions)
+		copies.push_back(MemoryToImageCopy{
+			.sType = s_structureTypeMemoryToImageCopy,
+			.pNext = nullptr,
+			.pHostPointer = data + region.bufferOffset,
+			.memoryRowLength = region.bufferRowLength,
+			.memoryImageHeight = region.bufferImageHeight,
+			.imageSubresource = region.imageSubresource,
+			.imageOffset = region.imageOffset,
+			.imageExtent = region.imageExtent
+		});
+
+	const CopyMemoryToImageInfo copy_info{
+		.sType = s_structureTypeCopyMemoryToImageInfo,
+		.pNext = nullptr,
+		.flags = 0,
+		.dstImage = image,
+		.dstImageLayout = VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL,
+		.regionCount = static_cast<uint32_t>(copies.size()),
+		.pRegions = copies.data()
+	};
+
+	if (s_copyMemoryToImage(device, &copy_info) != VK_SUCCESS)
+		throw std::runtime_error("Failed to copy to image from the host!");
+}
+
+/**
+ * \brief Measures uploading images through a staging batch against writing them from the host, on a headless device
+ * that enables host copies wherever they are supported, preferred or not. The staged time includes creating the
+ * staging buffers, the copies on the queue and the wait for them, since a host copy replaces all of it.
+ * \param width The width of every image.
+ * \param height The height of every image.
+ * \param image_count How many images are uploaded with each method.
+ */
+void HostImageCopy::Benchmark(const uint32_t width, const uint32_t height, const uint32_t image_count)
+{
+	const HeadlessDevice headless(true);
+
+	const vk::Device device = headless.GetDevice();
+	const vk::PhysicalDevice physical_device = headless.GetPhysicalDevice();
+
+	constexpr vk::Format format = vk::Format::eR8G8B8A8Unorm;
+
+	const vk::DeviceSize image_size = static_cast<vk::DeviceSize>(width) * height * 4;
+
+	std::vector<uint8_t> pixels(image_size);
+
+	std::mt19937 random(1);
+	std::ranges::generate(pixels, [&random] { return static_cast<uint8_t>(random()); });
+
+	const vk::BufferImageCopy region{
+		.bufferOffset = 0,
+		.bufferRowLength = 0,
+		.bufferImageHeight = 0,
+		.imageSubresource{
+			.aspectMask = vk::ImageAspectFlagBits::eColor,
+			.mipLevel = 0,
+			.baseArrayLayer = 0,
+			.layerCount = 1
+		},
+		.imageOffset = {0, 0, 0},
+		.imageExtent = {width, height, 1}
+	};
+
+	// Gets the milliseconds that uploading every image took, without creating the images themselves
+	auto upload = [&](const bool from_host)
+	{
+		std::vector<vk::Image> images(image_count);
+		std::vector<vk::DeviceMemory> images_memory(image_count);
+
+		const vk::ImageUsageFlags usage = vk::ImageUsageFlagBits::eSampled |
+		                                  (from_host ? GetImageUsage() : vk::ImageUsageFlagBits::eTransferDst);
+
+		for (uint32_t i = 0; i < image_count; i++)
+			Texture::CreateImage(device, physical_device, width, height, 1, format, vk::ImageTiling::eOptimal, usage,
+			                     vk::MemoryPropertyFlagBits::eDeviceLocal, images[i], images_memory[i]);
+
+		const Timer timer;
+
+		if (from_host) {
+			for (const vk::Image image : images)
+				Upload(device, image, 1, 1, pixels.data(), {region});
+		} else {
+			TextureUploadBatch batch(device, physical_device, headless.GetCommandPool(), headless.GetQueue());
+
+			for (const vk::Image image : images) {
+				vk::Buffer staging_buffer;
+				vk::BufferImageCopy staged_region = region;
+
+				memcpy(batch.Allocate(image_size, format, staged_region.bufferOffset, staging_buffer), pixels.data(),
+				       image_size);
+
+				batch.Add(image, 1, 1, staging_buffer, {staged_region});
+			}
+
+			batch.Submit();
+		}
+
+		const float milliseconds = timer.ElapsedMillis();
+
+		for (uint32_t i = 0; i < image_count; i++) {
+			device.destroyImage(images[i], nullptr);
+			device.freeMemory(images_memory[i], nullptr);
+		}
+
+		return milliseconds;
+	};
+
+	const float total_mib = static_cast<float>(image_size * image_count) / (1024.0f * 1024.0f);
+
+	VK_CORE_INFO("Texture upload of {0} images of {1}x{2} ({3:.1f} MiB), {4} memory:", image_count, width, height,
+	             total_mib, IsUnifiedMemory(physical_device) ? "unified" : "separate video");
+
+	const float staged = upload(false);
+
+	VK_CORE_INFO("  Staged: {0:.2f} ms ({1:.0f} MiB/s)", staged, total_mib / (staged * 0.001f));
+
+	if (!s_enabled || !SupportsFormat(physical_device, format)) {
+		VK_CORE_INFO("  Host copy: not supported by this device");
+		return;
+	}
+
+	const float host = upload(true);
+
+	VK_CORE_INFO("  Host copy: {0:.2f} ms ({1:.0f} MiB/s), {2}", host, total_mib / (host * 0.001f),
+	             IsPreferred(physical_device) ? "used for textures" : "not used for textures on this device");
+}
+
+/**
+ * \brief Checks whether the device has no separate video memory: software rasterizers and integrated GPUs,
+ * or any device whose device local memory can all be mapped.
+ */
+bool HostImageCopy::IsUnifiedMemory(const vk::PhysicalDevice physical_device)
+{
+	const vk::PhysicalDeviceType type = PhysicalDevice::GetProperties(physical_device).deviceType;
+
+	if (type == vk::PhysicalDeviceType::eCpu || type == vk::PhysicalDeviceType::eIntegratedGpu)
+		return true;
+
+	vk::PhysicalDeviceMemoryProperties memory_properties;
+	physical_device.getMemoryProperties(&memory_properties);
+
+	for (uint32_t i = 0; i < memory_properties.memoryTypeCount; i++) {
+		const vk::MemoryPropertyFlags flags = memory_properties.memoryTypes[i].propertyFlags;
+
+		if (flags & vk::MemoryPropertyFlagBits::eDeviceLocal && !(flags & vk::MemoryPropertyFlagBits::eHostVisible))
+			return false;
+	}
+
+	return true;
+}
@@ -0,0 +1,49 @@
+﻿#pragma once
+#include <vector>
+#include <vulkan/vulkan.hpp>
+
+/**
+ * \brief Uploads to images straight from the CPU through VK_EXT_host_image_copy, without a staging buffer or a queue
+ * submission. Only used where the image memory is close to the CPU anyway (integrated, unified memory and software
+ * devices), since on discrete GPUs the copy engine is faster than writing across the bus.
+ * The extension is declared in the source file and its functions are loaded from the device, since the vendored
+ * Vulkan headers predate it.
+ */
+class HostImageCopy
+{
+public:
+	static bool IsSupported(vk::PhysicalDevice physical_device);
+
+	static bool IsPreferred(vk::PhysicalDevice physical_device);
+
+	static const void* AddDeviceFeatures(vk::PhysicalDevice physical_device,
+	                                     std::vector<const char*>& extensions,
+	                                     const void* next,
+	                                     bool only_if_preferred = true);
+
+	static void Load(vk::Device device);
+
+	[[nodiscard]] static bool IsEnabled() { return s_enabled; }
+
+	static bool SupportsFormat(vk::PhysicalDevice physical_device, vk::Format format);
+
+	static vk::ImageUsageFlags GetImageUsage();
+
+	static void Upload(vk::Device device,
+	                   vk::Image image,
+	                   uint32_t mip_levels,
+	                   uint32_t layer_count,
+	                   const uint8_t* data,
+	                   const std::vector<vk::BufferImageCopy>& regions);
+
+	static void Benchmark(uint32_t width, uint32_t height, uint32_t image_count);
+
+private:
+	static bool IsUnifiedMemory(vk::PhysicalDevice physical_device);
+
+	// Whether the extension was added to the features of the device being created
+	inline static bool s_requested = false;
+
+	// Whether the device was created with the extension, and its functions were loaded
+	inline static bool s_enabled = false;
+};
@@ -0,0 +1,305 @@
+﻿#define VULKAN_HPP_NO_CONSTRUCTORS
+
+#include "Image.h"
+
+#include "Buffer.h"
+
+/**
+ * \brief Creates an image and binds it to its own memory, after checking that the device supports its shape.
+ * \param device The logical device.
+ * \param physical_device The physical device, used to check the limits of the format and to find memory.
+ * \param specification What the image looks like.
+ * \param image Gets the created image.
+ * \param image_memory Gets the memory bound to the image.
+ */
+void Image::Create(const vk::Device device,
+                   const vk::PhysicalDevice physical_device,
+                   const ImageSpecification& specification,
+                   vk::Image& image,
+                   vk::DeviceMemory& image_memory)
+{
+	Validate(physical_device, specification);
+
+	vk::ImageCreateFlags flags;
+
+	if (specification.viewType == vk::ImageViewType::eCube || specification.viewType == vk::ImageViewType::eCubeArray)
+		flags |= vk::ImageCreateFlagBits::eCubeCompatible;
+
+	vk::ImageCreateInfo image_info{
+		.flags = flags,
+		.imageType = GetImageType(specification.viewType),
+		.format = specification.format,
+		.extent{
+			.width = specification.width,
+			.height = specification.height,
+			.depth = specification.depth
+		},
+		.mipLevels = specification.mipLevels,
+		.arrayLayers = specification.arrayLayers,
+		.samples = specification.samples,
+		.tiling = specification.tiling,
+		.usage = specification.usage,
+		.sharingMode = vk::SharingMode::eExclusive,
+		.initialLayout = vk::ImageLayout::eUndefined,
+	};
+
+	if (device.createImage(&image_info, nullptr, &image) != vk::Result::eSuccess)
+		throw std::runtime_error("Failed to create image!");
+
+	vk::MemoryRequirements mem_requirements;
+	device.getImageMemoryRequirements(image, &mem_requirements);
+
+	vk::MemoryAllocateInfo alloc_info{
+		.allocationSize = mem_requirements.size,
+		.memoryTypeIndex = Buffer::FindMemoryType(mem_requirements.memoryTypeBits,
+		                                          specification.memoryProperties, physical_device)
+	};
+
+	if (device.allocateMemory(&alloc_info, nullptr, &image_memory) != vk::Result::eSuccess) {
+		device.destroyImage(image, nullptr);
+		throw std::runtime_error("Failed to allocate image memory!");
+	}
+
+	device.bindImageMemory(image, image_memory, 0);
+}
+
+/**
+ * \brief Creates a view of every level and layer of an image, with the view type it was specified with.
+ */
+vk::ImageView Image::CreateView(const vk::Device device, const vk::Image image, const ImageSpecification& specification)
+{
+	return CreateView(device, image, specification.viewType, specification.format, GetFullRange(specification));
+}
+
+/**
+ * \brief Creates a view of part of an image, e.g. a single face of a cube map or a single level to render into.
+ * \param device The logical device.
+ * \param image The image to view.
+ * \param view_type How the levels and layers are interpreted.
+ * \param format The format of the view, which can differ from the image if it was created mutable.
+ * \param range The levels and layers that the view covers.
+ * \return The created view.
+ */
+vk::ImageView Image::CreateView(const vk::Device device,
+                                const vk::Image image,
+                                const vk::ImageViewType view_type,
+                                const vk::Format format,
+                                const vk::ImageSubresourceRange& range)
+{
+	vk::ImageViewCreateInfo view_info{
+		.image = image,
+		.viewType = view_type,
+		.format = format,
+		.subresourceRange = range
+	};
+
+	vk::ImageView image_view;
+
+	if (device.createImageView(&view_info, nullptr, &image_view) != vk::Result::eSuccess)
+		throw std::runtime_error("Failed to create texture image view!");
+
+	return image_view;
+}
+
+/**
+ * \brief Records a layout transition of any range of an image. The stages and accesses on both sides of the barrier
+ * follow from the layouts, so work that used the old layout finishes before work in the new one starts.
+ * \param command_buffer The command buffer that is being recorded.
+ * \param image The image to transition.
+ * \param old_layout The layout that the range is in, or undefined to discard its contents.
+ * \param new_layout The layout that the range ends up in.
+ * \param range The levels and layers to transition.
+ */
+void Image::RecordLayoutTransition(const vk::CommandBuffer command_buffer,
+                                   const vk::Image image,
+                                   const vk::ImageLayout old_layout,
+                                   const vk::ImageLayout new_layout,
+                                   const vk::ImageSubresourceRange& range)
+{
+	const LayoutAccess source = GetLayoutAccess(old_layout, true);
+	const LayoutAccess destination = GetLayoutAccess(new_layout, false);
+
+	vk::ImageMemoryBarrier barrier{
+		.srcAccessMask = source.access,
+		.dstAccessMask = destination.access,
+		.oldLayout = old_layout,
+		.newLayout = new_layout,
+		.srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED,
+		.dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED,
+		.image = image,
+		.subresourceRange = range
+	};
+
+	command_buffer.pipelineBarrier(source.stages, destination.stages, {}, 0, nullptr, 0, nullptr, 1, &barrier);
+}
+
+/**
+ * \brief Transitions any range of an image in its own submission, and waits for it to finish.
+ * Prefer recording the transition next to the work that needs it, this is meant for one-off setup.
+ */
+void Image::TransitionLayout(const vk::Device device,
+                             const vk::CommandPool command_pool,
+                             const vk::Queue queue,
+                             const vk::Image image,
+                             const vk::ImageLayout old_layout,
+                             const vk::ImageLayout new_layout,
+                             const vk::ImageSubresourceRange& range)
+{
+	vk::CommandBuffer command_buffer = Buffer::BeginSingleTimeCommands(device, command_pool);
+
+	RecordLayoutTransition(command_buffer, image, old_layout, new_layout, range);
+
+	Buffer::EndSingleTimeCommands(device, command_pool, queue, command_buffer);
+}
+
+vk::ImageSubresourceRange Image::GetFullRange(const ImageSpecification& specification)
+{
+	return vk::ImageSubresourceRange{
+		.aspectMask = GetAspectMask(specification.format),
+		.baseMipLevel = 0,
+		.levelCount = specification.mipLevels,
+		.baseArrayLayer = 0,
+		.layerCount = specification.arrayLayers
+	};
+}
+
+vk::ImageAspectFlags Image::GetAspectMask(const vk::Format format)
+{
+	switch (format) {
+		case vk::Format::eD16Unorm:
+		case vk::Format::eX8D24UnormPack32:
+		case vk::Format::eD32Sfloat:
+			return vk::ImageAspectFlagBits::eDepth;
+
+		case vk::Format::eS8Uint:
+			return vk::ImageAspectFlagBits::eStencil;
+
+		case vk::Format::eD16UnormS8Uint:
+		case vk::Format::eD24UnormS8Uint:
+		case vk::Format::eD32SfloatS8Uint:
+			return vk::ImageAspectFlagBits::eDepth | vk::ImageAspectFlagBits::eStencil;
+
+		default:
+			return vk::ImageAspectFlagBits::eColor;
+	}
+}
+
+vk::ImageType Image::GetImageType(const vk::ImageViewType view_type)
+{
+	switch (view_type) {
+		case vk::ImageViewType::e1D:
+		case vk::ImageViewType::e1DArray:
+			return vk::ImageType::e1D;
+
+		case vk::ImageViewType::e3D:
+			return vk::ImageType::e3D;
+
+		default:
+			return vk::ImageType::e2D;
+	}
+}
+
+/**
+ * \brief Gets the stages and accesses that use an image in a layout.
+ * \param layout The layout.
+ * \param source Whether the layout is the one being left, in which case undefined and present need nothing to finish.
+ */
+Image::LayoutAccess Image::GetLayoutAccess(const vk::ImageLayout layout, const bool source)
+{
+	switch (layout) {
+		case vk::ImageLayout::eUndefined:
+		case vk::ImageLayout::ePreinitialized:
+			return {vk::PipelineStageFlagBits::eTopOfPipe, vk::AccessFlagBits::eNone};
+
+		case vk::ImageLayout::eTransferDstOptimal:
+			return {vk::PipelineStageFlagBits::eTransfer, vk::AccessFlagBits::eTransferWrite};
+
+		case vk::ImageLayout::eTransferSrcOptimal:
+			return {vk::PipelineStageFlagBits::eTransfer, vk::AccessFlagBits::eTransferRead};
+
+		case vk::ImageLayout::eShaderReadOnlyOptimal:
+			return {
+				vk::PipelineStageFlagBits::eVertexShader | vk::PipelineStageFlagBits::eFragmentShader |
+				vk::PipelineStageFlagBits::eComputeShader,
+				vk::AccessFlagBits::eShaderRead
+			};
+
+		case vk::ImageLayout::eColorAttachmentOptimal:
+			return {
+				vk::PipelineStageFlagBits::eColorAttachmentOutput,
+				vk::AccessFlagBits::eColorAttachmentRead | vk::AccessFlagBits::eColorAttachmentWrite
+			};
+
+		case vk::ImageLayout::eDepthStencilAttachmentOptimal:
+			return {
+				vk::PipelineStageFlagBits::eEarlyFragmentTests | vk::PipelineStageFlagBits::eLateFragmentTests,
+				vk::AccessFlagBits::eDepthStencilAttachmentRead | vk::AccessFlagBits::eDepthStencilAttachmentWrite
+			};
+
+		case vk::ImageLayout::eDepthStencilReadOnlyOptimal:
+			return {
+				vk::PipelineStageFlagBits::eEarlyFragmentTests | vk::PipelineStageFlagBits::eFragmentShader,
+				vk::AccessFlagBits::eDepthStencilAttachmentRead | vk::AccessFlagBits::eShaderRead
+			};
+
+		case vk::ImageLayout::ePresentSrcKHR:
+			// Presentation is ordered by semaphores, which the barrier only has to chain onto
+			return {
+				source ? vk::PipelineStageFlagBits::eTopOfPipe : vk::PipelineStageFlagBits::eBottomOfPipe,
+				vk::AccessFlagBits::eNone
+			};
+
+		default:
+			// Layouts like general can be used by anything, so everything is waited for
+			return {
+				vk::PipelineStageFlagBits::eAllCommands,
+				vk::AccessFlagBits::eMemoryRead | vk::AccessFlagBits::eMemoryWrite
+			};
+	}
+}
+
+/**
+ * \brief Checks a specification against the rules of its view type and the limits of the device for its format,
+ * so that mistakes show up as a readable error rather than a validation message or a crash in the driver.
+ */
+void Image::Validate(const vk::PhysicalDevice physical_device, const ImageSpecification& specification)
+{
+	const vk::ImageViewType view_type = specification.viewType;
+	const bool cube = view_type == vk::ImageViewType::eCube || view_type == vk::ImageViewType::eCubeArray;
+
+	if (cube && (specification.width != specification.height || specification.arrayLayers % 6 != 0))
+		throw std::invalid_argument("Cube map faces must be square, with six layers per cube!");
+
+	if (view_type == vk::ImageViewType::e3D && specification.arrayLayers != 1)
+		throw std::invalid_argument("3D images can't have array layers!");
+
+	if (view_type != vk::ImageViewType::e3D && specification.depth != 1)
+		throw std::invalid_argument("Only 3D images can have a depth!");
+
+	if (specification.samples != vk::SampleCountFlagBits::e1 &&
+	    (specification.mipLevels != 1 || GetImageType(view_type) != vk::ImageType::e2D ||
+	     specification.tiling != vk::ImageTiling::eOptimal))
+		throw std::invalid_argument("Multisampled images must be optimal 2D images with a single mip level!");
+
+	vk::ImageCreateFlags flags;
+
+	if (cube)
+		flags |= vk::ImageCreateFlagBits::eCubeCompatible;
+
+	vk::ImageFormatProperties properties;
+
+	if (physical_device.getImageFormatProperties(specification.format, GetImageType(view_type), specification.tiling,
+	                                             specification.usage, flags, &properties) != vk::Result::eSuccess)
+		throw std::runtime_error("Image format " + vk::to_string(specification.format) +
+		                         " is not supported for this usage!");
+
+	if (specification.width > properties.maxExtent.width || specification.height > properties.maxExtent.height ||
+	    specification.depth > properties.maxExtent.depth)
+		throw std::runtime_error("Image is larger than the device supports!");
+
+	if (specification.mipLevels > properties.maxMipLevels || specification.arrayLayers > properties.maxArrayLayers)
+		throw std::runtime_error("Image has more mip levels or layers than the device supports!");
+
+	if (!(properties.sampleCounts & specification.samples))
+		throw std::runtime_error("Image sample count is not supported by the device!");
+}
@@ -0,0 +1,85 @@
+﻿#pragma once
+#include <vulkan/vulkan.hpp>
+
+// Everything that describes an image, for any kind of texture or attachment
+struct ImageSpecification
+{
+	// Also decides the image type, and for cube views the compatibility flag
+	vk::ImageViewType viewType = vk::ImageViewType::e2D;
+
+	vk::Format format = vk::Format::eR8G8B8A8Srgb;
+
+	uint32_t width = 1;
+
+	uint32_t height = 1;
+
+	// Only above 1 for 3D images
+	uint32_t depth = 1;
+
+	uint32_t mipLevels = 1;
+
+	// Six per cube for cube views
+	uint32_t arrayLayers = 1;
+
+	vk::SampleCountFlagBits samples = vk::SampleCountFlagBits::e1;
+
+	vk::ImageTiling tiling = vk::ImageTiling::eOptimal;
+
+	vk::ImageUsageFlags usage = vk::ImageUsageFlagBits::eTransferDst | vk::ImageUsageFlagBits::eSampled;
+
+	vk::MemoryPropertyFlags memoryProperties = vk::MemoryPropertyFlagBits::eDeviceLocal;
+};
+
+/**
+ * \brief Creates images of every shape (1D, 2D, arrays, cube maps, 3D volumes, multisampled), their views,
+ * and layout transitions over any range of their levels and layers.
+ */
+class Image
+{
+public:
+	static void Create(vk::Device device,
+	                   vk::PhysicalDevice physical_device,
+	                   const ImageSpecification& specification,
+	                   vk::Image& image,
+	                   vk::DeviceMemory& image_memory);
+
+	static vk::ImageView CreateView(vk::Device device, vk::Image image, const ImageSpecification& specification);
+
+	static vk::ImageView CreateView(vk::Device device,
+	                                vk::Image image,
+	                                vk::ImageViewType view_type,
+	                                vk::Format format,
+	                                const vk::ImageSubresourceRange& range);
+
+	static void RecordLayoutTransition(vk::CommandBuffer command_buffer,
+	                                   vk::Image image,
+	                                   vk::ImageLayout old_layout,
+	                                   vk::ImageLayout new_layout,
+	                                   const vk::ImageSubresourceRange& range);
+
+	static void TransitionLayout(vk::Device device,
+	                             vk::CommandPool command_pool,
+	                             vk::Queue queue,
+	                             vk::Image image,
+	                             vk::ImageLayout old_layout,
+	                             vk::ImageLayout new_layout,
+	                             const vk::ImageSubresourceRange& range);
+
+	static vk::ImageSubresourceRange GetFullRange(const ImageSpecification& specification);
+
+	static vk::ImageAspectFlags GetAspectMask(vk::Format format);
+
+	static vk::ImageType GetImageType(vk::ImageViewType view_type);
+
+private:
+	struct LayoutAccess
+	{
+		vk::PipelineStageFlags stages;
+
+		vk::AccessFlags access;
+	};
+
+	static LayoutAccess GetLayoutAccess(vk::ImageLayout layout, bool source);
+
+	static void Validate(vk::PhysicalDevice physical_device, const ImageSpecification& specification);
+};
@@ -0,0 +1,626 @@
+﻿#include "ImageKernels.h"
+
+#include <algorithm>
+#include <atomic>
+#include <bit>
+#include <cmath>
+#include <cstring>
+#include <random>
+#include <stdexcept>
+#include <vector>
+
+#include "Core/Log.h"
+#include "Core/Timer.h"
+
+#if defined(_M_X64) || defined(__SSE2__) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#define IMAGE_KERNELS_SSE2
+#include <immintrin.h>
+
+// SSSE3 and AVX2 paths are compiled regardless of the target flags, and only called when the CPU has them
+#if defined(_MSC_VER) && !defined(__clang__)
+#include <intrin.h>
+#define IMAGE_KERNELS_TARGET(instruction_set)
+#else
+#include <cpuid.h>
+#define IMAGE_KERNELS_TARGET(instruction_set) __attribute__((target(instruction_set)))
+#endif
+#endif
+
+namespace
+{
+	SimdLevel DetectSimdLevel()
+	{
+#ifdef IMAGE_KERNELS_SSE2
+#if defined(_MSC_VER) && !defined(__clang__)
+		int info[4];
+
+		__cpuid(info, 0);
+		const int max_leaf = info[0];
+
+		__cpuid(info, 1);
+		const bool ssse3 = info[2] & 1 << 9;
+		const bool os_avx = (info[2] & 1 << 27) && (info[2] & 1 << 28) && (_xgetbv(0) & 6) == 6;
+
+		bool avx2 = false;
+
+		if (max_leaf >= 7) {
+			__cpuidex(info, 7, 0);
+			avx2 = os_avx && info[1] & 1 << 5;
+		}
+
+		return avx2 ? SimdLevel::Avx2 : ssse3 ? SimdLevel::Ssse3 : SimdLevel::Scalar;
+#else
+		__builtin_cpu_init();
+
+		return __builtin_cpu_supports("avx2")
+			       ? SimdLevel::Avx2
+			       : __builtin_cpu_supports("ssse3")
+			       ? SimdLevel::Ssse3
+			       : SimdLevel::Scalar;
+#endif
+#else
+		return SimdLevel::Scalar;
+#endif
+	}
+
+	const SimdLevel s_supportedSimdLevel = DetectSimdLevel();
+
+	std::atomic s_simdLevel = s_supportedSimdLevel;
+
+	// Rounds c * a / 255 to nearest without a division, exact for every 8 bit pair
+	uint8_t MultiplyUnorm8(const uint32_t c, const uint32_t a)
+	{
+		const uint32_t product = c * a + 128;
+		return static_cast<uint8_t>((product + (product >> 8)) >> 8);
+	}
+
+	const std::array<uint16_t, 256>& GetSrgbToLinearTable()
+	{
+		static const std::array<uint16_t, 256> table = []
+		{
+			std::array<uint16_t, 256> values{};
+
+			for (uint32_t i = 0; i < 256; i++) {
+				const double srgb = i / 255.0;
+				const double linear = srgb <= 0.04045 ? srgb / 12.92 : std::pow((srgb + 0.055) / 1.055, 2.4);
+
+				values[i] = static_cast<uint16_t>(std::lround(linear * 65535.0));
+			}
+
+			return values;
+		}();
+
+		return table;
+	}
+
+#ifdef IMAGE_KERNELS_SSE2
+	// Shuffle that spreads four RGB pixels over four RGBA pixels, leaving alpha zero
+	const __m128i s_rgbToRgbaMask = _mm_setr_epi8(0, 1, 2, -1, 3, 4, 5, -1, 6, 7, 8, -1, 9, 10, 11, -1);
+
+	IMAGE_KERNELS_TARGET("ssse3")
+	size_t ExpandRgbToRgba8Ssse3(const uint8_t* source, const size_t pixel_count, uint8_t* destination)
+	{
+		const __m128i alpha = _mm_set1_epi32(static_cast<int>(0xFF000000));
+
+		size_t i = 0;
+
+		// Each load reads 16 bytes for 12 used ones, so the last pixels are left to the scalar loop
+		for (; i + 6 <= pixel_count; i += 4) {
+			const __m128i rgb = _mm_loadu_si128(reinterpret_cast<const __m128i*>(source + i * 3));
+			const __m128i rgba = _mm_or_si128(_mm_shuffle_epi8(rgb, s_rgbToRgbaMask), alpha);
+
+			_mm_storeu_si128(reinterpret_cast<__m128i*>(destination + i * 4), rgba);
+		}
+
+		return i;
+	}
+
+	IMAGE_KERNELS_TARGET("avx2")
+	size_t ExpandRgbToRgba8Avx2(const uint8_t* source, const size_t pixel_count, uint8_t* destination)
+	{
+		const __m256i mask = _mm256_broadcastsi128_si256(s_rgbToRgbaMask);
+		const __m256i alpha = _mm256_set1_epi32(static_cast<int>(0xFF000000));
+
+		size_t i = 0;
+
+		for (; i + 10 <= pixel_count; i += 8) {
+			const __m128i low = _mm_loadu_si128(reinterpret_cast<const __m128i*>(source + i * 3));
+			const __m128i high = _mm_loadu_si128(reinterpret_cast<const __m128i*>(source + i * 3 + 12));
+
+			const __m256i rgb = _mm256_inserti128_si256(_mm256_castsi128_si256(low), high, 1);
+			const __m256i rgba = _mm256_or_si256(_mm256_shuffle_epi8(rgb, mask), alpha);
+
+			_mm256_storeu_si256(reinterpret_cast<__m256i*>(destination + i * 4), rgba);
+		}
+
+		return i;
+	}
+
+	IMAGE_KERNELS_TARGET("ssse3")
+	size_t SwizzleRgba8Ssse3(const uint8_t* source, const size_t pixel_count, const __m128i mask, uint8_t* destination)
+	{
+		size_t i = 0;
+
+		for (; i + 4 <= pixel_count; i += 4) {
+			const __m128i pixels = _mm_loadu_si128(reinterpret_cast<const __m128i*>(source + i * 4));
+			_mm_storeu_si128(reinterpret_cast<__m128i*>(destination + i * 4), _mm_shuffle_epi8(pixels, mask));
+		}
+
+		return i;
+	}
+
+	IMAGE_KERNELS_TARGET("avx2")
+	size_t SwizzleRgba8Avx2(const uint8_t* source, const size_t pixel_count, const __m128i mask, uint8_t* destination)
+	{
+		const __m256i wide_mask = _mm256_broadcastsi128_si256(mask);
+
+		size_t i = 0;
+
+		for (; i + 8 <= pixel_count; i += 8) {
+			const __m256i pixels = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(source + i * 4));
+			_mm256_storeu_si256(reinterpret_cast<__m256i*>(destination + i * 4), _mm256_shuffle_epi8(pixels, wide_mask));
+		}
+
+		return i;
+	}
+
+	// Multiplies the color of two pixels held as 16 bit channels by their alpha, with the same rounding as MultiplyUnorm8
+	__m128i PremultiplySse2(const __m128i pixels)
+	{
+		__m128i alpha = _mm_shufflelo_epi16(pixels, _MM_SHUFFLE(3, 3, 3, 3));
+		alpha = _mm_shufflehi_epi16(alpha, _MM_SHUFFLE(3, 3, 3, 3));
+
+		const __m128i product = _mm_add_epi16(_mm_mullo_epi16(pixels, alpha), _mm_set1_epi16(128));
+
+		return _mm_srli_epi16(_mm_add_epi16(product, _mm_srli_epi16(product, 8)), 8);
+	}
+
+	size_t PremultiplyAlphaRgba8Sse2(const uint8_t* source, const size_t pixel_count, uint8_t* destination)
+	{
+		const __m128i zero = _mm_setzero_si128();
+		const __m128i alpha_mask = _mm_set1_epi32(static_cast<int>(0xFF000000));
+
+		size_t i = 0;
+
+		for (; i + 4 <= pixel_count; i += 4) {
+			const __m128i pixels = _mm_loadu_si128(reinterpret_cast<const __m128i*>(source + i * 4));
+
+			const __m128i low = PremultiplySse2(_mm_unpacklo_epi8(pixels, zero));
+			const __m128i high = PremultiplySse2(_mm_unpackhi_epi8(pixels, zero));
+
+			// The multiplied alpha is thrown away, and the original one kept
+			const __m128i color = _mm_andnot_si128(alpha_mask, _mm_packus_epi16(low, high));
+
+			_mm_storeu_si128(reinterpret_cast<__m128i*>(destination + i * 4),
+			                 _mm_or_si128(color, _mm_and_si128(pixels, alpha_mask)));
+		}
+
+		return i;
+	}
+
+	IMAGE_KERNELS_TARGET("avx2")
+	__m256i PremultiplyAvx2(const __m256i pixels)
+	{
+		__m256i alpha = _mm256_shufflelo_epi16(pixels, _MM_SHUFFLE(3, 3, 3, 3));
+		alpha = _mm256_shufflehi_epi16(alpha, _MM_SHUFFLE(3, 3, 3, 3));
+
+		const __m256i product = _mm256_add_epi16(_mm256_mullo_epi16(pixels, alpha), _mm256_set1_epi16(128));
+
+		return _mm256_srli_epi16(_mm256_add_epi16(product, _mm256_srli_epi16(product, 8)), 8);
+	}
+
+	IMAGE_KERNELS_TARGET("avx2")
+	size_t PremultiplyAlphaRgba8Avx2(const uint8_t* source, const size_t pixel_count, uint8_t* destination)
+	{
+		const __m256i zero = _mm256_setzero_si256();
+		const __m256i alpha_mask = _mm256_set1_epi32(static_cast<int>(0xFF000000));
+
+		size_t i = 0;
+
+		for (; i + 8 <= pixel_count; i += 8) {
+			const __m256i pixels = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(source + i * 4));
+
+			// Unpacking and packing both work per 128 bit lane, so the pixels come back in their original order
+			const __m256i low = PremultiplyAvx2(_mm256_unpacklo_epi8(pixels, zero));
+			const __m256i high = PremultiplyAvx2(_mm256_unpackhi_epi8(pixels, zero));
+
+			const __m256i color = _mm256_andnot_si256(alpha_mask, _mm256_packus_epi16(low, high));
+
+			_mm256_storeu_si256(reinterpret_cast<__m256i*>(destination + i * 4),
+			                    _mm256_or_si256(color, _mm256_and_si256(pixels, alpha_mask)));
+		}
+
+		return i;
+	}
+
+	// Two destination pixels per iteration, from four source pixels of each row
+	uint32_t DownsampleRowSse2(const uint8_t* row_0,
+	                           const uint8_t* row_1,
+	                           const uint32_t width,
+	                           const uint32_t source_width,
+	                           uint8_t* output)
+	{
+		const __m128i zero = _mm_setzero_si128();
+		const __m128i rounding = _mm_set1_epi16(2);
+
+		uint32_t x = 0;
+
+		for (; x + 2 <= width && x * 2 + 4 <= source_width; x += 2) {
+			const __m128i top = _mm_loadu_si128(reinterpret_cast<const __m128i*>(row_0 + x * 8));
+			const __m128i bottom = _mm_loadu_si128(reinterpret_cast<const __m128i*>(row_1 + x * 8));
+
+			// Vertical sums of pixels 0-1 and 2-3, as 16 bit channels
+			const __m128i low = _mm_add_epi16(_mm_unpacklo_epi8(top, zero), _mm_unpacklo_epi8(bottom, zero));
+			const __m128i high = _mm_add_epi16(_mm_unpackhi_epi8(top, zero), _mm_unpackhi_epi8(bottom, zero));
+
+			// Horizontal sums, pixel 0 + 1 and pixel 2 + 3
+			const __m128i sum_low = _mm_add_epi16(low, _mm_srli_si128(low, 8));
+			const __m128i sum_high = _mm_add_epi16(high, _mm_srli_si128(high, 8));
+
+			__m128i sum = _mm_unpacklo_epi64(sum_low, sum_high);
+			sum = _mm_srli_epi16(_mm_add_epi16(sum, rounding), 2);
+
+			_mm_storel_epi64(reinterpret_cast<__m128i*>(output + x * 4), _mm_packus_epi16(sum, zero));
+		}
+
+		return x;
+	}
+
+	// Four destination pixels per iteration, the same steps as the SSE2 version in each 128 bit lane
+	IMAGE_KERNELS_TARGET("avx2")
+	uint32_t DownsampleRowAvx2(const uint8_t* row_0,
+	                           const uint8_t* row_1,
+	                           const uint32_t width,
+	                           const uint32_t source_width,
+	                           uint8_t* output)
+	{
+		const __m256i zero = _mm256_setzero_si256();
+		const __m256i rounding = _mm256_set1_epi16(2);
+
+		uint32_t x = 0;
+
+		for (; x + 4 <= width && x * 2 + 8 <= source_width; x += 4) {
+			const __m256i top = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(row_0 + x * 8));
+			const __m256i bottom = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(row_1 + x * 8));
+
+			const __m256i low = _mm256_add_epi16(_mm256_unpacklo_epi8(top, zero), _mm256_unpacklo_epi8(bottom, zero));
+			const __m256i high = _mm256_add_epi16(_mm256_unpackhi_epi8(top, zero),
+			                                      _mm256_unpackhi_epi8(bottom, zero));
+
+			const __m256i sum_low = _mm256_add_epi16(low, _mm256_srli_si256(low, 8));
+			const __m256i sum_high = _mm256_add_epi16(high, _mm256_srli_si256(high, 8));
+
+			__m256i sum = _mm256_unpacklo_epi64(sum_low, sum_high);
+			sum = _mm256_srli_epi16(_mm256_add_epi16(sum, rounding), 2);
+
+			// Each lane packed its two pixels into its low half, which are brought together into the low lane
+			const __m256i packed = _mm256_permute4x64_epi64(_mm256_packus_epi16(sum, zero), _MM_SHUFFLE(3, 1, 2, 0));
+
+			_mm_storeu_si128(reinterpret_cast<__m128i*>(output + x * 4), _mm256_castsi256_si128(packed));
+		}
+
+		return x;
+	}
+#endif
+}
+
+/**
+ * \brief Converts decoded pixels with any channel count to RGBA8, e.g. straight from stb into mapped staging memory.
+ * Grey is replicated into RGB, and missing alpha becomes opaque.
+ * \param source The tightly packed source pixels.
+ * \param channels The number of 8 bit channels of the source, 1 to 4.
+ * \param pixel_count The number of pixels.
+ * \param destination Gets pixel_count RGBA8 pixels.
+ */
+void ImageKernels::ExpandToRgba8(const uint8_t* source,
+                                 const uint32_t channels,
+                                 const size_t pixel_count,
+                                 uint8_t* destination)
+{
+	switch (channels) {
+		case 4:
+			memcpy(destination, source, pixel_count * 4);
+			break;
+
+		case 3:
+			ExpandRgbToRgba8(source, pixel_count, destination);
+			break;
+
+		case 2:
+			for (size_t i = 0; i < pixel_count; i++) {
+				memset(destination + i * 4, source[i * 2], 3);
+				destination[i * 4 + 3] = source[i * 2 + 1];
+			}
+			break;
+
+		case 1:
+			for (size_t i = 0; i < pixel_count; i++) {
+				memset(destination + i * 4, source[i], 3);
+				destination[i * 4 + 3] = 255;
+			}
+			break;
+
+		default:
+			throw std::invalid_argument("Images must have 1 to 4 channels!");
+	}
+}
+
+/**
+ * \brief Adds an opaque alpha channel to RGB8 pixels.
+ * \param source The tightly packed RGB8 pixels.
+ * \param pixel_count The number of pixels.
+ * \param destination Gets pixel_count RGBA8 pixels, and must not overlap the source.
+ */
+void ImageKernels::ExpandRgbToRgba8(const uint8_t* source, const size_t pixel_count, uint8_t* destination)
+{
+	size_t i = 0;
+
+#ifdef IMAGE_KERNELS_SSE2
+	if (GetSimdLevel() == SimdLevel::Avx2)
+		i = ExpandRgbToRgba8Avx2(source, pixel_count, destination);
+	else if (GetSimdLevel() == SimdLevel::Ssse3)
+		i = ExpandRgbToRgba8Ssse3(source, pixel_count, destination);
+#endif
+
+	for (; i < pixel_count; i++) {
+		destination[i * 4 + 0] = source[i * 3 + 0];
+		destination[i * 4 + 1] = source[i * 3 + 1];
+		destination[i * 4 + 2] = source[i * 3 + 2];
+		destination[i * 4 + 3] = 255;
+	}
+}
+
+/**
+ * \brief Reorders the channels of RGBA8 pixels, e.g. {2, 1, 0, 3} to convert between RGBA and BGRA.
+ * \param source The tightly packed source pixels.
+ * \param pixel_count The number of pixels.
+ * \param order For each destination channel, the source channel that it is taken from.
+ * \param destination Gets the reordered pixels, and may be the source itself.
+ */
+void ImageKernels::SwizzleRgba8(const uint8_t* source,
+                                const size_t pixel_count,
+                                const std::array<uint8_t, 4>& order,
+                                uint8_t* destination)
+{
+	size_t i = 0;
+
+#ifdef IMAGE_KERNELS_SSE2
+	if (GetSimdLevel() != SimdLevel::Scalar) {
+		alignas(16) std::array<uint8_t, 16> mask_bytes{};
+
+		for (uint8_t pixel = 0; pixel < 4; pixel++)
+			for (uint8_t channel = 0; channel < 4; channel++)
+				mask_bytes[pixel * 4 + channel] = static_cast<uint8_t>(pixel * 4 + (order[channel] & 3));
+
+		const __m128i mask = _mm_load_si128(reinterpret_cast<const __m128i*>(mask_bytes.data()));
+
+		i = GetSimdLevel() == SimdLevel::Avx2
+			    ? SwizzleRgba8Avx2(source, pixel_count, mask, destination)
+			    : SwizzleRgba8Ssse3(source, pixel_count, mask, destination);
+	}
+#endif
+
+	for (; i < pixel_count; i++) {
+		const std::array pixel = {source[i * 4 + 0], source[i * 4 + 1], source[i * 4 + 2], source[i * 4 + 3]};
+
+		for (uint32_t channel = 0; channel < 4; channel++)
+			destination[i * 4 + channel] = pixel[order[channel] & 3];
+	}
+}
+
+/**
+ * \brief Multiplies the color channels of RGBA8 pixels by their alpha, rounding to nearest.
+ * \param source The tightly packed source pixels.
+ * \param pixel_count The number of pixels.
+ * \param destination Gets the premultiplied pixels, and may be the source itself.
+ */
+void ImageKernels::PremultiplyAlphaRgba8(const uint8_t* source, const size_t pixel_count, uint8_t* destination)
+{
+	size_t i = 0;
+
+#ifdef IMAGE_KERNELS_SSE2
+	// The narrow path only needs SSE2, which every x64 CPU has, so it runs at any vector level
+	i = GetSimdLevel() == SimdLevel::Avx2
+		    ? PremultiplyAlphaRgba8Avx2(source, pixel_count, destination)
+		    : GetSimdLevel() == SimdLevel::Ssse3
+		    ? PremultiplyAlphaRgba8Sse2(source, pixel_count, destination)
+		    : 0;
+#endif
+
+	for (; i < pixel_count; i++) {
+		const uint8_t alpha = source[i * 4 + 3];
+
+		destination[i * 4 + 0] = MultiplyUnorm8(source[i * 4 + 0], alpha);
+		destination[i * 4 + 1] = MultiplyUnorm8(source[i * 4 + 1], alpha);
+		destination[i * 4 + 2] = MultiplyUnorm8(source[i * 4 + 2], alpha);
+		destination[i * 4 + 3] = alpha;
+	}
+}
+
+/**
+ * \brief Decodes sRGB encoded RGBA8 pixels to linear RGBA16 unorm through a lookup table, so that filtering and
+ * blending on the CPU happen in linear space without losing the precision of the dark tones. Alpha is already linear.
+ * A table lookup per channel beats both the curve and gathers, so this kernel has no vector path.
+ * \param source The tightly packed sRGB pixels.
+ * \param pixel_count The number of pixels.
+ * \param destination Gets pixel_count linear RGBA16 pixels.
+ */
+void ImageKernels::SrgbToLinearRgba16(const uint8_t* source, const size_t pixel_count, uint16_t* destination)
+{
+	const std::array<uint16_t, 256>& table = GetSrgbToLinearTable();
+
+	for (size_t i = 0; i < pixel_count; i++) {
+		destination[i * 4 + 0] = table[source[i * 4 + 0]];
+		destination[i * 4 + 1] = table[source[i * 4 + 1]];
+		destination[i * 4 + 2] = table[source[i * 4 + 2]];
+		destination[i * 4 + 3] = static_cast<uint16_t>(source[i * 4 + 3] * 257);
+	}
+}
+
+/**
+ * \brief Halves an RGBA8 image with a 2x2 box filter, rounding to nearest.
+ * Each level of a mip chain is floor(extent / 2), so an odd last row or column is left out,
+ * and an extent of 1 is sampled twice.
+ * \param source The tightly packed source pixels.
+ * \param source_width The width of the source in pixels.
+ * \param source_height The height of the source in pixels.
+ * \param destination Gets max(1, width / 2) x max(1, height / 2) tightly packed pixels.
+ */
+void ImageKernels::DownsampleRgba8(const uint8_t* source,
+                                   const uint32_t source_width,
+                                   const uint32_t source_height,
+                                   uint8_t* destination)
+{
+	const uint32_t width = std::max(1u, source_width / 2);
+	const uint32_t height = std::max(1u, source_height / 2);
+
+	for (uint32_t y = 0; y < height; y++) {
+		const uint8_t* row_0 = source + static_cast<size_t>(std::min(y * 2, source_height - 1)) * source_width * 4;
+		const uint8_t* row_1 = source + static_cast<size_t>(std::min(y * 2 + 1, source_height - 1)) * source_width * 4;
+		uint8_t* output = destination + static_cast<size_t>(y) * width * 4;
+
+		uint32_t x = 0;
+
+#ifdef IMAGE_KERNELS_SSE2
+		if (source_width >= 2) {
+			if (GetSimdLevel() == SimdLevel::Avx2)
+				x = DownsampleRowAvx2(row_0, row_1, width, source_width, output);
+
+			if (GetSimdLevel() != SimdLevel::Scalar)
+				x += DownsampleRowSse2(row_0 + x * 8, row_1 + x * 8, width - x, source_width - x * 2, output + x * 4);
+		}
+#endif
+
+		for (; x < width; x++) {
+			const uint32_t x_0 = std::min(x * 2, source_width - 1) * 4;
+			const uint32_t x_1 = std::min(x * 2 + 1, source_width - 1) * 4;
+
+			for (uint32_t channel = 0; channel < 4; channel++)
+				output[x * 4 + channel] = static_cast<uint8_t>(
+					(row_0[x_0 + channel] + row_0[x_1 + channel] + row_1[x_0 + channel] + row_1[x_1 + channel] + 2) >> 2);
+		}
+	}
+}
+
+/**
+ * \brief Gets how many levels a full mip chain has, down to and including 1x1.
+ */
+uint32_t ImageKernels::GetMipLevelCount(const uint32_t width, const uint32_t height)
+{
+	return static_cast<uint32_t>(std::bit_width(std::max(width, height)));
+}
+
+/**
+ * \brief Gets the width or height of a mip level.
+ */
+uint32_t ImageKernels::GetMipExtent(const uint32_t extent, const uint32_t mip_level)
+{
+	return std::max(1u, extent >> mip_level);
+}
+
+/**
+ * \brief Gets the instruction set that the kernels currently use.
+ */
+SimdLevel ImageKernels::GetSimdLevel()
+{
+	return s_simdLevel.load(std::memory_order_relaxed);
+}
+
+/**
+ * \brief Gets the fastest instruction set that this CPU supports.
+ */
+SimdLevel ImageKernels::GetSupportedSimdLevel()
+{
+	return s_supportedSimdLevel;
+}
+
+/**
+ * \brief Restricts the kernels to an instruction set, e.g. to compare against the scalar paths.
+ * \param level The instruction set to use, lowered to the supported one if the CPU lacks it.
+ */
+void ImageKernels::SetSimdLevel(const SimdLevel level)
+{
+	s_simdLevel.store(std::min(level, s_supportedSimdLevel), std::memory_order_relaxed);
+}
+
+/**
+ * \brief Times every kernel at every supported instruction set on a random image, and logs the throughput
+ * in megapixels per second next to the speedup over the scalar path.
+ * \param width The width of the image.
+ * \param height The height of the image.
+ */
+void ImageKernels::Benchmark(const uint32_t width, const uint32_t height)
+{
+	const size_t pixel_count = static_cast<size_t>(width) * height;
+
+	std::vector<uint8_t> source(pixel_count * 4);
+	std::vector<uint8_t> destination(pixel_count * 4);
+	std::vector<uint16_t> destination_16(pixel_count * 4);
+
+	std::mt19937 random(42);
+	std::ranges::generate(source, [&random] { return static_cast<uint8_t>(random()); });
+
+	const std::pair<const char*, void (*)(const uint8_t*, size_t, uint32_t, uint32_t, uint8_t*, uint16_t*)> kernels[] = {
+		{
+			"Expand RGB to RGBA", [](const uint8_t* in, const size_t count, uint32_t, uint32_t, uint8_t* out, uint16_t*)
+			{
+				ExpandRgbToRgba8(in, count, out);
+			}
+		},
+		{
+			"Swizzle BGRA", [](const uint8_t* in, const size_t count, uint32_t, uint32_t, uint8_t* out, uint16_t*)
+			{
+				SwizzleRgba8(in, count, {2, 1, 0, 3}, out);
+			}
+		},
+		{
+			"Premultiply alpha", [](const uint8_t* in, const size_t count, uint32_t, uint32_t, uint8_t* out, uint16_t*)
+			{
+				PremultiplyAlphaRgba8(in, count, out);
+			}
+		},
+		{
+			"sRGB to linear", [](const uint8_t* in, const size_t count, uint32_t, uint32_t, uint8_t*, uint16_t* out)
+			{
+				SrgbToLinearRgba16(in, count, out);
+			}
+		},
+		{
+			"Downsample", [](const uint8_t* in, size_t, const uint32_t w, const uint32_t h, uint8_t* out, uint16_t*)
+			{
+				DownsampleRgba8(in, w, h, out);
+			}
+		}
+	};
+
+	const SimdLevel previous_level = GetSimdLevel();
+	constexpr uint32_t iterations = 10;
+	constexpr const char* level_names[] = {"scalar", "SSSE3", "AVX2"};
+
+	for (const auto& [name, kernel] : kernels) {
+		float scalar_rate = 0.0f;
+
+		for (auto level = SimdLevel::Scalar; level <= s_supportedSimdLevel;
+		     level = static_cast<SimdLevel>(static_cast<int>(level) + 1)) {
+			SetSimdLevel(level);
+
+			// One untimed run, so that the pages of the destination are already mapped
+			kernel(source.data(), pixel_count, width, height, destination.data(), destination_16.data());
+
+			Timer timer;
+
+			for (uint32_t i = 0; i < iterations; i++)
+				kernel(source.data(), pixel_count, width, height, destination.data(), destination_16.data());
+
+			const float rate = static_cast<float>(pixel_count) * iterations / 1e6f / timer.Elapsed();
+
+			if (level == SimdLevel::Scalar)
+				scalar_rate = rate;
+
+			VK_CORE_INFO("{0} ({1}): {2:.1f} MP/s, {3:.2f}x", name, level_names[static_cast<int>(level)], rate,
+			             rate / scalar_rate);
+		}
+	}
+
+	SetSimdLevel(previous_level);
+}
@@ -0,0 +1,50 @@
+﻿#pragma once
+#include <array>
+#include <cstddef>
+#include <cstdint>
+
+// Instruction sets that the kernels have paths for, from slowest to fastest
+enum class SimdLevel
+{
+	Scalar,
+	Ssse3,
+	Avx2
+};
+
+/**
+ * \brief Pixel processing that runs over whole images on the CPU, vectorized where the target supports it.
+ * The instruction set is picked once at runtime, and every kernel can write straight into mapped staging memory.
+ */
+class ImageKernels
+{
+public:
+	static void ExpandToRgba8(const uint8_t* source, uint32_t channels, size_t pixel_count, uint8_t* destination);
+
+	static void ExpandRgbToRgba8(const uint8_t* source, size_t pixel_count, uint8_t* destination);
+
+	static void SwizzleRgba8(const uint8_t* source,
+	                         size_t pixel_count,
+	                         const std::array<uint8_t, 4>& order,
+	                         uint8_t* destination);
+
+	static void PremultiplyAlphaRgba8(const uint8_t* source, size_t pixel_count, uint8_t* destination);
+
+	static void SrgbToLinearRgba16(const uint8_t* source, size_t pixel_count, uint16_t* destination);
+
+	static void DownsampleRgba8(const uint8_t* source,
+	                            uint32_t source_width,
+	                            uint32_t source_height,
+	                            uint8_t* destination);
+
+	static uint32_t GetMipLevelCount(uint32_t width, uint32_t height);
+
+	static uint32_t GetMipExtent(uint32_t extent, uint32_t mip_level);
+
+	static SimdLevel GetSimdLevel();
+
+	static SimdLevel GetSupportedSimdLevel();
+
+	static void SetSimdLevel(SimdLevel level);
+
+	static void Benchmark(uint32_t width, uint32_t height);
+};
@@ -0,0 +1,129 @@
+﻿#include "Ktx2File.h"
+
+#include <cstring>
+#include <filesystem>
+
+#include "ImageKernels.h"
+#include "TextureTranscoder.h"
+#include "Core/Log.h"
+
+namespace
+{
+	constexpr uint8_t s_identifier[12] = {0xAB, 0x4B, 0x54, 0x58, 0x20, 0x32, 0x30, 0xBB, 0x0D, 0x0A, 0x1A, 0x0A};
+
+	// Layout of the file header, see the "File Structure" section of the KTX 2.0 specification
+	struct Ktx2Header
+	{
+		uint8_t identifier[12];
+		uint32_t vkFormat;
+		uint32_t typeSize;
+		uint32_t pixelWidth;
+		uint32_t pixelHeight;
+		uint32_t pixelDepth;
+		uint32_t layerCount;
+		uint32_t faceCount;
+		uint32_t levelCount;
+		uint32_t supercompressionScheme;
+		uint32_t dfdByteOffset;
+		uint32_t dfdByteLength;
+		uint32_t kvdByteOffset;
+		uint32_t kvdByteLength;
+		uint64_t sgdByteOffset;
+		uint64_t sgdByteLength;
+	};
+
+	struct Ktx2LevelIndex
+	{
+		uint64_t byteOffset;
+		uint64_t byteLength;
+		uint64_t uncompressedByteLength;
+	};
+
+	static_assert(sizeof(Ktx2Header) == 80 && sizeof(Ktx2LevelIndex) == 24);
+}
+
+/**
+ * \brief Maps a KTX2 file and validates its header and level index.
+ * \param file_path The path of the file.
+ */
+Ktx2File::Ktx2File(const std::string& file_path) : m_file(file_path)
+{
+	if (!m_file.IsOpen())
+		return;
+
+	// Levels are stored smallest first but copied largest first, so the whole file is read ahead instead
+	m_file.Advise(MappedFile::Access::WillNeed);
+
+	const auto* data = reinterpret_cast<const uint8_t*>(m_file.GetData());
+	const size_t size = m_file.GetSize();
+
+	Ktx2Header header;
+
+	if (size < sizeof(header)) {
+		VK_CORE_ERROR("{0} is too small to be a KTX2 file", file_path);
+		return;
+	}
+
+	std::memcpy(&header, data, sizeof(header));
+
+	if (std::memcmp(header.identifier, s_identifier, sizeof(s_identifier)) != 0) {
+		VK_CORE_ERROR("{0} is not a KTX2 file", file_path);
+		return;
+	}
+
+	if (header.supercompressionScheme != 0 || header.vkFormat == 0) {
+		VK_CORE_ERROR("{0} uses supercompression, which is not supported", file_path);
+		return;
+	}
+
+	if (header.pixelDepth > 1 || header.layerCount > 1 || header.faceCount != 1 || header.pixelHeight == 0) {
+		VK_CORE_ERROR("{0} is not a 2D texture", file_path);
+		return;
+	}
+
+	m_format = static_cast<vk::Format>(header.vkFormat);
+	m_width = header.pixelWidth;
+	m_height = header.pixelHeight;
+
+	if (TextureTranscoder::GetBlockInfo(m_format).bytes == 0) {
+		VK_CORE_ERROR("{0} has unsupported format {1}", file_path, vk::to_string(m_format));
+		return;
+	}
+
+	// A level count of zero asks the loader to generate the mips, only the base level is stored then
+	const uint32_t level_count = std::max(1u, header.levelCount);
+
+	if (sizeof(header) + level_count * sizeof(Ktx2LevelIndex) > size ||
+	    level_count > ImageKernels::GetMipLevelCount(m_width, m_height)) {
+		VK_CORE_ERROR("{0} has a corrupt level index", file_path);
+		return;
+	}
+
+	for (uint32_t level = 0; level < level_count; level++) {
+		Ktx2LevelIndex index;
+		std::memcpy(&index, data + sizeof(header) + level * sizeof(index), sizeof(index));
+
+		const uint32_t width = ImageKernels::GetMipExtent(m_width, level);
+		const uint32_t height = ImageKernels::GetMipExtent(m_height, level);
+
+		if (index.byteOffset > size || index.byteLength > size - index.byteOffset ||
+		    index.byteLength < TextureTranscoder::GetLevelSize(m_format, width, height)) {
+			VK_CORE_ERROR("{0}: mip level {1} is outside of the file or too small", file_path, level);
+			return;
+		}
+
+		m_levels.push_back(Level{
+			.data = data + index.byteOffset,
+			.size = index.byteLength,
+			.width = width,
+			.height = height
+		});
+	}
+
+	m_isValid = true;
+}
+
+bool Ktx2File::IsKtx2(const std::string& file_path)
+{
+	return std::filesystem::path(file_path).extension() == ".ktx2";
+}
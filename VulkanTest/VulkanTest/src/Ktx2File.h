@@ -0,0 +1,56 @@
+﻿#pragma once
+#include <string>
+#include <vector>
+#include <vulkan/vulkan.hpp>
+
+#include "Core/MappedFile.h"
+
+/**
+ * \brief A KTX2 texture container, mapped into memory. Every mip level is a view into the mapping,
+ * so the file has to outlive the upload of its levels.
+ * Only 2D, non-array textures without supercompression (Basis Universal / zstd) are supported.
+ */
+class Ktx2File
+{
+public:
+	struct Level
+	{
+		const uint8_t* data = nullptr;
+
+		uint64_t size = 0;
+
+		uint32_t width = 0;
+
+		uint32_t height = 0;
+	};
+
+	explicit Ktx2File(const std::string& file_path);
+
+	[[nodiscard]] bool IsValid() const { return m_isValid; }
+
+	[[nodiscard]] vk::Format GetFormat() const { return m_format; }
+
+	[[nodiscard]] uint32_t GetWidth() const { return m_width; }
+
+	[[nodiscard]] uint32_t GetHeight() const { return m_height; }
+
+	[[nodiscard]] uint32_t GetLevelCount() const { return static_cast<uint32_t>(m_levels.size()); }
+
+	[[nodiscard]] const Level& GetLevel(const uint32_t level) const { return m_levels[level]; }
+
+	static bool IsKtx2(const std::string& file_path);
+
+private:
+	MappedFile m_file;
+
+	bool m_isValid = false;
+
+	vk::Format m_format = vk::Format::eUndefined;
+
+	uint32_t m_width = 0;
+
+	uint32_t m_height = 0;
+
+	// Level 0 is the full resolution image
+	std::vector<Level> m_levels;
+};
@@ -2,21 +2,28 @@
 
 #include "LogicalDevice.h"
 #include<set>
+#include"BindlessTextures.h"
+#include"HostImageCopy.h"
 #include"PhysicalDevice.h"
+#include"TextureResidency.h"
 #include"ValidationLayers.h"
 
 void LogicalDevice::CreateLogicalDevice(
 	vk::Device& device,
 	vk::PhysicalDevice physical_device,
 	vk::Queue& graphics_queue,
-	vk::Queue& present_queue)
+	vk::Queue& present_queue,
+	vk::Queue& transfer_queue)
 {
 	// Get the queue family indices
-	auto [index_graphics_family, index_present_family] = PhysicalDevice::FindQueueFamilies(physical_device);
+	auto [index_graphics_family, index_present_family, index_transfer_family] =
+		PhysicalDevice::FindQueueFamilies(physical_device);
 
 	// Create a set of different queue create infos for drawing and presenting
 	std::vector<vk::DeviceQueueCreateInfo> queue_create_infos;
-	std::set unique_queue_families = {index_graphics_family.value(), index_present_family.value()};
+	std::set unique_queue_families = {
+		index_graphics_family.value(), index_present_family.value(), index_transfer_family.value()
+	};
 
 	// Set the priority to 1.0f
 	float queue_priority = 1.0f;
@@ -32,16 +39,42 @@ void LogicalDevice::CreateLogicalDevice(
 	}
 
 	// Get the physical device features
-	vk::PhysicalDeviceFeatures device_features{
-		.samplerAnisotropy = static_cast<vk::Bool32>(true)
+	vk::PhysicalDeviceFeatures device_features = PhysicalDevice::GetEnabledFeatures(physical_device);
+
+	const auto supported_features = physical_device.getFeatures2<vk::PhysicalDeviceFeatures2,
+	                                                             vk::PhysicalDeviceDescriptorIndexingFeatures>();
+
+	const auto& supported_indexing = supported_features.get<vk::PhysicalDeviceDescriptorIndexingFeatures>();
+
+	// Bindless textures need descriptor indexing, which is only enabled when the device has all of it
+	vk::PhysicalDeviceDescriptorIndexingFeatures descriptor_indexing_features{
+		.shaderSampledImageArrayNonUniformIndexing = static_cast<vk::Bool32>(true),
+		.descriptorBindingSampledImageUpdateAfterBind = static_cast<vk::Bool32>(true),
+		.descriptorBindingUpdateUnusedWhilePending = static_cast<vk::Bool32>(true),
+		.descriptorBindingPartiallyBound = static_cast<vk::Bool32>(true),
+		// Lets compute shaders size their runtime descriptor arrays when the set is allocated
+		.descriptorBindingVariableDescriptorCount = supported_indexing.descriptorBindingVariableDescriptorCount,
+		.runtimeDescriptorArray = static_cast<vk::Bool32>(true)
 	};
 
+	std::vector<const char*> extensions = PhysicalDevice::s_device_extensions;
+
+	const void* features = BindlessTextures::IsSupported(physical_device) ? &descriptor_indexing_features : nullptr;
+
+	// Textures are written from the CPU without staging on devices where that is faster
+	features = HostImageCopy::AddDeviceFeatures(physical_device, extensions, features);
+
+	// Lets texture residency follow what the driver reports as available, instead of a fixed budget alone
+	if (TextureResidency::SupportsMemoryBudget(physical_device))
+		extensions.push_back(VK_EXT_MEMORY_BUDGET_EXTENSION_NAME);
+
 	// Make the Logical Device create info
 	vk::DeviceCreateInfo create_info{
+		.pNext = features,
 		.queueCreateInfoCount = static_cast<uint32_t>(queue_create_infos.size()),
 		.pQueueCreateInfos = queue_create_infos.data(),
-		.enabledExtensionCount = static_cast<uint32_t>(PhysicalDevice::s_device_extensions.size()),
-		.ppEnabledExtensionNames = PhysicalDevice::s_device_extensions.data(),
+		.enabledExtensionCount = static_cast<uint32_t>(extensions.size()),
+		.ppEnabledExtensionNames = extensions.data(),
 		.pEnabledFeatures = &device_features
 	};
 
@@ -56,6 +89,9 @@ void LogicalDevice::CreateLogicalDevice(
 	if (physical_device.createDevice(&create_info, nullptr, &device) != vk::Result::eSuccess)
 		throw std::runtime_error("Failed to create Logical Device!");
 
+	HostImageCopy::Load(device);
+
 	device.getQueue(index_graphics_family.value(), 0, &graphics_queue);
 	device.getQueue(index_present_family.value(), 0, &present_queue);
+	device.getQueue(index_transfer_family.value(), 0, &transfer_queue);
 }
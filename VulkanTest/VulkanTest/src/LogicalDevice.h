@@ -8,5 +8,6 @@ public:
 		vk::Device& device,
 		vk::PhysicalDevice physical_device,
 		vk::Queue& graphics_queue,
-		vk::Queue& present_queue);
+		vk::Queue& present_queue,
+		vk::Queue& transfer_queue);
 };
@@ -0,0 +1,110 @@
+﻿#define VULKAN_HPP_NO_CONSTRUCTORS
+
+#include "Mesh.h"
+
+#include <algorithm>
+#include <limits>
+
+#include "Buffer.h"
+#include "MeshLoader.h"
+#include "MeshOptimizer.h"
+#include "Core/Log.h"
+
+Mesh::Mesh(const std::string& file_path,
+           const vk::Device device,
+           const vk::PhysicalDevice physical_device,
+           const vk::CommandPool command_pool,
+           const vk::Queue graphics_queue,
+           const bool quantize_vertices)
+	: Mesh(Import(file_path), device, physical_device, command_pool, graphics_queue, quantize_vertices) {}
+
+/**
+ * \brief Uploads geometry that was loaded or generated on the CPU.
+ * \param data The triangles, which must not be empty.
+ * \param device The logical device.
+ * \param physical_device The physical device, used to find memory for the buffers.
+ * \param command_pool The command pool that the copies are recorded from.
+ * \param graphics_queue The queue that the copies are submitted to.
+ * \param quantize_vertices Whether to store vertices as QuantizedMeshVertex, as long as they are within its tolerances.
+ */
+Mesh::Mesh(const MeshData& data,
+           const vk::Device device,
+           const vk::PhysicalDevice physical_device,
+           const vk::CommandPool command_pool,
+           const vk::Queue graphics_queue,
+           const bool quantize_vertices)
+{
+	if (data.vertices.empty() || data.indices.empty())
+		throw std::invalid_argument("Meshes need at least one triangle!");
+
+	m_vertexCount = static_cast<uint32_t>(data.vertices.size());
+	m_indexCount = static_cast<uint32_t>(data.indices.size());
+
+	if (quantize_vertices) {
+		const QuantizedVertices<QuantizedMeshVertex> quantized = VertexQuantizer::Quantize<QuantizedMeshVertex>(
+			data.vertices);
+
+		if (quantized.IsWithinBounds()) {
+			m_vertexRemaps = quantized.remaps;
+			m_quantized = true;
+
+			Buffer::CreatePrimitiveBuffer(m_vertexBuffer, m_vertexBufferMemory, device, physical_device,
+			                              quantized.vertices, command_pool, graphics_queue);
+		} else {
+			VK_CORE_WARN("Mesh vertices are over the quantization tolerance by {0:.2f}x, keeping them as floats",
+			             *std::ranges::max_element(quantized.errors));
+		}
+	}
+
+	if (!m_quantized)
+		Buffer::CreatePrimitiveBuffer(m_vertexBuffer, m_vertexBufferMemory, device, physical_device, data.vertices,
+		                              command_pool, graphics_queue);
+
+	// The largest 16 bit index is left out, since it restarts primitives when that is enabled
+	if (data.vertices.size() < std::numeric_limits<uint16_t>::max()) {
+		const std::vector<uint16_t> indices(data.indices.begin(), data.indices.end());
+
+		m_indexType = ::GetIndexType<uint16_t>();
+
+		Buffer::CreatePrimitiveBuffer(m_indexBuffer, m_indexBufferMemory, device, physical_device, indices,
+		                              command_pool, graphics_queue);
+	} else {
+		m_indexType = ::GetIndexType<uint32_t>();
+
+		Buffer::CreatePrimitiveBuffer(m_indexBuffer, m_indexBufferMemory, device, physical_device, data.indices,
+		                              command_pool, graphics_queue);
+	}
+}
+
+/**
+ * \brief Binds the buffers of the mesh and draws all of its triangles, the pipeline must use GetVertexInputState().
+ */
+void Mesh::Draw(const vk::CommandBuffer command_buffer, const uint32_t instance_count) const
+{
+	constexpr vk::DeviceSize offset = 0;
+
+	command_buffer.bindVertexBuffers(0, 1, &m_vertexBuffer, &offset);
+	command_buffer.bindIndexBuffer(m_indexBuffer, 0, m_indexType);
+	command_buffer.drawIndexed(m_indexCount, instance_count, 0, 0, 0);
+}
+
+/**
+ * \brief Loads a model and reorders it for the GPU, which is done once here instead of on every draw.
+ */
+MeshData Mesh::Import(const std::string& file_path)
+{
+	MeshData data = MeshLoader::Load(file_path);
+
+	MeshOptimizer::Optimize(data);
+
+	return data;
+}
+
+void Mesh::Destroy(const vk::Device device) const
+{
+	device.destroyBuffer(m_indexBuffer, nullptr);
+	device.freeMemory(m_indexBufferMemory, nullptr);
+
+	device.destroyBuffer(m_vertexBuffer, nullptr);
+	device.freeMemory(m_vertexBufferMemory, nullptr);
+}
@@ -0,0 +1,75 @@
+﻿#pragma once
+#include <string>
+#include <vulkan/vulkan.hpp>
+
+#include "Vertex.h"
+#include "VertexQuantizer.h"
+
+/**
+ * \brief A loaded model in device local vertex and index buffers, uploaded through the primitive buffer path.
+ * Indices are stored as 16 bits whenever the vertices fit, which halves the index memory of small meshes,
+ * and vertices are quantized to half their size unless that loses visible precision.
+ */
+class Mesh
+{
+public:
+	Mesh(const std::string& file_path,
+	     vk::Device device,
+	     vk::PhysicalDevice physical_device,
+	     vk::CommandPool command_pool,
+	     vk::Queue graphics_queue,
+	     bool quantize_vertices = true);
+
+	Mesh(const MeshData& data,
+	     vk::Device device,
+	     vk::PhysicalDevice physical_device,
+	     vk::CommandPool command_pool,
+	     vk::Queue graphics_queue,
+	     bool quantize_vertices = true);
+
+	void Draw(vk::CommandBuffer command_buffer, uint32_t instance_count = 1) const;
+
+	void Destroy(vk::Device device) const;
+
+	[[nodiscard]] vk::Buffer GetVertexBuffer() const { return m_vertexBuffer; }
+
+	[[nodiscard]] vk::Buffer GetIndexBuffer() const { return m_indexBuffer; }
+
+	[[nodiscard]] vk::IndexType GetIndexType() const { return m_indexType; }
+
+	[[nodiscard]] uint32_t GetVertexCount() const { return m_vertexCount; }
+
+	[[nodiscard]] uint32_t GetIndexCount() const { return m_indexCount; }
+
+	[[nodiscard]] bool IsQuantized() const { return m_quantized; }
+
+	// The layout of either MeshVertex or QuantizedMeshVertex, for the pipelines that draw the mesh
+	[[nodiscard]] vk::PipelineVertexInputStateCreateInfo GetVertexInputState() const
+	{
+		return m_quantized ? VertexLayout<QuantizedMeshVertex>::GetInputState() : VertexLayout<MeshVertex>::GetInputState();
+	}
+
+	// What the vertex shader needs to undo the remapping of quantized positions and texture coordinates
+	[[nodiscard]] const QuantizedVertices<QuantizedMeshVertex>::Remaps& GetVertexRemaps() const { return m_vertexRemaps; }
+
+private:
+	static MeshData Import(const std::string& file_path);
+
+	vk::Buffer m_vertexBuffer;
+
+	vk::DeviceMemory m_vertexBufferMemory;
+
+	vk::Buffer m_indexBuffer;
+
+	vk::DeviceMemory m_indexBufferMemory;
+
+	vk::IndexType m_indexType = vk::IndexType::eUint32;
+
+	uint32_t m_vertexCount = 0;
+
+	uint32_t m_indexCount = 0;
+
+	bool m_quantized = false;
+
+	QuantizedVertices<QuantizedMeshVertex>::Remaps m_vertexRemaps{};
+};
@@ -0,0 +1,1297 @@
+﻿#include "MeshLoader.h"
+
+#include <algorithm>
+#include <charconv>
+#include <cmath>
+#include <cstring>
+#include <filesystem>
+#include <limits>
+#include <stdexcept>
+#include <glm/gtc/quaternion.hpp>
+
+#include "Core/Log.h"
+#include "Core/MappedFile.h"
+#include "Core/Timer.h"
+
+namespace
+{
+	constexpr uint32_t s_missing = std::numeric_limits<uint32_t>::max();
+
+	constexpr uint32_t s_glbMagic = 0x46546C67;
+
+	constexpr uint32_t s_glbJsonChunk = 0x4E4F534A;
+
+	constexpr uint32_t s_glbBinaryChunk = 0x004E4942;
+
+	// Nodes nest at most this deep, so that malformed files can't exhaust the stack
+	constexpr uint32_t s_maxNodeDepth = 64;
+
+	// Above this doubles skip integers, so no index or size in a glTF file can be as large
+	constexpr double s_maxJsonInteger = 9007199254740992.0;
+
+	bool IsSpace(const char c)
+	{
+		return c == ' ' || c == '\t' || c == '\r';
+	}
+
+	const char* SkipSpaces(const char* cursor, const char* end)
+	{
+		while (cursor < end && IsSpace(*cursor))
+			cursor++;
+
+		return cursor;
+	}
+
+	// Powers of ten that doubles hold exactly
+	constexpr double s_exactPowers[] = {
+		1e0, 1e1, 1e2, 1e3, 1e4, 1e5, 1e6, 1e7, 1e8, 1e9, 1e10, 1e11,
+		1e12, 1e13, 1e14, 1e15, 1e16, 1e17, 1e18, 1e19, 1e20, 1e21, 1e22
+	};
+
+	bool IsDigit(const char c)
+	{
+		return static_cast<unsigned>(c - '0') <= 9;
+	}
+
+	// Checks eight characters for being digits at once, within one 64-bit register (SWAR)
+	bool IsEightDigits(const uint64_t chunk)
+	{
+		return ((chunk & 0xF0F0F0F0F0F0F0F0) | ((chunk + 0x0606060606060606 & 0xF0F0F0F0F0F0F0F0) >> 4)) ==
+			0x3333333333333333;
+	}
+
+	// Turns eight digits into their value with three multiplications instead of eight, for little endian targets
+	uint32_t ParseEightDigits(uint64_t chunk)
+	{
+		chunk -= 0x3030303030303030;
+		chunk = chunk * 10 + (chunk >> 8);
+		chunk = ((chunk & 0x000000FF000000FF) * (100 + (1000000ull << 32)) +
+		         (chunk >> 16 & 0x000000FF000000FF) * (1 + (10000ull << 32))) >> 32;
+
+		return static_cast<uint32_t>(chunk);
+	}
+
+	bool ParseFloatFallback(const char*& cursor, const char* end, float& value)
+	{
+		if (cursor < end && *cursor == '+')
+			cursor++;
+
+		const auto [next, error] = std::from_chars(cursor, end, value);
+
+		if (error != std::errc())
+			return false;
+
+		cursor = next;
+		return true;
+	}
+
+	/**
+	 * \brief Parses a float, reading the digits after the point eight at a time. Numbers with at most 19 digits
+	 * and a small exponent, which is what exporters write, are converted with a single exact double operation
+	 * (Clinger's fast path). Everything else, and the rare result that lands exactly between two floats, goes through
+	 * from_chars, so the result is always correctly rounded.
+	 */
+	bool ParseFloat(const char*& cursor, const char* end, float& value)
+	{
+		cursor = SkipSpaces(cursor, end);
+
+		const char* current = cursor;
+		const bool negative = current < end && *current == '-';
+
+		if (negative || (current < end && *current == '+'))
+			current++;
+
+		uint64_t mantissa = 0;
+		int64_t exponent = 0;
+
+		const char* integer = current;
+
+		while (current < end && IsDigit(*current))
+			mantissa = mantissa * 10 + static_cast<uint64_t>(*current++ - '0');
+
+		int64_t digits = current - integer;
+
+		if (current < end && *current == '.') {
+			const char* fraction = ++current;
+
+			for (uint64_t chunk; end - current >= 8; current += 8) {
+				memcpy(&chunk, current, sizeof(chunk));
+
+				if (!IsEightDigits(chunk))
+					break;
+
+				mantissa = mantissa * 100000000 + ParseEightDigits(chunk);
+			}
+
+			while (current < end && IsDigit(*current))
+				mantissa = mantissa * 10 + static_cast<uint64_t>(*current++ - '0');
+
+			exponent = fraction - current;
+			digits += current - fraction;
+		}
+
+		// Not a plain number, e.g. nan or inf
+		if (digits == 0)
+			return ParseFloatFallback(cursor, end, value);
+
+		if (current < end && (*current == 'e' || *current == 'E')) {
+			current++;
+
+			const bool negative_exponent = current < end && *current == '-';
+
+			if (negative_exponent || (current < end && *current == '+'))
+				current++;
+
+			if (current == end || !IsDigit(*current))
+				return ParseFloatFallback(cursor, end, value);
+
+			int64_t explicit_exponent = 0;
+
+			while (current < end && IsDigit(*current)) {
+				if (explicit_exponent < 10000)
+					explicit_exponent = explicit_exponent * 10 + (*current - '0');
+
+				current++;
+			}
+
+			exponent += negative_exponent ? -explicit_exponent : explicit_exponent;
+		}
+
+		if (digits > 19 || mantissa > (uint64_t{1} << 53) || exponent < -22 || exponent > 22)
+			return ParseFloatFallback(cursor, end, value);
+
+		double result = static_cast<double>(mantissa);
+		result = exponent < 0 ? result / s_exactPowers[-exponent] : result * s_exactPowers[exponent];
+
+		// Rounding the double to a float again is only wrong when it lands exactly halfway between two floats
+		uint64_t bits;
+		memcpy(&bits, &result, sizeof(bits));
+
+		if ((bits & 0x1FFFFFFF) == 0x10000000)
+			return ParseFloatFallback(cursor, end, value);
+
+		value = static_cast<float>(negative ? -result : result);
+		cursor = current;
+		return true;
+	}
+
+	bool ParseInteger(const char*& cursor, const char* end, int64_t& value)
+	{
+		const bool negative = cursor < end && *cursor == '-';
+
+		if (negative || (cursor < end && *cursor == '+'))
+			cursor++;
+
+		if (cursor == end || static_cast<unsigned>(*cursor - '0') > 9)
+			return false;
+
+		value = 0;
+
+		while (cursor < end && static_cast<unsigned>(*cursor - '0') <= 9 && value < (int64_t{1} << 40))
+			value = value * 10 + (*cursor++ - '0');
+
+		if (negative)
+			value = -value;
+
+		return true;
+	}
+
+	// OBJ indices start at 1, and negative ones count back from the last element
+	uint32_t ResolveObjIndex(const int64_t index, const size_t count)
+	{
+		const int64_t resolved = index > 0 ? index - 1 : static_cast<int64_t>(count) + index;
+
+		if (index == 0 || resolved < 0 || resolved >= static_cast<int64_t>(count))
+			throw std::runtime_error("OBJ face refers to an element that doesn't exist!");
+
+		return static_cast<uint32_t>(resolved);
+	}
+
+	// Which position, texture coordinate and normal an OBJ vertex is made of
+	struct ObjVertexKey
+	{
+		uint32_t position;
+
+		uint32_t texCoord;
+
+		uint32_t normal;
+
+		bool operator==(const ObjVertexKey&) const = default;
+	};
+
+	/**
+	 * \brief Maps OBJ vertex keys to vertices without hashing: the vertices of each position are chained, and a position
+	 * rarely has more than a few. Faces tend to use positions that were read recently, so unlike a hash table the
+	 * lookups stay in cache, and adding a vertex never allocates on its own.
+	 */
+	class ObjVertexTable
+	{
+	public:
+		// Gets the vertex of a key, or adds it as the next vertex if it is new
+		uint32_t Find(const ObjVertexKey& key, bool& added)
+		{
+			if (key.position >= m_heads.size())
+				m_heads.resize(std::max<size_t>(key.position + 1, m_heads.size() * 2), s_missing);
+
+			for (uint32_t vertex = m_heads[key.position]; vertex != s_missing; vertex = m_next[vertex])
+				if (m_keys[vertex] == key) {
+					added = false;
+					return vertex;
+				}
+
+			const auto vertex = static_cast<uint32_t>(m_keys.size());
+
+			m_keys.push_back(key);
+			m_next.push_back(m_heads[key.position]);
+			m_heads[key.position] = vertex;
+
+			added = true;
+			return vertex;
+		}
+
+		[[nodiscard]] const ObjVertexKey& GetKey(const uint32_t vertex) const { return m_keys[vertex]; }
+
+	private:
+		// The last vertex added for each position
+		std::vector<uint32_t> m_heads;
+
+		// The vertex added before each vertex with the same position
+		std::vector<uint32_t> m_next;
+
+		std::vector<ObjVertexKey> m_keys;
+	};
+
+	/**
+	 * \brief Just enough of a JSON document to read the glTF scene description. Strings are views into the chunk,
+	 * escapes are kept as they are since glTF only uses them in names and URIs, which aren't needed.
+	 */
+	struct JsonValue
+	{
+		enum class Type
+		{
+			Null,
+			Boolean,
+			Number,
+			String,
+			Array,
+			Object
+		};
+
+		Type type = Type::Null;
+
+		double number = 0.0;
+
+		std::string_view string;
+
+		// Values of an array, or of an object in the same order as its keys
+		std::vector<JsonValue> elements;
+
+		std::vector<std::string_view> keys;
+
+		[[nodiscard]] const JsonValue* Find(const std::string_view key) const
+		{
+			for (size_t i = 0; i < keys.size(); i++)
+				if (keys[i] == key)
+					return &elements[i];
+
+			return nullptr;
+		}
+
+		[[nodiscard]] double GetNumber(const std::string_view key, const double fallback) const
+		{
+			const JsonValue* value = Find(key);
+
+			return value && value->type == Type::Number ? value->number : fallback;
+		}
+
+		// Converting anything but a whole number in range to an integer is undefined, so everything else is invalid
+		[[nodiscard]] size_t AsIndex() const
+		{
+			if (type != Type::Number || !(number >= 0.0 && number < s_maxJsonInteger) ||
+			    std::trunc(number) != number)
+				return std::numeric_limits<size_t>::max();
+
+			return static_cast<size_t>(number);
+		}
+
+		[[nodiscard]] size_t GetIndex(const std::string_view key) const
+		{
+			const JsonValue* value = Find(key);
+
+			return value ? value->AsIndex() : std::numeric_limits<size_t>::max();
+		}
+
+		// Gets a count, offset or size, which has to be a non-negative integer when it is present
+		[[nodiscard]] size_t GetSize(const std::string_view key, const size_t fallback) const
+		{
+			const JsonValue* value = Find(key);
+
+			if (!value)
+				return fallback;
+
+			const size_t size = value->AsIndex();
+
+			if (size == std::numeric_limits<size_t>::max())
+				throw std::runtime_error("glTF " + std::string(key) + " must be a non-negative integer!");
+
+			return size;
+		}
+
+		[[nodiscard]] const JsonValue& At(const size_t index) const
+		{
+			if (type != Type::Array || index >= elements.size())
+				throw std::runtime_error("glTF refers to an element that doesn't exist!");
+
+			return elements[index];
+		}
+
+		// Gets an element of an array member, e.g. an accessor of the document
+		[[nodiscard]] const JsonValue& At(const std::string_view key, const size_t index) const
+		{
+			const JsonValue* value = Find(key);
+
+			if (!value)
+				throw std::runtime_error("glTF refers to an element that doesn't exist!");
+
+			return value->At(index);
+		}
+	};
+
+	class JsonParser
+	{
+	public:
+		JsonParser(const char* begin, const char* end) : m_cursor(begin), m_end(end) {}
+
+		JsonValue Parse()
+		{
+			JsonValue value = ParseValue(0);
+
+			SkipWhitespace();
+
+			if (m_cursor != m_end && *m_cursor != '\0')
+				Fail();
+
+			return value;
+		}
+
+	private:
+		static constexpr uint32_t s_maxDepth = 128;
+
+		[[noreturn]] static void Fail()
+		{
+			throw std::runtime_error("Malformed glTF JSON!");
+		}
+
+		void SkipWhitespace()
+		{
+			while (m_cursor < m_end && (*m_cursor == ' ' || *m_cursor == '\t' || *m_cursor == '\n' || *m_cursor == '\r'))
+				m_cursor++;
+		}
+
+		void Expect(const char c)
+		{
+			SkipWhitespace();
+
+			if (m_cursor == m_end || *m_cursor != c)
+				Fail();
+
+			m_cursor++;
+		}
+
+		bool Consume(const std::string_view literal)
+		{
+			if (static_cast<size_t>(m_end - m_cursor) < literal.size() ||
+			    std::string_view(m_cursor, literal.size()) != literal)
+				return false;
+
+			m_cursor += literal.size();
+			return true;
+		}
+
+		std::string_view ParseString()
+		{
+			Expect('"');
+
+			const char* begin = m_cursor;
+
+			while (m_cursor < m_end && *m_cursor != '"')
+				m_cursor += *m_cursor == '\\' ? 2 : 1;
+
+			if (m_cursor >= m_end)
+				Fail();
+
+			return {begin, static_cast<size_t>(m_cursor++ - begin)};
+		}
+
+		JsonValue ParseValue(const uint32_t depth)
+		{
+			if (depth > s_maxDepth)
+				Fail();
+
+			SkipWhitespace();
+
+			if (m_cursor == m_end)
+				Fail();
+
+			JsonValue value;
+
+			switch (*m_cursor) {
+				case '{':
+					value.type = JsonValue::Type::Object;
+					m_cursor++;
+					SkipWhitespace();
+
+					if (m_cursor < m_end && *m_cursor == '}') {
+						m_cursor++;
+						break;
+					}
+
+					for (;;) {
+						value.keys.push_back(ParseString());
+						Expect(':');
+						value.elements.push_back(ParseValue(depth + 1));
+						SkipWhitespace();
+
+						if (m_cursor == m_end || *m_cursor != ',')
+							break;
+
+						m_cursor++;
+					}
+
+					Expect('}');
+					break;
+
+				case '[':
+					value.type = JsonValue::Type::Array;
+					m_cursor++;
+					SkipWhitespace();
+
+					if (m_cursor < m_end && *m_cursor == ']') {
+						m_cursor++;
+						break;
+					}
+
+					for (;;) {
+						value.elements.push_back(ParseValue(depth + 1));
+						SkipWhitespace();
+
+						if (m_cursor == m_end || *m_cursor != ',')
+							break;
+
+						m_cursor++;
+					}
+
+					Expect(']');
+					break;
+
+				case '"':
+					value.type = JsonValue::Type::String;
+					value.string = ParseString();
+					break;
+
+				case 't':
+				case 'f':
+					value.type = JsonValue::Type::Boolean;
+					value.number = *m_cursor == 't' ? 1.0 : 0.0;
+
+					if (!Consume("true") && !Consume("false"))
+						Fail();
+					break;
+
+				case 'n':
+					if (!Consume("null"))
+						Fail();
+					break;
+
+				default:
+				{
+					value.type = JsonValue::Type::Number;
+
+					const auto [next, error] = std::from_chars(m_cursor, m_end, value.number);
+
+					if (error != std::errc())
+						Fail();
+
+					m_cursor = next;
+					break;
+				}
+			}
+
+			return value;
+		}
+
+		const char* m_cursor;
+
+		const char* m_end;
+	};
+
+	// Where the elements of a glTF accessor are in the binary chunk, and how to read them
+	struct GltfAccessor
+	{
+		const uint8_t* data = nullptr;
+
+		size_t count = 0;
+
+		size_t stride = 0;
+
+		uint32_t componentType = 0;
+
+		uint32_t components = 0;
+
+		bool normalized = false;
+
+		[[nodiscard]] float ReadFloat(const size_t element, const uint32_t component) const
+		{
+			const uint8_t* source = data + element * stride;
+
+			switch (componentType) {
+				case 5120:
+				{
+					int8_t value;
+					memcpy(&value, source + component, sizeof(value));
+					return normalized ? std::max(value / 127.0f, -1.0f) : value;
+				}
+				case 5121:
+					return normalized ? source[component] / 255.0f : source[component];
+				case 5122:
+				{
+					int16_t value;
+					memcpy(&value, source + component * 2, sizeof(value));
+					return normalized ? std::max(value / 32767.0f, -1.0f) : value;
+				}
+				case 5123:
+				{
+					uint16_t value;
+					memcpy(&value, source + component * 2, sizeof(value));
+					return normalized ? value / 65535.0f : value;
+				}
+				default:
+				{
+					float value;
+					memcpy(&value, source + component * 4, sizeof(value));
+					return value;
+				}
+			}
+		}
+
+		[[nodiscard]] uint32_t ReadIndex(const size_t element) const
+		{
+			const uint8_t* source = data + element * stride;
+
+			switch (componentType) {
+				case 5121:
+					return source[0];
+				case 5123:
+				{
+					uint16_t value;
+					memcpy(&value, source, sizeof(value));
+					return value;
+				}
+				default:
+				{
+					uint32_t value;
+					memcpy(&value, source, sizeof(value));
+					return value;
+				}
+			}
+		}
+	};
+
+	uint32_t GetComponentSize(const uint32_t component_type)
+	{
+		switch (component_type) {
+			case 5120:
+			case 5121:
+				return 1;
+			case 5122:
+			case 5123:
+				return 2;
+			case 5125:
+			case 5126:
+				return 4;
+			default:
+				throw std::runtime_error("glTF accessor has an unknown component type!");
+		}
+	}
+
+	uint32_t GetComponentCount(const std::string_view type)
+	{
+		if (type == "SCALAR")
+			return 1;
+		if (type == "VEC2")
+			return 2;
+		if (type == "VEC3")
+			return 3;
+		if (type == "VEC4")
+			return 4;
+
+		throw std::runtime_error("glTF accessor type is not supported for geometry!");
+	}
+
+	/**
+	 * \brief Resolves an accessor through its buffer view into the binary chunk, checking that every element is inside.
+	 */
+	GltfAccessor GetAccessor(const JsonValue& gltf, const size_t index, const uint8_t* binary, const size_t binary_size)
+	{
+		const JsonValue& accessor = gltf.At("accessors", index);
+
+		if (accessor.Find("sparse"))
+			throw std::runtime_error("Sparse glTF accessors are not supported!");
+
+		const JsonValue* type = accessor.Find("type");
+
+		if (!type || type->type != JsonValue::Type::String)
+			throw std::runtime_error("glTF accessor has no type!");
+
+		GltfAccessor result{
+			.count = accessor.GetSize("count", 0),
+			.componentType = static_cast<uint32_t>(std::min<size_t>(accessor.GetSize("componentType", 0), UINT32_MAX)),
+			.components = GetComponentCount(type->string),
+			.normalized = accessor.Find("normalized") && accessor.Find("normalized")->number != 0.0
+		};
+
+		const size_t element_size = static_cast<size_t>(GetComponentSize(result.componentType)) * result.components;
+		const size_t view_index = accessor.GetIndex("bufferView");
+
+		if (view_index == std::numeric_limits<size_t>::max())
+			throw std::runtime_error("glTF accessors without a buffer view are not supported!");
+
+		const JsonValue& view = gltf.At("bufferViews", view_index);
+
+		if (view.GetIndex("buffer") != 0)
+			throw std::runtime_error("Only the binary chunk of a GLB can be used as a glTF buffer!");
+
+		const size_t view_offset = view.GetSize("byteOffset", 0);
+		const size_t view_length = view.GetSize("byteLength", 0);
+		const size_t accessor_offset = accessor.GetSize("byteOffset", 0);
+
+		result.stride = view.GetSize("byteStride", element_size);
+
+		if (view_offset > binary_size || view_length > binary_size - view_offset || result.stride < element_size)
+			throw std::runtime_error("glTF buffer view is outside of the binary chunk!");
+
+		if (accessor_offset > view_length || element_size > view_length - accessor_offset ||
+		    (result.count > 0 && result.count - 1 > (view_length - accessor_offset - element_size) / result.stride))
+			throw std::runtime_error("glTF accessor is outside of its buffer view!");
+
+		result.data = binary + view_offset + accessor_offset;
+
+		return result;
+	}
+
+	glm::mat4 GetNodeTransform(const JsonValue& node)
+	{
+		if (const JsonValue* matrix = node.Find("matrix"); matrix && matrix->elements.size() == 16) {
+			glm::mat4 transform;
+
+			for (int i = 0; i < 16; i++)
+				transform[i / 4][i % 4] = static_cast<float>(matrix->elements[i].number);
+
+			return transform;
+		}
+
+		glm::vec3 translation(0.0f);
+		glm::quat rotation(1.0f, 0.0f, 0.0f, 0.0f);
+		glm::vec3 scale(1.0f);
+
+		if (const JsonValue* value = node.Find("translation"); value && value->elements.size() == 3)
+			translation = {value->elements[0].number, value->elements[1].number, value->elements[2].number};
+
+		// Stored as x, y, z, w
+		if (const JsonValue* value = node.Find("rotation"); value && value->elements.size() == 4)
+			rotation = glm::quat(static_cast<float>(value->elements[3].number),
+			                     static_cast<float>(value->elements[0].number),
+			                     static_cast<float>(value->elements[1].number),
+			                     static_cast<float>(value->elements[2].number));
+
+		if (const JsonValue* value = node.Find("scale"); value && value->elements.size() == 3)
+			scale = {value->elements[0].number, value->elements[1].number, value->elements[2].number};
+
+		glm::mat4 transform(1.0f);
+		transform[3] = glm::vec4(translation, 1.0f);
+
+		return transform * glm::mat4_cast(rotation) * glm::mat4(glm::vec4(scale.x, 0.0f, 0.0f, 0.0f),
+		                                                        glm::vec4(0.0f, scale.y, 0.0f, 0.0f),
+		                                                        glm::vec4(0.0f, 0.0f, scale.z, 0.0f),
+		                                                        glm::vec4(0.0f, 0.0f, 0.0f, 1.0f));
+	}
+
+	// Appends a number to text without going through streams or locales
+	template < typename T >
+	void AppendNumber(std::string& text, const T value)
+	{
+		char buffer[32];
+
+		const auto [end, error] = std::to_chars(buffer, buffer + sizeof(buffer), value);
+
+		text.append(buffer, end);
+	}
+}
+
+/**
+ * \brief Loads a model, picking the format from its contents.
+ * \param file_path The path of the model, relative to the models folder.
+ * \return Its geometry as one triangle list, with every node transform of a glTF scene applied.
+ */
+MeshData MeshLoader::Load(const std::string& file_path)
+{
+	const std::string path = "assets/models/" + file_path;
+	const Timer timer;
+
+	const MappedFile file(path);
+
+	if (!file.IsOpen())
+		throw std::runtime_error("Failed to load mesh " + path + "!");
+
+	// Both formats are read once from front to back, apart from the scene description of a GLB
+	file.Advise(MappedFile::Access::Sequential);
+
+	const auto* data = reinterpret_cast<const uint8_t*>(file.GetData());
+	uint32_t magic = 0;
+
+	if (file.GetSize() >= sizeof(magic))
+		memcpy(&magic, data, sizeof(magic));
+
+	MeshData mesh = magic == s_glbMagic ? LoadGlb(data, file.GetSize()) : LoadObj(file.GetView());
+
+	const float seconds = timer.Elapsed();
+	const float megabytes = static_cast<float>(file.GetSize()) / (1024.0f * 1024.0f);
+
+	VK_CORE_TRACE("Mesh {0}: {1} vertices, {2} triangles from {3:.1f} MiB in {4:.1f} ms ({5:.0f} MiB/s)", path,
+	              mesh.vertices.size(), mesh.indices.size() / 3, megabytes, seconds * 1000.0f, megabytes / seconds);
+
+	return mesh;
+}
+
+/**
+ * \brief Parses a Wavefront OBJ model. Positions, texture coordinates, normals and faces are read; polygons are
+ * triangulated as fans, and everything else (groups, materials, lines) is skipped.
+ * Texture coordinates are flipped vertically, since OBJ puts the origin at the bottom and Vulkan at the top.
+ * \param text The contents of the file.
+ * \return The triangles, with a vertex for every distinct combination of position, coordinate and normal.
+ */
+MeshData MeshLoader::LoadObj(const std::string_view text)
+{
+	std::vector<glm::vec3> positions;
+	std::vector<glm::vec2> tex_coords;
+	std::vector<glm::vec3> normals;
+
+	MeshData mesh;
+	ObjVertexTable table;
+
+	// Reused for every face, so only the largest polygon allocates
+	std::vector<uint32_t> polygon;
+
+	const char* cursor = text.data();
+	const char* end = cursor + text.size();
+
+	auto fail = [&text](const char* position)
+	{
+		const size_t line = std::count(text.data(), position, '\n') + 1;
+
+		throw std::runtime_error("Malformed OBJ at line " + std::to_string(line) + "!");
+	};
+
+	while (cursor < end) {
+		// memchr is vectorized by every C runtime, which makes finding the lines as fast as reading the memory
+		auto line_end = static_cast<const char*>(memchr(cursor, '\n', static_cast<size_t>(end - cursor)));
+
+		if (!line_end)
+			line_end = end;
+
+		const char* line = SkipSpaces(cursor, line_end);
+
+		if (line_end - line >= 2 && line[0] == 'v') {
+			const char* values = line + 2;
+
+			if (line[1] == ' ' || line[1] == '\t') {
+				glm::vec3& position = positions.emplace_back();
+
+				if (!ParseFloat(values, line_end, position.x) || !ParseFloat(values, line_end, position.y) ||
+				    !ParseFloat(values, line_end, position.z))
+					fail(line);
+			} else if (line[1] == 't') {
+				glm::vec2& tex_coord = tex_coords.emplace_back(0.0f);
+
+				if (!ParseFloat(values, line_end, tex_coord.x))
+					fail(line);
+
+				ParseFloat(values, line_end, tex_coord.y);
+
+				tex_coord.y = 1.0f - tex_coord.y;
+			} else if (line[1] == 'n') {
+				glm::vec3& normal = normals.emplace_back();
+
+				if (!ParseFloat(values, line_end, normal.x) || !ParseFloat(values, line_end, normal.y) ||
+				    !ParseFloat(values, line_end, normal.z))
+					fail(line);
+			}
+		} else if (line_end - line >= 2 && line[0] == 'f' && IsSpace(line[1])) {
+			polygon.clear();
+
+			for (const char* token = SkipSpaces(line + 2, line_end); token < line_end;
+			     token = SkipSpaces(token, line_end)) {
+				int64_t index;
+				ObjVertexKey key{s_missing, s_missing, s_missing};
+
+				if (!ParseInteger(token, line_end, index))
+					fail(line);
+
+				key.position = ResolveObjIndex(index, positions.size());
+
+				if (token < line_end && *token == '/') {
+					token++;
+
+					if (token < line_end && *token != '/') {
+						if (!ParseInteger(token, line_end, index))
+							fail(line);
+
+						key.texCoord = ResolveObjIndex(index, tex_coords.size());
+					}
+
+					if (token < line_end && *token == '/') {
+						token++;
+
+						if (!ParseInteger(token, line_end, index))
+							fail(line);
+
+						key.normal = ResolveObjIndex(index, normals.size());
+					}
+				}
+
+				if (token < line_end && !IsSpace(*token))
+					fail(line);
+
+				bool added;
+				const uint32_t vertex = table.Find(key, added);
+
+				if (added)
+					mesh.vertices.push_back(MeshVertex{
+						.position = positions[key.position],
+						.normal = key.normal != s_missing ? normals[key.normal] : glm::vec3(0.0f),
+						.texCoord = key.texCoord != s_missing ? tex_coords[key.texCoord] : glm::vec2(0.0f)
+					});
+
+				polygon.push_back(vertex);
+			}
+
+			if (polygon.size() < 3)
+				fail(line);
+
+			for (size_t i = 2; i < polygon.size(); i++)
+				mesh.indices.insert(mesh.indices.end(), {polygon[0], polygon[i - 1], polygon[i]});
+		}
+
+		cursor = line_end + 1;
+	}
+
+	std::vector<bool> missing_normals(mesh.vertices.size());
+	bool any_missing = false;
+
+	for (uint32_t vertex = 0; vertex < mesh.vertices.size(); vertex++)
+		if (table.GetKey(vertex).normal == s_missing) {
+			missing_normals[vertex] = true;
+			any_missing = true;
+		}
+
+	if (any_missing)
+		GenerateNormals(mesh, 0, 0, missing_normals);
+
+	return mesh;
+}
+
+/**
+ * \brief Parses a binary glTF 2.0 model. Every triangle primitive of the default scene is added with its node
+ * transforms applied, reading positions, normals and the first texture coordinates. Materials, skins, animations
+ * and compression extensions are not supported.
+ * \param data The contents of the file.
+ * \param size The size of the file in bytes.
+ * \return The triangles of all primitives, as one list.
+ */
+MeshData MeshLoader::LoadGlb(const uint8_t* data, const size_t size)
+{
+	auto read_u32 = [data](const size_t offset)
+	{
+		uint32_t value;
+		memcpy(&value, data + offset, sizeof(value));
+		return value;
+	};
+
+	if (size < 20 || read_u32(0) != s_glbMagic || read_u32(4) != 2)
+		throw std::runtime_error("Not a glTF 2.0 binary file!");
+
+	// The length in the header is trusted only as far as the file goes, and has to cover the header itself
+	const size_t total_size = std::min<size_t>(read_u32(8), size);
+	const size_t json_size = read_u32(12);
+
+	if (total_size < 20)
+		throw std::runtime_error("glTF binary file is shorter than its header!");
+
+	if (read_u32(16) != s_glbJsonChunk || json_size > total_size - 20)
+		throw std::runtime_error("glTF binary file has no JSON chunk!");
+
+	const auto* json = reinterpret_cast<const char*>(data + 20);
+
+	const uint8_t* binary = nullptr;
+	size_t binary_size = 0;
+
+	// Chunks are aligned to 4 bytes, and the binary chunk is optional
+	if (const size_t binary_header = 20 + ((json_size + 3) & ~size_t{3}); binary_header + 8 <= total_size &&
+	                                                                       read_u32(binary_header + 4) ==
+	                                                                       s_glbBinaryChunk) {
+		binary = data + binary_header + 8;
+		binary_size = std::min<size_t>(read_u32(binary_header), total_size - binary_header - 8);
+	}
+
+	const JsonValue gltf = JsonParser(json, json + json_size).Parse();
+
+	if (const JsonValue* required = gltf.Find("extensionsRequired"); required && !required->elements.empty())
+		throw std::runtime_error("glTF file requires extension " + std::string(required->elements[0].string) +
+		                         ", which is not supported!");
+
+	MeshData mesh;
+	std::vector<bool> missing_normals;
+
+	const JsonValue* meshes = gltf.Find("meshes");
+	const JsonValue* nodes = gltf.Find("nodes");
+
+	if (!meshes)
+		return mesh;
+
+	auto add_mesh = [&](const JsonValue& gltf_mesh, const glm::mat4& transform)
+	{
+		const auto normal_matrix = glm::mat3(glm::transpose(glm::inverse(transform)));
+
+		// A mirroring transform turns counter-clockwise triangles clockwise, which the winding has to undo
+		const bool mirrored = glm::determinant(glm::mat3(transform)) < 0.0f;
+		const JsonValue* primitives = gltf_mesh.Find("primitives");
+
+		if (!primitives)
+			return;
+
+		for (const JsonValue& primitive : primitives->elements) {
+			// Points, lines and strips are skipped rather than drawn as something they are not
+			if (primitive.GetNumber("mode", 4.0) != 4.0)
+				continue;
+
+			const JsonValue* attributes = primitive.Find("attributes");
+
+			if (!attributes || !attributes->Find("POSITION"))
+				continue;
+
+			const GltfAccessor positions = GetAccessor(gltf, attributes->GetIndex("POSITION"), binary, binary_size);
+
+			if (positions.components != 3)
+				throw std::runtime_error("glTF positions must have three components!");
+
+			GltfAccessor normals, tex_coords;
+
+			if (attributes->Find("NORMAL"))
+				normals = GetAccessor(gltf, attributes->GetIndex("NORMAL"), binary, binary_size);
+
+			if (attributes->Find("TEXCOORD_0"))
+				tex_coords = GetAccessor(gltf, attributes->GetIndex("TEXCOORD_0"), binary, binary_size);
+
+			if ((normals.data && (normals.count != positions.count || normals.components != 3)) ||
+			    (tex_coords.data && (tex_coords.count != positions.count || tex_coords.components != 2)))
+				throw std::runtime_error("glTF attributes of a primitive don't match!");
+
+			const size_t first_vertex = mesh.vertices.size();
+			const size_t first_index = mesh.indices.size();
+
+			for (size_t i = 0; i < positions.count; i++) {
+				const glm::vec4 position = transform * glm::vec4(positions.ReadFloat(i, 0), positions.ReadFloat(i, 1),
+				                                                 positions.ReadFloat(i, 2), 1.0f);
+
+				MeshVertex& vertex = mesh.vertices.emplace_back(MeshVertex{
+					.position = glm::vec3(position),
+					.normal = glm::vec3(0.0f),
+					.texCoord = glm::vec2(0.0f)
+				});
+
+				if (normals.data) {
+					const glm::vec3 normal = normal_matrix * glm::vec3(normals.ReadFloat(i, 0), normals.ReadFloat(i, 1),
+					                                                   normals.ReadFloat(i, 2));
+					const float length = glm::length(normal);
+
+					vertex.normal = length > 0.0f ? normal / length : normal;
+				}
+
+				if (tex_coords.data)
+					vertex.texCoord = {tex_coords.ReadFloat(i, 0), tex_coords.ReadFloat(i, 1)};
+			}
+
+			if (const size_t indices_index = primitive.GetIndex("indices");
+				indices_index != std::numeric_limits<size_t>::max()) {
+				const GltfAccessor indices = GetAccessor(gltf, indices_index, binary, binary_size);
+
+				if (indices.components != 1 || indices.count % 3 != 0)
+					throw std::runtime_error("glTF indices must be a list of whole triangles!");
+
+				if (indices.componentType != 5121 && indices.componentType != 5123 && indices.componentType != 5125)
+					throw std::runtime_error("glTF indices must be unsigned bytes, shorts or ints!");
+
+				mesh.indices.reserve(first_index + indices.count);
+
+				for (size_t i = 0; i < indices.count; i++) {
+					const uint32_t index = indices.ReadIndex(i);
+
+					if (index >= positions.count)
+						throw std::runtime_error("glTF index refers to a vertex that doesn't exist!");
+
+					mesh.indices.push_back(static_cast<uint32_t>(first_vertex) + index);
+				}
+			} else {
+				for (size_t i = 0; i + 2 < positions.count; i += 3)
+					mesh.indices.insert(mesh.indices.end(), {
+						                    static_cast<uint32_t>(first_vertex + i),
+						                    static_cast<uint32_t>(first_vertex + i + 1),
+						                    static_cast<uint32_t>(first_vertex + i + 2)
+					                    });
+			}
+
+			if (mirrored)
+				for (size_t i = first_index; i + 2 < mesh.indices.size(); i += 3)
+					std::swap(mesh.indices[i + 1], mesh.indices[i + 2]);
+
+			if (!normals.data) {
+				missing_normals.assign(mesh.vertices.size() - first_vertex, true);
+				GenerateNormals(mesh, first_vertex, first_index, missing_normals);
+			}
+		}
+	};
+
+	const JsonValue* scenes = gltf.Find("scenes");
+
+	// Without a scene, every mesh is added once as it is
+	if (!scenes || !nodes || scenes->elements.empty()) {
+		for (const JsonValue& gltf_mesh : meshes->elements)
+			add_mesh(gltf_mesh, glm::mat4(1.0f));
+
+		return mesh;
+	}
+
+	// Nodes form trees, so a node that is reached twice is part of a cycle or has two parents
+	std::vector<bool> visited(nodes->elements.size());
+
+	auto add_node = [&](auto& self, const JsonValue& node_number, const glm::mat4& parent, const uint32_t depth) -> void
+	{
+		if (depth > s_maxNodeDepth)
+			throw std::runtime_error("glTF nodes nest too deep!");
+
+		const size_t node_index = node_number.AsIndex();
+		const JsonValue& node = nodes->At(node_index);
+
+		if (visited[node_index])
+			throw std::runtime_error("glTF node " + std::to_string(node_index) + " is reached more than once!");
+
+		visited[node_index] = true;
+
+		const glm::mat4 transform = parent * GetNodeTransform(node);
+
+		if (const size_t mesh_index = node.GetIndex("mesh"); mesh_index != std::numeric_limits<size_t>::max())
+			add_mesh(meshes->At(mesh_index), transform);
+
+		if (const JsonValue* children = node.Find("children"))
+			for (const JsonValue& child : children->elements)
+				self(self, child, transform, depth + 1);
+	};
+
+	const size_t scene_index = gltf.Find("scene") ? gltf.GetIndex("scene") : 0;
+
+	if (const JsonValue* scene_nodes = scenes->At(scene_index).Find("nodes"))
+		for (const JsonValue& node : scene_nodes->elements)
+			add_node(add_node, node, glm::mat4(1.0f), 0);
+
+	return mesh;
+}
+
+/**
+ * \brief Measures parsing on generated models, a grid of quads written both as OBJ text and as a GLB file.
+ * The files are built in memory, so only the parsers are timed, not the disk.
+ * \param grid_size The number of quads along each side, the models have twice its square in triangles.
+ */
+void MeshLoader::Benchmark(const uint32_t grid_size)
+{
+	const uint32_t side = grid_size + 1;
+	const size_t vertex_count = static_cast<size_t>(side) * side;
+	const size_t triangle_count = static_cast<size_t>(grid_size) * grid_size * 2;
+
+	std::string obj;
+	obj.reserve(vertex_count * 64 + triangle_count * 48);
+
+	std::vector<float> positions, tex_coords;
+	std::vector<uint32_t> indices;
+
+	for (uint32_t y = 0; y < side; y++)
+		for (uint32_t x = 0; x < side; x++) {
+			const float u = static_cast<float>(x) / static_cast<float>(grid_size);
+			const float v = static_cast<float>(y) / static_cast<float>(grid_size);
+			const float height = 0.05f * std::sin(u * 31.0f) * std::cos(v * 17.0f);
+
+			positions.insert(positions.end(), {u * 2.0f - 1.0f, height, v * 2.0f - 1.0f});
+			tex_coords.insert(tex_coords.end(), {u, v});
+
+			obj += "v ";
+			AppendNumber(obj, u * 2.0f - 1.0f);
+			obj += ' ';
+			AppendNumber(obj, height);
+			obj += ' ';
+			AppendNumber(obj, v * 2.0f - 1.0f);
+			obj += "\nvt ";
+			AppendNumber(obj, u);
+			obj += ' ';
+			AppendNumber(obj, 1.0f - v);
+			obj += '\n';
+		}
+
+	obj += "vn 0 1 0\n";
+
+	for (uint32_t y = 0; y < grid_size; y++)
+		for (uint32_t x = 0; x < grid_size; x++) {
+			const uint32_t corner = y * side + x;
+
+			for (const uint32_t index : {corner, corner + side, corner + 1, corner + 1, corner + side, corner + side + 1}) {
+				indices.push_back(index);
+
+				obj += indices.size() % 3 == 1 ? "f " : " ";
+				AppendNumber(obj, index + 1);
+				obj += '/';
+				AppendNumber(obj, index + 1);
+				obj += "/1";
+
+				if (indices.size() % 3 == 0)
+					obj += '\n';
+			}
+		}
+
+	// The GLB holds the same grid, without normals so that generating them is part of the measurement
+	const size_t positions_size = positions.size() * sizeof(float);
+	const size_t tex_coords_size = tex_coords.size() * sizeof(float);
+	const size_t indices_size = indices.size() * sizeof(uint32_t);
+
+	std::string json = "{\"asset\":{\"version\":\"2.0\"},\"buffers\":[{\"byteLength\":";
+	AppendNumber(json, positions_size + tex_coords_size + indices_size);
+	json += "}],\"bufferViews\":[{\"buffer\":0,\"byteLength\":";
+	AppendNumber(json, positions_size);
+	json += "},{\"buffer\":0,\"byteOffset\":";
+	AppendNumber(json, positions_size);
+	json += ",\"byteLength\":";
+	AppendNumber(json, tex_coords_size);
+	json += "},{\"buffer\":0,\"byteOffset\":";
+	AppendNumber(json, positions_size + tex_coords_size);
+	json += ",\"byteLength\":";
+	AppendNumber(json, indices_size);
+	json += "}],\"accessors\":[{\"bufferView\":0,\"componentType\":5126,\"type\":\"VEC3\",\"count\":";
+	AppendNumber(json, vertex_count);
+	json += "},{\"bufferView\":1,\"componentType\":5126,\"type\":\"VEC2\",\"count\":";
+	AppendNumber(json, vertex_count);
+	json += "},{\"bufferView\":2,\"componentType\":5125,\"type\":\"SCALAR\",\"count\":";
+	AppendNumber(json, indices.size());
+	json += "}],\"meshes\":[{\"primitives\":[{\"attributes\":{\"POSITION\":0,\"TEXCOORD_0\":1},\"indices\":2}]}],"
+		"\"nodes\":[{\"mesh\":0}],\"scenes\":[{\"nodes\":[0]}],\"scene\":0}";
+
+	json.resize((json.size() + 3) & ~size_t{3}, ' ');
+
+	const size_t binary_size = positions_size + tex_coords_size + indices_size;
+	std::vector<uint8_t> glb(28 + json.size() + binary_size);
+
+	auto write_u32 = [&glb](const size_t offset, const size_t value)
+	{
+		const auto value_u32 = static_cast<uint32_t>(value);
+		memcpy(glb.data() + offset, &value_u32, sizeof(value_u32));
+	};
+
+	write_u32(0, s_glbMagic);
+	write_u32(4, 2);
+	write_u32(8, glb.size());
+	write_u32(12, json.size());
+	write_u32(16, s_glbJsonChunk);
+	memcpy(glb.data() + 20, json.data(), json.size());
+
+	uint8_t* binary = glb.data() + 28 + json.size();
+	write_u32(20 + json.size(), binary_size);
+	write_u32(24 + json.size(), s_glbBinaryChunk);
+	memcpy(binary, positions.data(), positions_size);
+	memcpy(binary + positions_size, tex_coords.data(), tex_coords_size);
+	memcpy(binary + positions_size + tex_coords_size, indices.data(), indices_size);
+
+	VK_CORE_INFO("Mesh loading benchmark: {0} vertices, {1} triangles", vertex_count, triangle_count);
+
+	auto measure = [triangle_count](const char* name, const size_t size, auto&& load)
+	{
+		// The best of a few runs, so that page faults of the first run don't count
+		float best = std::numeric_limits<float>::max();
+
+		for (int run = 0; run < 3; run++) {
+			const Timer timer;
+			const MeshData mesh = load();
+			best = std::min(best, timer.Elapsed());
+
+			if (mesh.indices.size() != triangle_count * 3)
+				VK_CORE_ERROR("{0} parsed {1} triangles instead of {2}", name, mesh.indices.size() / 3, triangle_count);
+		}
+
+		const float megabytes = static_cast<float>(size) / (1024.0f * 1024.0f);
+
+		VK_CORE_INFO("  {0}: {1:.1f} MiB in {2:.1f} ms, {3:.0f} MiB/s, {4:.1f} M triangles/s", name, megabytes,
+		             best * 1000.0f, megabytes / best, static_cast<float>(triangle_count) / best / 1e6f);
+	};
+
+	measure("OBJ", obj.size(), [&obj] { return LoadObj(obj); });
+	measure("GLB", glb.size(), [&glb] { return LoadGlb(glb.data(), glb.size()); });
+}
+
+/**
+ * \brief Measures loading a model from disk, including mapping and reading the file.
+ * \param file_path The path of the model, relative to the models folder.
+ */
+void MeshLoader::Benchmark(const std::string& file_path)
+{
+	std::error_code error;
+	const uintmax_t size = std::filesystem::file_size("assets/models/" + file_path, error);
+
+	const Timer timer;
+	const MeshData mesh = Load(file_path);
+	const float seconds = timer.Elapsed();
+
+	const float megabytes = error ? 0.0f : static_cast<float>(size) / (1024.0f * 1024.0f);
+
+	VK_CORE_INFO("Mesh {0}: {1} vertices, {2} triangles, {3:.1f} MiB in {4:.1f} ms, {5:.0f} MiB/s", file_path,
+	             mesh.vertices.size(), mesh.indices.size() / 3, megabytes, seconds * 1000.0f, megabytes / seconds);
+}
+
+/**
+ * \brief Gives vertices without a normal the average of the faces around them, weighted by area.
+ * \param mesh The mesh, whose triangles from first_index on only use vertices from first_vertex on.
+ * \param first_vertex The first vertex that is looked at.
+ * \param first_index The first index that is looked at.
+ * \param missing Whether each vertex from first_vertex on needs a normal.
+ */
+void MeshLoader::GenerateNormals(MeshData& mesh,
+                                 const size_t first_vertex,
+                                 const size_t first_index,
+                                 const std::vector<bool>& missing)
+{
+	std::vector<glm::vec3> sums(mesh.vertices.size() - first_vertex, glm::vec3(0.0f));
+
+	for (size_t i = first_index; i + 2 < mesh.indices.size(); i += 3) {
+		const uint32_t a = mesh.indices[i], b = mesh.indices[i + 1], c = mesh.indices[i + 2];
+
+		// The cross product is twice the area, which weighs every face by its size
+		const glm::vec3 face = glm::cross(mesh.vertices[b].position - mesh.vertices[a].position,
+		                                  mesh.vertices[c].position - mesh.vertices[a].position);
+
+		for (const uint32_t vertex : {a, b, c})
+			sums[vertex - first_vertex] += face;
+	}
+
+	for (size_t vertex = 0; vertex < sums.size(); vertex++) {
+		if (!missing[vertex])
+			continue;
+
+		const float length = glm::length(sums[vertex]);
+
+		mesh.vertices[first_vertex + vertex].normal = length > 0.0f ? sums[vertex] / length : glm::vec3(0.0f, 1.0f, 0.0f);
+	}
+}
@@ -0,0 +1,38 @@
+﻿#pragma once
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <string_view>
+#include <vector>
+
+#include "Vertex.h"
+
+// The geometry of a model as one indexed triangle list, ready to be uploaded
+struct MeshData
+{
+	std::vector<MeshVertex> vertices;
+
+	std::vector<uint32_t> indices;
+};
+
+/**
+ * \brief Reads Wavefront OBJ and binary glTF 2.0 (GLB) models into indexed triangle lists.
+ * Files are mapped and parsed in one pass, without allocating per token: text is scanned in place,
+ * and OBJ vertices are deduplicated through chains per position index instead of hashing.
+ */
+class MeshLoader
+{
+public:
+	static MeshData Load(const std::string& file_path);
+
+	static MeshData LoadObj(std::string_view text);
+
+	static MeshData LoadGlb(const uint8_t* data, size_t size);
+
+	static void Benchmark(uint32_t grid_size);
+
+	static void Benchmark(const std::string& file_path);
+
+private:
+	static void GenerateNormals(MeshData& mesh, size_t first_vertex, size_t first_index, const std::vector<bool>& missing);
+};
@@ -0,0 +1,504 @@
+﻿#include "MeshOptimizer.h"
+
+#include <algorithm>
+#include <cmath>
+#include <limits>
+#include <numeric>
+#include <random>
+
+#include "MeshLoader.h"
+#include "Core/Log.h"
+#include "Core/Timer.h"
+
+namespace
+{
+	constexpr uint32_t s_unused = std::numeric_limits<uint32_t>::max();
+
+	/**
+	 * \brief A FIFO post-transform cache, the model that hardware caches are closest to. Entries are timestamps,
+	 * so a vertex is cached if fewer than the cache size of misses happened since it was last loaded.
+	 */
+	class FifoCache
+	{
+	public:
+		FifoCache(const size_t vertex_count, const uint32_t cache_size)
+			: m_timestamps(vertex_count, 0), m_cacheSize(cache_size), m_time(cache_size + 1) {}
+
+		// Uses a vertex, and returns whether it had to be transformed
+		bool Access(const uint32_t vertex)
+		{
+			if (m_time - m_timestamps[vertex] <= m_cacheSize)
+				return false;
+
+			m_timestamps[vertex] = m_time++;
+			return true;
+		}
+
+		// Forgets everything, as if the triangles that follow were drawn on their own
+		void Clear() { m_time += m_cacheSize + 1; }
+
+	private:
+		std::vector<uint64_t> m_timestamps;
+
+		uint64_t m_cacheSize;
+
+		uint64_t m_time;
+	};
+
+	// Which triangles use each vertex, as one flat list
+	struct Adjacency
+	{
+		std::vector<uint32_t> offsets;
+
+		std::vector<uint32_t> counts;
+
+		std::vector<uint32_t> triangles;
+	};
+
+	Adjacency BuildAdjacency(const std::vector<uint32_t>& indices, const size_t vertex_count)
+	{
+		Adjacency adjacency{
+			.offsets = std::vector<uint32_t>(vertex_count, 0),
+			.counts = std::vector<uint32_t>(vertex_count, 0),
+			.triangles = std::vector<uint32_t>(indices.size())
+		};
+
+		for (const uint32_t index : indices)
+			adjacency.counts[index]++;
+
+		for (size_t vertex = 1; vertex < vertex_count; vertex++)
+			adjacency.offsets[vertex] = adjacency.offsets[vertex - 1] + adjacency.counts[vertex - 1];
+
+		std::vector<uint32_t> fill(adjacency.offsets);
+
+		for (size_t i = 0; i < indices.size(); i++)
+			adjacency.triangles[fill[indices[i]]++] = static_cast<uint32_t>(i / 3);
+
+		return adjacency;
+	}
+
+	// Shuffles the triangles of a mesh, which stands in for index orders that were never optimized
+	void ShuffleTriangles(MeshData& mesh, const uint32_t seed)
+	{
+		std::vector<uint32_t> order(mesh.indices.size() / 3);
+		std::iota(order.begin(), order.end(), 0);
+		std::ranges::shuffle(order, std::mt19937(seed));
+
+		std::vector<uint32_t> indices;
+		indices.reserve(mesh.indices.size());
+
+		for (const uint32_t triangle : order)
+			indices.insert(indices.end(), mesh.indices.begin() + triangle * 3, mesh.indices.begin() + triangle * 3 + 3);
+
+		mesh.indices = std::move(indices);
+	}
+
+	MeshData GenerateGrid(const uint32_t grid_size)
+	{
+		MeshData mesh;
+		const uint32_t side = grid_size + 1;
+
+		for (uint32_t y = 0; y < side; y++)
+			for (uint32_t x = 0; x < side; x++)
+				mesh.vertices.push_back(MeshVertex{
+					.position = {static_cast<float>(x), 0.0f, static_cast<float>(y)},
+					.normal = {0.0f, 1.0f, 0.0f},
+					.texCoord = {static_cast<float>(x) / grid_size, static_cast<float>(y) / grid_size}
+				});
+
+		for (uint32_t y = 0; y < grid_size; y++)
+			for (uint32_t x = 0; x < grid_size; x++) {
+				const uint32_t corner = y * side + x;
+
+				mesh.indices.insert(mesh.indices.end(), {
+					                    corner, corner + side, corner + 1, corner + 1, corner + side, corner + side + 1
+				                    });
+			}
+
+		return mesh;
+	}
+
+	MeshData GenerateSphere(const uint32_t rings, const uint32_t segments)
+	{
+		MeshData mesh;
+
+		for (uint32_t ring = 0; ring <= rings; ring++)
+			for (uint32_t segment = 0; segment <= segments; segment++) {
+				const float theta = 3.14159265f * static_cast<float>(ring) / rings;
+				const float phi = 6.28318531f * static_cast<float>(segment) / segments;
+				const glm::vec3 normal(std::sin(theta) * std::cos(phi), std::cos(theta), std::sin(theta) * std::sin(phi));
+
+				mesh.vertices.push_back(MeshVertex{
+					.position = normal,
+					.normal = normal,
+					.texCoord = {static_cast<float>(segment) / segments, static_cast<float>(ring) / rings}
+				});
+			}
+
+		for (uint32_t ring = 0; ring < rings; ring++)
+			for (uint32_t segment = 0; segment < segments; segment++) {
+				const uint32_t corner = ring * (segments + 1) + segment;
+
+				mesh.indices.insert(mesh.indices.end(), {
+					                    corner, corner + 1, corner + segments + 1,
+					                    corner + 1, corner + segments + 2, corner + segments + 1
+				                    });
+			}
+
+		return mesh;
+	}
+}
+
+/**
+ * \brief Runs every optimization in order: the vertex cache order comes first, the overdraw sort only moves whole
+ * clusters of it, and reordering the vertices last doesn't change either.
+ * \param mesh The mesh to reorder in place.
+ * \param overdraw_threshold How much worse the vertex cache may get for a better overdraw order, 1 keeps it as is.
+ */
+void MeshOptimizer::Optimize(MeshData& mesh, const float overdraw_threshold)
+{
+	if (mesh.indices.empty())
+		return;
+
+	const std::vector<size_t> clusters = OptimizeVertexCache(mesh);
+
+	OptimizeOverdraw(mesh, clusters, overdraw_threshold);
+	OptimizeVertexFetch(mesh);
+}
+
+/**
+ * \brief Reorders the triangles for the post-transform vertex cache with Tipsify (Sander, Nehab and Barczak 2007).
+ * Triangles are emitted as fans around a vertex, and the next fan is picked among the vertices just emitted,
+ * preferring those still in the cache with few triangles left. Runs in linear time.
+ * \param mesh The mesh whose indices are reordered.
+ * \return Where each cluster starts, in triangles: the points where no emitted vertex had triangles left,
+ * so the cache starts over anyway and the order of the clusters doesn't matter to it.
+ */
+std::vector<size_t> MeshOptimizer::OptimizeVertexCache(MeshData& mesh)
+{
+	const std::vector<uint32_t>& indices = mesh.indices;
+	const size_t vertex_count = mesh.vertices.size();
+	const size_t triangle_count = indices.size() / 3;
+
+	const Adjacency adjacency = BuildAdjacency(indices, vertex_count);
+
+	std::vector<uint32_t> live(adjacency.counts);
+	std::vector<uint64_t> timestamps(vertex_count, 0);
+	std::vector<bool> emitted(triangle_count, false);
+
+	std::vector<uint32_t> dead_ends;
+	std::vector<uint32_t> candidates;
+	std::vector<size_t> clusters;
+
+	std::vector<uint32_t> result;
+	result.reserve(indices.size());
+
+	uint64_t time = s_cacheSize + 1;
+	size_t cursor = 0;
+
+	// Gets a vertex that still has triangles, from the recently emitted ones first, then in index order
+	auto skip_dead_end = [&]() -> uint32_t
+	{
+		while (!dead_ends.empty()) {
+			const uint32_t vertex = dead_ends.back();
+			dead_ends.pop_back();
+
+			if (live[vertex] > 0)
+				return vertex;
+		}
+
+		for (; cursor < vertex_count; cursor++)
+			if (live[cursor] > 0)
+				return static_cast<uint32_t>(cursor);
+
+		return s_unused;
+	};
+
+	for (uint32_t fanning = skip_dead_end(); fanning != s_unused;) {
+		candidates.clear();
+
+		for (uint32_t i = 0; i < adjacency.counts[fanning]; i++) {
+			const uint32_t triangle = adjacency.triangles[adjacency.offsets[fanning] + i];
+
+			if (emitted[triangle])
+				continue;
+
+			for (uint32_t corner = 0; corner < 3; corner++) {
+				const uint32_t vertex = indices[triangle * 3 + corner];
+
+				result.push_back(vertex);
+				dead_ends.push_back(vertex);
+				candidates.push_back(vertex);
+				live[vertex]--;
+
+				if (time - timestamps[vertex] > s_cacheSize)
+					timestamps[vertex] = time++;
+			}
+
+			emitted[triangle] = true;
+		}
+
+		// The candidate that stays in the cache for all of its remaining triangles, and has been in it the longest
+		uint32_t next = s_unused;
+		int64_t best_priority = -1;
+
+		for (const uint32_t vertex : candidates) {
+			if (live[vertex] == 0)
+				continue;
+
+			int64_t priority = 0;
+
+			if (time - timestamps[vertex] + 2 * live[vertex] <= s_cacheSize)
+				priority = static_cast<int64_t>(time - timestamps[vertex]);
+
+			if (priority > best_priority) {
+				best_priority = priority;
+				next = vertex;
+			}
+		}
+
+		if (next == s_unused) {
+			next = skip_dead_end();
+
+			if (next != s_unused)
+				clusters.push_back(result.size() / 3);
+		}
+
+		fanning = next;
+	}
+
+	mesh.indices = std::move(result);
+
+	clusters.insert(clusters.begin(), 0);
+
+	return clusters;
+}
+
+/**
+ * \brief Sorts clusters of triangles so that those facing away from the center of the mesh are drawn first,
+ * which from most views are the ones in front, and hide what is drawn after them (Sander et al. 2007).
+ * Clusters are split further where that costs the vertex cache less than the threshold.
+ * \param mesh The mesh whose indices are reordered.
+ * \param clusters Where the clusters of the vertex cache order start, in triangles.
+ * \param threshold How much the cache misses of a cluster may grow by splitting it, e.g. 1.05 for 5%.
+ */
+void MeshOptimizer::OptimizeOverdraw(MeshData& mesh, const std::vector<size_t>& clusters, const float threshold)
+{
+	const size_t triangle_count = mesh.indices.size() / 3;
+
+	if (triangle_count == 0)
+		return;
+
+	const std::vector<size_t> split = SplitClusters(mesh, clusters, threshold);
+
+	glm::vec3 mesh_center(0.0f);
+	float mesh_area = 0.0f;
+
+	std::vector<glm::vec3> centers(split.size());
+	std::vector<glm::vec3> normals(split.size());
+
+	for (size_t cluster = 0; cluster < split.size(); cluster++) {
+		const size_t end = cluster + 1 < split.size() ? split[cluster + 1] : triangle_count;
+
+		glm::vec3 center(0.0f), normal(0.0f);
+		float area = 0.0f;
+
+		for (size_t triangle = split[cluster]; triangle < end; triangle++) {
+			const glm::vec3& a = mesh.vertices[mesh.indices[triangle * 3]].position;
+			const glm::vec3& b = mesh.vertices[mesh.indices[triangle * 3 + 1]].position;
+			const glm::vec3& c = mesh.vertices[mesh.indices[triangle * 3 + 2]].position;
+
+			const glm::vec3 cross = glm::cross(b - a, c - a);
+			const float triangle_area = glm::length(cross);
+
+			center += (a + b + c) * (triangle_area / 3.0f);
+			normal += cross;
+			area += triangle_area;
+		}
+
+		mesh_center += center;
+		mesh_area += area;
+
+		centers[cluster] = area > 0.0f ? center / area : center;
+		normals[cluster] = glm::length(normal) > 0.0f ? glm::normalize(normal) : normal;
+	}
+
+	if (mesh_area > 0.0f)
+		mesh_center /= mesh_area;
+
+	std::vector<float> facing(split.size());
+
+	for (size_t cluster = 0; cluster < split.size(); cluster++)
+		facing[cluster] = glm::dot(centers[cluster] - mesh_center, normals[cluster]);
+
+	std::vector<size_t> order(split.size());
+	std::iota(order.begin(), order.end(), 0);
+
+	std::ranges::stable_sort(order, [&facing](const size_t a, const size_t b) { return facing[a] > facing[b]; });
+
+	std::vector<uint32_t> indices;
+	indices.reserve(mesh.indices.size());
+
+	for (const size_t cluster : order) {
+		const size_t end = cluster + 1 < split.size() ? split[cluster + 1] : triangle_count;
+
+		indices.insert(indices.end(), mesh.indices.begin() + split[cluster] * 3, mesh.indices.begin() + end * 3);
+	}
+
+	mesh.indices = std::move(indices);
+}
+
+/**
+ * \brief Renumbers the vertices in the order the indices first use them, so that vertex fetch walks the vertex buffer
+ * front to back. Vertices that no triangle uses are dropped.
+ * \param mesh The mesh whose vertices are reordered, and indices remapped.
+ */
+void MeshOptimizer::OptimizeVertexFetch(MeshData& mesh)
+{
+	std::vector<uint32_t> remap(mesh.vertices.size(), s_unused);
+	std::vector<MeshVertex> vertices;
+	vertices.reserve(mesh.vertices.size());
+
+	for (uint32_t& index : mesh.indices) {
+		if (remap[index] == s_unused) {
+			remap[index] = static_cast<uint32_t>(vertices.size());
+			vertices.push_back(mesh.vertices[index]);
+		}
+
+		index = remap[index];
+	}
+
+	mesh.vertices = std::move(vertices);
+}
+
+/**
+ * \brief Simulates drawing a mesh through a FIFO post-transform cache.
+ * \param mesh The mesh to draw.
+ * \param cache_size The entries of the cache.
+ * \return The average cache misses per triangle (ACMR) and per used vertex (ATVR).
+ */
+VertexCacheStatistics MeshOptimizer::AnalyzeVertexCache(const MeshData& mesh, const uint32_t cache_size)
+{
+	FifoCache cache(mesh.vertices.size(), cache_size);
+	std::vector<bool> used(mesh.vertices.size(), false);
+
+	size_t misses = 0, used_count = 0;
+
+	for (const uint32_t index : mesh.indices) {
+		misses += cache.Access(index);
+
+		if (!used[index]) {
+			used[index] = true;
+			used_count++;
+		}
+	}
+
+	VertexCacheStatistics statistics;
+
+	if (!mesh.indices.empty()) {
+		statistics.acmr = static_cast<float>(misses) / static_cast<float>(mesh.indices.size() / 3);
+		statistics.atvr = static_cast<float>(misses) / static_cast<float>(used_count);
+	}
+
+	return statistics;
+}
+
+/**
+ * \brief Reports the vertex cache before and after optimizing generated meshes, with their triangles in the order
+ * exporters tend to write (rows) and in no order at all (shuffled).
+ */
+void MeshOptimizer::Benchmark()
+{
+	VK_CORE_INFO("Mesh optimization, {0} entry FIFO cache:", s_cacheSize);
+
+	MeshData grid = GenerateGrid(256);
+	Report("Grid, rows", grid);
+
+	grid = GenerateGrid(256);
+	ShuffleTriangles(grid, 1);
+	Report("Grid, shuffled", grid);
+
+	MeshData sphere = GenerateSphere(256, 512);
+	Report("Sphere, rows", sphere);
+
+	sphere = GenerateSphere(256, 512);
+	ShuffleTriangles(sphere, 2);
+	Report("Sphere, shuffled", sphere);
+}
+
+/**
+ * \brief Reports the vertex cache of a model before and after optimizing it.
+ * \param file_path The path of the model, relative to the models folder.
+ */
+void MeshOptimizer::Benchmark(const std::string& file_path)
+{
+	MeshData mesh = MeshLoader::Load(file_path);
+
+	Report(file_path.c_str(), mesh);
+}
+
+/**
+ * \brief Splits clusters where starting over with an empty cache adds few misses, so that the overdraw sort has
+ * smaller pieces to move around. A cluster is split once the misses since its start, per triangle,
+ * are within the threshold of what the whole cluster has.
+ */
+std::vector<size_t> MeshOptimizer::SplitClusters(const MeshData& mesh,
+                                                 const std::vector<size_t>& clusters,
+                                                 const float threshold)
+{
+	const size_t triangle_count = mesh.indices.size() / 3;
+
+	FifoCache cache(mesh.vertices.size(), s_cacheSize);
+	std::vector<size_t> split;
+
+	for (size_t cluster = 0; cluster < clusters.size(); cluster++) {
+		const size_t start = clusters[cluster];
+		const size_t end = cluster + 1 < clusters.size() ? clusters[cluster + 1] : triangle_count;
+
+		size_t cluster_misses = 0;
+		cache.Clear();
+
+		for (size_t i = start * 3; i < end * 3; i++)
+			cluster_misses += cache.Access(mesh.indices[i]);
+
+		const float cluster_acmr = static_cast<float>(cluster_misses) / static_cast<float>(end - start);
+
+		size_t piece_start = start;
+		size_t piece_misses = 0;
+		cache.Clear();
+
+		split.push_back(start);
+
+		for (size_t triangle = start; triangle < end; triangle++) {
+			for (uint32_t corner = 0; corner < 3; corner++)
+				piece_misses += cache.Access(mesh.indices[triangle * 3 + corner]);
+
+			const size_t piece_triangles = triangle + 1 - piece_start;
+
+			// Pieces of a few triangles always have a high miss rate, and aren't worth sorting on their own
+			if (piece_triangles >= s_cacheSize && triangle + 1 < end &&
+			    static_cast<float>(piece_misses) / static_cast<float>(piece_triangles) <= cluster_acmr * threshold) {
+				split.push_back(triangle + 1);
+				piece_start = triangle + 1;
+				piece_misses = 0;
+				cache.Clear();
+			}
+		}
+	}
+
+	return split;
+}
+
+void MeshOptimizer::Report(const char* name, MeshData& mesh)
+{
+	const VertexCacheStatistics before = AnalyzeVertexCache(mesh);
+
+	const Timer timer;
+	Optimize(mesh);
+	const float milliseconds = timer.ElapsedMillis();
+
+	const VertexCacheStatistics after = AnalyzeVertexCache(mesh);
+
+	VK_CORE_INFO("  {0}: {1} triangles, ACMR {2:.3f} -> {3:.3f}, ATVR {4:.3f} -> {5:.3f}, optimized in {6:.1f} ms",
+	             name, mesh.indices.size() / 3, before.acmr, after.acmr, before.atvr, after.atvr, milliseconds);
+}
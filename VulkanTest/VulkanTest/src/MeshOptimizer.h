@@ -0,0 +1,49 @@
+﻿#pragma once
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+struct MeshData;
+
+// How well an index order uses the post-transform vertex cache, see MeshOptimizer::AnalyzeVertexCache
+struct VertexCacheStatistics
+{
+	// Average cache misses per triangle, between 0.5 for the best regular grids and 3 for no reuse at all
+	float acmr = 0.0f;
+
+	// Average transforms per vertex that is used, 1 is optimal
+	float atvr = 0.0f;
+};
+
+/**
+ * \brief Reorders meshes at import time so the GPU does less work drawing them, without changing how they look:
+ * triangles for the post-transform vertex cache (Tipsify), then clusters of triangles so that outward facing
+ * ones are drawn first and hide the rest (less overdraw), and finally vertices in the order they are first used
+ * so that vertex fetch reads memory front to back.
+ */
+class MeshOptimizer
+{
+public:
+	// Entries of the simulated cache, small enough that the order works on any GPU
+	static constexpr uint32_t s_cacheSize = 16;
+
+	static void Optimize(MeshData& mesh, float overdraw_threshold = 1.05f);
+
+	static std::vector<size_t> OptimizeVertexCache(MeshData& mesh);
+
+	static void OptimizeOverdraw(MeshData& mesh, const std::vector<size_t>& clusters, float threshold);
+
+	static void OptimizeVertexFetch(MeshData& mesh);
+
+	static VertexCacheStatistics AnalyzeVertexCache(const MeshData& mesh, uint32_t cache_size = s_cacheSize);
+
+	static void Benchmark();
+
+	static void Benchmark(const std::string& file_path);
+
+private:
+	static std::vector<size_t> SplitClusters(const MeshData& mesh, const std::vector<size_t>& clusters, float threshold);
+
+	static void Report(const char* name, MeshData& mesh);
+};
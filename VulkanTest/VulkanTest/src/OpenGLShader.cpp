@@ -2,13 +2,21 @@
 
 #include "OpenGLShader.h"
 
+#include <algorithm>
+#include <cstdio>
+#include <cstring>
+#include <filesystem>
 #include <fstream>
 #include <glm/gtc/type_ptr.hpp>
 #include <shaderc/shaderc.hpp>
 #include <spirv_cross/spirv_cross.hpp>
 #include <spirv_cross/spirv_glsl.hpp>
+#include <unordered_map>
 
+#include "ShaderReflectionCache.h"
+#include "SpirvOptimizer.h"
 #include "Core/Assert.h"
+#include "Core/Hash.h"
 #include "Core/Log.h"
 #include "Core/Timer.h"
 
@@ -20,12 +28,20 @@ public:
 	 * \param type The string depicting the type of shader that the function looks for.
 	 * \return A shader type flag bit.
 	 */
-	static vk::ShaderStageFlagBits ShaderTypeFromString(const std::string& type)
+	static vk::ShaderStageFlagBits ShaderTypeFromString(const std::string_view type)
 	{
 		if (type == "vertex")
 			return vk::ShaderStageFlagBits::eVertex;
 		if (type == "fragment" || type == "pixel")
 			return vk::ShaderStageFlagBits::eFragment;
+		if (type == "geometry")
+			return vk::ShaderStageFlagBits::eGeometry;
+		if (type == "tess_control" || type == "tessellation_control" || type == "hull")
+			return vk::ShaderStageFlagBits::eTessellationControl;
+		if (type == "tess_evaluation" || type == "tessellation_evaluation" || type == "domain")
+			return vk::ShaderStageFlagBits::eTessellationEvaluation;
+		if (type == "compute")
+			return vk::ShaderStageFlagBits::eCompute;
 
 		VK_CORE_ASSERT(false, "Unknown shader type!");
 
@@ -46,6 +62,18 @@ public:
 			case vk::ShaderStageFlagBits::eFragment:
 				return shaderc_glsl_fragment_shader;
 
+			case vk::ShaderStageFlagBits::eGeometry:
+				return shaderc_glsl_geometry_shader;
+
+			case vk::ShaderStageFlagBits::eTessellationControl:
+				return shaderc_glsl_tess_control_shader;
+
+			case vk::ShaderStageFlagBits::eTessellationEvaluation:
+				return shaderc_glsl_tess_evaluation_shader;
+
+			case vk::ShaderStageFlagBits::eCompute:
+				return shaderc_glsl_compute_shader;
+
 			default:
 				VK_CORE_ASSERT(false);
 				return static_cast<shaderc_shader_kind>(0);
@@ -68,6 +96,18 @@ public:
 			case vk::ShaderStageFlagBits::eFragment:
 				return "GLSL_FRAGMENT_SHADER";
 
+			case vk::ShaderStageFlagBits::eGeometry:
+				return "GLSL_GEOMETRY_SHADER";
+
+			case vk::ShaderStageFlagBits::eTessellationControl:
+				return "GLSL_TESS_CONTROL_SHADER";
+
+			case vk::ShaderStageFlagBits::eTessellationEvaluation:
+				return "GLSL_TESS_EVALUATION_SHADER";
+
+			case vk::ShaderStageFlagBits::eCompute:
+				return "GLSL_COMPUTE_SHADER";
+
 			default:
 				VK_CORE_ASSERT(false);
 				return nullptr;
@@ -80,12 +120,44 @@ public:
 	}
 
 	/**
-	 * \brief If there is no previous cache of shaders, create a new one for future use.
+	 * \brief Gets the name that every cache file of a shader starts with. Pruning the interface between stages makes
+	 * the SPIR-V of each stage depend on the others, so the name holds a hash of the paths of all the stages and of
+	 * the defines. The file name of the first stage only comes first to make the cache easier to look through.
+	 * \param file_paths The source file of every stage, empty for missing stages.
+	 * \param defines The preprocessor definitions of the variant.
+	 * \return The file name of the first stage, followed by a '.' and the hash.
 	 */
-	static void CreateCacheDirectoryIfNeeded()
+	static std::string GetCacheName(const ShaderStageArray<std::string>& file_paths, const ShaderDefines& defines)
 	{
-		std::string cache_directory = GetCacheDirectory();
+		const std::string variant_key = ShaderVariant::GetKey(defines);
+
+		uint64_t hash = Fnv1a::Combine(Fnv1a::Hash(variant_key), variant_key.size());
+		std::string first_file_name;
 
+		for (uint32_t index = 0; index < ShaderStage::s_count; index++) {
+			const std::string& file_path = file_paths[index];
+
+			if (file_path.empty())
+				continue;
+
+			// The stage and the length are hashed too, so that no two sets of paths run together
+			hash = Fnv1a::Combine(Fnv1a::Hash(file_path, Fnv1a::Combine(hash, index)), file_path.size());
+
+			if (first_file_name.empty())
+				first_file_name = std::filesystem::path(file_path).filename().string();
+		}
+
+		char buffer[18];
+		snprintf(buffer, sizeof(buffer), ".%016llx", static_cast<unsigned long long>(hash));
+
+		return first_file_name + buffer;
+	}
+
+	/**
+	 * \brief If there is no previous cache of shaders, create a new one for future use.
+	 */
+	static void CreateCacheDirectoryIfNeeded(const std::filesystem::path& cache_directory)
+	{
 		if (!std::filesystem::exists(cache_directory))
 			std::filesystem::create_directories(cache_directory);
 	}
@@ -99,6 +171,18 @@ public:
 			case vk::ShaderStageFlagBits::eFragment:
 				return ".cached_glsl.frag";
 
+			case vk::ShaderStageFlagBits::eGeometry:
+				return ".cached_glsl.geom";
+
+			case vk::ShaderStageFlagBits::eTessellationControl:
+				return ".cached_glsl.tesc";
+
+			case vk::ShaderStageFlagBits::eTessellationEvaluation:
+				return ".cached_glsl.tese";
+
+			case vk::ShaderStageFlagBits::eCompute:
+				return ".cached_glsl.comp";
+
 			default:
 				VK_ASSERT(false);
 				return "";
@@ -119,6 +203,18 @@ public:
 			case vk::ShaderStageFlagBits::eFragment:
 				return ".cached_vulkan.frag";
 
+			case vk::ShaderStageFlagBits::eGeometry:
+				return ".cached_vulkan.geom";
+
+			case vk::ShaderStageFlagBits::eTessellationControl:
+				return ".cached_vulkan.tesc";
+
+			case vk::ShaderStageFlagBits::eTessellationEvaluation:
+				return ".cached_vulkan.tese";
+
+			case vk::ShaderStageFlagBits::eCompute:
+				return ".cached_vulkan.comp";
+
 			default:
 				VK_ASSERT(false);
 				return "";
@@ -126,30 +222,120 @@ public:
 	}
 };
 
+namespace
+{
+	// Shader files were read into a string, and every stage was copied out of it, before they were mapped.
+	// Both are kept as they were, apart from accepting every stage, to measure the mapped files and views against.
+	std::string ReadFileCopy(const std::string& file_path)
+	{
+		std::string result;
+
+		if (std::ifstream in(file_path, std::ios::in | std::ios::binary); in) {
+
+			in.seekg(0, std::ios::end);
+
+			if (size_t size = in.tellg(); size != -1) {
+
+				result.resize(size);
+				in.seekg(0, std::ios::beg);
+				in.read(&result[0], size);
+			} else
+				VK_CORE_ERROR("Could not read from file '{0}'", file_path);
+		} else
+			VK_CORE_ERROR("Could not open file '{0}'", file_path);
+
+		return result;
+	}
+
+	std::unordered_map<vk::ShaderStageFlagBits, std::string> PreProcessCopies(const std::string& source)
+	{
+		std::unordered_map<vk::ShaderStageFlagBits, std::string> shader_sources;
+
+		auto type_token = "#type";
+
+		size_t type_token_length = strlen(type_token);
+		size_t pos = source.find(type_token, 0); // Start of shader type declaration line
+
+		while (pos != std::string::npos) {
+
+			size_t eol = source.find_first_of("\r\n", pos); // End of shader type declaration line
+
+			VK_CORE_ASSERT(eol != std::string::npos, "Syntax error");
+
+			size_t begin = pos + type_token_length + 1; // Start of shader type name (after "#type" keyword)
+			std::string type = source.substr(begin, eol - begin);
+
+			size_t next_line_pos = source.find_first_not_of("\r\n", eol);
+			// Start of shader code after shader type declaration line
+
+			VK_CORE_ASSERT(next_line_pos != std::string::npos, "Syntax error");
+			pos = source.find(type_token, next_line_pos); // Start of next shader type declaration line
+
+			shader_sources[ShaderUtils::ShaderTypeFromString(type)] = (pos == std::string::npos) ?
+				                                                          source.substr(next_line_pos) :
+				                                                          source.substr(next_line_pos,
+				                                                                        pos - next_line_pos);
+		}
+
+		return shader_sources;
+	}
+
+	// Reads every character of a stage, the way the compiler would
+	uint8_t Checksum(const std::string_view text)
+	{
+		uint8_t sum = 0;
+
+		for (const char c : text)
+			sum += static_cast<uint8_t>(c);
+
+		return sum;
+	}
+}
+
 /**
  * \brief Creates a shader with on single file path.
  * \param file_path The file path of the shader.
+ * \param defines The preprocessor definitions that select which variant of the shader is compiled.
+ * \param cache_directory Where the compiled shader is cached, empty for the cache of the assets.
  */
-OpenGLShader::OpenGLShader(const std::string& file_path)
+OpenGLShader::OpenGLShader(const std::string& file_path, ShaderDefines defines, std::filesystem::path cache_directory)
+	: m_sourceFilePath(file_path),
+	  m_defines(std::move(defines)),
+	  m_cacheDirectory(cache_directory.empty() ? ShaderUtils::GetCacheDirectory() : std::move(cache_directory))
 {
-	/*
-	 * Since this shader only uses a single file path, it will set
-	 * all file locations in its hash directory to be the same.
-	 */
-	m_filePaths[vk::ShaderStageFlagBits::eVertex] = file_path;
-	m_filePaths[vk::ShaderStageFlagBits::eFragment] = file_path;
+	// Extract name from file_path
+	auto last_slash = file_path.find_last_of("/\\");
+	last_slash = last_slash == std::string::npos ? 0 : last_slash + 1;
+	auto last_dot = file_path.rfind('.');
+	auto count = last_dot == std::string::npos ? file_path.size() - last_slash : last_dot - last_slash;
+	m_name = file_path.substr(last_slash, count);
 
-	ShaderUtils::CreateCacheDirectoryIfNeeded();
+	ShaderUtils::CreateCacheDirectoryIfNeeded(m_cacheDirectory);
 
 	// This empty scope is for calculating the amount it takes to compile all shaders
 	{
-		std::string source = Readfile(file_path);
+		// The stage sources are views into this mapping, so it has to outlive the compilation
+		const MappedFile source = Readfile(file_path);
+
+		Timer preprocess_timer;
 
 		/*
 		 * Since this is a single file path, parse the file to see if there are
 		 * multiple shaders in it.
 		 */
-		auto shader_sources = PreProcess(source);
+		auto shader_sources = PreProcess(source.GetView());
+
+		VK_CORE_TRACE("Shader preprocessing of {0} bytes took {1} ms", source.GetSize(),
+		              preprocess_timer.ElapsedMillis());
+
+		/*
+		 * Since this shader only uses a single file path, it will set
+		 * all file locations in its hash directory to be the same.
+		 */
+		for (const auto stage : ShaderStage::s_stages)
+			if (!shader_sources[ShaderStage::GetIndex(stage)].empty())
+				m_filePaths[ShaderStage::GetIndex(stage)] = file_path;
+
 		Timer timer;
 
 		CompileOrGetVulkanBinaries(shader_sources);
@@ -158,12 +344,6 @@ OpenGLShader::OpenGLShader(const std::string& file_path)
 		VK_CORE_WARN("Shader creation took {0} ms", timer.ElapsedMillis());
 	}
 
-	// Extract name from file_path
-	auto last_slash = file_path.find_last_of("/\\");
-	last_slash = last_slash == std::string::npos ? 0 : last_slash + 1;
-	auto last_dot = file_path.rfind('.');
-	auto count = last_dot == std::string::npos ? file_path.size() - last_slash : last_dot - last_slash;
-	m_name = file_path.substr(last_slash, count);
 }
 
 /**
@@ -171,21 +351,31 @@ OpenGLShader::OpenGLShader(const std::string& file_path)
  * \param name The assigned name for the shader.
  * \param vertex_src The vertex shader source code file location.
  * \param fragment_src The fragment shader source code file location.
+ * \param defines The preprocessor definitions that select which variant of the shader is compiled.
+ * \param cache_directory Where the compiled shader is cached, empty for the cache of the assets.
  */
 OpenGLShader::OpenGLShader(std::string name,
                            const std::string& vertex_src,
-                           const std::string& fragment_src) : m_name(std::move(name))
+                           const std::string& fragment_src,
+                           ShaderDefines defines,
+                           std::filesystem::path cache_directory)
+	: m_name(std::move(name)),
+	  m_defines(std::move(defines)),
+	  m_cacheDirectory(cache_directory.empty() ? ShaderUtils::GetCacheDirectory() : std::move(cache_directory))
 {
 	// Assign the corresponding source code directories.
-	m_filePaths[vk::ShaderStageFlagBits::eVertex] = vertex_src;
-	m_filePaths[vk::ShaderStageFlagBits::eFragment] = fragment_src;
+	m_filePaths[ShaderStage::GetIndex(vk::ShaderStageFlagBits::eVertex)] = vertex_src;
+	m_filePaths[ShaderStage::GetIndex(vk::ShaderStageFlagBits::eFragment)] = fragment_src;
+
+	ShaderUtils::CreateCacheDirectoryIfNeeded(m_cacheDirectory);
 
-	ShaderUtils::CreateCacheDirectoryIfNeeded();
+	// Map the source code from each directory provided.
+	const MappedFile vertex_file = Readfile(vertex_src);
+	const MappedFile fragment_file = Readfile(fragment_src);
 
-	// Read the source code from each directory provided.
-	std::unordered_map<vk::ShaderStageFlagBits, std::string> sources;
-	sources[vk::ShaderStageFlagBits::eVertex] = Readfile(vertex_src);
-	sources[vk::ShaderStageFlagBits::eFragment] = Readfile(fragment_src);
+	ShaderStageArray<std::string_view> sources;
+	sources[ShaderStage::GetIndex(vk::ShaderStageFlagBits::eVertex)] = vertex_file.GetView();
+	sources[ShaderStage::GetIndex(vk::ShaderStageFlagBits::eFragment)] = fragment_file.GetView();
 
 	{
 		Timer timer;
@@ -202,127 +392,377 @@ OpenGLShader::OpenGLShader(std::string name,
 OpenGLShader::~OpenGLShader() {}
 
 /**
- * \brief Creates a shader module
- * \param device The logical device used to create the shader module.
- * \param shader The shader object that holds the vulkan byte code of the type of shader.
- * \param stage The type of shader stage that should be created.
- * \return A new shader module of the type of stage it was designated to be.
+ * \brief Compiles (or loads from the cache) another permutation of this shader's source code.
+ * \param defines The preprocessor definitions of the new variant.
+ * \return A new shader with the same name and sources, compiled with the given definitions.
  */
-vk::ShaderModule OpenGLShader::CreateShaderModule(const vk::Device device,
-                                                  OpenGLShader shader,
-                                                  const vk::ShaderStageFlagBits stage)
+std::shared_ptr<Shader> OpenGLShader::CreateVariant(const ShaderDefines& defines) const
 {
-	vk::ShaderModuleCreateInfo create_info{
-		/*
-		 * Since the data stored inside the vulkan spirv binaries is an array
-		 * of unsigned integers, when getting the size of the actual data,
-		 * it has to be multiplied by the size of uint32_t, which is the same.
-		 */
-		.codeSize = shader.m_vulkanSpirv[stage].size() * sizeof(uint32_t),
-		.pCode = shader.m_vulkanSpirv[stage].data(),
-	};
+	std::shared_ptr<Shader> variant;
 
-	vk::ShaderModule shader_module;
+	// Variants share the cache of the shader they were created from
+	if (!m_sourceFilePath.empty())
+		variant = std::make_shared<OpenGLShader>(m_sourceFilePath, defines, m_cacheDirectory);
+	else
+		variant = std::make_shared<OpenGLShader>(m_name,
+		                                         m_filePaths[ShaderStage::GetIndex(vk::ShaderStageFlagBits::eVertex)],
+		                                         m_filePaths[ShaderStage::GetIndex(vk::ShaderStageFlagBits::eFragment)],
+		                                         defines, m_cacheDirectory);
 
-	if (device.createShaderModule(&create_info, nullptr, &shader_module) != vk::Result::eSuccess)
-		throw std::runtime_error("Failed to create shader module! of type: " + static_cast<std::string>(
-			                         ShaderUtils::GLShaderStageToString(stage)));
+	// Variants keep the name of the shader they were created from
+	variant->SetName(m_name);
 
-	return shader_module;
+	return variant;
 }
 
 void OpenGLShader::Bind() const {}
 
 void OpenGLShader::Unbind() const {}
 
-void OpenGLShader::SetInt(const std::string& name, int value) {}
+/**
+ * \brief Looks up a member of one of the uniform blocks, so that it can be set without any string hashing.
+ * \param name The qualified ("ubo.model") or plain ("model") name of the member.
+ * \return The handle of the member, or ShaderUniforms::s_invalidHandle if the shader has no such uniform.
+ */
+ShaderUniformHandle OpenGLShader::GetUniformHandle(const std::string& name) const
+{
+	return m_uniforms.GetHandle(name);
+}
 
-void OpenGLShader::SetIntArray(const std::string& name, int* values, uint32_t count) {}
+void OpenGLShader::SetInt(const std::string& name, const int value)
+{
+	SetInt(GetUniformHandle(name), value);
+}
 
-void OpenGLShader::SetFloat(const std::string& name, float value) {}
+void OpenGLShader::SetIntArray(const std::string& name, int* values, const uint32_t count)
+{
+	SetIntArray(GetUniformHandle(name), values, count);
+}
 
-void OpenGLShader::SetFloat2(const std::string& name, const glm::vec2& value) {}
+void OpenGLShader::SetFloat(const std::string& name, const float value)
+{
+	SetFloat(GetUniformHandle(name), value);
+}
 
-void OpenGLShader::SetFloat3(const std::string& name, const glm::vec3& value) {}
+void OpenGLShader::SetFloat2(const std::string& name, const glm::vec2& value)
+{
+	SetFloat2(GetUniformHandle(name), value);
+}
 
-void OpenGLShader::SetFloat4(const std::string& name, const glm::vec4& value) {}
+void OpenGLShader::SetFloat3(const std::string& name, const glm::vec3& value)
+{
+	SetFloat3(GetUniformHandle(name), value);
+}
 
-void OpenGLShader::SetMat4(const std::string& name, const glm::mat4& value) {}
+void OpenGLShader::SetFloat4(const std::string& name, const glm::vec4& value)
+{
+	SetFloat4(GetUniformHandle(name), value);
+}
 
-/**
- * \brief Attempts to open a file at a provided directory.
- * \param file_path The file location directory.
- * \return A string containing the text from inside the file.
- */
-std::string OpenGLShader::Readfile(const std::string& file_path)
+void OpenGLShader::SetMat4(const std::string& name, const glm::mat4& value)
+{
+	SetMat4(GetUniformHandle(name), value);
+}
+
+void OpenGLShader::SetInt(const ShaderUniformHandle handle, const int value)
+{
+	m_uniforms.Set(handle, &value, sizeof(value));
+}
+
+void OpenGLShader::SetIntArray(const ShaderUniformHandle handle, int* values, const uint32_t count)
+{
+	m_uniforms.SetArray(handle, values, sizeof(int), count);
+}
+
+void OpenGLShader::SetFloat(const ShaderUniformHandle handle, const float value)
 {
-	std::string result;
+	m_uniforms.Set(handle, &value, sizeof(value));
+}
 
-	if (std::ifstream in(file_path, std::ios::in | std::ios::binary); in) {
+void OpenGLShader::SetFloat2(const ShaderUniformHandle handle, const glm::vec2& value)
+{
+	m_uniforms.Set(handle, &value, sizeof(value));
+}
 
-		in.seekg(0, std::ios::end);
+void OpenGLShader::SetFloat3(const ShaderUniformHandle handle, const glm::vec3& value)
+{
+	m_uniforms.Set(handle, &value, sizeof(value));
+}
 
-		if (size_t size = in.tellg(); size != -1) {
+void OpenGLShader::SetFloat4(const ShaderUniformHandle handle, const glm::vec4& value)
+{
+	m_uniforms.Set(handle, &value, sizeof(value));
+}
 
-			result.resize(size);
-			in.seekg(0, std::ios::beg);
-			in.read(&result[0], size);
-		} else
-			VK_CORE_ERROR("Could not read from file '{0}'", file_path);
-	} else
-		VK_CORE_ERROR("Could not open file '{0}'", file_path);
+void OpenGLShader::SetMat4(const ShaderUniformHandle handle, const glm::mat4& value)
+{
+	m_uniforms.Set(handle, &value, sizeof(value));
+}
 
-	return result;
+/**
+ * \brief Attempts to map a file at a provided directory into memory.
+ * \param file_path The file location directory.
+ * \return The mapped file, whose view contains the text from inside the file.
+ */
+MappedFile OpenGLShader::Readfile(const std::string& file_path)
+{
+	return MappedFile(file_path);
 }
 
 /**
  * \brief Parses a single shader source code file.
  * \param source The source code of the file.
- * \return The separated shaders from inside the original file.
+ * \return The separated shaders from inside the original file, as views into the source (empty for missing stages).
  */
-std::unordered_map<vk::ShaderStageFlagBits, std::string> OpenGLShader::PreProcess(const std::string& source)
+ShaderStageArray<std::string_view> OpenGLShader::PreProcess(const std::string_view source)
 {
-	std::unordered_map<vk::ShaderStageFlagBits, std::string> shader_sources;
+	ShaderStageArray<std::string_view> shader_sources;
 
-	auto type_token = "#type";
+	constexpr std::string_view type_token = "#type";
 
-	size_t type_token_length = strlen(type_token);
 	size_t pos = source.find(type_token, 0); // Start of shader type declaration line
 
-	while (pos != std::string::npos) {
+	while (pos != std::string_view::npos) {
 
 		size_t eol = source.find_first_of("\r\n", pos); // End of shader type declaration line
 
-		VK_CORE_ASSERT(eol != std::string::npos, "Syntax error");
-
-		size_t begin = pos + type_token_length + 1; // Start of shader type name (after "#type" keyword)
-		std::string type = source.substr(begin, eol - begin);
+		VK_CORE_ASSERT(eol != std::string_view::npos, "Syntax error");
 
-		const bool type_condition = (ShaderUtils::ShaderTypeFromString(type) == vk::ShaderStageFlagBits::eVertex) || (
-			                            ShaderUtils::ShaderTypeFromString(type) == vk::ShaderStageFlagBits::eFragment);
+		size_t begin = source.find_first_not_of(" \t", pos + type_token.size());
+		// Start of shader type name (after "#type" keyword)
+		size_t end = source.find_last_not_of(" \t", eol - 1) + 1;
 
-		VK_CORE_ASSERT(type_condition, "Invalid shader type specified");
+		const vk::ShaderStageFlagBits stage = ShaderUtils::ShaderTypeFromString(source.substr(begin, end - begin));
 
 		size_t next_line_pos = source.find_first_not_of("\r\n", eol);
 		// Start of shader code after shader type declaration line
 
-		VK_CORE_ASSERT(next_line_pos != std::string::npos, "Syntax error");
+		VK_CORE_ASSERT(next_line_pos != std::string_view::npos, "Syntax error");
 		pos = source.find(type_token, next_line_pos); // Start of next shader type declaration line
 
-		shader_sources[ShaderUtils::ShaderTypeFromString(type)] = (pos == std::string::npos) ?
-			                                                          source.substr(next_line_pos) :
-			                                                          source.substr(next_line_pos, pos - next_line_pos);
+		shader_sources[ShaderStage::GetIndex(stage)] = (pos == std::string_view::npos) ?
+			                                               source.substr(next_line_pos) :
+			                                               source.substr(next_line_pos, pos - next_line_pos);
 	}
 
 	return shader_sources;
 }
 
+/**
+ * \brief Measures reading and splitting a generated shader with two large stages, and every shader file in the
+ * assets that has #type lines.
+ */
+void OpenGLShader::BenchmarkPreProcess()
+{
+	std::string source;
+
+	for (const char* stage : {"vertex", "fragment"}) {
+		source += "#type ";
+		source += stage;
+		source += "\n#version 450\n\n";
+
+		for (int line = 0; line < 8192; line++)
+			source += "layout(location = 0) in vec4 a_Attribute; // Filler that the preprocessor has to skip\n";
+	}
+
+	const std::filesystem::path path = std::filesystem::temp_directory_path() / "VulkanTestPreProcessBenchmark.glsl";
+
+	{
+		std::ofstream file(path, std::ios::binary);
+		file.write(source.data(), static_cast<std::streamsize>(source.size()));
+
+		if (!file) {
+			VK_CORE_ERROR("Could not write {0}", path.string());
+			return;
+		}
+	}
+
+	BenchmarkPreProcess(path.string());
+
+	std::error_code error;
+	std::filesystem::remove(path, error);
+
+	for (const std::filesystem::directory_entry& entry : std::filesystem::directory_iterator("assets/shaders", error))
+		if (entry.path().extension() == ".glsl")
+			BenchmarkPreProcess(entry.path().string());
+}
+
+/**
+ * \brief Measures reading and splitting a shader file the way it was done before, a copy of the file and then a copy
+ * of every stage, against a mapping of the file and views into it. The stages are read once afterwards in both
+ * cases, since views leave touching the file to the compiler. The file stays in the page cache throughout.
+ * \param file_path The path of a shader file with #type lines.
+ */
+void OpenGLShader::BenchmarkPreProcess(const std::string& file_path)
+{
+	std::error_code error;
+	const uintmax_t size = std::filesystem::file_size(file_path, error);
+
+	if (error) {
+		VK_CORE_ERROR("Could not open file '{0}'", file_path);
+		return;
+	}
+
+	// Enough runs that small files are measured over a while too
+	const int runs = static_cast<int>(std::clamp<uintmax_t>((64ull << 20) / std::max<uintmax_t>(size, 1), 10, 100000));
+
+	struct Result
+	{
+		float read = 0.0f;
+
+		float preprocess = 0.0f;
+
+		float pass = 0.0f;
+	};
+
+	uint8_t checksum = 0;
+
+	Result copies;
+
+	for (int run = 0; run < runs; run++) {
+		Timer timer;
+		const std::string file = ReadFileCopy(file_path);
+		copies.read += timer.Elapsed();
+
+		timer.Reset();
+		const auto shader_sources = PreProcessCopies(file);
+		copies.preprocess += timer.Elapsed();
+
+		timer.Reset();
+
+		for (const auto& [stage, stage_source] : shader_sources)
+			checksum += Checksum(stage_source);
+
+		copies.pass += timer.Elapsed();
+	}
+
+	Result views;
+
+	for (int run = 0; run < runs; run++) {
+		Timer timer;
+		const MappedFile file = Readfile(file_path);
+		views.read += timer.Elapsed();
+
+		timer.Reset();
+		const ShaderStageArray<std::string_view> shader_sources = PreProcess(file.GetView());
+		views.preprocess += timer.Elapsed();
+
+		timer.Reset();
+
+		for (const std::string_view stage_source : shader_sources)
+			checksum += Checksum(stage_source);
+
+		views.pass += timer.Elapsed();
+	}
+
+	VK_CORE_INFO("Shader preprocessing {0}: {1:.1f} KiB, {2} runs", file_path, static_cast<float>(size) / 1024.0f,
+	             runs);
+
+	auto report = [runs](const char* name, const Result& result)
+	{
+		const float scale = 1e6f / static_cast<float>(runs);
+
+		VK_CORE_INFO("  {0}: read {1:.2f} us, preprocess {2:.2f} us, pass over the stages {3:.2f} us, total {4:.2f} us",
+		             name, result.read * scale, result.preprocess * scale, result.pass * scale,
+		             (result.read + result.preprocess + result.pass) * scale);
+	};
+
+	report("Copies", copies);
+	report("Views", views);
+
+	VK_CORE_TRACE("  Checksum of the stages read: {0}", checksum);
+}
+
+/**
+ * \brief Measures creating a shader from a cold cache, where it is compiled, optimized and reflected, against a warm
+ * one, where its SPIR-V and reflection file are read back. In between, the SPIR-V is cached but the reflection file
+ * is gone: debug builds reflect the SPIR-V with spirv-cross, release builds compile again, since stripped SPIR-V
+ * has no names left to reflect. The shader is cached in a temporary directory of its own, so that the cache of the
+ * assets is left alone.
+ * \param file_path The path of a shader file with #type lines.
+ */
+void OpenGLShader::BenchmarkCreation(const std::string& file_path)
+{
+	constexpr int runs = 5;
+
+	const std::filesystem::path cache_directory =
+		std::filesystem::temp_directory_path() / "VulkanTestShaderCreationBenchmark";
+
+	std::error_code error;
+	std::filesystem::remove_all(cache_directory, error);
+
+	// Removes the reflection files, and the SPIR-V as well when asked to
+	auto clear_cache = [&](const bool spirv)
+	{
+		if (spirv) {
+			std::filesystem::remove_all(cache_directory, error);
+			return;
+		}
+
+		for (const std::filesystem::directory_entry& entry : std::filesystem::directory_iterator(cache_directory, error))
+			if (entry.path().extension() == ".cached_reflection")
+				std::filesystem::remove(entry.path(), error);
+	};
+
+	auto measure = [&](const char* name, const bool clear, const bool clear_spirv)
+	{
+		float milliseconds = 0.0f;
+
+		for (int run = 0; run < runs; run++) {
+			if (clear)
+				clear_cache(clear_spirv);
+
+			const Timer timer;
+			const OpenGLShader shader(file_path, {}, cache_directory);
+			milliseconds += timer.ElapsedMillis();
+		}
+
+		VK_CORE_INFO("  {0}: {1:.2f} ms", name, milliseconds / runs);
+	};
+
+	VK_CORE_INFO("Shader creation benchmark: {0}, average of {1} runs", file_path, runs);
+
+	measure("Cold, compiled, optimized and reflected", true, true);
+
+	measure(SpirvOptimizerSettings::GetDefault().stripDebugInfo
+		        ? "SPIR-V cached without its reflection file, compiled again"
+		        : "SPIR-V cached without its reflection file, reflected with spirv-cross", true, false);
+
+	measure("Warm, SPIR-V and reflection file cached", false, false);
+
+	// The part of a warm start that takes the place of spirv-cross
+	{
+		const OpenGLShader shader(file_path, {}, cache_directory);
+
+		const std::filesystem::path reflection_path =
+			cache_directory / (ShaderUtils::GetCacheName(shader.m_filePaths, shader.m_defines) + ".cached_reflection");
+
+		constexpr int read_runs = runs * 1000;
+
+		const Timer timer;
+
+		for (int run = 0; run < read_runs; run++) {
+			ShaderReflection reflection;
+
+			if (!ShaderReflectionCache::Read(reflection_path, ShaderReflectionCache::GetKey(shader.m_vulkanSpirv),
+			                                 reflection)) {
+				VK_CORE_ERROR("Could not read {0}", reflection_path.string());
+				break;
+			}
+		}
+
+		VK_CORE_INFO("  Reading the reflection file alone: {0:.1f} us", timer.ElapsedMillis() * 1000.0f / read_runs);
+	}
+
+	std::filesystem::remove_all(cache_directory, error);
+}
+
 /**
  * \brief Compiles GLSL shader to vulkan SPIRV binaries.
  * \param shader_sources The list of each shader stage, along with its source code.
  */
 void OpenGLShader::CompileOrGetVulkanBinaries(
-	const std::unordered_map<vk::ShaderStageFlagBits, std::string>& shader_sources)
+	const ShaderStageArray<std::string_view>& shader_sources)
 {
 	// Creating a compiler and its options
 	shaderc::CompileOptions options;
@@ -333,19 +773,35 @@ void OpenGLShader::CompileOrGetVulkanBinaries(
 	if (optimize)
 		options.SetOptimizationLevel(shaderc_optimization_level_performance);
 
-	std::filesystem::path cache_directory = ShaderUtils::GetCacheDirectory();
+	// Each variant gets its own set of macros, so features are compiled in or out instead of branched on
+	for (const auto& [define_name, define_value] : m_defines)
+		options.AddMacroDefinition(define_name, define_value);
+
+	const std::filesystem::path& cache_directory = m_cacheDirectory;
+
+	// Name that every cache file of this shader starts with
+	const std::string cache_name = ShaderUtils::GetCacheName(m_filePaths, m_defines);
 
 	auto& shader_data = m_vulkanSpirv;
-	shader_data.clear();
+	shader_data = {};
+	m_reflection = {};
+
+	const SpirvOptimizerSettings settings = SpirvOptimizerSettings::GetDefault();
+
+	ShaderStageArray<std::filesystem::path> cached_paths;
+	bool cache_complete = true;
 
 	// Read each shader from their source codes
-	for (auto&& [stage, source] : shader_sources) {
+	for (const auto stage : ShaderStage::s_stages) {
+
+		const uint32_t index = ShaderStage::GetIndex(stage);
+		const std::string_view source = shader_sources[index];
 
-		std::filesystem::path shader_file_path = m_filePaths[stage];
-		std::filesystem::path cached_path =
-			cache_directory / (shader_file_path.filename().string().
-			                                    substr(0, shader_file_path.filename().string().find_first_of('.')) +
-			                   ShaderUtils::GLShaderStageCachedVulkanFileExtension(stage));
+		if (source.empty())
+			continue;
+
+		std::filesystem::path& cached_path = cached_paths[index];
+		cached_path = cache_directory / (cache_name + ShaderUtils::GLShaderStageCachedVulkanFileExtension(stage));
 
 		// Create an input file stream to see if the source file
 		// that is being looked upon is open (meaning that it also exists),
@@ -355,18 +811,44 @@ void OpenGLShader::CompileOrGetVulkanBinaries(
 			auto size = in.tellg();
 			in.seekg(0, std::ios::beg);
 
-			auto& data = shader_data[stage];
+			auto& data = shader_data[index];
 			data.resize(size / sizeof(uint32_t));
 			in.read(reinterpret_cast<char*>(data.data()), size);
 		} else {
+			cache_complete = false;
+		}
+	}
 
-			// Create a compiler
-			shaderc::Compiler compiler;
+	/*
+	 * Reflection results are stored next to the SPIR-V and keyed by its hash, so spirv-cross only
+	 * runs when the SPIR-V actually changed.
+	 */
+	Timer reflection_timer;
+
+	const std::filesystem::path reflection_path = cache_directory / (cache_name + ".cached_reflection");
+	const bool cached_reflection = cache_complete &&
+		ShaderReflectionCache::Read(reflection_path, ShaderReflectionCache::GetKey(shader_data), m_reflection);
+
+	/*
+	 * The stages are post-processed together, since removing the outputs that the next stage never reads
+	 * needs both of them, so they are all compiled again if any is missing. Stripped SPIR-V no longer has
+	 * the names of uniform members either, so it is compiled again too if its reflection file is gone.
+	 */
+	if (!cache_complete || (!cached_reflection && settings.stripDebugInfo)) {
+		// Create a compiler
+		shaderc::Compiler compiler;
+
+		for (const auto stage : ShaderStage::s_stages) {
+			const uint32_t index = ShaderStage::GetIndex(stage);
+			const std::string_view source = shader_sources[index];
+
+			if (source.empty())
+				continue;
 
 			// Convert the glsl code to SPIRV byte code.
-			shaderc::SpvCompilationResult module = compiler.CompileGlslToSpv(source,
+			shaderc::SpvCompilationResult module = compiler.CompileGlslToSpv(source.data(), source.size(),
 			                                                                 ShaderUtils::GLShaderStageToShaderC(stage),
-			                                                                 m_filePaths[stage].c_str(), options);
+			                                                                 m_filePaths[index].c_str(), options);
 			// Check that the compilation was successful.
 			if (module.GetCompilationStatus() != shaderc_compilation_status_success) {
 
@@ -375,26 +857,113 @@ void OpenGLShader::CompileOrGetVulkanBinaries(
 			}
 
 			// Get the byte code from the compilation.
-			shader_data[stage] = std::vector(module.cbegin(), module.cend());
+			shader_data[index] = std::vector(module.cbegin(), module.cend());
+		}
+
+		SpirvOptimizerSettings unstripped = settings;
+		unstripped.stripDebugInfo = false;
+
+		SpirvOptimizer::Optimize(shader_data, unstripped, m_name);
+
+		// Reflect before stripping, so that uniforms can still be set by name in release builds
+		m_reflection = {};
+
+		for (const auto stage : ShaderStage::s_stages)
+			if (HasStage(stage))
+				Reflect(stage, shader_data[ShaderStage::GetIndex(stage)]);
 
-			if (std::ofstream out(cached_path, std::ios::out | std::ios::binary); out.is_open()) {
+		if (settings.stripDebugInfo)
+			SpirvOptimizer::StripDebugInfo(shader_data);
+
+		for (uint32_t index = 0; index < ShaderStage::s_count; index++) {
+			auto& data = shader_data[index];
+
+			if (data.empty())
+				continue;
+
+			if (std::ofstream out(cached_paths[index], std::ios::out | std::ios::binary); out.is_open()) {
 
-				auto& data = shader_data[stage];
 				out.write(reinterpret_cast<char*>(data.data()), data.size() * sizeof(uint32_t));
 				out.flush();
 				out.close();
 			}
 		}
+
+		ShaderReflectionCache::Write(reflection_path, ShaderReflectionCache::GetKey(shader_data), m_reflection);
+	} else if (!cached_reflection) {
+		// Unstripped SPIR-V still has every name, so its reflection file can be rebuilt from it
+		for (const auto stage : ShaderStage::s_stages)
+			if (HasStage(stage))
+				Reflect(stage, shader_data[ShaderStage::GetIndex(stage)]);
+
+		ShaderReflectionCache::Write(reflection_path, ShaderReflectionCache::GetKey(shader_data), m_reflection);
 	}
 
-	for (auto&& [stage, data] : shader_data)
-		Reflect(stage, data);
+	VK_CORE_TRACE("Shader reflection of {0} took {1} ms ({2})", m_name, reflection_timer.ElapsedMillis(),
+	              cached_reflection ? "cached" : "spirv-cross");
+
+	m_uniforms = ShaderUniforms(m_reflection);
 }
 
 void OpenGLShader::CompileOrGetOpenGLBinaries() {}
 
 void OpenGLShader::CreateShaderModule(vk::Device device) {}
 
+/**
+ * \brief Adds a descriptor to the reflection data, merging it with the same binding of other stages.
+ * \param reflection The reflection data of the whole shader.
+ * \param resource The descriptor as seen by one of the stages.
+ */
+static void AddResourceBinding(ShaderReflection& reflection, const ShaderResourceBinding& resource)
+{
+	for (auto& existing : reflection.bindings) {
+		if (existing.set == resource.set && existing.binding == resource.binding) {
+			VK_CORE_ASSERT(existing.type == resource.type, "Descriptor type mismatch between shader stages!");
+
+			existing.stages |= resource.stages;
+			existing.size = std::max(existing.size, resource.size);
+			return;
+		}
+	}
+
+	reflection.bindings.push_back(resource);
+}
+
+/**
+ * \brief Gets the vulkan format of a scalar or vector stage variable.
+ * \param type The type of the variable.
+ * \return The format, or undefined for types that take more than one location.
+ */
+static vk::Format GetStageVariableFormat(const spirv_cross::SPIRType& type)
+{
+	if (type.columns != 1 || !type.array.empty() || type.vecsize < 1 || type.vecsize > 4)
+		return vk::Format::eUndefined;
+
+	constexpr vk::Format float_formats[] = {
+		vk::Format::eR32Sfloat, vk::Format::eR32G32Sfloat, vk::Format::eR32G32B32Sfloat, vk::Format::eR32G32B32A32Sfloat
+	};
+	constexpr vk::Format int_formats[] = {
+		vk::Format::eR32Sint, vk::Format::eR32G32Sint, vk::Format::eR32G32B32Sint, vk::Format::eR32G32B32A32Sint
+	};
+	constexpr vk::Format uint_formats[] = {
+		vk::Format::eR32Uint, vk::Format::eR32G32Uint, vk::Format::eR32G32B32Uint, vk::Format::eR32G32B32A32Uint
+	};
+
+	switch (type.basetype) {
+		case spirv_cross::SPIRType::Float:
+			return float_formats[type.vecsize - 1];
+
+		case spirv_cross::SPIRType::Int:
+			return int_formats[type.vecsize - 1];
+
+		case spirv_cross::SPIRType::UInt:
+			return uint_formats[type.vecsize - 1];
+
+		default:
+			return vk::Format::eUndefined;
+	}
+}
+
 /**
  * \brief Reflects the information of a compiled shader.
  * \param stage The type of shader stage.
@@ -405,10 +974,45 @@ void OpenGLShader::Reflect(const vk::ShaderStageFlagBits stage, const std::vecto
 	spirv_cross::Compiler compiler(shader_data);
 	spirv_cross::ShaderResources resources = compiler.get_shader_resources();
 
-	VK_CORE_TRACE("OpenGLShader::Reflect - {0} {1}", ShaderUtils::GLShaderStageToString(stage), m_filePaths[stage]);
+	VK_CORE_TRACE("OpenGLShader::Reflect - {0} {1}", ShaderUtils::GLShaderStageToString(stage),
+	              m_filePaths[ShaderStage::GetIndex(stage)]);
 	VK_CORE_TRACE("\t{0} uniform buffers", resources.uniform_buffers.size());
+	VK_CORE_TRACE("\t{0} storage buffers", resources.storage_buffers.size());
 	VK_CORE_TRACE("\t{0} resources", resources.sampled_images.size());
 
+	// Every kind of descriptor that spirv-cross reports, along with the vulkan type it maps to
+	const std::pair<const spirv_cross::SmallVector<spirv_cross::Resource>*, vk::DescriptorType> descriptor_kinds[] = {
+		{&resources.uniform_buffers, vk::DescriptorType::eUniformBuffer},
+		{&resources.storage_buffers, vk::DescriptorType::eStorageBuffer},
+		{&resources.sampled_images, vk::DescriptorType::eCombinedImageSampler},
+		{&resources.separate_images, vk::DescriptorType::eSampledImage},
+		{&resources.separate_samplers, vk::DescriptorType::eSampler},
+		{&resources.storage_images, vk::DescriptorType::eStorageImage},
+	};
+
+	for (const auto& [kind_resources, descriptor_type] : descriptor_kinds) {
+		for (const auto& resource : *kind_resources) {
+
+			const auto& type = compiler.get_type(resource.type_id);
+			const auto& base_type = compiler.get_type(resource.base_type_id);
+
+			const bool is_buffer = descriptor_type == vk::DescriptorType::eUniformBuffer ||
+			                       descriptor_type == vk::DescriptorType::eStorageBuffer;
+
+			ShaderResourceBinding binding{
+				.name = resource.name,
+				.set = compiler.get_decoration(resource.id, spv::DecorationDescriptorSet),
+				.binding = compiler.get_decoration(resource.id, spv::DecorationBinding),
+				.type = descriptor_type,
+				.count = type.array.empty() ? 1 : type.array[0],
+				.size = is_buffer ? static_cast<uint32_t>(compiler.get_declared_struct_size(base_type)) : 0,
+				.stages = stage
+			};
+
+			AddResourceBinding(m_reflection, binding);
+		}
+	}
+
 	VK_CORE_TRACE("Uniform buffers:");
 
 	for (const auto& resource : resources.uniform_buffers) {
@@ -422,5 +1026,85 @@ void OpenGLShader::Reflect(const vk::ShaderStageFlagBits stage, const std::vecto
 		VK_CORE_TRACE("\tSize = {0}", buffer_size);
 		VK_CORE_TRACE("\tBinding = {0}", binding);
 		VK_CORE_TRACE("\tMembers = {0}", member_count);
+
+		// Members are named after the block instance ("ubo.model"), falling back to the block type name
+		const std::string& instance_name = compiler.get_name(resource.id);
+		const std::string& block_name = instance_name.empty() ? resource.name : instance_name;
+		const uint32_t set = compiler.get_decoration(resource.id, spv::DecorationDescriptorSet);
+
+		for (uint32_t i = 0; i < static_cast<uint32_t>(member_count); i++) {
+			const uint32_t offset = compiler.type_struct_member_offset(buffer_type, i);
+
+			// Every stage that uses the block reports the same members
+			const bool known = std::ranges::any_of(m_reflection.uniformMembers, [&](const ShaderUniformMember& member)
+			{
+				return member.set == set && member.binding == binding && member.offset == offset;
+			});
+
+			if (known)
+				continue;
+
+			const auto& member_type = compiler.get_type(buffer_type.member_types[i]);
+
+			m_reflection.uniformMembers.push_back(ShaderUniformMember{
+				.name = block_name + "." + compiler.get_member_name(resource.base_type_id, i),
+				.set = set,
+				.binding = binding,
+				.offset = offset,
+				.size = static_cast<uint32_t>(compiler.get_declared_struct_member_size(buffer_type, i)),
+				.arrayStride = member_type.array.empty() ? 0 : compiler.type_struct_member_array_stride(buffer_type, i)
+			});
+		}
+	}
+
+	for (const auto& resource : resources.push_constant_buffers) {
+
+		const auto& buffer_type = compiler.get_type(resource.base_type_id);
+
+		// The range starts at the first member that the stage actually declares
+		uint32_t offset = UINT32_MAX;
+
+		for (uint32_t i = 0; i < buffer_type.member_types.size(); i++)
+			offset = std::min(offset, compiler.type_struct_member_offset(buffer_type, i));
+
+		const auto size = static_cast<uint32_t>(compiler.get_declared_struct_size(buffer_type));
+
+		m_reflection.pushConstantRanges.push_back(vk::PushConstantRange{
+			.stageFlags = stage,
+			.offset = offset,
+			.size = size - offset
+		});
+
+		VK_CORE_TRACE("Push constants: {0} ({1} bytes)", resource.name, size - offset);
+	}
+
+	// Stage inputs and outputs, built-ins like gl_Position have no location and are left out
+	const std::pair<const spirv_cross::SmallVector<spirv_cross::Resource>*, std::vector<ShaderStageVariable>*>
+		stage_variables[] = {
+			{&resources.stage_inputs, &m_reflection.stageInputs},
+			{&resources.stage_outputs, &m_reflection.stageOutputs},
+		};
+
+	for (const auto& [variables, reflected] : stage_variables) {
+		for (const auto& resource : *variables) {
+			if (!compiler.has_decoration(resource.id, spv::DecorationLocation))
+				continue;
+
+			reflected->push_back(ShaderStageVariable{
+				.name = resource.name,
+				.stage = stage,
+				.location = compiler.get_decoration(resource.id, spv::DecorationLocation),
+				.format = GetStageVariableFormat(compiler.get_type(resource.type_id))
+			});
+		}
+	}
+
+	if (stage == vk::ShaderStageFlagBits::eCompute) {
+		for (uint32_t dimension = 0; dimension < 3; dimension++)
+			m_reflection.localSize[dimension] = std::max(
+				1u, compiler.get_execution_mode_argument(spv::ExecutionModeLocalSize, dimension));
+
+		VK_CORE_TRACE("Local size = ({0}, {1}, {2})", m_reflection.localSize[0], m_reflection.localSize[1],
+		              m_reflection.localSize[2]);
 	}
 }
@@ -1,24 +1,29 @@
 ﻿#pragma once
 
+#include <filesystem>
+#include <string_view>
 #include <unordered_map>
 #include <glm/glm.hpp>
 #include <vulkan/vulkan.hpp>
 
 #include "Shader.h"
+#include "ShaderReflection.h"
+#include "ShaderStage.h"
+#include "Core/MappedFile.h"
 
 class OpenGLShader : public Shader
 {
 public:
-	OpenGLShader(const std::string& file_path);
+	OpenGLShader(const std::string& file_path, ShaderDefines defines = {}, std::filesystem::path cache_directory = {});
 
 	OpenGLShader(std::string name,
 	             const std::string& vertex_src,
-	             const std::string& fragment_src);
+	             const std::string& fragment_src,
+	             ShaderDefines defines = {},
+	             std::filesystem::path cache_directory = {});
 
 	~OpenGLShader() override;
 
-	static vk::ShaderModule CreateShaderModule(vk::Device device, OpenGLShader shader, vk::ShaderStageFlagBits stage);
-
 	void Bind() const override;
 
 	void Unbind() const override;
@@ -37,8 +42,44 @@ public:
 
 	void SetMat4(const std::string& name, const glm::mat4& value) override;
 
+	[[nodiscard]] ShaderUniformHandle GetUniformHandle(const std::string& name) const override;
+
+	void SetInt(ShaderUniformHandle handle, int value) override;
+
+	void SetIntArray(ShaderUniformHandle handle, int* values, uint32_t count) override;
+
+	void SetFloat(ShaderUniformHandle handle, float value) override;
+
+	void SetFloat2(ShaderUniformHandle handle, const glm::vec2& value) override;
+
+	void SetFloat3(ShaderUniformHandle handle, const glm::vec3& value) override;
+
+	void SetFloat4(ShaderUniformHandle handle, const glm::vec4& value) override;
+
+	void SetMat4(ShaderUniformHandle handle, const glm::mat4& value) override;
+
 	[[nodiscard]] const std::string& GetName() const override { return m_name; }
 
+	void SetName(const std::string& name) override { m_name = name; }
+
+	[[nodiscard]] const ShaderDefines& GetDefines() const override { return m_defines; }
+
+	[[nodiscard]] std::shared_ptr<Shader> CreateVariant(const ShaderDefines& defines) const override;
+
+	[[nodiscard]] const ShaderReflection& GetReflection() const { return m_reflection; }
+
+	[[nodiscard]] ShaderUniforms& GetUniforms() { return m_uniforms; }
+
+	[[nodiscard]] bool HasStage(const vk::ShaderStageFlagBits stage) const
+	{
+		return !m_vulkanSpirv[ShaderStage::GetIndex(stage)].empty();
+	}
+
+	[[nodiscard]] const std::vector<uint32_t>& GetVulkanSpirv(const vk::ShaderStageFlagBits stage) const
+	{
+		return m_vulkanSpirv[ShaderStage::GetIndex(stage)];
+	}
+
 	void UploadUniformInt(const std::string& name, float value);
 
 	void UploadUniformIntArray(const std::string& name, int* values, uint32_t count);
@@ -55,12 +96,18 @@ public:
 
 	void UploadUniformMat4(const std::string& name, const glm::mat4& matrix);
 
+	static void BenchmarkPreProcess();
+
+	static void BenchmarkPreProcess(const std::string& file_path);
+
+	static void BenchmarkCreation(const std::string& file_path);
+
 private:
-	static std::string Readfile(const std::string& file_path);
+	static MappedFile Readfile(const std::string& file_path);
 
-	static std::unordered_map<vk::ShaderStageFlagBits, std::string> PreProcess(const std::string& source);
+	static ShaderStageArray<std::string_view> PreProcess(std::string_view source);
 
-	void CompileOrGetVulkanBinaries(const std::unordered_map<vk::ShaderStageFlagBits, std::string>& shader_sources);
+	void CompileOrGetVulkanBinaries(const ShaderStageArray<std::string_view>& shader_sources);
 
 	static void CompileOrGetOpenGLBinaries();
 
@@ -71,13 +118,25 @@ private:
 private:
 	uint32_t m_rendererID;
 
-	std::unordered_map<vk::ShaderStageFlagBits, std::string> m_filePaths;
+	ShaderStageArray<std::string> m_filePaths;
 
 	std::string m_name;
 
-	std::unordered_map<vk::ShaderStageFlagBits, std::vector<uint32_t>> m_vulkanSpirv;
+	// Only set when every stage was read from the same file
+	std::string m_sourceFilePath;
+
+	ShaderDefines m_defines;
+
+	// Where the compiled SPIR-V and the reflection files are kept
+	std::filesystem::path m_cacheDirectory;
+
+	ShaderStageArray<std::vector<uint32_t>> m_vulkanSpirv;
+
+	ShaderStageArray<std::vector<uint32_t>> m_openGLSpirv;
+
+	ShaderStageArray<std::string> m_openGLSourceCode;
 
-	std::unordered_map<vk::ShaderStageFlagBits, std::vector<uint32_t>> m_openGLSpirv;
+	ShaderReflection m_reflection;
 
-	std::unordered_map<vk::ShaderStageFlagBits, std::string> m_openGLSourceCode;
+	ShaderUniforms m_uniforms;
 };
@@ -64,6 +64,60 @@ void PhysicalDevice::CreateCommandPool(vk::CommandPool& command_pool,
 		throw std::runtime_error("Failed to create command pool!");
 }
 
+/**
+ * \brief Checks whether optimal tiled images of a format can be uploaded to and sampled from,
+ * which is how block compressed textures are used.
+ * \param physical_device The device to check.
+ * \param format The format of the texture.
+ * \return Whether the device supports the format for sampled textures.
+ */
+bool PhysicalDevice::SupportsSampledImageFormat(const vk::PhysicalDevice physical_device, const vk::Format format)
+{
+	vk::FormatProperties format_properties;
+	physical_device.getFormatProperties(format, &format_properties);
+
+	constexpr vk::FormatFeatureFlags required = vk::FormatFeatureFlagBits::eSampledImage |
+	                                            vk::FormatFeatureFlagBits::eTransferDst;
+
+	return (format_properties.optimalTilingFeatures & required) == required;
+}
+
+/**
+ * \brief Gets the properties and limits of a device, which are queried the first time and cached afterwards.
+ * \param physical_device The physical device.
+ * \return The properties, which stay valid for the whole run.
+ */
+const vk::PhysicalDeviceProperties& PhysicalDevice::GetProperties(const vk::PhysicalDevice physical_device)
+{
+	std::scoped_lock lock(s_propertiesMutex);
+
+	const auto [it, inserted] = s_properties.try_emplace(physical_device);
+
+	if (inserted)
+		physical_device.getProperties(&it->second);
+
+	return it->second;
+}
+
+/**
+ * \brief Gets the features that the logical device is created with: the required ones,
+ * plus every texture compression family that the device supports.
+ * \param physical_device The device that the logical device is created from.
+ * \return The features to enable.
+ */
+vk::PhysicalDeviceFeatures PhysicalDevice::GetEnabledFeatures(const vk::PhysicalDevice physical_device)
+{
+	vk::PhysicalDeviceFeatures supported_features;
+	physical_device.getFeatures(&supported_features);
+
+	return vk::PhysicalDeviceFeatures{
+		.samplerAnisotropy = static_cast<vk::Bool32>(true),
+		.textureCompressionETC2 = supported_features.textureCompressionETC2,
+		.textureCompressionASTC_LDR = supported_features.textureCompressionASTC_LDR,
+		.textureCompressionBC = supported_features.textureCompressionBC
+	};
+}
+
 bool PhysicalDevice::IsDeviceSuitable(const vk::PhysicalDevice device)
 {
 	QueueFamilyIndices indices = FindQueueFamilies(device);
@@ -188,5 +242,19 @@ PhysicalDevice::QueueFamilyIndices PhysicalDevice::FindQueueFamilies(const vk::P
 		i++;
 	}
 
+	indices.transferFamily = indices.graphicsFamily;
+
+	// Transfer only families usually map to the copy engines, which work alongside rendering
+	for (uint32_t family = 0; family < queue_family_count; family++) {
+		const vk::QueueFlags flags = queue_families[family].queueFlags;
+
+		if (flags & vk::QueueFlagBits::eTransfer && !(flags & vk::QueueFlagBits::eGraphics)) {
+			indices.transferFamily = family;
+
+			if (!(flags & vk::QueueFlagBits::eCompute))
+				break;
+		}
+	}
+
 	return indices;
 }
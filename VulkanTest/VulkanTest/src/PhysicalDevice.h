@@ -1,6 +1,8 @@
 #pragma once
 
+#include<mutex>
 #include<optional>
+#include<unordered_map>
 #include<vector>
 #include <GLFW/glfw3.h>
 #include<vulkan/vulkan.hpp>
@@ -16,6 +18,9 @@ public:
 
 		std::optional<uint32_t> presentFamily;
 
+		// A family dedicated to transfers when the device has one, otherwise the graphics family
+		std::optional<uint32_t> transferFamily;
+
 		[[nodiscard]] bool IsComplete() const
 		{
 			return graphicsFamily.has_value() && presentFamily.has_value();
@@ -31,6 +36,12 @@ public:
 
 	static void CreateCommandPool(vk::CommandPool& command_pool, vk::PhysicalDevice physical_device, vk::Device device);
 
+	static bool SupportsSampledImageFormat(vk::PhysicalDevice physical_device, vk::Format format);
+
+	static vk::PhysicalDeviceFeatures GetEnabledFeatures(vk::PhysicalDevice physical_device);
+
+	static const vk::PhysicalDeviceProperties& GetProperties(vk::PhysicalDevice physical_device);
+
 private:
 	// This is for finding the first suitable device (might not be the best)
 	static bool IsDeviceSuitable(vk::PhysicalDevice device);
@@ -45,4 +56,9 @@ private:
 
 	// The current window of the application being used
 	inline static GLFWwindow* m_appWindow;
+
+	// Properties never change while the application runs, so each device is only queried once
+	inline static std::mutex s_propertiesMutex;
+
+	inline static std::unordered_map<VkPhysicalDevice, vk::PhysicalDeviceProperties> s_properties;
 };
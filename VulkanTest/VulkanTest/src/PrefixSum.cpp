@@ -0,0 +1,311 @@
+﻿#define VULKAN_HPP_NO_CONSTRUCTORS
+
+#include "PrefixSum.h"
+
+#include <algorithm>
+#include <array>
+#include <numeric>
+#include <random>
+#include <string>
+#include <utility>
+
+#include "Buffer.h"
+#include "ComputePipeline.h"
+#include "HeadlessDevice.h"
+#include "PhysicalDevice.h"
+#include "Core/Log.h"
+#include "Core/Timer.h"
+
+/**
+ * \brief Compiles both kernels and creates their pipelines.
+ * \param device The logical device that will handle object creations.
+ * \param physical_device The physical device, whose work group count limit caps the number of values.
+ * \param shader_module_cache The cache that owns the shader modules of the kernels.
+ */
+PrefixSum::PrefixSum(const vk::Device device,
+                     const vk::PhysicalDevice physical_device,
+                     ShaderModuleCache& shader_module_cache) : m_device(device), m_physicalDevice(physical_device),
+                                                               m_scanShader("assets/shaders/PrefixSum.glsl"),
+                                                               m_addShader("assets/shaders/PrefixSum.glsl",
+                                                                           {{"ADD_BLOCK_SUMS", "1"}})
+{
+	const uint64_t max_groups = PhysicalDevice::GetProperties(physical_device).limits.maxComputeWorkGroupCount[0];
+
+	m_maxCount = static_cast<uint32_t>(std::min<uint64_t>(max_groups * s_workGroupSize, UINT32_MAX));
+
+	ComputePipeline::CreateComputePipeline(m_scanPipeline, m_scanPipelineLayout, m_scanSetLayouts, device,
+	                                       m_scanShader, shader_module_cache);
+
+	ComputePipeline::CreateComputePipeline(m_addPipeline, m_addPipelineLayout, m_addSetLayouts, device,
+	                                       m_addShader, shader_module_cache);
+}
+
+PrefixSum::~PrefixSum()
+{
+	ComputePipeline::Destroy(m_device, m_scanPipeline, m_scanPipelineLayout, m_scanSetLayouts);
+	ComputePipeline::Destroy(m_device, m_addPipeline, m_addPipelineLayout, m_addSetLayouts);
+}
+
+/**
+ * \brief Records an inclusive scan of a buffer in place. The sums wrap around like 32 bit unsigned integers.
+ * A plan can be recorded any number of times, but only one of its scans may run at a time.
+ * \param command_buffer The command buffer that the dispatches are recorded into.
+ * \param plan The plan of the buffer, whose values the caller makes visible to compute shaders before, and to its
+ * next reader after (e.g. ComputePipeline::ComputeToHostBarrier).
+ */
+void PrefixSum::Record(const vk::CommandBuffer command_buffer, const Plan& plan) const
+{
+	const std::vector<Plan::Level>& levels = plan.m_levels;
+
+	if (levels.empty())
+		return;
+
+	// Scan every level, the block totals of each one are the values of the next
+	for (const Plan::Level& level : levels) {
+		Dispatch(command_buffer, m_scanPipeline, m_scanPipelineLayout, m_scanShader, level);
+
+		ComputePipeline::ComputeToComputeBarrier(command_buffer, level.values);
+		ComputePipeline::ComputeToComputeBarrier(command_buffer, level.blockSums);
+	}
+
+	// Add the scanned totals of all previous blocks, from the level with the fewest values down to the input
+	for (size_t i = levels.size() - 1; i-- > 0;) {
+		Dispatch(command_buffer, m_addPipeline, m_addPipelineLayout, m_addShader, levels[i]);
+
+		if (i > 0)
+			ComputePipeline::ComputeToComputeBarrier(command_buffer, levels[i].values);
+	}
+}
+
+/**
+ * \brief Scans random values on the GPU and compares them against std::inclusive_scan, for counts on and
+ * around the block boundaries of every level, and for a count that is asked for.
+ * \param count Another number of values to test, e.g. one that a feature needs, or 0 for none.
+ */
+void PrefixSum::Test(const uint32_t count)
+{
+	const HeadlessDevice headless;
+
+	const vk::Device device = headless.GetDevice();
+	const vk::PhysicalDevice physical_device = headless.GetPhysicalDevice();
+
+	ShaderModuleCache shader_module_cache(device);
+
+	// The scan objects are destroyed before the device
+	{
+		PrefixSum prefix_sum(device, physical_device, shader_module_cache);
+
+		std::vector<uint32_t> counts = {
+			1, s_workGroupSize - 1, s_workGroupSize, s_workGroupSize + 1, s_workGroupSize * s_workGroupSize,
+			s_workGroupSize * s_workGroupSize + 1, 1000000
+		};
+
+		// Nothing is scanned for 0 values, and a buffer can't be empty
+		if (count > 0)
+			counts.push_back(std::min(count, prefix_sum.GetMaxCount()));
+
+		std::mt19937 random(1);
+
+		VK_CORE_INFO("Prefix sum test (at most {0} values):", prefix_sum.GetMaxCount());
+
+		for (const uint32_t value_count : counts) {
+			const vk::DeviceSize size = value_count * sizeof(uint32_t);
+
+			vk::Buffer buffer;
+			vk::DeviceMemory buffer_memory;
+
+			Buffer::CreateBuffer(device, physical_device, size, vk::BufferUsageFlagBits::eStorageBuffer,
+			                     vk::MemoryPropertyFlagBits::eHostVisible | vk::MemoryPropertyFlagBits::eHostCoherent,
+			                     buffer, buffer_memory);
+
+			void* data;
+			device.mapMemory(buffer_memory, 0, size, {}, &data);
+
+			auto* values = static_cast<uint32_t*>(data);
+
+			std::vector<uint32_t> expected(value_count);
+			std::ranges::generate(expected, [&random] { return static_cast<uint32_t>(random()); });
+			std::copy(expected.begin(), expected.end(), values);
+
+			Timer cpu_timer;
+			std::inclusive_scan(expected.begin(), expected.end(), expected.begin());
+			const float cpu_milliseconds = cpu_timer.ElapsedMillis();
+
+			Timer gpu_timer;
+
+			// The plan is destroyed before the buffer it was made for
+			{
+				const Plan plan = prefix_sum.CreatePlan(buffer, value_count);
+
+				const vk::CommandBuffer command_buffer = Buffer::BeginSingleTimeCommands(device,
+				                                                                         headless.GetCommandPool());
+
+				prefix_sum.Record(command_buffer, plan);
+
+				ComputePipeline::ComputeToHostBarrier(command_buffer, buffer);
+
+				Buffer::EndSingleTimeCommands(device, headless.GetCommandPool(), headless.GetQueue(), command_buffer);
+			}
+
+			const float gpu_milliseconds = gpu_timer.ElapsedMillis();
+
+			const auto [mismatch, _] = std::mismatch(expected.begin(), expected.end(), values);
+			const bool passed = mismatch == expected.end();
+
+			if (!passed)
+				VK_CORE_ERROR("  {0} values: first difference at {1}, {2} instead of {3}", value_count,
+				              mismatch - expected.begin(), values[mismatch - expected.begin()], *mismatch);
+			else
+				VK_CORE_INFO("  {0} values: passed, GPU {1:.2f} ms (with submission), std::inclusive_scan {2:.2f} ms",
+				             value_count, gpu_milliseconds, cpu_milliseconds);
+
+			device.unmapMemory(buffer_memory);
+			device.destroyBuffer(buffer, nullptr);
+			device.freeMemory(buffer_memory, nullptr);
+
+			if (!passed)
+				throw std::runtime_error("Prefix sum of " + std::to_string(value_count) + " values is wrong!");
+		}
+	}
+
+	shader_module_cache.Destroy();
+}
+
+/**
+ * \brief Creates the block total buffers and descriptor sets that scanning a buffer needs.
+ * \param values The buffer that is scanned.
+ * \param count The number of values in it, at most GetMaxCount(). A plan for 0 values records nothing.
+ * \return The plan, which has to be destroyed before the buffer.
+ */
+PrefixSum::Plan PrefixSum::CreatePlan(const vk::Buffer values, const uint32_t count) const
+{
+	if (count > m_maxCount)
+		throw std::invalid_argument("Prefix sum of " + std::to_string(count) + " values is over the limit of " +
+		                            std::to_string(m_maxCount) + "!");
+
+	Plan plan(m_device);
+
+	if (count == 0)
+		return plan;
+
+	vk::DescriptorPoolSize pool_size{
+		.type = vk::DescriptorType::eStorageBuffer,
+		.descriptorCount = 2 * s_maxLevels
+	};
+
+	vk::DescriptorPoolCreateInfo pool_info{
+		.maxSets = s_maxLevels,
+		.poolSizeCount = 1,
+		.pPoolSizes = &pool_size
+	};
+
+	if (m_device.createDescriptorPool(&pool_info, nullptr, &plan.m_descriptorPool) != vk::Result::eSuccess)
+		throw std::runtime_error("Failed to create prefix sum descriptor pool!");
+
+	vk::Buffer level_values = values;
+	uint32_t level_count = count;
+
+	while (true) {
+		Plan::Level& level = plan.m_levels.emplace_back();
+		level.count = level_count;
+		level.values = level_values;
+
+		// Even a single block writes its total, which nothing reads
+		const uint32_t block_count = (level_count + s_workGroupSize - 1) / s_workGroupSize;
+
+		Buffer::CreateBuffer(m_device, m_physicalDevice, block_count * sizeof(uint32_t),
+		                     vk::BufferUsageFlagBits::eStorageBuffer, vk::MemoryPropertyFlagBits::eDeviceLocal,
+		                     level.blockSums, level.blockSumsMemory);
+
+		/*
+		 * Both kernels are compiled from the same bindings, so their set layouts are identically defined
+		 * and a set allocated with one can be bound with the other.
+		 */
+		vk::DescriptorSetAllocateInfo alloc_info{
+			.descriptorPool = plan.m_descriptorPool,
+			.descriptorSetCount = 1,
+			.pSetLayouts = &m_scanSetLayouts[0]
+		};
+
+		if (m_device.allocateDescriptorSets(&alloc_info, &level.descriptorSet) != vk::Result::eSuccess)
+			throw std::runtime_error("Failed to allocate prefix sum descriptor set!");
+
+		const std::array<vk::DescriptorBufferInfo, 2> buffer_infos = {
+			vk::DescriptorBufferInfo{.buffer = level.values, .offset = 0, .range = VK_WHOLE_SIZE},
+			vk::DescriptorBufferInfo{.buffer = level.blockSums, .offset = 0, .range = VK_WHOLE_SIZE}
+		};
+
+		vk::WriteDescriptorSet descriptor_write{
+			.dstSet = level.descriptorSet,
+			.dstBinding = 0,
+			.dstArrayElement = 0,
+			.descriptorCount = static_cast<uint32_t>(buffer_infos.size()),
+			.descriptorType = vk::DescriptorType::eStorageBuffer,
+			.pBufferInfo = buffer_infos.data()
+		};
+
+		m_device.updateDescriptorSets(1, &descriptor_write, 0, nullptr);
+
+		if (block_count == 1)
+			break;
+
+		level_values = level.blockSums;
+		level_count = block_count;
+	}
+
+	return plan;
+}
+
+PrefixSum::Plan::~Plan()
+{
+	Destroy();
+}
+
+PrefixSum::Plan::Plan(Plan&& other) noexcept
+{
+	*this = std::move(other);
+}
+
+PrefixSum::Plan& PrefixSum::Plan::operator=(Plan&& other) noexcept
+{
+	if (this != &other) {
+		Destroy();
+
+		m_device = std::exchange(other.m_device, nullptr);
+		m_descriptorPool = std::exchange(other.m_descriptorPool, nullptr);
+		m_levels = std::exchange(other.m_levels, {});
+	}
+
+	return *this;
+}
+
+void PrefixSum::Plan::Destroy()
+{
+	for (const Level& level : m_levels) {
+		m_device.destroyBuffer(level.blockSums, nullptr);
+		m_device.freeMemory(level.blockSumsMemory, nullptr);
+	}
+
+	m_levels.clear();
+
+	// Destroying the pool frees the descriptor sets as well
+	if (m_descriptorPool)
+		m_device.destroyDescriptorPool(m_descriptorPool, nullptr);
+
+	m_descriptorPool = nullptr;
+}
+
+void PrefixSum::Dispatch(const vk::CommandBuffer command_buffer,
+                         const vk::Pipeline pipeline,
+                         const vk::PipelineLayout pipeline_layout,
+                         const OpenGLShader& shader,
+                         const Plan::Level& level)
+{
+	command_buffer.bindPipeline(vk::PipelineBindPoint::eCompute, pipeline);
+	command_buffer.bindDescriptorSets(vk::PipelineBindPoint::eCompute, pipeline_layout, 0, 1, &level.descriptorSet,
+	                                  0, nullptr);
+	command_buffer.pushConstants(pipeline_layout, vk::ShaderStageFlagBits::eCompute, 0, sizeof(uint32_t),
+	                             &level.count);
+
+	ComputePipeline::DispatchInvocations(command_buffer, shader.GetReflection(), level.count);
+}
@@ -0,0 +1,113 @@
+﻿#pragma once
+#include <vector>
+#include <vulkan/vulkan.hpp>
+
+#include "OpenGLShader.h"
+#include "ShaderModuleCache.h"
+
+/**
+ * \brief Inclusive prefix sum of 32 bit unsigned integers on the GPU, with the kernels of PrefixSum.glsl.
+ * Each level scans blocks of one work group and writes the total of every block to the next level, until a level
+ * fits into a single work group. The scanned totals are then added back down, one level at a time. So the count is
+ * only bound by the work groups of one dispatch: 256 * maxComputeWorkGroupCount[0], at least 16776960 values.
+ */
+class PrefixSum
+{
+public:
+	PrefixSum(vk::Device device, vk::PhysicalDevice physical_device, ShaderModuleCache& shader_module_cache);
+
+	~PrefixSum();
+
+	PrefixSum(const PrefixSum&) = delete;
+
+	PrefixSum& operator=(const PrefixSum&) = delete;
+
+	/**
+	 * \brief The block total buffers and descriptor sets for scanning one buffer. The caller owns it, and destroys it
+	 * before the buffer it was made for, so that no descriptor can outlive that buffer.
+	 */
+	class Plan
+	{
+	public:
+		~Plan();
+
+		Plan(const Plan&) = delete;
+
+		Plan& operator=(const Plan&) = delete;
+
+		Plan(Plan&& other) noexcept;
+
+		Plan& operator=(Plan&& other) noexcept;
+
+		[[nodiscard]] uint32_t GetCount() const { return m_levels.empty() ? 0 : m_levels.front().count; }
+
+	private:
+		struct Level
+		{
+			uint32_t count = 0;
+
+			// The input buffer for the first level, the block totals of the level before it otherwise
+			vk::Buffer values;
+
+			vk::Buffer blockSums;
+
+			vk::DeviceMemory blockSumsMemory;
+
+			vk::DescriptorSet descriptorSet;
+		};
+
+		explicit Plan(vk::Device device) : m_device(device) {}
+
+		void Destroy();
+
+		vk::Device m_device;
+
+		vk::DescriptorPool m_descriptorPool;
+
+		std::vector<Level> m_levels;
+
+		friend class PrefixSum;
+	};
+
+	[[nodiscard]] Plan CreatePlan(vk::Buffer values, uint32_t count) const;
+
+	void Record(vk::CommandBuffer command_buffer, const Plan& plan) const;
+
+	[[nodiscard]] uint32_t GetMaxCount() const { return m_maxCount; }
+
+	static void Test(uint32_t count);
+
+private:
+	static void Dispatch(vk::CommandBuffer command_buffer,
+	                     vk::Pipeline pipeline,
+	                     vk::PipelineLayout pipeline_layout,
+	                     const OpenGLShader& shader,
+	                     const Plan::Level& level);
+
+	static constexpr uint32_t s_workGroupSize = 256;
+
+	// Enough levels for any 32 bit count, since 256^4 = 2^32
+	static constexpr uint32_t s_maxLevels = 4;
+
+	vk::Device m_device;
+
+	vk::PhysicalDevice m_physicalDevice;
+
+	uint32_t m_maxCount = 0;
+
+	OpenGLShader m_scanShader;
+
+	OpenGLShader m_addShader;
+
+	vk::Pipeline m_scanPipeline;
+
+	vk::PipelineLayout m_scanPipelineLayout;
+
+	std::vector<vk::DescriptorSetLayout> m_scanSetLayouts;
+
+	vk::Pipeline m_addPipeline;
+
+	vk::PipelineLayout m_addPipelineLayout;
+
+	std::vector<vk::DescriptorSetLayout> m_addSetLayouts;
+};
@@ -0,0 +1,117 @@
+﻿#define VULKAN_HPP_NO_CONSTRUCTORS
+
+#include "SamplerCache.h"
+
+#include <vulkan/vulkan_hash.hpp>
+
+#include "PhysicalDevice.h"
+#include "Core/Log.h"
+
+/**
+ * \brief Gets the sampler with the given state, creating it the first time it is asked for.
+ * The sampler stays owned by the cache, so it can be shared freely and must not be destroyed by its users.
+ * \param device The logical device that the sampler belongs to.
+ * \param physical_device The physical device, used to check the sampler allocation limit.
+ * \param create_info The full sampler state, without any chained structures.
+ * \return A sampler that stays valid until the cache is destroyed for the device.
+ */
+vk::Sampler SamplerCache::GetOrCreate(const vk::Device device,
+                                      const vk::PhysicalDevice physical_device,
+                                      const vk::SamplerCreateInfo& create_info)
+{
+	// Chained structures would only be compared by their address, so they can't be part of the key
+	if (create_info.pNext)
+		throw std::invalid_argument("Cached samplers can't have chained structures!");
+
+	const Key key{device, create_info};
+
+	std::scoped_lock lock(s_mutex);
+
+	if (const auto it = s_samplers.find(key); it != s_samplers.end())
+		return it->second;
+
+	vk::Sampler sampler;
+
+	if (device.createSampler(&create_info, nullptr, &sampler) != vk::Result::eSuccess)
+		throw std::runtime_error("Failed to create texture sampler!");
+
+	s_samplers.emplace(key, sampler);
+
+	const uint32_t limit = PhysicalDevice::GetProperties(physical_device).limits.maxSamplerAllocationCount;
+
+	VK_CORE_TRACE("SamplerCache - created sampler {0} of at most {1}", s_samplers.size(), limit);
+
+	if (s_samplers.size() * 2 > limit)
+		VK_CORE_WARN("SamplerCache - {0} samplers use over half of the device limit of {1}", s_samplers.size(), limit);
+
+	return sampler;
+}
+
+/**
+ * \brief Gets the trilinear, anisotropic, repeating sampler that textures use unless they ask for something else.
+ */
+vk::Sampler SamplerCache::GetDefault(const vk::Device device, const vk::PhysicalDevice physical_device)
+{
+	return GetOrCreate(device, physical_device, GetDefaultCreateInfo(physical_device));
+}
+
+/**
+ * \brief Gets the state of the default sampler, e.g. as a starting point for a variation of it.
+ * The LOD isn't clamped, the image view already limits sampling to the levels that a texture has,
+ * so textures with different mip counts still share the sampler.
+ * \param physical_device The physical device, whose maximum anisotropy is used.
+ */
+vk::SamplerCreateInfo SamplerCache::GetDefaultCreateInfo(const vk::PhysicalDevice physical_device)
+{
+	return vk::SamplerCreateInfo{
+		.magFilter = vk::Filter::eLinear,
+		.minFilter = vk::Filter::eLinear,
+		.mipmapMode = vk::SamplerMipmapMode::eLinear,
+		.addressModeU = vk::SamplerAddressMode::eRepeat,
+		.addressModeV = vk::SamplerAddressMode::eRepeat,
+		.addressModeW = vk::SamplerAddressMode::eRepeat,
+		.mipLodBias = 0.0f,
+		.anisotropyEnable = static_cast<vk::Bool32>(true),
+		.maxAnisotropy = PhysicalDevice::GetProperties(physical_device).limits.maxSamplerAnisotropy,
+		.compareEnable = static_cast<vk::Bool32>(false),
+		.compareOp = vk::CompareOp::eAlways,
+		.minLod = 0.0f,
+		.maxLod = VK_LOD_CLAMP_NONE,
+		.borderColor = vk::BorderColor::eIntOpaqueBlack,
+		.unnormalizedCoordinates = static_cast<vk::Bool32>(false)
+	};
+}
+
+/**
+ * \brief Destroys every sampler of a device. Has to happen after everything that samples with them is gone,
+ * and before the logical device is destroyed.
+ * \param device The logical device whose samplers are destroyed.
+ */
+void SamplerCache::Destroy(const vk::Device device)
+{
+	std::scoped_lock lock(s_mutex);
+
+	std::erase_if(s_samplers, [device](const auto& entry)
+	{
+		if (entry.first.device != static_cast<VkDevice>(device))
+			return false;
+
+		device.destroySampler(entry.second, nullptr);
+		return true;
+	});
+}
+
+size_t SamplerCache::GetSize()
+{
+	std::scoped_lock lock(s_mutex);
+
+	return s_samplers.size();
+}
+
+size_t SamplerCache::KeyHash::operator()(const Key& key) const
+{
+	size_t seed = std::hash<vk::SamplerCreateInfo>{}(key.createInfo);
+	VULKAN_HPP_HASH_COMBINE(seed, key.device);
+
+	return seed;
+}
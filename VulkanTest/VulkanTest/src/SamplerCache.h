@@ -0,0 +1,44 @@
+﻿#pragma once
+#include <mutex>
+#include <unordered_map>
+#include <vulkan/vulkan.hpp>
+
+/**
+ * \brief Shares sampler objects between everything that samples with the same state. Applications only ever use a
+ * handful of distinct samplers, and creating one per texture wastes driver objects and runs into the sampler
+ * allocation limit of the device.
+ */
+class SamplerCache
+{
+public:
+	static vk::Sampler GetOrCreate(vk::Device device,
+	                               vk::PhysicalDevice physical_device,
+	                               const vk::SamplerCreateInfo& create_info);
+
+	static vk::Sampler GetDefault(vk::Device device, vk::PhysicalDevice physical_device);
+
+	static vk::SamplerCreateInfo GetDefaultCreateInfo(vk::PhysicalDevice physical_device);
+
+	static void Destroy(vk::Device device);
+
+	static size_t GetSize();
+
+private:
+	struct Key
+	{
+		VkDevice device;
+
+		vk::SamplerCreateInfo createInfo;
+
+		bool operator==(const Key&) const = default;
+	};
+
+	struct KeyHash
+	{
+		size_t operator()(const Key& key) const;
+	};
+
+	inline static std::mutex s_mutex;
+
+	inline static std::unordered_map<Key, vk::Sampler, KeyHash> s_samplers;
+};
@@ -1,15 +1,55 @@
 ﻿#include "Shader.h"
 #include "OpenGLShader.h"
 
-std::shared_ptr<Shader> Shader::Create(const std::string& filepath)
+namespace
 {
-	return std::make_shared<OpenGLShader>(filepath);
+	// Escapes the separators of a variant key, so that a value like "1;B=2" can't pass for another define
+	void AppendEscaped(std::string& key, const std::string& text)
+	{
+		for (const char c : text) {
+			if (c == '\\' || c == ';' || c == '=')
+				key += '\\';
+
+			key += c;
+		}
+	}
+}
+
+/**
+ * \brief Builds a deterministic key from a set of shader definitions.
+ * \param defines The preprocessor definitions of the variant.
+ * \return A string in the form "NAME=VALUE;NAME" (empty for the default variant), where '\\', ';' and '=' inside
+ * names and values are escaped with a '\\'.
+ */
+std::string ShaderVariant::GetKey(const ShaderDefines& defines)
+{
+	std::string key;
+
+	for (const auto& [name, value] : defines) {
+		if (!key.empty())
+			key += ';';
+
+		AppendEscaped(key, name);
+
+		if (!value.empty()) {
+			key += '=';
+			AppendEscaped(key, value);
+		}
+	}
+
+	return key;
+}
+
+std::shared_ptr<Shader> Shader::Create(const std::string& filepath, const ShaderDefines& defines)
+{
+	return std::make_shared<OpenGLShader>(filepath, defines);
 }
 
 std::shared_ptr<Shader> Shader::Create(
 	const std::string& name,
 	const std::string& vertex_src,
-	const std::string& fragment_src)
+	const std::string& fragment_src,
+	const ShaderDefines& defines)
 {
-	return std::make_shared<OpenGLShader>(name, vertex_src, fragment_src);
+	return std::make_shared<OpenGLShader>(name, vertex_src, fragment_src, defines);
 }
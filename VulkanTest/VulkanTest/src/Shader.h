@@ -1,9 +1,24 @@
 ﻿#pragma once
+#include <map>
 #include <memory>
 #include <string>
 #include <glm/glm.hpp>
 #include <vulkan/vulkan.hpp>
 
+#include "ShaderUniforms.h"
+
+/**
+ * \brief A set of preprocessor definitions (name -> value) that selects a single permutation of a shader.
+ * It is ordered so that the same set of definitions always produces the same variant key.
+ */
+using ShaderDefines = std::map<std::string, std::string>;
+
+class ShaderVariant
+{
+public:
+	static std::string GetKey(const ShaderDefines& defines);
+};
+
 class Shader
 {
 public:
@@ -27,12 +42,37 @@ public:
 
 	virtual void SetMat4(const std::string& name, const glm::mat4& value) = 0;
 
+	// Setters that take a handle from GetUniformHandle, for code that sets the same uniforms every frame
+
+	[[nodiscard]] virtual ShaderUniformHandle GetUniformHandle(const std::string& name) const = 0;
+
+	virtual void SetInt(ShaderUniformHandle handle, int value) = 0;
+
+	virtual void SetIntArray(ShaderUniformHandle handle, int* values, uint32_t count) = 0;
+
+	virtual void SetFloat(ShaderUniformHandle handle, float value) = 0;
+
+	virtual void SetFloat2(ShaderUniformHandle handle, const glm::vec2& value) = 0;
+
+	virtual void SetFloat3(ShaderUniformHandle handle, const glm::vec3& value) = 0;
+
+	virtual void SetFloat4(ShaderUniformHandle handle, const glm::vec4& value) = 0;
+
+	virtual void SetMat4(ShaderUniformHandle handle, const glm::mat4& value) = 0;
+
 	[[nodiscard]] virtual const std::string& GetName() const = 0;
 
-	static std::shared_ptr<Shader> Create(const std::string& filepath);
+	virtual void SetName(const std::string& name) = 0;
+
+	[[nodiscard]] virtual const ShaderDefines& GetDefines() const = 0;
+
+	[[nodiscard]] virtual std::shared_ptr<Shader> CreateVariant(const ShaderDefines& defines) const = 0;
+
+	static std::shared_ptr<Shader> Create(const std::string& filepath, const ShaderDefines& defines = {});
 
 	static std::shared_ptr<Shader> Create(
 		const std::string& name,
 		const std::string& vertex_src,
-		const std::string& fragment_src);
+		const std::string& fragment_src,
+		const ShaderDefines& defines = {});
 };
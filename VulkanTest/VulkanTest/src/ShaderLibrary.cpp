@@ -1,10 +1,47 @@
 ﻿#include "ShaderLibrary.h"
-#include "Core/Assert.h"
 
+#include <filesystem>
+#include <ranges>
+#include <stdexcept>
+
+ShaderLibrary::ShaderLibrary() : m_entries(std::make_unique<Entry[]>(s_maxShaders)) {}
+
+/**
+ * \brief Waits for every shader that is still being loaded, since their threads write into the library.
+ */
+ShaderLibrary::~ShaderLibrary()
+{
+	std::vector<std::shared_future<std::shared_ptr<Shader>>> loading;
+
+	{
+		std::scoped_lock lock(m_mutex);
+
+		for (const ShaderID id : m_ids | std::views::values)
+			if (m_entries[id].loading.valid())
+				loading.push_back(m_entries[id].loading);
+	}
+
+	for (const auto& future : loading)
+		future.wait();
+}
+
+/**
+ * \brief Adds a shader under a name that isn't taken yet.
+ * Throws if the name already has a shader, or one that is still loading, since replacing a published shader would
+ * free it under the readers of Get(ShaderID).
+ * \param name The name that the shader is stored under.
+ * \param shader The shader.
+ */
 void ShaderLibrary::Add(const std::string& name, const std::shared_ptr<Shader>& shader)
 {
-	VK_CORE_ASSERT(!Exists(name), "Shader already exists!");
-	m_shaders[name] = shader;
+	std::scoped_lock lock(m_mutex);
+
+	const ShaderID id = Intern(name);
+
+	if (m_entries[id].owner || m_entries[id].loading.valid())
+		throw std::runtime_error("Shader " + name + " already exists!");
+
+	Store(id, shader);
 }
 
 void ShaderLibrary::Add(const std::shared_ptr<Shader>& shader)
@@ -23,17 +60,191 @@ std::shared_ptr<Shader> ShaderLibrary::Load(vk::Device device, const std::string
 std::shared_ptr<Shader> ShaderLibrary::Load(vk::Device device, const std::string& name, const std::string& file_path)
 {
 	auto shader = Shader::Create(file_path);
+	shader->SetName(name);
 	Add(name, shader);
 	return shader;
 }
 
+/**
+ * \brief Compiles a shader on another thread. Loading the same name twice gives back the same future, and loading
+ * a file that is still being compiled under another name shares that shader instead of compiling the file again,
+ * which would also write its cache files from two threads at once. Until the shader is ready, Get with its ID
+ * returns nullptr.
+ * \param device The logical device.
+ * \param name The name that the shader is stored under.
+ * \param file_path The file path of the shader.
+ * \return A future that holds the shader once it has been compiled and added to the library.
+ */
+std::shared_future<std::shared_ptr<Shader>> ShaderLibrary::LoadAsync(vk::Device device,
+                                                                     const std::string& name,
+                                                                     const std::string& file_path)
+{
+	std::scoped_lock lock(m_mutex);
+
+	const ShaderID id = Intern(name);
+	Entry& entry = m_entries[id];
+
+	if (entry.loading.valid())
+		return entry.loading;
+
+	if (entry.owner) {
+		std::promise<std::shared_ptr<Shader>> loaded;
+		loaded.set_value(entry.owner);
+		return loaded.get_future().share();
+	}
+
+	std::string source = std::filesystem::absolute(file_path).lexically_normal().generic_string();
+
+	if (const auto it = m_sourceLoads.find(source); it != m_sourceLoads.end()) {
+		entry.loading = std::async(std::launch::async, [this, id, source_load = it->second]
+		{
+			auto shader = source_load.get();
+
+			std::scoped_lock store_lock(m_mutex);
+			Store(id, shader);
+			return shader;
+		}).share();
+
+		return entry.loading;
+	}
+
+	// The task can't finish before the load is recorded below, since it takes the lock that is held here
+	entry.loading = std::async(std::launch::async, [this, id, name, file_path, source]
+	{
+		std::shared_ptr<Shader> shader;
+
+		try {
+			shader = Shader::Create(file_path);
+			shader->SetName(name);
+		} catch (...) {
+			std::scoped_lock store_lock(m_mutex);
+			m_sourceLoads.erase(source);
+			throw;
+		}
+
+		std::scoped_lock store_lock(m_mutex);
+		Store(id, shader);
+		m_sourceLoads.erase(source);
+		return shader;
+	}).share();
+
+	m_sourceLoads.emplace(std::move(source), entry.loading);
+
+	return entry.loading;
+}
+
+/**
+ * \brief Gets the ID of a shader name, reserving one if the name has not been seen yet.
+ * IDs can be taken before the shader is added or loaded, and stay the same for the lifetime of the library.
+ * \param name The name of the shader.
+ * \return The ID to pass to Get.
+ */
+ShaderID ShaderLibrary::GetID(const std::string& name)
+{
+	std::scoped_lock lock(m_mutex);
+	return Intern(name);
+}
+
+/**
+ * \brief Gets a shader by its ID, without taking a lock or touching its reference count.
+ * The library keeps the shader alive for as long as the library itself is alive.
+ * \param id An ID from GetID.
+ * \return The shader, or nullptr if it has not been added or finished loading yet, or the ID is invalid.
+ */
+Shader* ShaderLibrary::Get(const ShaderID id) const
+{
+	if (id >= s_maxShaders)
+		return nullptr;
+
+	return m_entries[id].shader.load(std::memory_order_acquire);
+}
+
 std::shared_ptr<Shader> ShaderLibrary::Get(const std::string& name)
 {
-	VK_CORE_ASSERT(Exists(name), "Shader not found!");
-	return m_shaders[name];
+	std::scoped_lock lock(m_mutex);
+
+	const auto it = m_ids.find(name);
+
+	if (it == m_ids.end() || !m_entries[it->second].owner)
+		throw std::runtime_error("Shader " + name + " not found!");
+
+	return m_entries[it->second].owner;
+}
+
+/**
+ * \brief Gets a variant of a shader, compiling it the first time it is requested.
+ * The compilation happens outside of the lock, so other threads can keep using the library meanwhile.
+ * \param name The name of a shader that was previously added to the library.
+ * \param defines The preprocessor definitions of the variant.
+ * \return The shader compiled with the given definitions.
+ */
+std::shared_ptr<Shader> ShaderLibrary::Get(const std::string& name, const ShaderDefines& defines)
+{
+	if (defines.empty())
+		return Get(name);
+
+	const std::string variant_name = GetVariantName(name, defines);
+
+	{
+		std::scoped_lock lock(m_mutex);
+
+		if (auto it = m_variants.find(variant_name); it != m_variants.end())
+			return it->second;
+	}
+
+	auto variant = Get(name)->CreateVariant(defines);
+
+	std::scoped_lock lock(m_mutex);
+
+	// Another thread may have compiled the same variant in the meantime, in which case that one is kept
+	return m_variants.try_emplace(variant_name, variant).first->second;
 }
 
 bool ShaderLibrary::Exists(const std::string& name) const
 {
-	return m_shaders.contains(name);
+	std::scoped_lock lock(m_mutex);
+
+	const auto it = m_ids.find(name);
+	return it != m_ids.end() && m_entries[it->second].owner;
+}
+
+bool ShaderLibrary::Exists(const std::string& name, const ShaderDefines& defines) const
+{
+	if (defines.empty())
+		return Exists(name);
+
+	std::scoped_lock lock(m_mutex);
+	return m_variants.contains(GetVariantName(name, defines));
+}
+
+/**
+ * \brief Gets or reserves the ID of a name. The mutex has to be held.
+ * Throws once the library is full, since the entries can't grow under lock free readers.
+ */
+ShaderID ShaderLibrary::Intern(const std::string& name)
+{
+	if (const auto it = m_ids.find(name); it != m_ids.end())
+		return it->second;
+
+	if (m_ids.size() >= s_maxShaders)
+		throw std::runtime_error("Too many shaders in the library, the limit is " + std::to_string(s_maxShaders) + "!");
+
+	const auto id = static_cast<ShaderID>(m_ids.size());
+	m_ids.emplace(name, id);
+	return id;
+}
+
+/**
+ * \brief Publishes a shader to the lock free readers. The mutex has to be held, and the entry must not have a
+ * shader yet, since readers may still hold the old one.
+ */
+void ShaderLibrary::Store(const ShaderID id, const std::shared_ptr<Shader>& shader)
+{
+	m_entries[id].owner = shader;
+	m_entries[id].shader.store(shader.get(), std::memory_order_release);
+}
+
+std::string ShaderLibrary::GetVariantName(const std::string& name, const ShaderDefines& defines)
+{
+	return name + '|' + ShaderVariant::GetKey(defines);
 }
@@ -1,14 +1,30 @@
 ﻿#pragma once
+#include <atomic>
+#include <future>
 #include <memory>
+#include <mutex>
 #include <string>
 #include <unordered_map>
 #include <vulkan/vulkan.hpp>
 
 #include "Shader.h"
 
+// Index of a shader name inside the library, so that per draw lookups are an array access instead of a string hash
+using ShaderID = uint32_t;
+
 class ShaderLibrary
 {
 public:
+	static constexpr uint32_t s_maxShaders = 256;
+
+	ShaderLibrary();
+
+	~ShaderLibrary();
+
+	ShaderLibrary(const ShaderLibrary&) = delete;
+
+	ShaderLibrary& operator=(const ShaderLibrary&) = delete;
+
 	void Add(const std::string& name, const std::shared_ptr<Shader>& shader);
 
 	void Add(const std::shared_ptr<Shader>& shader);
@@ -17,10 +33,50 @@ public:
 
 	std::shared_ptr<Shader> Load(vk::Device device, const std::string& name, const std::string& file_path);
 
+	std::shared_future<std::shared_ptr<Shader>> LoadAsync(vk::Device device,
+	                                                      const std::string& name,
+	                                                      const std::string& file_path);
+
+	ShaderID GetID(const std::string& name);
+
+	[[nodiscard]] Shader* Get(ShaderID id) const;
+
 	std::shared_ptr<Shader> Get(const std::string& name);
 
+	std::shared_ptr<Shader> Get(const std::string& name, const ShaderDefines& defines);
+
 	[[nodiscard]] bool Exists(const std::string& name) const;
 
+	[[nodiscard]] bool Exists(const std::string& name, const ShaderDefines& defines) const;
+
 private:
-	std::unordered_map<std::string, std::shared_ptr<Shader>> m_shaders;
+	struct Entry
+	{
+		// Set once the shader is ready, and read without taking the lock
+		std::atomic<Shader*> shader = nullptr;
+
+		std::shared_ptr<Shader> owner;
+
+		// Valid while, and after, the shader is loaded on another thread
+		std::shared_future<std::shared_ptr<Shader>> loading;
+	};
+
+	ShaderID Intern(const std::string& name);
+
+	void Store(ShaderID id, const std::shared_ptr<Shader>& shader);
+
+	static std::string GetVariantName(const std::string& name, const ShaderDefines& defines);
+
+	mutable std::mutex m_mutex;
+
+	// Never reallocated, so lock free readers can index it while other threads add shaders
+	std::unique_ptr<Entry[]> m_entries;
+
+	std::unordered_map<std::string, ShaderID> m_ids;
+
+	// Loads that are still running, by source path, so that two names for one file compile it once
+	std::unordered_map<std::string, std::shared_future<std::shared_ptr<Shader>>> m_sourceLoads;
+
+	// Permutations of the shaders above, compiled the first time they are requested
+	std::unordered_map<std::string, std::shared_ptr<Shader>> m_variants;
 };
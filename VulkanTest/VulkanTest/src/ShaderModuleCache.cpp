@@ -0,0 +1,87 @@
+﻿#define VULKAN_HPP_NO_CONSTRUCTORS
+
+#include "ShaderModuleCache.h"
+
+#include <ranges>
+
+#include "Core/Hash.h"
+#include "Core/Log.h"
+
+ShaderModuleCache::ShaderModuleCache(const vk::Device device) : m_device(device) {}
+
+ShaderModuleCache::~ShaderModuleCache()
+{
+	Destroy();
+}
+
+/**
+ * \brief Gets the shader module that was created from the given code, creating it the first time it is asked for.
+ * The module stays owned by the cache, so pipelines can share it and must not destroy it themselves.
+ * \param spirv The vulkan spirv binary of a single shader stage.
+ * \return A shader module that stays valid until the cache is destroyed.
+ */
+vk::ShaderModule ShaderModuleCache::GetOrCreate(const std::vector<uint32_t>& spirv)
+{
+	if (spirv.empty())
+		throw std::runtime_error("Failed to create shader module! No spirv code was given");
+
+	const uint64_t hash = Hash(spirv);
+
+	std::scoped_lock lock(m_mutex);
+
+	for (auto [it, end] = m_modules.equal_range(hash); it != end; ++it)
+		if (it->second.first == spirv)
+			return it->second.second;
+
+	vk::ShaderModuleCreateInfo create_info{
+		/*
+		 * Since the data stored inside the vulkan spirv binaries is an array
+		 * of unsigned integers, when getting the size of the actual data,
+		 * it has to be multiplied by the size of uint32_t, which is the same.
+		 */
+		.codeSize = spirv.size() * sizeof(uint32_t),
+		.pCode = spirv.data(),
+	};
+
+	vk::ShaderModule shader_module;
+
+	if (m_device.createShaderModule(&create_info, nullptr, &shader_module) != vk::Result::eSuccess)
+		throw std::runtime_error("Failed to create shader module!");
+
+	m_modules.emplace(hash, std::make_pair(spirv, shader_module));
+
+	VK_CORE_TRACE("ShaderModuleCache - created module {0:016x} ({1} bytes), {2} cached", hash,
+	              create_info.codeSize, m_modules.size());
+
+	return shader_module;
+}
+
+/**
+ * \brief Destroys every cached shader module. Has to happen before the logical device is destroyed.
+ */
+void ShaderModuleCache::Destroy()
+{
+	std::scoped_lock lock(m_mutex);
+
+	for (const auto& module : m_modules | std::views::values)
+		m_device.destroyShaderModule(module.second, nullptr);
+
+	m_modules.clear();
+}
+
+/**
+ * \brief Hashes spirv code with 64 bit FNV-1a, going over whole words instead of single bytes.
+ * \param spirv The vulkan spirv binary of a single shader stage.
+ * \return The content hash of the code.
+ */
+uint64_t ShaderModuleCache::Hash(const std::vector<uint32_t>& spirv)
+{
+	return Fnv1a::Hash(spirv);
+}
+
+size_t ShaderModuleCache::GetSize() const
+{
+	std::scoped_lock lock(m_mutex);
+
+	return m_modules.size();
+}
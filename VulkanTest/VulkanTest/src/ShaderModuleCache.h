@@ -0,0 +1,33 @@
+﻿#pragma once
+#include <mutex>
+#include <unordered_map>
+#include <vector>
+#include <vulkan/vulkan.hpp>
+
+class ShaderModuleCache
+{
+public:
+	explicit ShaderModuleCache(vk::Device device);
+
+	~ShaderModuleCache();
+
+	ShaderModuleCache(const ShaderModuleCache&) = delete;
+
+	ShaderModuleCache& operator=(const ShaderModuleCache&) = delete;
+
+	vk::ShaderModule GetOrCreate(const std::vector<uint32_t>& spirv);
+
+	void Destroy();
+
+	static uint64_t Hash(const std::vector<uint32_t>& spirv);
+
+	[[nodiscard]] size_t GetSize() const;
+
+private:
+	vk::Device m_device;
+
+	mutable std::mutex m_mutex;
+
+	// Modules with the same hash are kept together with their code, so that collisions are still told apart
+	std::unordered_multimap<uint64_t, std::pair<std::vector<uint32_t>, vk::ShaderModule>> m_modules;
+};
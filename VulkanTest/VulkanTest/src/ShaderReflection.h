@@ -0,0 +1,93 @@
+﻿#pragma once
+#include <algorithm>
+#include <array>
+#include <string>
+#include <vector>
+#include <vulkan/vulkan.hpp>
+
+/**
+ * \brief A descriptor that a shader accesses, as found by reflecting its SPIR-V.
+ */
+struct ShaderResourceBinding
+{
+	std::string name;
+
+	uint32_t set = 0;
+
+	uint32_t binding = 0;
+
+	vk::DescriptorType type = vk::DescriptorType::eUniformBuffer;
+
+	// Number of descriptors in the binding (arrays of resources)
+	uint32_t count = 1;
+
+	// Declared size of the block, only used by uniform and storage buffers
+	uint32_t size = 0;
+
+	vk::ShaderStageFlags stages;
+};
+
+/**
+ * \brief A member of a uniform block, with its std140 placement inside the block.
+ */
+struct ShaderUniformMember
+{
+	// Qualified with the instance name of the block, e.g. "ubo.model"
+	std::string name;
+
+	uint32_t set = 0;
+
+	uint32_t binding = 0;
+
+	uint32_t offset = 0;
+
+	// Declared size of the whole member, including every array element
+	uint32_t size = 0;
+
+	// Distance between array elements, or 0 when the member is not an array
+	uint32_t arrayStride = 0;
+};
+
+/**
+ * \brief An input or output variable of a single stage, e.g. a vertex attribute.
+ */
+struct ShaderStageVariable
+{
+	std::string name;
+
+	vk::ShaderStageFlagBits stage = vk::ShaderStageFlagBits::eVertex;
+
+	uint32_t location = 0;
+
+	// Format of a scalar or vector variable, undefined for matrices and structs
+	vk::Format format = vk::Format::eUndefined;
+};
+
+/**
+ * \brief Everything the pipeline creation needs to know about the resources of all the stages of a shader.
+ */
+struct ShaderReflection
+{
+	std::vector<ShaderResourceBinding> bindings;
+
+	std::vector<vk::PushConstantRange> pushConstantRanges;
+
+	std::vector<ShaderUniformMember> uniformMembers;
+
+	std::vector<ShaderStageVariable> stageInputs;
+
+	std::vector<ShaderStageVariable> stageOutputs;
+
+	// Work group size of a compute shader (local_size_x/y/z)
+	std::array<uint32_t, 3> localSize = {1, 1, 1};
+
+	[[nodiscard]] uint32_t GetSetCount() const
+	{
+		uint32_t set_count = 0;
+
+		for (const auto& resource : bindings)
+			set_count = std::max(set_count, resource.set + 1);
+
+		return set_count;
+	}
+};
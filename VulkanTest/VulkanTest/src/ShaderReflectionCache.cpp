@@ -0,0 +1,274 @@
+﻿#include "ShaderReflectionCache.h"
+
+#include <cstring>
+#include <fstream>
+#include <string_view>
+
+#include "ShaderModuleCache.h"
+#include "Core/Hash.h"
+#include "Core/Log.h"
+#include "Core/MappedFile.h"
+
+namespace
+{
+	// "REFL", followed by the format version
+	constexpr uint32_t s_magic = 0x4C464552;
+	constexpr uint32_t s_version = 1;
+
+	class BinaryWriter
+	{
+	public:
+		template < typename T >
+		void Write(const T value)
+		{
+			static_assert(std::is_trivially_copyable_v<T>);
+
+			const auto* bytes = reinterpret_cast<const char*>(&value);
+			m_data.insert(m_data.end(), bytes, bytes + sizeof(T));
+		}
+
+		void WriteString(const std::string& value)
+		{
+			Write(static_cast<uint32_t>(value.size()));
+			m_data.insert(m_data.end(), value.begin(), value.end());
+		}
+
+		[[nodiscard]] const std::vector<char>& GetData() const { return m_data; }
+
+	private:
+		std::vector<char> m_data;
+	};
+
+	/**
+	 * \brief Reads values back in the order they were written. Running past the end only sets the failed flag,
+	 * so a truncated file reads as zeroes and gets rejected afterwards.
+	 */
+	class BinaryReader
+	{
+	public:
+		explicit BinaryReader(const std::string_view data) : m_data(data) {}
+
+		template < typename T >
+		T Read()
+		{
+			T value{};
+
+			if (m_offset + sizeof(T) > m_data.size()) {
+				m_failed = true;
+				return value;
+			}
+
+			std::memcpy(&value, m_data.data() + m_offset, sizeof(T));
+			m_offset += sizeof(T);
+			return value;
+		}
+
+		std::string ReadString()
+		{
+			const auto size = Read<uint32_t>();
+
+			if (m_failed || m_offset + size > m_data.size()) {
+				m_failed = true;
+				return {};
+			}
+
+			std::string value(m_data.substr(m_offset, size));
+			m_offset += size;
+			return value;
+		}
+
+		// Element counts are checked against what is left, so a corrupt count can't cause a huge allocation
+		uint32_t ReadCount()
+		{
+			const auto count = Read<uint32_t>();
+
+			if (count > m_data.size() - m_offset)
+				m_failed = true;
+
+			return m_failed ? 0 : count;
+		}
+
+		[[nodiscard]] bool Failed() const { return m_failed; }
+
+		[[nodiscard]] bool AtEnd() const { return m_offset == m_data.size(); }
+
+	private:
+		std::string_view m_data;
+
+		size_t m_offset = 0;
+
+		bool m_failed = false;
+	};
+
+	void WriteStageVariables(BinaryWriter& writer, const std::vector<ShaderStageVariable>& variables)
+	{
+		writer.Write(static_cast<uint32_t>(variables.size()));
+
+		for (const auto& variable : variables) {
+			writer.WriteString(variable.name);
+			writer.Write(static_cast<uint32_t>(variable.stage));
+			writer.Write(variable.location);
+			writer.Write(static_cast<uint32_t>(variable.format));
+		}
+	}
+
+	void ReadStageVariables(BinaryReader& reader, std::vector<ShaderStageVariable>& variables)
+	{
+		variables.resize(reader.ReadCount());
+
+		for (auto& variable : variables) {
+			variable.name = reader.ReadString();
+			variable.stage = static_cast<vk::ShaderStageFlagBits>(reader.Read<uint32_t>());
+			variable.location = reader.Read<uint32_t>();
+			variable.format = static_cast<vk::Format>(reader.Read<uint32_t>());
+		}
+	}
+}
+
+/**
+ * \brief Gets the key that a reflection file is stored under: a hash of the SPIR-V of every stage.
+ * \param spirv The vulkan spirv binaries of a shader, per stage.
+ * \return The combined content hash.
+ */
+uint64_t ShaderReflectionCache::GetKey(const ShaderStageArray<std::vector<uint32_t>>& spirv)
+{
+	uint64_t key = Fnv1a::s_offsetBasis;
+
+	for (uint32_t index = 0; index < ShaderStage::s_count; index++) {
+		if (spirv[index].empty())
+			continue;
+
+		key = Fnv1a::Combine(key, ShaderModuleCache::Hash(spirv[index]) + index);
+	}
+
+	return key;
+}
+
+/**
+ * \brief Reads reflection results that were stored by Write.
+ * \param file_path The reflection file next to the cached SPIR-V.
+ * \param key The key of the SPIR-V that is currently being used.
+ * \param reflection Gets the stored results, only if the file matches the key.
+ * \return Whether the file existed, is valid and belongs to the same SPIR-V.
+ */
+bool ShaderReflectionCache::Read(const std::filesystem::path& file_path, const uint64_t key,
+                                 ShaderReflection& reflection)
+{
+	if (!std::filesystem::exists(file_path))
+		return false;
+
+	const MappedFile file(file_path.string());
+
+	if (!file.IsOpen())
+		return false;
+
+	BinaryReader reader(file.GetView());
+
+	if (reader.Read<uint32_t>() != s_magic || reader.Read<uint32_t>() != s_version || reader.Read<uint64_t>() != key)
+		return false;
+
+	ShaderReflection result;
+
+	result.bindings.resize(reader.ReadCount());
+
+	for (auto& binding : result.bindings) {
+		binding.name = reader.ReadString();
+		binding.set = reader.Read<uint32_t>();
+		binding.binding = reader.Read<uint32_t>();
+		binding.type = static_cast<vk::DescriptorType>(reader.Read<uint32_t>());
+		binding.count = reader.Read<uint32_t>();
+		binding.size = reader.Read<uint32_t>();
+		binding.stages = static_cast<vk::ShaderStageFlags>(reader.Read<uint32_t>());
+	}
+
+	result.pushConstantRanges.resize(reader.ReadCount());
+
+	for (auto& range : result.pushConstantRanges) {
+		range.stageFlags = static_cast<vk::ShaderStageFlags>(reader.Read<uint32_t>());
+		range.offset = reader.Read<uint32_t>();
+		range.size = reader.Read<uint32_t>();
+	}
+
+	result.uniformMembers.resize(reader.ReadCount());
+
+	for (auto& member : result.uniformMembers) {
+		member.name = reader.ReadString();
+		member.set = reader.Read<uint32_t>();
+		member.binding = reader.Read<uint32_t>();
+		member.offset = reader.Read<uint32_t>();
+		member.size = reader.Read<uint32_t>();
+		member.arrayStride = reader.Read<uint32_t>();
+	}
+
+	ReadStageVariables(reader, result.stageInputs);
+	ReadStageVariables(reader, result.stageOutputs);
+
+	for (auto& size : result.localSize)
+		size = reader.Read<uint32_t>();
+
+	if (reader.Failed() || !reader.AtEnd()) {
+		VK_CORE_WARN("Ignoring corrupt shader reflection cache {0}", file_path.string());
+		return false;
+	}
+
+	reflection = std::move(result);
+	return true;
+}
+
+/**
+ * \brief Stores reflection results, so that the next launch can skip reflecting the same SPIR-V.
+ * \param file_path The reflection file next to the cached SPIR-V.
+ * \param key The key of the SPIR-V that the results were reflected from.
+ * \param reflection The results to store.
+ */
+void ShaderReflectionCache::Write(const std::filesystem::path& file_path, const uint64_t key,
+                                  const ShaderReflection& reflection)
+{
+	BinaryWriter writer;
+
+	writer.Write(s_magic);
+	writer.Write(s_version);
+	writer.Write(key);
+
+	writer.Write(static_cast<uint32_t>(reflection.bindings.size()));
+
+	for (const auto& binding : reflection.bindings) {
+		writer.WriteString(binding.name);
+		writer.Write(binding.set);
+		writer.Write(binding.binding);
+		writer.Write(static_cast<uint32_t>(binding.type));
+		writer.Write(binding.count);
+		writer.Write(binding.size);
+		writer.Write(static_cast<uint32_t>(binding.stages));
+	}
+
+	writer.Write(static_cast<uint32_t>(reflection.pushConstantRanges.size()));
+
+	for (const auto& range : reflection.pushConstantRanges) {
+		writer.Write(static_cast<uint32_t>(range.stageFlags));
+		writer.Write(range.offset);
+		writer.Write(range.size);
+	}
+
+	writer.Write(static_cast<uint32_t>(reflection.uniformMembers.size()));
+
+	for (const auto& member : reflection.uniformMembers) {
+		writer.WriteString(member.name);
+		writer.Write(member.set);
+		writer.Write(member.binding);
+		writer.Write(member.offset);
+		writer.Write(member.size);
+		writer.Write(member.arrayStride);
+	}
+
+	WriteStageVariables(writer, reflection.stageInputs);
+	WriteStageVariables(writer, reflection.stageOutputs);
+
+	for (const uint32_t size : reflection.localSize)
+		writer.Write(size);
+
+	if (std::ofstream out(file_path, std::ios::out | std::ios::binary); out.is_open())
+		out.write(writer.GetData().data(), static_cast<std::streamsize>(writer.GetData().size()));
+	else
+		VK_CORE_WARN("Could not write shader reflection cache {0}", file_path.string());
+}
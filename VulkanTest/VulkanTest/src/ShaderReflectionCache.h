@@ -0,0 +1,20 @@
+﻿#pragma once
+#include <filesystem>
+#include <vector>
+
+#include "ShaderReflection.h"
+#include "ShaderStage.h"
+
+/**
+ * \brief Stores reflection results in a small binary file next to the cached SPIR-V, so that warm starts
+ * do not have to run spirv-cross at all. The file is only used if it was written for the exact same SPIR-V.
+ */
+class ShaderReflectionCache
+{
+public:
+	static uint64_t GetKey(const ShaderStageArray<std::vector<uint32_t>>& spirv);
+
+	static bool Read(const std::filesystem::path& file_path, uint64_t key, ShaderReflection& reflection);
+
+	static void Write(const std::filesystem::path& file_path, uint64_t key, const ShaderReflection& reflection);
+};
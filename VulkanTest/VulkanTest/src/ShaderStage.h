@@ -0,0 +1,55 @@
+﻿#pragma once
+#include <array>
+#include <stdexcept>
+#include <vulkan/vulkan.hpp>
+
+class ShaderStage
+{
+public:
+	static constexpr uint32_t s_count = 6;
+
+	// Every supported stage, in the order that they run inside a pipeline
+	static constexpr std::array<vk::ShaderStageFlagBits, s_count> s_stages = {
+		vk::ShaderStageFlagBits::eVertex,
+		vk::ShaderStageFlagBits::eTessellationControl,
+		vk::ShaderStageFlagBits::eTessellationEvaluation,
+		vk::ShaderStageFlagBits::eGeometry,
+		vk::ShaderStageFlagBits::eFragment,
+		vk::ShaderStageFlagBits::eCompute
+	};
+
+	/**
+	 * \brief Gets the position of a stage inside per-stage arrays.
+	 * \param stage A single vulkan shader stage.
+	 * \return The index of the stage.
+	 */
+	static constexpr uint32_t GetIndex(const vk::ShaderStageFlagBits stage)
+	{
+		switch (stage) {
+			case vk::ShaderStageFlagBits::eVertex:
+				return 0;
+
+			case vk::ShaderStageFlagBits::eTessellationControl:
+				return 1;
+
+			case vk::ShaderStageFlagBits::eTessellationEvaluation:
+				return 2;
+
+			case vk::ShaderStageFlagBits::eGeometry:
+				return 3;
+
+			case vk::ShaderStageFlagBits::eFragment:
+				return 4;
+
+			case vk::ShaderStageFlagBits::eCompute:
+				return 5;
+
+			default:
+				throw std::invalid_argument("Unsupported shader stage!");
+		}
+	}
+};
+
+// Storage with one element per shader stage, indexed by ShaderStage::GetIndex
+template < typename T >
+using ShaderStageArray = std::array<T, ShaderStage::s_count>;
@@ -0,0 +1,230 @@
+﻿#include "ShaderUniforms.h"
+
+#include <algorithm>
+#include <cstring>
+
+#include "Core/Assert.h"
+
+/**
+ * \brief Creates zero initialized copies of every uniform block that the shader declares.
+ * Members can be looked up by their qualified name ("ubo.model"), and by their plain name ("model")
+ * as long as no other block has a member with the same name.
+ * \param reflection The reflection data of the whole shader.
+ */
+ShaderUniforms::ShaderUniforms(const ShaderReflection& reflection)
+{
+	for (const auto& resource : reflection.bindings) {
+		if (resource.type != vk::DescriptorType::eUniformBuffer)
+			continue;
+
+		// Everything starts out dirty, so the uniform buffers never keep the garbage they were created with
+		Block block{
+			.set = resource.set,
+			.binding = resource.binding,
+			.data = std::vector<std::byte>(resource.size),
+			.dirtyFrames = UINT32_MAX
+		};
+
+		m_blocks.push_back(std::move(block));
+	}
+
+	std::unordered_map<std::string, uint32_t> plain_name_count;
+
+	for (const auto& uniform : reflection.uniformMembers) {
+
+		const auto block = std::ranges::find_if(m_blocks, [&](const Block& candidate)
+		{
+			return candidate.set == uniform.set && candidate.binding == uniform.binding;
+		});
+
+		VK_CORE_ASSERT(block != m_blocks.end(), "Uniform member without a uniform block!");
+		VK_CORE_ASSERT(uniform.offset + uniform.size <= block->data.size(), "Uniform member outside of its block!");
+
+		const auto handle = static_cast<ShaderUniformHandle>(m_members.size());
+
+		m_members.push_back(Member{
+			.block = static_cast<uint32_t>(block - m_blocks.begin()),
+			.offset = uniform.offset,
+			.size = uniform.size,
+			.arrayStride = uniform.arrayStride,
+			.dirtyFrames = UINT32_MAX
+		});
+
+		block->members.push_back(handle);
+		m_handles[uniform.name] = handle;
+
+		const std::string plain_name = uniform.name.substr(uniform.name.find('.') + 1);
+
+		if (plain_name_count[plain_name]++ == 0)
+			m_handles[plain_name] = handle;
+		else
+			m_handles.erase(plain_name);
+	}
+
+	for (auto& block : m_blocks)
+		std::ranges::sort(block.members, {}, [this](const ShaderUniformHandle handle)
+		{
+			return m_members[handle].offset;
+		});
+}
+
+/**
+ * \brief Looks up a uniform member by name. Meant to be done once, outside of the per frame code.
+ * \param name The qualified or plain name of the member.
+ * \return The handle of the member, or s_invalidHandle if the shader has no such uniform.
+ */
+ShaderUniformHandle ShaderUniforms::GetHandle(const std::string& name) const
+{
+	const auto it = m_handles.find(name);
+
+	return it == m_handles.end() ? s_invalidHandle : it->second;
+}
+
+/**
+ * \brief Writes a value into the CPU copy of a member. Writing the value it already has does not dirty it.
+ * Like glUniform with a location of -1, an invalid handle is ignored.
+ * \param handle The member to write.
+ * \param data The value, in the std140 layout of the member.
+ * \param size The size of the value in bytes, at most the size of the member.
+ */
+void ShaderUniforms::Set(const ShaderUniformHandle handle, const void* data, const uint32_t size)
+{
+	if (handle >= m_members.size())
+		return;
+
+	const Member& member = m_members[handle];
+
+	VK_CORE_ASSERT(size <= member.size, "Value is larger than the uniform it is written to!");
+
+	std::byte* destination = m_blocks[member.block].data.data() + member.offset;
+
+	if (std::memcmp(destination, data, size) == 0)
+		return;
+
+	std::memcpy(destination, data, size);
+	MarkDirty(handle);
+}
+
+/**
+ * \brief Writes tightly packed values into an array member, spreading them out to its array stride.
+ * \param handle The array member to write.
+ * \param data The values, one after another.
+ * \param element_size The size of a single value in bytes.
+ * \param count The number of values to write, starting from the first element.
+ */
+void ShaderUniforms::SetArray(const ShaderUniformHandle handle,
+                              const void* data,
+                              const uint32_t element_size,
+                              const uint32_t count)
+{
+	if (handle >= m_members.size())
+		return;
+
+	const Member& member = m_members[handle];
+
+	const uint32_t stride = member.arrayStride ? member.arrayStride : element_size;
+
+	VK_CORE_ASSERT(element_size <= stride, "Value is larger than the array elements it is written to!");
+	VK_CORE_ASSERT(count == 0 || (count - 1) * stride + element_size <= member.size, "Too many array values!");
+
+	std::byte* destination = m_blocks[member.block].data.data() + member.offset;
+	const auto* source = static_cast<const std::byte*>(data);
+
+	bool changed = false;
+
+	for (uint32_t i = 0; i < count; i++) {
+		std::byte* element = destination + i * stride;
+
+		if (std::memcmp(element, source + i * element_size, element_size) != 0) {
+			std::memcpy(element, source + i * element_size, element_size);
+			changed = true;
+		}
+	}
+
+	if (changed)
+		MarkDirty(handle);
+}
+
+/**
+ * \brief Copies the members of a block that changed since the last flush of the same frame.
+ * Neighbouring dirty members are merged, so they go out as a single copy.
+ * \param frame The frame in flight that the destination belongs to.
+ * \param set The descriptor set of the block.
+ * \param binding The binding of the block.
+ * \param destination The mapped (host coherent) uniform buffer of that frame.
+ * \return The number of bytes that were copied.
+ */
+uint32_t ShaderUniforms::Flush(const uint32_t frame, const uint32_t set, const uint32_t binding, void* destination)
+{
+	VK_CORE_ASSERT(frame < s_maxFramesInFlight, "Too many frames in flight!");
+
+	const uint32_t block_index = FindBlock(set, binding);
+
+	const uint32_t frame_bit = 1u << frame;
+
+	if (block_index == UINT32_MAX || !(m_blocks[block_index].dirtyFrames & frame_bit))
+		return 0;
+
+	Block* block = &m_blocks[block_index];
+
+	auto* target = static_cast<std::byte*>(destination);
+
+	uint32_t copied = 0;
+	uint32_t range_begin = 0;
+	uint32_t range_end = 0;
+
+	for (const ShaderUniformHandle handle : block->members) {
+		Member& member = m_members[handle];
+
+		if (!(member.dirtyFrames & frame_bit))
+			continue;
+
+		member.dirtyFrames &= ~frame_bit;
+
+		if (range_end != range_begin && member.offset > range_end) {
+			std::memcpy(target + range_begin, block->data.data() + range_begin, range_end - range_begin);
+			copied += range_end - range_begin;
+			range_begin = member.offset;
+		}
+		else if (range_end == range_begin)
+			range_begin = member.offset;
+
+		range_end = std::max(range_end, member.offset + member.size);
+	}
+
+	if (range_end != range_begin) {
+		std::memcpy(target + range_begin, block->data.data() + range_begin, range_end - range_begin);
+		copied += range_end - range_begin;
+	}
+
+	block->dirtyFrames &= ~frame_bit;
+
+	return copied;
+}
+
+uint32_t ShaderUniforms::GetBlockSize(const uint32_t set, const uint32_t binding) const
+{
+	const uint32_t block = FindBlock(set, binding);
+
+	return block == UINT32_MAX ? 0 : static_cast<uint32_t>(m_blocks[block].data.size());
+}
+
+uint32_t ShaderUniforms::FindBlock(const uint32_t set, const uint32_t binding) const
+{
+	for (uint32_t i = 0; i < m_blocks.size(); i++)
+		if (m_blocks[i].set == set && m_blocks[i].binding == binding)
+			return i;
+
+	return UINT32_MAX;
+}
+
+/**
+ * \brief Marks a member, and its block, as needing to be flushed to every frame in flight.
+ */
+void ShaderUniforms::MarkDirty(const ShaderUniformHandle handle)
+{
+	Member& member = m_members[handle];
+
+	member.dirtyFrames = UINT32_MAX;
+	m_blocks[member.block].dirtyFrames = UINT32_MAX;
+}
@@ -0,0 +1,76 @@
+﻿#pragma once
+#include <cstddef>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+#include "ShaderReflection.h"
+
+// Index of a uniform block member, looked up once by name so that setting it does no string hashing
+using ShaderUniformHandle = uint32_t;
+
+/**
+ * \brief CPU side copies of the uniform blocks of a shader, laid out exactly like the reflected blocks.
+ * Setting a member only touches the copy; every frame in flight then gets just the changed ranges flushed
+ * into its own uniform buffer.
+ */
+class ShaderUniforms
+{
+public:
+	static constexpr ShaderUniformHandle s_invalidHandle = UINT32_MAX;
+
+	// Dirty state is kept as one bit per frame in flight
+	static constexpr uint32_t s_maxFramesInFlight = 32;
+
+	ShaderUniforms() = default;
+
+	explicit ShaderUniforms(const ShaderReflection& reflection);
+
+	[[nodiscard]] ShaderUniformHandle GetHandle(const std::string& name) const;
+
+	void Set(ShaderUniformHandle handle, const void* data, uint32_t size);
+
+	void SetArray(ShaderUniformHandle handle, const void* data, uint32_t element_size, uint32_t count);
+
+	uint32_t Flush(uint32_t frame, uint32_t set, uint32_t binding, void* destination);
+
+	[[nodiscard]] uint32_t GetBlockSize(uint32_t set, uint32_t binding) const;
+
+private:
+	struct Block
+	{
+		uint32_t set = 0;
+
+		uint32_t binding = 0;
+
+		std::vector<std::byte> data;
+
+		// Members of the block, sorted by offset
+		std::vector<ShaderUniformHandle> members;
+
+		uint32_t dirtyFrames = 0;
+	};
+
+	struct Member
+	{
+		uint32_t block = 0;
+
+		uint32_t offset = 0;
+
+		uint32_t size = 0;
+
+		uint32_t arrayStride = 0;
+
+		uint32_t dirtyFrames = 0;
+	};
+
+	[[nodiscard]] uint32_t FindBlock(uint32_t set, uint32_t binding) const;
+
+	void MarkDirty(ShaderUniformHandle handle);
+
+	std::vector<Block> m_blocks;
+
+	std::vector<Member> m_members;
+
+	std::unordered_map<std::string, ShaderUniformHandle> m_handles;
+};
@@ -0,0 +1,116 @@
+﻿#include "SkylinePacker.h"
+
+#include <algorithm>
+
+SkylinePacker::SkylinePacker(const uint32_t width, const uint32_t height)
+	: m_width(width),
+	  m_height(height),
+	  m_skyline{{0, 0, width}} {}
+
+/**
+ * \brief Places a rectangle where its top ends up lowest, preferring the narrowest spot on ties to limit wasted space.
+ * \param width The width of the rectangle.
+ * \param height The height of the rectangle.
+ * \return Where the rectangle was placed, or nothing when it doesn't fit anymore.
+ */
+std::optional<PackedRect> SkylinePacker::Insert(const uint32_t width, const uint32_t height)
+{
+	if (width == 0 || height == 0 || width > m_width || height > m_height)
+		return std::nullopt;
+
+	size_t best_index = m_skyline.size();
+	uint32_t best_top = UINT32_MAX;
+	uint32_t best_width = UINT32_MAX;
+
+	for (size_t i = 0; i < m_skyline.size(); i++) {
+		const std::optional<uint32_t> y = Fit(i, width, height);
+
+		if (!y)
+			continue;
+
+		const uint32_t top = *y + height;
+
+		if (top < best_top || (top == best_top && m_skyline[i].width < best_width)) {
+			best_index = i;
+			best_top = top;
+			best_width = m_skyline[i].width;
+		}
+	}
+
+	if (best_index == m_skyline.size())
+		return std::nullopt;
+
+	const PackedRect rect{
+		.x = m_skyline[best_index].x,
+		.y = best_top - height,
+		.width = width,
+		.height = height
+	};
+
+	// The new segment covers the rectangle, and the segments it lies on are cut back to what is still visible
+	m_skyline.insert(m_skyline.begin() + static_cast<ptrdiff_t>(best_index), Segment{rect.x, best_top, width});
+
+	const uint32_t right = rect.x + width;
+
+	for (size_t i = best_index + 1; i < m_skyline.size();) {
+		Segment& segment = m_skyline[i];
+
+		if (segment.x >= right)
+			break;
+
+		const uint32_t overlap = right - segment.x;
+
+		if (overlap < segment.width) {
+			segment.x += overlap;
+			segment.width -= overlap;
+			break;
+		}
+
+		m_skyline.erase(m_skyline.begin() + static_cast<ptrdiff_t>(i));
+	}
+
+	// Neighbours at the same height are merged, so the skyline stays short
+	for (size_t i = 0; i + 1 < m_skyline.size();) {
+		if (m_skyline[i].y == m_skyline[i + 1].y) {
+			m_skyline[i].width += m_skyline[i + 1].width;
+			m_skyline.erase(m_skyline.begin() + static_cast<ptrdiff_t>(i + 1));
+		} else
+			i++;
+	}
+
+	m_usedArea += static_cast<uint64_t>(width) * height;
+
+	return rect;
+}
+
+float SkylinePacker::GetOccupancy() const
+{
+	return static_cast<float>(m_usedArea) / (static_cast<float>(m_width) * static_cast<float>(m_height));
+}
+
+/**
+ * \brief Finds how low a rectangle can sit when its left edge is at the start of a segment.
+ * \param index The segment that the rectangle starts on.
+ * \param width The width of the rectangle.
+ * \param height The height of the rectangle.
+ * \return The y of the bottom of the rectangle, which rests on the highest segment it spans, if it fits at all.
+ */
+std::optional<uint32_t> SkylinePacker::Fit(const size_t index, const uint32_t width, const uint32_t height) const
+{
+	if (m_skyline[index].x + width > m_width)
+		return std::nullopt;
+
+	uint32_t y = 0;
+	uint32_t remaining = width;
+
+	for (size_t i = index; remaining > 0; i++) {
+		y = std::max(y, m_skyline[i].y);
+
+		if (y + height > m_height)
+			return std::nullopt;
+
+		remaining -= std::min(remaining, m_skyline[i].width);
+	}
+
+	return y;
+}
@@ -0,0 +1,52 @@
+﻿#pragma once
+#include <cstdint>
+#include <optional>
+#include <vector>
+
+struct PackedRect
+{
+	uint32_t x = 0;
+
+	uint32_t y = 0;
+
+	uint32_t width = 0;
+
+	uint32_t height = 0;
+};
+
+/**
+ * \brief Packs rectangles into a fixed size area with the skyline bottom-left heuristic. Only the top edge of what is
+ * packed so far is tracked, so inserting stays cheap however many rectangles the area holds.
+ */
+class SkylinePacker
+{
+public:
+	SkylinePacker(uint32_t width, uint32_t height);
+
+	std::optional<PackedRect> Insert(uint32_t width, uint32_t height);
+
+	[[nodiscard]] uint64_t GetUsedArea() const { return m_usedArea; }
+
+	[[nodiscard]] float GetOccupancy() const;
+
+private:
+	// A horizontal segment of the skyline, starting at x and covering everything below y
+	struct Segment
+	{
+		uint32_t x;
+
+		uint32_t y;
+
+		uint32_t width;
+	};
+
+	[[nodiscard]] std::optional<uint32_t> Fit(size_t index, uint32_t width, uint32_t height) const;
+
+	uint32_t m_width;
+
+	uint32_t m_height;
+
+	uint64_t m_usedArea = 0;
+
+	std::vector<Segment> m_skyline;
+};
@@ -0,0 +1,387 @@
+﻿#include "SpirvOptimizer.h"
+
+#include <spirv-tools/optimizer.hpp>
+#include <spirv_cross/spirv_cross.hpp>
+
+#include "Core/Log.h"
+
+namespace
+{
+	// SPIR-V binary layout, see the "Physical Layout of a SPIR-V Module" section of the specification
+	constexpr size_t s_headerWordCount = 5;
+
+	constexpr uint32_t s_opName = 5;
+	constexpr uint32_t s_opEntryPoint = 15;
+	constexpr uint32_t s_opVariable = 59;
+	constexpr uint32_t s_opStore = 62;
+	constexpr uint32_t s_opAccessChain = 65;
+	constexpr uint32_t s_opInBoundsAccessChain = 66;
+	constexpr uint32_t s_opDecorate = 71;
+
+	constexpr uint32_t s_storageClassInput = 1;
+	constexpr uint32_t s_storageClassOutput = 3;
+	constexpr uint32_t s_decorationLocation = 30;
+
+	/**
+	 * \brief Gets the number of words in an OpEntryPoint before its interface list.
+	 * The name operand is a nul terminated string packed four characters per word.
+	 */
+	size_t GetEntryPointInterfaceStart(const uint32_t* instruction, const size_t word_count)
+	{
+		size_t word = 3;
+
+		while (word < word_count) {
+			const uint32_t packed = instruction[word++];
+
+			if ((packed >> 24) == 0)
+				break;
+		}
+
+		return word;
+	}
+
+	/**
+	 * \brief Gets how many consecutive locations an interface variable takes up.
+	 * Arrays and matrices take one location per element or column, and blocks one per member.
+	 */
+	uint32_t GetLocationCount(const spirv_cross::Compiler& compiler, const spirv_cross::SPIRType& type)
+	{
+		uint32_t location_count = type.columns;
+
+		if (type.basetype == spirv_cross::SPIRType::Struct) {
+			location_count = 0;
+
+			for (const auto member_type : type.member_types)
+				location_count += GetLocationCount(compiler, compiler.get_type(member_type));
+		}
+
+		for (const uint32_t length : type.array)
+			location_count *= length;
+
+		return location_count;
+	}
+}
+
+/**
+ * \brief Runs post-processing passes over every stage of a shader.
+ * \param stages The SPIR-V of each stage, which is replaced by its optimized version.
+ * \param settings Which passes to run.
+ * \param shader_name The name of the shader, only used for logging.
+ */
+void SpirvOptimizer::Optimize(ShaderStageArray<std::vector<uint32_t>>& stages,
+                              const SpirvOptimizerSettings& settings,
+                              const std::string& shader_name)
+{
+	ShaderStageArray<std::pair<size_t, uint32_t>> before;
+
+	for (uint32_t index = 0; index < ShaderStage::s_count; index++) {
+		if (stages[index].empty())
+			continue;
+
+		before[index] = {stages[index].size() * sizeof(uint32_t), CountInstructions(stages[index])};
+		RunPasses(stages[index], settings);
+	}
+
+	/*
+	 * Go from the last stage to the first, so that inputs which the optimizer already
+	 * removed from a stage also stop counting as read when its producer gets pruned.
+	 * The stages are stored in pipeline order, with compute last, which never has a consumer.
+	 * Both sides of an interface lose the same locations: an input that has no output to match
+	 * is invalid (VUID-RuntimeSpirv-OpEntryPoint-08743), even if it is never read.
+	 */
+	if (settings.pruneStageInterfaces) {
+		std::vector<uint32_t>* consumer = nullptr;
+
+		for (auto it = std::rbegin(ShaderStage::s_stages); it != std::rend(ShaderStage::s_stages); ++it) {
+
+			auto& spirv = stages[ShaderStage::GetIndex(*it)];
+
+			if (*it == vk::ShaderStageFlagBits::eCompute || spirv.empty())
+				continue;
+
+			if (consumer) {
+				const std::set<uint32_t> read_locations = GetReadInputLocations(*consumer);
+
+				const uint32_t removed_outputs = RemoveInterfaceVariables(spirv, s_storageClassOutput, read_locations);
+				const uint32_t removed_inputs = RemoveInterfaceVariables(*consumer, s_storageClassInput,
+				                                                         read_locations);
+
+				if (removed_outputs || removed_inputs)
+					VK_CORE_TRACE("SpirvOptimizer - {0} {1}: removed {2} unread output(s), and {3} input(s) of the "
+					              "next stage", shader_name, vk::to_string(*it), removed_outputs, removed_inputs);
+
+				if (removed_outputs)
+					RunCleanupPasses(spirv, settings);
+
+				if (removed_inputs)
+					RunCleanupPasses(*consumer, settings);
+			}
+
+			consumer = &spirv;
+		}
+	}
+
+	for (const auto stage : ShaderStage::s_stages) {
+		const uint32_t index = ShaderStage::GetIndex(stage);
+
+		if (stages[index].empty())
+			continue;
+
+		const auto [size_before, instructions_before] = before[index];
+
+		VK_CORE_TRACE("SpirvOptimizer - {0} {1}: {2} -> {3} bytes, {4} -> {5} instructions", shader_name,
+		              vk::to_string(stage), size_before, stages[index].size() * sizeof(uint32_t),
+		              instructions_before, CountInstructions(stages[index]));
+	}
+}
+
+/**
+ * \brief Strips debug information from every stage of a shader, without optimizing it again.
+ * \param stages The SPIR-V of each stage, which is replaced by its stripped version.
+ */
+void SpirvOptimizer::StripDebugInfo(ShaderStageArray<std::vector<uint32_t>>& stages)
+{
+	const SpirvOptimizerSettings settings{
+		.performancePasses = false,
+		.stripDebugInfo = true,
+		.pruneStageInterfaces = false
+	};
+
+	for (auto& spirv : stages)
+		if (!spirv.empty())
+			RunPasses(spirv, settings);
+}
+
+/**
+ * \brief Counts the instructions of a SPIR-V module.
+ * \param spirv The SPIR-V binary.
+ * \return The number of instructions after the header.
+ */
+uint32_t SpirvOptimizer::CountInstructions(const std::vector<uint32_t>& spirv)
+{
+	uint32_t count = 0;
+
+	for (size_t word = s_headerWordCount; word < spirv.size(); count++) {
+		const uint32_t word_count = spirv[word] >> 16;
+
+		if (word_count == 0)
+			break;
+
+		word += word_count;
+	}
+
+	return count;
+}
+
+/**
+ * \brief Runs spirv-opt over a single module.
+ * \param spirv The SPIR-V binary, which is replaced by the optimized version if all passes succeed.
+ * \param settings Which passes to run.
+ * \return Whether the optimization succeeded.
+ */
+bool SpirvOptimizer::RunPasses(std::vector<uint32_t>& spirv, const SpirvOptimizerSettings& settings)
+{
+	spvtools::Optimizer optimizer(SPV_ENV_VULKAN_1_3);
+
+	optimizer.SetMessageConsumer([](spv_message_level_t level,
+	                                const char* source,
+	                                const spv_position_t& position,
+	                                const char* message)
+	{
+		if (level <= SPV_MSG_ERROR)
+			VK_CORE_ERROR("spirv-opt: {0}", message);
+	});
+
+	if (settings.performancePasses)
+		optimizer.RegisterPerformancePasses();
+
+	if (!settings.passes.empty() && !optimizer.RegisterPassesFromFlags(settings.passes)) {
+		VK_CORE_ERROR("spirv-opt: Invalid pass flags");
+		return false;
+	}
+
+	if (settings.stripDebugInfo)
+		optimizer.RegisterPass(spvtools::CreateStripDebugInfoPass());
+
+	std::vector<uint32_t> optimized;
+
+	if (!optimizer.Run(spirv.data(), spirv.size(), &optimized))
+		return false;
+
+	spirv = std::move(optimized);
+
+	return true;
+}
+
+/**
+ * \brief Cleans up everything that only existed to compute or declare removed interface variables.
+ */
+void SpirvOptimizer::RunCleanupPasses(std::vector<uint32_t>& spirv, const SpirvOptimizerSettings& settings)
+{
+	SpirvOptimizerSettings cleanup = settings;
+	cleanup.passes.emplace_back("--eliminate-dead-code-aggressive");
+	cleanup.passes.emplace_back("--eliminate-dead-const");
+	cleanup.passes.emplace_back("--remove-unused-interface-variables");
+
+	RunPasses(spirv, cleanup);
+}
+
+/**
+ * \brief Finds the locations of all the inputs that a stage actually reads.
+ * \param spirv The SPIR-V of the consuming stage.
+ * \return The set of read input locations.
+ */
+std::set<uint32_t> SpirvOptimizer::GetReadInputLocations(const std::vector<uint32_t>& spirv)
+{
+	spirv_cross::Compiler compiler(spirv);
+
+	// Only look at the variables that the entry point's call graph touches
+	const auto resources = compiler.get_shader_resources(compiler.get_active_interface_variables());
+
+	std::set<uint32_t> locations;
+
+	for (const auto& input : resources.stage_inputs) {
+
+		const uint32_t location = compiler.get_decoration(input.id, spv::DecorationLocation);
+		const uint32_t location_count = GetLocationCount(compiler, compiler.get_type(input.type_id));
+
+		for (uint32_t i = 0; i < location_count; i++)
+			locations.insert(location + i);
+	}
+
+	return locations;
+}
+
+/**
+ * \brief Removes the located input or output variables of a stage whose location is not kept, along with every store
+ * to them. The computations feeding those stores are left for dead code elimination to remove.
+ * \param spirv The SPIR-V of the stage.
+ * \param storage_class Output to prune a producer, or Input to prune the consumer to match.
+ * \param kept_locations The input locations that the consuming stage reads.
+ * \return The number of removed variables.
+ */
+uint32_t SpirvOptimizer::RemoveInterfaceVariables(std::vector<uint32_t>& spirv,
+                                                  const uint32_t storage_class,
+                                                  const std::set<uint32_t>& kept_locations)
+{
+	if (spirv.size() <= s_headerWordCount)
+		return 0;
+
+	std::unordered_map<uint32_t, uint32_t> locations;
+	std::set<uint32_t> variables;
+
+	// First pass: find the located variables of the storage class
+	for (size_t word = s_headerWordCount; word < spirv.size();) {
+		const uint32_t opcode = spirv[word] & 0xFFFF;
+		const uint32_t word_count = spirv[word] >> 16;
+
+		if (word_count == 0)
+			return 0;
+
+		if (opcode == s_opDecorate && word_count >= 4 && spirv[word + 2] == s_decorationLocation)
+			locations[spirv[word + 1]] = spirv[word + 3];
+		else if (opcode == s_opVariable && spirv[word + 3] == storage_class)
+			variables.insert(spirv[word + 2]);
+
+		word += word_count;
+	}
+
+	// Pointers to the removed variables (the variables, and any access chains into them)
+	std::set<uint32_t> dead;
+
+	for (const uint32_t variable : variables)
+		if (auto location = locations.find(variable);
+			location != locations.end() && !kept_locations.contains(location->second))
+			dead.insert(variable);
+
+	if (dead.empty())
+		return 0;
+
+	const auto removed_count = static_cast<uint32_t>(dead.size());
+
+	/*
+	 * Second pass: follow access chains, and make sure that the variables are only ever stored to.
+	 * Any other use (e.g. reading back an output, or passing it to a function) keeps the module as is.
+	 * Inputs that are not kept are never read, so they have no uses at all.
+	 */
+	for (size_t word = s_headerWordCount; word < spirv.size();) {
+		const uint32_t opcode = spirv[word] & 0xFFFF;
+		const uint32_t word_count = spirv[word] >> 16;
+
+		switch (opcode) {
+			case s_opName:
+			case s_opDecorate:
+			case s_opEntryPoint:
+			case s_opVariable:
+			case s_opStore:
+				break;
+
+			case s_opAccessChain:
+			case s_opInBoundsAccessChain:
+				if (dead.contains(spirv[word + 3])) {
+					dead.insert(spirv[word + 2]);
+					break;
+				}
+				[[fallthrough]];
+
+			default:
+				for (uint32_t operand = 1; operand < word_count; operand++)
+					if (dead.contains(spirv[word + operand]))
+						return 0;
+		}
+
+		word += word_count;
+	}
+
+	// Third pass: copy every instruction that does not reference the removed variables
+	std::vector<uint32_t> result(spirv.begin(), spirv.begin() + s_headerWordCount);
+	result.reserve(spirv.size());
+
+	for (size_t word = s_headerWordCount; word < spirv.size();) {
+		const uint32_t opcode = spirv[word] & 0xFFFF;
+		const uint32_t word_count = spirv[word] >> 16;
+		const uint32_t* instruction = &spirv[word];
+
+		word += word_count;
+
+		switch (opcode) {
+			case s_opName:
+			case s_opDecorate:
+			case s_opStore:
+				if (dead.contains(instruction[1]))
+					continue;
+				break;
+
+			case s_opVariable:
+			case s_opAccessChain:
+			case s_opInBoundsAccessChain:
+				if (dead.contains(instruction[2]))
+					continue;
+				break;
+
+			case s_opEntryPoint: {
+				// Rebuild the entry point without the removed variables in its interface
+				const size_t interface_start = GetEntryPointInterfaceStart(instruction, word_count);
+				const size_t header = result.size();
+
+				result.insert(result.end(), instruction, instruction + interface_start);
+
+				for (size_t i = interface_start; i < word_count; i++)
+					if (!dead.contains(instruction[i]))
+						result.push_back(instruction[i]);
+
+				result[header] = (static_cast<uint32_t>(result.size() - header) << 16) | opcode;
+				continue;
+			}
+
+			default:
+				break;
+		}
+
+		result.insert(result.end(), instruction, instruction + word_count);
+	}
+
+	spirv = std::move(result);
+
+	return removed_count;
+}
@@ -0,0 +1,60 @@
+﻿#pragma once
+#include <set>
+#include <string>
+#include <vector>
+#include <vulkan/vulkan.hpp>
+
+#include "ShaderStage.h"
+
+struct SpirvOptimizerSettings
+{
+	// Runs the same set of passes as "spirv-opt -O"
+	bool performancePasses = true;
+
+	// Extra passes, using the same flags as the spirv-opt command line (e.g. "--merge-blocks")
+	std::vector<std::string> passes;
+
+	// Removes names, source text and line information. Reflection has to run before, since it needs the names
+	bool stripDebugInfo = false;
+
+	// Removes outputs that the next stage never reads, the code that computes them, and the matching inputs
+	bool pruneStageInterfaces = true;
+
+	/**
+	 * \brief The settings that shaders are compiled with by default. Release builds strip debug information, after
+	 * the uniform member names have been reflected and stored next to the SPIR-V.
+	 */
+	static SpirvOptimizerSettings GetDefault()
+	{
+		SpirvOptimizerSettings settings;
+
+#ifdef NDEBUG
+		settings.stripDebugInfo = true;
+#endif
+
+		return settings;
+	}
+};
+
+class SpirvOptimizer
+{
+public:
+	static void Optimize(ShaderStageArray<std::vector<uint32_t>>& stages,
+	                     const SpirvOptimizerSettings& settings,
+	                     const std::string& shader_name);
+
+	static void StripDebugInfo(ShaderStageArray<std::vector<uint32_t>>& stages);
+
+	static uint32_t CountInstructions(const std::vector<uint32_t>& spirv);
+
+private:
+	static bool RunPasses(std::vector<uint32_t>& spirv, const SpirvOptimizerSettings& settings);
+
+	static std::set<uint32_t> GetReadInputLocations(const std::vector<uint32_t>& spirv);
+
+	static uint32_t RemoveInterfaceVariables(std::vector<uint32_t>& spirv,
+	                                         uint32_t storage_class,
+	                                         const std::set<uint32_t>& kept_locations);
+
+	static void RunCleanupPasses(std::vector<uint32_t>& spirv, const SpirvOptimizerSettings& settings);
+};
@@ -55,7 +55,8 @@ void SwapChain::CreateSwapChain(vk::SwapchainKHR& swap_chain,
 		.imageUsage = vk::ImageUsageFlagBits::eColorAttachment
 	};
 
-	const auto [indices_graphics_family, indices_present_family] = PhysicalDevice::FindQueueFamilies(physical_device);
+	const auto [indices_graphics_family, indices_present_family, indices_transfer_family] =
+		PhysicalDevice::FindQueueFamilies(physical_device);
 	const uint32_t queue_family_indices[] = {indices_graphics_family.value(), indices_present_family.value()};
 
 	if (indices_graphics_family != indices_present_family) {
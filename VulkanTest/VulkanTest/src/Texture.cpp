@@ -1,7 +1,24 @@
 ﻿#define VULKAN_HPP_NO_CONSTRUCTORS
 
 #include "Texture.h"
+
+#include <filesystem>
+#include <fstream>
+#include <limits>
+#include <optional>
+
 #include "Buffer.h"
+#include "HostImageCopy.h"
+#include "Image.h"
+#include "ImageKernels.h"
+#include "Ktx2File.h"
+#include "PhysicalDevice.h"
+#include "SamplerCache.h"
+#include "TextureTranscoder.h"
+#include "TextureUploadBatch.h"
+#include "Core/Log.h"
+#include "Core/MappedFile.h"
+#include "Core/Timer.h"
 
 #define STB_IMAGE_IMPLEMENTATION
 #include <stb_image.h>
@@ -12,213 +29,723 @@ Texture::Texture(const std::string& file_path,
                  const vk::CommandPool command_pool,
                  const vk::Queue& queue)
 {
-	int tex_width, tex_height, tex_channels;
+	TextureUploadBatch batch(device, physical_device, command_pool, queue);
+
+	Load(file_path, batch);
+
+	batch.Submit();
+}
+
+/**
+ * \brief Loads a texture into a batch, which uploads it together with the rest of the batch.
+ * The texture can't be sampled before the batch was submitted.
+ * \param file_path The path of the image, relative to the textures folder.
+ * \param batch The batch that records the upload, which has to submit to a graphics queue if the mip chain is blitted.
+ */
+Texture::Texture(const std::string& file_path, TextureUploadBatch& batch)
+{
+	Load(file_path, batch);
+}
+
+/**
+ * \brief Loads images of the same size as the layers of one array texture, so that a set of materials or sprites
+ * needs a single descriptor and binding, and shaders pick the layer instead.
+ * The texture can't be sampled before the batch was submitted.
+ * \param file_paths The paths of the images, relative to the textures folder, in layer order.
+ * \param batch The batch that records the upload, which has to submit to a graphics queue if the mip chain is blitted.
+ */
+Texture::Texture(const std::vector<std::string>& file_paths, TextureUploadBatch& batch)
+{
+	if (file_paths.empty())
+		throw std::invalid_argument("Array textures need at least one layer!");
+
+	const vk::Device device = batch.GetDevice();
+	const vk::PhysicalDevice physical_device = batch.GetPhysicalDevice();
+
+	m_filePath = "assets/textures/" + file_paths.front();
+	m_layerCount = static_cast<uint32_t>(file_paths.size());
+	m_viewType = vk::ImageViewType::e2DArray;
+
+	std::vector<stbi_uc*> layers;
+	std::vector<int> layer_channels;
+	int tex_width = 0, tex_height = 0;
+
+	for (const std::string& file_path : file_paths) {
+		int width, height, channels;
+		stbi_uc* pixels = DecodeImageFile("assets/textures/" + file_path, width, height, channels);
+
+		if (pixels && layers.empty()) {
+			tex_width = width;
+			tex_height = height;
+		}
+
+		if (!pixels || width != tex_width || height != tex_height) {
+			stbi_image_free(pixels);
+
+			for (stbi_uc* layer : layers)
+				stbi_image_free(layer);
+
+			throw std::runtime_error("Failed to load array texture layer " + file_path +
+			                         "! Every layer must be an image of the same size");
+		}
+
+		layers.push_back(pixels);
+		layer_channels.push_back(channels);
+	}
+
+	const auto width = static_cast<uint32_t>(tex_width);
+	const auto height = static_cast<uint32_t>(tex_height);
+
+	m_mipLevels = ImageKernels::GetMipLevelCount(width, height);
+
+	const bool blit_mipmaps = SupportsLinearBlit(physical_device, m_format);
+
+	std::vector<vk::BufferImageCopy> layer_regions;
+
+	const vk::DeviceSize layer_size = GetMipChainRegions(width, height, blit_mipmaps ? 1 : m_mipLevels,
+	                                                     layer_regions);
+
+	vk::Buffer staging_buffer;
+	vk::DeviceSize staging_offset;
+
+	uint8_t* staging = batch.Allocate(layer_size * m_layerCount, m_format, staging_offset, staging_buffer);
+
+	// Every layer holds its own chain, one after the other
+	std::vector<vk::BufferImageCopy> regions;
+
+	for (uint32_t layer = 0; layer < m_layerCount; layer++) {
+		uint8_t* layer_staging = staging + layer * layer_size;
+
+		ImageKernels::ExpandToRgba8(layers[layer], static_cast<uint32_t>(layer_channels[layer]),
+		                            static_cast<size_t>(width) * height, layer_staging);
+
+		stbi_image_free(layers[layer]);
+
+		for (uint32_t level = 1; level < layer_regions.size(); level++)
+			ImageKernels::DownsampleRgba8(layer_staging + layer_regions[level - 1].bufferOffset,
+			                              layer_regions[level - 1].imageExtent.width,
+			                              layer_regions[level - 1].imageExtent.height,
+			                              layer_staging + layer_regions[level].bufferOffset);
+
+		for (vk::BufferImageCopy region : layer_regions) {
+			region.bufferOffset += staging_offset + layer * layer_size;
+			region.imageSubresource.baseArrayLayer = layer;
+
+			regions.push_back(region);
+		}
+	}
+
+	vk::ImageUsageFlags usage = vk::ImageUsageFlagBits::eTransferDst | vk::ImageUsageFlagBits::eSampled;
+
+	if (blit_mipmaps)
+		usage |= vk::ImageUsageFlagBits::eTransferSrc;
+
+	Image::Create(device, physical_device, ImageSpecification{
+		              .viewType = m_viewType,
+		              .format = m_format,
+		              .width = width,
+		              .height = height,
+		              .mipLevels = m_mipLevels,
+		              .arrayLayers = m_layerCount,
+		              .usage = usage
+	              }, m_textureImage, m_textureImageMemory);
+
+	batch.Add(m_textureImage, m_mipLevels, m_layerCount, staging_buffer, std::move(regions), blit_mipmaps);
+
+	VK_CORE_TRACE("Texture {0}: {1}x{2}, {3} layers, {4} mip levels ({5})", m_filePath, width, height, m_layerCount,
+	              m_mipLevels, blit_mipmaps ? "blit" : "cpu");
+}
+
+/**
+ * \brief Creates a 1x1 texture of a single color, e.g. to stand in for textures that are still loading.
+ * \param color The RGBA color of the texture.
+ * \param device The logical device.
+ * \param physical_device The physical device, used to find memory for the image.
+ * \param command_pool The command pool that the upload commands are allocated from.
+ * \param graphics_queue The queue that the upload is submitted to.
+ */
+Texture::Texture(const std::array<uint8_t, 4>& color,
+                 const vk::Device device,
+                 const vk::PhysicalDevice physical_device,
+                 const vk::CommandPool command_pool,
+                 const vk::Queue& graphics_queue)
+{
+	TextureUploadBatch batch(device, physical_device, command_pool, graphics_queue);
+
+	std::vector<vk::BufferImageCopy> regions;
+	GetMipChainRegions(1, 1, 1, regions);
+
+	vk::Buffer staging_buffer;
+	memcpy(batch.Allocate(color.size(), m_format, regions[0].bufferOffset, staging_buffer), color.data(),
+	       color.size());
+
+	CreateImage(device, physical_device, 1, 1, m_mipLevels, m_format, vk::ImageTiling::eOptimal,
+	            vk::ImageUsageFlagBits::eTransferDst | vk::ImageUsageFlagBits::eSampled,
+	            vk::MemoryPropertyFlagBits::eDeviceLocal, m_textureImage, m_textureImageMemory);
+
+	batch.Add(m_textureImage, m_mipLevels, 1, staging_buffer, std::move(regions));
+	batch.Submit();
+}
+
+void Texture::Load(const std::string& file_path, TextureUploadBatch& batch)
+{
+	m_filePath = "assets/textures/" + file_path;
 
-	std::string cached_root_path = "assets/textures/" + file_path;
+	if (Ktx2File::IsKtx2(m_filePath))
+		LoadKtx2(m_filePath, batch);
+	else
+		LoadImageFile(m_filePath, batch);
+}
 
-	m_filePath = cached_root_path.c_str();
+/**
+ * \brief Loads a regular image (png, jpg, ...) as RGBA8, and generates its mip chain.
+ * \param file_path The path of the image.
+ * \param batch The batch that the upload is recorded into.
+ */
+void Texture::LoadImageFile(const std::string& file_path, TextureUploadBatch& batch)
+{
+	const vk::Device device = batch.GetDevice();
+	const vk::PhysicalDevice physical_device = batch.GetPhysicalDevice();
 
-	stbi_uc* pixels = stbi_load(m_filePath, &tex_width, &tex_height, &tex_channels, STBI_rgb_alpha);
+	int tex_width, tex_height, tex_channels;
 
-	vk::DeviceSize image_size = tex_width * tex_height * 4;
+	// Decoded with the channels of the file, which are expanded to RGBA by the SIMD kernels rather than by stb
+	stbi_uc* pixels = DecodeImageFile(file_path, tex_width, tex_height, tex_channels);
 
 	if (!pixels)
 		throw std::runtime_error("Failed to load texture image!");
 
+	const auto width = static_cast<uint32_t>(tex_width);
+	const auto height = static_cast<uint32_t>(tex_height);
+
+	m_mipLevels = ImageKernels::GetMipLevelCount(width, height);
+
+	// Devices that take host copies get the pixels written straight into the image, skipping the batch entirely
+	const bool host_copy = HostImageCopy::IsEnabled() && HostImageCopy::SupportsFormat(physical_device, m_format);
+
+	/*
+	 * The GPU filters the mip chain itself if it can blit the format linearly,
+	 * otherwise the whole chain is built on the CPU and uploaded together with the base level.
+	 */
+	const bool blit_mipmaps = !host_copy && SupportsLinearBlit(physical_device, m_format);
+
+	std::vector<vk::BufferImageCopy> regions;
+
+	const vk::DeviceSize image_size = GetMipChainRegions(width, height, blit_mipmaps ? 1 : m_mipLevels, regions);
+
+	std::vector<uint8_t> host_pixels;
 	vk::Buffer staging_buffer;
-	vk::DeviceMemory staging_buffer_memory;
+	vk::DeviceSize staging_offset = 0;
+
+	uint8_t* staging;
+
+	if (host_copy) {
+		host_pixels.resize(image_size);
+		staging = host_pixels.data();
+	} else
+		staging = batch.Allocate(image_size, m_format, staging_offset, staging_buffer);
 
-	Buffer::CreateBuffer(device, physical_device, image_size, vk::BufferUsageFlagBits::eTransferSrc,
-	                     vk::MemoryPropertyFlagBits::eHostVisible | vk::MemoryPropertyFlagBits::eHostCoherent,
-	                     staging_buffer, staging_buffer_memory);
+	ImageKernels::ExpandToRgba8(pixels, static_cast<uint32_t>(tex_channels), static_cast<size_t>(width) * height,
+	                            staging);
 
-	void* data;
-	device.mapMemory(staging_buffer_memory, 0, image_size, {}, &data);
-	memcpy(data, pixels, image_size);
-	device.unmapMemory(staging_buffer_memory);
+	// Each level is filtered from the previous one, straight inside the mapped staging memory
+	for (uint32_t level = 1; level < regions.size(); level++)
+		ImageKernels::DownsampleRgba8(staging + regions[level - 1].bufferOffset,
+		                              regions[level - 1].imageExtent.width, regions[level - 1].imageExtent.height,
+		                              staging + regions[level].bufferOffset);
 
 	stbi_image_free(pixels);
 
-	CreateImage(device, physical_device, tex_width, tex_height, vk::Format::eR8G8B8A8Srgb, vk::ImageTiling::eOptimal,
-	            vk::ImageUsageFlagBits::eTransferDst | vk::ImageUsageFlagBits::eSampled,
+	vk::ImageUsageFlags usage = vk::ImageUsageFlagBits::eSampled;
+
+	if (host_copy)
+		usage |= HostImageCopy::GetImageUsage();
+	else
+		usage |= vk::ImageUsageFlagBits::eTransferDst;
+
+	if (blit_mipmaps)
+		usage |= vk::ImageUsageFlagBits::eTransferSrc;
+
+	CreateImage(device, physical_device, width, height, m_mipLevels, m_format, vk::ImageTiling::eOptimal, usage,
 	            vk::MemoryPropertyFlagBits::eDeviceLocal, m_textureImage, m_textureImageMemory);
 
-	TransitionImageLayout(device, command_pool, queue, m_textureImage, vk::Format::eR8G8B8A8Srgb,
-	                      vk::ImageLayout::eUndefined, vk::ImageLayout::eTransferDstOptimal);
+	if (host_copy) {
+		const Timer timer;
+
+		HostImageCopy::Upload(device, m_textureImage, m_mipLevels, 1, staging, regions);
+
+		VK_CORE_TRACE("Texture {0}: {1}x{2}, {3} mip levels, written from the host in {4:.2f} ms", file_path, width,
+		              height, m_mipLevels, timer.ElapsedMillis());
+		return;
+	}
 
-	Buffer::CopyBufferToImage(device, command_pool, queue, staging_buffer, m_textureImage,
-	                          static_cast<uint32_t>(tex_width), static_cast<uint32_t>(tex_height));
+	for (vk::BufferImageCopy& region : regions)
+		region.bufferOffset += staging_offset;
 
-	TransitionImageLayout(device, command_pool, queue, m_textureImage, vk::Format::eR8G8B8A8Srgb,
-	                      vk::ImageLayout::eTransferDstOptimal, vk::ImageLayout::eShaderReadOnlyOptimal);
+	batch.Add(m_textureImage, m_mipLevels, 1, staging_buffer, std::move(regions), blit_mipmaps);
 
-	device.destroyBuffer(staging_buffer, nullptr);
-	device.freeMemory(staging_buffer_memory, nullptr);
+	VK_CORE_TRACE("Texture {0}: {1}x{2}, {3} mip levels ({4})", file_path, width, height, m_mipLevels,
+	              blit_mipmaps ? "blit" : "cpu");
 }
 
-void Texture::CreateTextureImageView(const vk::Device device)
+/**
+ * \brief Decodes an image file straight out of a read-only mapping of it, instead of through the buffered stdio reads
+ * of stbi_load, which copy the whole file once more before the decoder sees it.
+ * \param file_path The path of the image.
+ * \param width Gets the width of the image.
+ * \param height Gets the height of the image.
+ * \param channels Gets the number of channels in the file.
+ * \param desired_channels The number of channels to decode to, 0 to keep those of the file.
+ * \return The pixels, freed with stbi_image_free, or nullptr if the file couldn't be read or decoded.
+ */
+uint8_t* Texture::DecodeImageFile(const std::string& file_path,
+                                  int& width,
+                                  int& height,
+                                  int& channels,
+                                  const int desired_channels)
 {
-	m_textureImageView = CreateImageView(device, m_textureImage, vk::Format::eR8G8B8A8Srgb);
+	const Timer timer;
+
+	const MappedFile file(file_path);
+
+	if (!file.IsOpen() || file.GetSize() == 0 || file.GetSize() > static_cast<size_t>(std::numeric_limits<int>::max()))
+		return nullptr;
+
+	// The decoder reads the file once from front to back, so the kernel can read far ahead of it on a cold cache
+	file.Advise(MappedFile::Access::Sequential);
+
+	stbi_uc* pixels = stbi_load_from_memory(reinterpret_cast<const stbi_uc*>(file.GetData()),
+	                                        static_cast<int>(file.GetSize()), &width, &height, &channels,
+	                                        desired_channels);
+
+	if (pixels)
+		VK_CORE_TRACE("Decoded {0}: {1} KiB mapped, {2}x{3} in {4:.2f} ms", file_path, file.GetSize() / 1024, width,
+		              height, timer.ElapsedMillis());
+
+	return pixels;
 }
 
-void Texture::CreateTextureSampler(vk::Device device, const vk::PhysicalDevice physical_device)
+/**
+ * \brief Reads the size of an image file from its header, through a mapping like DecodeImageFile instead of stdio.
+ * The kernel is asked to read the rest of the file ahead, since it is usually decoded right after.
+ * \param file_path The path of the image.
+ * \param width Gets the width of the image.
+ * \param height Gets the height of the image.
+ * \param channels Gets the number of channels in the file.
+ * \return Whether the file could be read and is an image that stb_image understands.
+ */
+bool Texture::ReadImageInfo(const std::string& file_path, int& width, int& height, int& channels)
 {
-	vk::PhysicalDeviceProperties properties;
+	const MappedFile file(file_path);
+
+	if (!file.IsOpen() || file.GetSize() == 0 || file.GetSize() > static_cast<size_t>(std::numeric_limits<int>::max()))
+		return false;
+
+	file.Advise(MappedFile::Access::WillNeed);
 
-	physical_device.getProperties(&properties);
+	return stbi_info_from_memory(reinterpret_cast<const stbi_uc*>(file.GetData()), static_cast<int>(file.GetSize()),
+	                             &width, &height, &channels) != 0;
+}
+
+/**
+ * \brief Measures decoding a generated, uncompressed image from a cold page cache. Decoding a BMP costs little, so
+ * most of the time is spent waiting for the disk, which is what the hints of MappedFile::Advise are about.
+ * \param width The width of the image.
+ * \param height The height of the image.
+ */
+void Texture::BenchmarkDecode(const uint32_t width, const uint32_t height)
+{
+	const uint32_t row_size = (width * 3 + 3) & ~3u;
+	const uint32_t pixel_size = row_size * height;
 
-	vk::SamplerCreateInfo sampler_info{
-		.magFilter = vk::Filter::eLinear,
-		.minFilter = vk::Filter::eLinear,
-		.mipmapMode = vk::SamplerMipmapMode::eLinear,
-		.addressModeU = vk::SamplerAddressMode::eRepeat,
-		.addressModeV = vk::SamplerAddressMode::eRepeat,
-		.addressModeW = vk::SamplerAddressMode::eRepeat,
-		.mipLodBias = 0.0f,
-		.anisotropyEnable = static_cast<vk::Bool32>(true),
-		.maxAnisotropy = properties.limits.maxSamplerAnisotropy,
-		.compareEnable = static_cast<vk::Bool32>(false),
-		.compareOp = vk::CompareOp::eAlways,
-		.minLod = 0.0f,
-		.maxLod = 0.0f,
-		.borderColor = vk::BorderColor::eIntOpaqueBlack,
-		.unnormalizedCoordinates = static_cast<vk::Bool32>(false)
+	std::vector<uint8_t> bmp(54 + static_cast<size_t>(pixel_size));
+
+	auto write = [&bmp](const size_t offset, const uint32_t value, const size_t size)
+	{
+		memcpy(bmp.data() + offset, &value, size);
 	};
 
-	if (device.createSampler(&sampler_info, nullptr, &m_textureSampler) != vk::Result::eSuccess)
-		throw std::runtime_error("Failed to create texture sampler!");
+	// A bottom-up 24 bit BMP with the 40 byte info header
+	write(0, 0x4D42, 2);
+	write(2, static_cast<uint32_t>(bmp.size()), 4);
+	write(10, 54, 4);
+	write(14, 40, 4);
+	write(18, width, 4);
+	write(22, height, 4);
+	write(26, 1, 2);
+	write(28, 24, 2);
+	write(34, pixel_size, 4);
+
+	for (uint32_t y = 0; y < height; y++)
+		for (uint32_t x = 0; x < width; x++) {
+			uint8_t* pixel = bmp.data() + 54 + static_cast<size_t>(y) * row_size + x * 3;
+			pixel[0] = static_cast<uint8_t>(x ^ y);
+			pixel[1] = static_cast<uint8_t>(x * 7 + y);
+			pixel[2] = static_cast<uint8_t>(y * 3);
+		}
+
+	const std::filesystem::path path = std::filesystem::temp_directory_path() / "VulkanTestDecodeBenchmark.bmp";
+
+	{
+		std::ofstream file(path, std::ios::binary);
+		file.write(reinterpret_cast<const char*>(bmp.data()), static_cast<std::streamsize>(bmp.size()));
+
+		if (!file) {
+			VK_CORE_ERROR("Could not write {0}", path.string());
+			return;
+		}
+	}
+
+	BenchmarkColdDecode(path.string());
+
+	std::error_code error;
+	std::filesystem::remove(path, error);
 }
 
-void Texture::Destroy(const vk::Device device) const
+/**
+ * \brief Measures decoding an image file from a cold page cache.
+ * \param file_path The path of the image, relative to the textures folder.
+ */
+void Texture::BenchmarkDecode(const std::string& file_path)
 {
-	device.destroySampler(m_textureSampler, nullptr);
-	device.destroyImageView(m_textureImageView, nullptr);
-	device.destroyImage(m_textureImage, nullptr);
-	device.freeMemory(m_textureImageMemory, nullptr);
+	BenchmarkColdDecode("assets/textures/" + file_path);
 }
 
-void Texture::CreateImage(const vk::Device device,
-                          const vk::PhysicalDevice physical_device,
-                          uint32_t width,
-                          uint32_t height,
-                          vk::Format format,
-                          vk::ImageTiling tiling,
-                          vk::ImageUsageFlags usage,
-                          const vk::MemoryPropertyFlags properties,
-                          vk::Image& image,
-                          vk::DeviceMemory& image_memory)
+/**
+ * \brief Decodes a file from a cold page cache without a hint and with the hints that make the OS read a mapping
+ * ahead, and also reads through the mapping without decoding it, which leaves only the I/O. The file is dropped
+ * from the page cache before every run, and each result is the average of a few runs.
+ * \param file_path The path of the image.
+ */
+void Texture::BenchmarkColdDecode(const std::string& file_path)
 {
-	vk::ImageCreateInfo image_info{
-		// Optional
-		.flags = {},
-		.imageType = vk::ImageType::e2D,
-		.format = format,
-		.extent{
-			.width = width,
-			.height = height,
-			.depth = 1
-		},
-		.mipLevels = 1,
-		.arrayLayers = 1,
-		.samples = vk::SampleCountFlagBits::e1,
-		.tiling = tiling,
-		.usage = usage,
-		.sharingMode = vk::SharingMode::eExclusive,
-		.initialLayout = vk::ImageLayout::eUndefined,
+	struct Hint
+	{
+		const char* name;
+
+		std::optional<MappedFile::Access> access;
+	};
+
+	const Hint hints[] = {
+		{"No hint", std::nullopt},
+		{"Sequential", MappedFile::Access::Sequential},
+		{"Will need", MappedFile::Access::WillNeed}
 	};
 
-	if (device.createImage(&image_info, nullptr, &image) != vk::Result::eSuccess)
-		throw std::runtime_error("Failed to create image!");
+	constexpr int runs = 5;
+	constexpr size_t page_size = 4096;
+
+	size_t file_size;
+
+	{
+		const MappedFile file(file_path);
+
+		if (!file.IsOpen() || file.GetSize() == 0 || !MappedFile::Evict(file_path)) {
+			VK_CORE_ERROR("Could not open or evict {0}", file_path);
+			return;
+		}
+
+		file_size = file.GetSize();
+	}
+
+	VK_CORE_INFO("Cold decode benchmark: {0}, {1:.1f} MiB", file_path,
+	             static_cast<float>(file_size) / (1024.0f * 1024.0f));
 
-	vk::MemoryRequirements mem_requirements;
-	device.getImageMemoryRequirements(image, &mem_requirements);
+	auto decode = [](const MappedFile& file)
+	{
+		int width, height, channels;
 
-	vk::MemoryAllocateInfo alloc_info{
-		.allocationSize = mem_requirements.size,
-		.memoryTypeIndex = Buffer::FindMemoryType(mem_requirements.memoryTypeBits,
-		                                          properties, physical_device)
+		stbi_uc* pixels = stbi_load_from_memory(reinterpret_cast<const stbi_uc*>(file.GetData()),
+		                                        static_cast<int>(file.GetSize()), &width, &height, &channels, 0);
+
+		if (!pixels)
+			throw std::runtime_error("Failed to decode texture image!");
+
+		stbi_image_free(pixels);
 	};
 
-	if (device.allocateMemory(&alloc_info, nullptr, &image_memory) != vk::Result::eSuccess)
-		throw std::runtime_error("Failed to allocate image memory!");
+	// Every page that is read goes into this, so that reading them can't be optimized away
+	uint8_t checksum = 0;
+
+	for (const Hint& hint : hints) {
+		float read_milliseconds = 0.0f;
+		float decode_milliseconds = 0.0f;
 
-	device.bindImageMemory(image, image_memory, 0);
+		for (int run = 0; run < runs; run++) {
+			MappedFile::Evict(file_path);
+
+			{
+				const Timer timer;
+				const MappedFile file(file_path);
+
+				if (hint.access)
+					file.Advise(*hint.access);
+
+				for (size_t offset = 0; offset < file.GetSize(); offset += page_size)
+					checksum += static_cast<uint8_t>(file.GetData()[offset]);
+
+				read_milliseconds += timer.ElapsedMillis();
+			}
+
+			MappedFile::Evict(file_path);
+
+			{
+				const Timer timer;
+				const MappedFile file(file_path);
+
+				if (hint.access)
+					file.Advise(*hint.access);
+
+				decode(file);
+				decode_milliseconds += timer.ElapsedMillis();
+			}
+		}
+
+		VK_CORE_INFO("  {0}: reading {1:.2f} ms, decoding {2:.2f} ms", hint.name, read_milliseconds / runs,
+		             decode_milliseconds / runs);
+	}
+
+	// The same once the file is cached, which is what no hint can make faster
+	float read_milliseconds = 0.0f;
+	float decode_milliseconds = 0.0f;
+
+	for (int run = 0; run < runs; run++) {
+		{
+			const Timer timer;
+			const MappedFile file(file_path);
+
+			for (size_t offset = 0; offset < file.GetSize(); offset += page_size)
+				checksum += static_cast<uint8_t>(file.GetData()[offset]);
+
+			read_milliseconds += timer.ElapsedMillis();
+		}
+
+		const Timer timer;
+		const MappedFile file(file_path);
+
+		decode(file);
+		decode_milliseconds += timer.ElapsedMillis();
+	}
+
+	VK_CORE_INFO("  Cached: reading {0:.2f} ms, decoding {1:.2f} ms", read_milliseconds / runs,
+	             decode_milliseconds / runs);
+	VK_CORE_TRACE("  Checksum of the pages read: {0}", checksum);
 }
 
-vk::ImageView Texture::CreateImageView(const vk::Device device, vk::Image image, vk::Format format)
+/**
+ * \brief Loads a KTX2 texture with all of its stored mip levels. Block compressed levels are uploaded as they are,
+ * unless the device can't sample the format, in which case they are decoded to RGBA8 on the CPU first.
+ * \param file_path The path of the KTX2 file.
+ * \param batch The batch that the upload is recorded into.
+ */
+void Texture::LoadKtx2(const std::string& file_path, TextureUploadBatch& batch)
 {
-	vk::ImageViewCreateInfo view_info{
-		.image = image,
-		.viewType = vk::ImageViewType::e2D,
-		.format = format,
-		.subresourceRange{
-			.aspectMask = vk::ImageAspectFlagBits::eColor,
-			.baseMipLevel = 0,
-			.levelCount = 1,
-			.baseArrayLayer = 0,
-			.layerCount = 1
-		}
-	};
+	const vk::Device device = batch.GetDevice();
+	const vk::PhysicalDevice physical_device = batch.GetPhysicalDevice();
 
-	vk::ImageView image_view;
-
-	if (device.createImageView(&view_info, nullptr, &image_view) != vk::Result::eSuccess)
-		throw std::runtime_error("Failed to create texture image view!");
-
-	return image_view;
-}
-
-void Texture::TransitionImageLayout(const vk::Device device,
-                                    const vk::CommandPool command_pool,
-                                    const vk::Queue& graphics_queue,
-                                    vk::Image image,
-                                    vk::Format format,
-                                    vk::ImageLayout old_layout,
-                                    vk::ImageLayout new_layout)
-{
-	vk::CommandBuffer command_buffer = Buffer::BeginSingleTimeCommands(device, command_pool);
-
-	vk::ImageMemoryBarrier barrier{
-		.srcAccessMask = vk::AccessFlagBits::eNone,
-		.dstAccessMask = vk::AccessFlagBits::eNone,
-		.oldLayout = old_layout,
-		.newLayout = new_layout,
-		.srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED,
-		.dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED,
-		.image = image,
-		.subresourceRange{
-			.aspectMask = vk::ImageAspectFlagBits::eColor,
-			.baseMipLevel = 0,
-			.levelCount = 1,
-			.baseArrayLayer = 0,
-			.layerCount = 1
-		},
-	};
+	const Ktx2File file(file_path);
 
-	vk::PipelineStageFlags source_stage, destination_stage;
+	if (!file.IsValid())
+		throw std::runtime_error("Failed to load KTX2 texture!");
 
-	if (old_layout == vk::ImageLayout::eUndefined && new_layout == vk::ImageLayout::eTransferDstOptimal) {
-		barrier.srcAccessMask = vk::AccessFlagBits::eNone;
-		barrier.dstAccessMask = vk::AccessFlagBits::eTransferWrite;
+	const vk::Format file_format = file.GetFormat();
+	const bool transcode = !PhysicalDevice::SupportsSampledImageFormat(physical_device, file_format);
 
-		source_stage = vk::PipelineStageFlagBits::eTopOfPipe;
-		destination_stage = vk::PipelineStageFlagBits::eTransfer;
+	if (transcode && !TextureTranscoder::CanDecode(file_format))
+		throw std::runtime_error("Texture format " + vk::to_string(file_format) +
+		                         " is not supported by the device and can't be decoded!");
 
-	} else if (old_layout == vk::ImageLayout::eTransferDstOptimal && new_layout ==
-	           vk::ImageLayout::eShaderReadOnlyOptimal) {
-		barrier.srcAccessMask = vk::AccessFlagBits::eTransferWrite;
-		barrier.dstAccessMask = vk::AccessFlagBits::eShaderRead;
+	m_format = transcode ? TextureTranscoder::GetDecodedFormat(file_format) : file_format;
+	m_mipLevels = file.GetLevelCount();
 
-		source_stage = vk::PipelineStageFlagBits::eTransfer;
-		destination_stage = vk::PipelineStageFlagBits::eFragmentShader;
+	// Copies of block compressed data have to start at a multiple of the block size
+	const vk::DeviceSize alignment = TextureUploadBatch::GetOffsetAlignment(m_format);
 
-	} else
-		throw std::invalid_argument("Unsupported layout transition!");
+	std::vector<vk::BufferImageCopy> regions;
+	vk::DeviceSize image_size = 0;
+
+	for (uint32_t level = 0; level < m_mipLevels; level++) {
+		const Ktx2File::Level& file_level = file.GetLevel(level);
 
-	command_buffer.pipelineBarrier(source_stage,
-	                               destination_stage,
-	                               vk::DependencyFlagBits::eByRegion,
-	                               0, nullptr, 0, nullptr, 1, &barrier);
+		regions.push_back(vk::BufferImageCopy{
+			.bufferOffset = image_size,
+			.bufferRowLength = 0,
+			.bufferImageHeight = 0,
+			.imageSubresource{
+				.aspectMask = vk::ImageAspectFlagBits::eColor,
+				.mipLevel = level,
+				.baseArrayLayer = 0,
+				.layerCount = 1
+			},
+			.imageOffset = {0, 0, 0},
+			.imageExtent = {file_level.width, file_level.height, 1}
+		});
 
-	Buffer::EndSingleTimeCommands(device, command_pool, graphics_queue, command_buffer);
+		image_size += TextureTranscoder::GetLevelSize(m_format, file_level.width, file_level.height);
+		image_size = (image_size + alignment - 1) / alignment * alignment;
+	}
+
+	vk::Buffer staging_buffer;
+	vk::DeviceSize staging_offset;
+
+	uint8_t* staging = batch.Allocate(image_size, m_format, staging_offset, staging_buffer);
+
+	for (uint32_t level = 0; level < m_mipLevels; level++) {
+		const Ktx2File::Level& file_level = file.GetLevel(level);
+		uint8_t* destination = staging + regions[level].bufferOffset;
+
+		if (transcode)
+			TextureTranscoder::Decode(file_format, file_level.data, file_level.width, file_level.height, destination);
+		else
+			memcpy(destination, file_level.data,
+			       TextureTranscoder::GetLevelSize(m_format, file_level.width, file_level.height));
+
+		regions[level].bufferOffset += staging_offset;
+	}
+
+	CreateImage(device, physical_device, file.GetWidth(), file.GetHeight(), m_mipLevels, m_format,
+	            vk::ImageTiling::eOptimal, vk::ImageUsageFlagBits::eTransferDst | vk::ImageUsageFlagBits::eSampled,
+	            vk::MemoryPropertyFlagBits::eDeviceLocal, m_textureImage, m_textureImageMemory);
+
+	batch.Add(m_textureImage, m_mipLevels, 1, staging_buffer, std::move(regions));
+
+	VK_CORE_TRACE("Texture {0}: {1}x{2} {3}, {4} mip levels, {5} bytes{6}", file_path, file.GetWidth(),
+	              file.GetHeight(), vk::to_string(m_format), m_mipLevels, image_size,
+	              transcode ? " (decoded on the CPU)" : "");
+}
+
+void Texture::CreateTextureImageView(const vk::Device device)
+{
+	m_textureImageView = Image::CreateView(device, m_textureImage, m_viewType, m_format, vk::ImageSubresourceRange{
+		                                       .aspectMask = vk::ImageAspectFlagBits::eColor,
+		                                       .baseMipLevel = 0,
+		                                       .levelCount = m_mipLevels,
+		                                       .baseArrayLayer = 0,
+		                                       .layerCount = m_layerCount
+	                                       });
+}
+
+/**
+ * \brief Picks the default sampler for the texture. Samplers are shared through the sampler cache,
+ * so the texture doesn't own it.
+ */
+void Texture::CreateTextureSampler(const vk::Device device, const vk::PhysicalDevice physical_device)
+{
+	m_textureSampler = SamplerCache::GetDefault(device, physical_device);
+}
+
+/**
+ * \brief Gets how much device memory the image of the texture occupies, including the padding of the driver.
+ * \param device The logical device that owns the image.
+ * \return The size of the image memory in bytes.
+ */
+vk::DeviceSize Texture::GetMemorySize(const vk::Device device) const
+{
+	vk::MemoryRequirements memory_requirements;
+	device.getImageMemoryRequirements(m_textureImage, &memory_requirements);
+
+	return memory_requirements.size;
+}
+
+void Texture::Destroy(const vk::Device device) const
+{
+	device.destroyImageView(m_textureImageView, nullptr);
+	device.destroyImage(m_textureImage, nullptr);
+	device.freeMemory(m_textureImageMemory, nullptr);
+}
+
+void Texture::CreateImage(const vk::Device device,
+                          const vk::PhysicalDevice physical_device,
+                          const uint32_t width,
+                          const uint32_t height,
+                          const uint32_t mip_levels,
+                          const vk::Format format,
+                          const vk::ImageTiling tiling,
+                          const vk::ImageUsageFlags usage,
+                          const vk::MemoryPropertyFlags properties,
+                          vk::Image& image,
+                          vk::DeviceMemory& image_memory)
+{
+	Image::Create(device, physical_device, ImageSpecification{
+		              .format = format,
+		              .width = width,
+		              .height = height,
+		              .mipLevels = mip_levels,
+		              .tiling = tiling,
+		              .usage = usage,
+		              .memoryProperties = properties
+	              }, image, image_memory);
+}
+
+vk::ImageView Texture::CreateImageView(const vk::Device device,
+                                       const vk::Image image,
+                                       const vk::Format format,
+                                       const uint32_t mip_levels)
+{
+	return Image::CreateView(device, image, vk::ImageViewType::e2D, format, vk::ImageSubresourceRange{
+		                         .aspectMask = vk::ImageAspectFlagBits::eColor,
+		                         .baseMipLevel = 0,
+		                         .levelCount = mip_levels,
+		                         .baseArrayLayer = 0,
+		                         .layerCount = 1
+	                         });
+}
+
+/**
+ * \brief Checks whether the mip chain of a format can be generated by the GPU with linear filtered blits.
+ * \param physical_device The device whose format support is checked.
+ * \param format The format of the texture.
+ * \return Whether optimal tiled images of the format support linear filtering and blitting both ways.
+ */
+bool Texture::SupportsLinearBlit(const vk::PhysicalDevice physical_device, const vk::Format format)
+{
+	vk::FormatProperties format_properties;
+	physical_device.getFormatProperties(format, &format_properties);
+
+	constexpr vk::FormatFeatureFlags required = vk::FormatFeatureFlagBits::eSampledImageFilterLinear |
+	                                            vk::FormatFeatureFlagBits::eBlitSrc |
+	                                            vk::FormatFeatureFlagBits::eBlitDst;
+
+	return (format_properties.optimalTilingFeatures & required) == required;
+}
+
+/**
+ * \brief Lays out the levels of a tightly packed RGBA8 mip chain one after another inside a single buffer.
+ * \param width The width of the base level.
+ * \param height The height of the base level.
+ * \param mip_levels How many levels to lay out.
+ * \param regions Gets the copy region of every level.
+ * \return The size of the whole chain in bytes.
+ */
+vk::DeviceSize Texture::GetMipChainRegions(const uint32_t width,
+                                           const uint32_t height,
+                                           const uint32_t mip_levels,
+                                           std::vector<vk::BufferImageCopy>& regions)
+{
+	vk::DeviceSize offset = 0;
+
+	regions.clear();
+
+	for (uint32_t level = 0; level < mip_levels; level++) {
+		const uint32_t level_width = ImageKernels::GetMipExtent(width, level);
+		const uint32_t level_height = ImageKernels::GetMipExtent(height, level);
+
+		regions.push_back(vk::BufferImageCopy{
+			.bufferOffset = offset,
+			.bufferRowLength = 0,
+			.bufferImageHeight = 0,
+			.imageSubresource{
+				.aspectMask = vk::ImageAspectFlagBits::eColor,
+				.mipLevel = level,
+				.baseArrayLayer = 0,
+				.layerCount = 1
+			},
+			.imageOffset = {0, 0, 0},
+			.imageExtent = {level_width, level_height, 1}
+		});
+
+		offset += static_cast<vk::DeviceSize>(level_width) * level_height * 4;
+	}
+
+	return offset;
 }
@@ -1,6 +1,11 @@
 ﻿#pragma once
+#include <array>
+#include <string>
+#include <vector>
 #include <vulkan/vulkan.hpp>
 
+class TextureUploadBatch;
+
 class Texture
 {
 public:
@@ -10,17 +15,57 @@ public:
 	        vk::CommandPool command_pool,
 	        const vk::Queue& queue);
 
+	Texture(const std::string& file_path, TextureUploadBatch& batch);
+
+	Texture(const std::vector<std::string>& file_paths, TextureUploadBatch& batch);
+
+	Texture(const std::array<uint8_t, 4>& color,
+	        vk::Device device,
+	        vk::PhysicalDevice physical_device,
+	        vk::CommandPool command_pool,
+	        const vk::Queue& graphics_queue);
+
 	void CreateTextureImageView(vk::Device device);
 
 	void CreateTextureSampler(vk::Device device, vk::PhysicalDevice physical_device);
 
 	void Destroy(vk::Device device) const;
 
+	[[nodiscard]] vk::DeviceSize GetMemorySize(vk::Device device) const;
+
+	[[nodiscard]] const std::string& GetFilePath() const { return m_filePath; }
+
+	[[nodiscard]] uint32_t GetLayerCount() const { return m_layerCount; }
+
+	static void BenchmarkDecode(uint32_t width, uint32_t height);
+
+	static void BenchmarkDecode(const std::string& file_path);
+
 private:
+	// Only used by the streamer and texture residency, which create and fill the image themselves
+	Texture() = default;
+
+	void Load(const std::string& file_path, TextureUploadBatch& batch);
+
+	void LoadImageFile(const std::string& file_path, TextureUploadBatch& batch);
+
+	void LoadKtx2(const std::string& file_path, TextureUploadBatch& batch);
+
+	static uint8_t* DecodeImageFile(const std::string& file_path,
+	                                int& width,
+	                                int& height,
+	                                int& channels,
+	                                int desired_channels = 0);
+
+	static bool ReadImageInfo(const std::string& file_path, int& width, int& height, int& channels);
+
+	static void BenchmarkColdDecode(const std::string& file_path);
+
 	static void CreateImage(vk::Device device,
 	                        vk::PhysicalDevice physical_device,
 	                        uint32_t width,
 	                        uint32_t height,
+	                        uint32_t mip_levels,
 	                        vk::Format format,
 	                        vk::ImageTiling tiling,
 	                        vk::ImageUsageFlags usage,
@@ -28,17 +73,24 @@ private:
 	                        vk::Image& image,
 	                        vk::DeviceMemory& image_memory);
 
-	static void TransitionImageLayout(vk::Device device,
-	                                  vk::CommandPool command_pool,
-	                                  const vk::Queue& graphics_queue,
-	                                  vk::Image image,
-	                                  vk::Format format,
-	                                  vk::ImageLayout old_layout,
-	                                  vk::ImageLayout new_layout);
+	static vk::ImageView CreateImageView(vk::Device device, vk::Image image, vk::Format format, uint32_t mip_levels = 1);
+
+	static bool SupportsLinearBlit(vk::PhysicalDevice physical_device, vk::Format format);
+
+	static vk::DeviceSize GetMipChainRegions(uint32_t width,
+	                                         uint32_t height,
+	                                         uint32_t mip_levels,
+	                                         std::vector<vk::BufferImageCopy>& regions);
+
+	std::string m_filePath;
+
+	vk::Format m_format = vk::Format::eR8G8B8A8Srgb;
 
-	static vk::ImageView CreateImageView(vk::Device device, vk::Image image, vk::Format format);
+	uint32_t m_mipLevels = 1;
 
-	const char* m_filePath;
+	uint32_t m_layerCount = 1;
+
+	vk::ImageViewType m_viewType = vk::ImageViewType::e2D;
 
 	vk::Image m_textureImage;
 
@@ -46,9 +98,22 @@ private:
 
 	vk::ImageView m_textureImageView;
 
+	// Owned by the sampler cache, and shared with every texture that samples the same way
 	vk::Sampler m_textureSampler;
 
+	friend class BindlessTextures;
+
+	friend class HostImageCopy;
+
+	friend class ResidentTexture;
+
 	friend class SwapChain;
 
+	friend class TextureAtlas;
+
+	friend class TextureResidency;
+
+	friend class TextureStreamer;
+
 	friend class VkUniform;
 };
@@ -0,0 +1,272 @@
+﻿#define VULKAN_HPP_NO_CONSTRUCTORS
+
+#include "TextureAtlas.h"
+
+#include <algorithm>
+#include <bit>
+#include <stb_image.h>
+
+#include "Buffer.h"
+#include "ImageKernels.h"
+#include "Core/Log.h"
+
+TextureAtlas::TextureAtlas(const vk::Device device,
+                           const vk::PhysicalDevice physical_device,
+                           const vk::CommandPool command_pool,
+                           const vk::Queue graphics_queue,
+                           const uint32_t page_size,
+                           const uint32_t padding)
+	: m_device(device),
+	  m_physicalDevice(physical_device),
+	  m_commandPool(command_pool),
+	  m_graphicsQueue(graphics_queue),
+	  m_pageSize(page_size),
+	  m_padding(padding),
+	  m_mipLevels(std::max(1u, static_cast<uint32_t>(std::bit_width(padding)))),
+	  m_alignment(1u << (m_mipLevels - 1))
+{
+	if (page_size % m_alignment != 0)
+		throw std::invalid_argument("Atlas page size must be a multiple of the gutter alignment!");
+}
+
+TextureAtlas::~TextureAtlas()
+{
+	for (const Page& page : m_pages)
+		page.texture->Destroy(m_device);
+}
+
+/**
+ * \brief Packs an image into the first page with room for it, creating a new page when none has.
+ * The image only shows up on the GPU after the next Flush.
+ * \param pixels The RGBA8 pixels of the image.
+ * \param width The width of the image.
+ * \param height The height of the image.
+ * \return The page, and the UV rectangle of the image inside it.
+ */
+AtlasRegion TextureAtlas::Add(const uint8_t* pixels, const uint32_t width, const uint32_t height)
+{
+	const uint32_t padded_width = Align(width + 2 * m_padding);
+	const uint32_t padded_height = Align(height + 2 * m_padding);
+
+	if (padded_width > m_pageSize || padded_height > m_pageSize)
+		throw std::invalid_argument("Image is too big for the texture atlas!");
+
+	std::optional<PackedRect> rect;
+	uint32_t page_index = 0;
+
+	for (; page_index < m_pages.size(); page_index++)
+		if ((rect = m_pages[page_index].packer.Insert(padded_width, padded_height)))
+			break;
+
+	if (!rect)
+		rect = CreatePage().packer.Insert(padded_width, padded_height);
+
+	Page& page = m_pages[page_index];
+
+	// Every gutter texel repeats the closest edge texel of the image
+	for (uint32_t y = 0; y < rect->height; y++) {
+		const uint32_t source_y = std::clamp(y, m_padding, m_padding + height - 1) - m_padding;
+		const uint8_t* source_row = pixels + static_cast<size_t>(source_y) * width * 4;
+		uint8_t* row = page.pixels.data() + (static_cast<size_t>(rect->y + y) * m_pageSize + rect->x) * 4;
+
+		for (uint32_t x = 0; x < m_padding; x++)
+			memcpy(row + x * 4, source_row, 4);
+
+		memcpy(row + m_padding * 4, source_row, static_cast<size_t>(width) * 4);
+
+		for (uint32_t x = m_padding + width; x < rect->width; x++)
+			memcpy(row + x * 4, source_row + (width - 1) * 4, 4);
+	}
+
+	page.dirtyMinX = std::min(page.dirtyMinX, rect->x);
+	page.dirtyMinY = std::min(page.dirtyMinY, rect->y);
+	page.dirtyMaxX = std::max(page.dirtyMaxX, rect->x + rect->width);
+	page.dirtyMaxY = std::max(page.dirtyMaxY, rect->y + rect->height);
+
+	const float page_size = static_cast<float>(m_pageSize);
+
+	return AtlasRegion{
+		.page = page_index,
+		.uvMin = glm::vec2(rect->x + m_padding, rect->y + m_padding) / page_size,
+		.uvMax = glm::vec2(rect->x + m_padding + width, rect->y + m_padding + height) / page_size
+	};
+}
+
+/**
+ * \brief Loads an image file and packs it into the atlas.
+ * \param file_path The path of the image, relative to the textures folder.
+ * \return The page, and the UV rectangle of the image inside it.
+ */
+AtlasRegion TextureAtlas::Add(const std::string& file_path)
+{
+	const std::string root_path = "assets/textures/" + file_path;
+
+	int tex_width, tex_height, tex_channels;
+
+	stbi_uc* pixels = Texture::DecodeImageFile(root_path, tex_width, tex_height, tex_channels, STBI_rgb_alpha);
+
+	if (!pixels)
+		throw std::runtime_error("Failed to load texture image!");
+
+	const AtlasRegion region = Add(pixels, static_cast<uint32_t>(tex_width), static_cast<uint32_t>(tex_height));
+
+	stbi_image_free(pixels);
+
+	return region;
+}
+
+/**
+ * \brief Uploads what was added to each page since the last flush, only covering the changed area of every level.
+ * Must be called before the pages are sampled, and from the thread that submits to the graphics queue.
+ */
+void TextureAtlas::Flush()
+{
+	for (Page& page : m_pages)
+		if (page.dirtyMinX < page.dirtyMaxX) {
+			Upload(page);
+
+			page.dirtyMinX = page.dirtyMinY = UINT32_MAX;
+			page.dirtyMaxX = page.dirtyMaxY = 0;
+			page.uploaded = true;
+		}
+}
+
+TextureAtlas::Page& TextureAtlas::CreatePage()
+{
+	Page page{
+		.packer = SkylinePacker(m_pageSize, m_pageSize),
+		.pixels = std::vector<uint8_t>(static_cast<size_t>(m_pageSize) * m_pageSize * 4),
+		.texture = std::unique_ptr<Texture>(new Texture())
+	};
+
+	Texture& texture = *page.texture;
+
+	texture.m_filePath = "atlas page " + std::to_string(m_pages.size());
+	texture.m_mipLevels = m_mipLevels;
+
+	Texture::CreateImage(m_device, m_physicalDevice, m_pageSize, m_pageSize, m_mipLevels, texture.m_format,
+	                     vk::ImageTiling::eOptimal,
+	                     vk::ImageUsageFlagBits::eTransferDst | vk::ImageUsageFlagBits::eSampled,
+	                     vk::MemoryPropertyFlagBits::eDeviceLocal, texture.m_textureImage,
+	                     texture.m_textureImageMemory);
+
+	// The first upload covers the whole page, so the image never has undefined texels
+	page.dirtyMinX = page.dirtyMinY = 0;
+	page.dirtyMaxX = page.dirtyMaxY = m_pageSize;
+
+	// The page is only added once its texture is complete, since the destructor and Flush use every page texture
+	try {
+		texture.CreateTextureImageView(m_device);
+		texture.CreateTextureSampler(m_device, m_physicalDevice);
+
+		return m_pages.emplace_back(std::move(page));
+	} catch (...) {
+		texture.Destroy(m_device);
+		throw;
+	}
+}
+
+/**
+ * \brief Rebuilds the mip chain of the dirty area of a page inside mapped staging memory,
+ * and copies every level of it into the page in one submission.
+ * \param page The page to upload.
+ */
+void TextureAtlas::Upload(Page& page) const
+{
+	// Images are placed on the alignment grid, so the dirty area is aligned and halves exactly on every level
+	const uint32_t x = page.dirtyMinX;
+	const uint32_t y = page.dirtyMinY;
+	const uint32_t width = page.dirtyMaxX - page.dirtyMinX;
+	const uint32_t height = page.dirtyMaxY - page.dirtyMinY;
+
+	std::vector<vk::BufferImageCopy> regions;
+	vk::DeviceSize size = 0;
+
+	for (uint32_t level = 0; level < m_mipLevels; level++) {
+		regions.push_back(vk::BufferImageCopy{
+			.bufferOffset = size,
+			.bufferRowLength = 0,
+			.bufferImageHeight = 0,
+			.imageSubresource{
+				.aspectMask = vk::ImageAspectFlagBits::eColor,
+				.mipLevel = level,
+				.baseArrayLayer = 0,
+				.layerCount = 1
+			},
+			.imageOffset = {static_cast<int32_t>(x >> level), static_cast<int32_t>(y >> level), 0},
+			.imageExtent = {width >> level, height >> level, 1}
+		});
+
+		size += static_cast<vk::DeviceSize>(width >> level) * (height >> level) * 4;
+	}
+
+	vk::Buffer staging_buffer;
+	vk::DeviceMemory staging_buffer_memory;
+
+	Buffer::CreateBuffer(m_device, m_physicalDevice, size, vk::BufferUsageFlagBits::eTransferSrc,
+	                     vk::MemoryPropertyFlagBits::eHostVisible | vk::MemoryPropertyFlagBits::eHostCoherent,
+	                     staging_buffer, staging_buffer_memory);
+
+	void* data;
+	m_device.mapMemory(staging_buffer_memory, 0, size, {}, &data);
+
+	auto* staging = static_cast<uint8_t*>(data);
+
+	for (uint32_t row = 0; row < height; row++)
+		memcpy(staging + static_cast<size_t>(row) * width * 4,
+		       page.pixels.data() + (static_cast<size_t>(y + row) * m_pageSize + x) * 4, static_cast<size_t>(width) * 4);
+
+	for (uint32_t level = 1; level < m_mipLevels; level++)
+		ImageKernels::DownsampleRgba8(staging + regions[level - 1].bufferOffset, regions[level - 1].imageExtent.width,
+		                              regions[level - 1].imageExtent.height, staging + regions[level].bufferOffset);
+
+	m_device.unmapMemory(staging_buffer_memory);
+
+	vk::CommandBuffer command_buffer = Buffer::BeginSingleTimeCommands(m_device, m_commandPool);
+
+	vk::ImageMemoryBarrier barrier{
+		.srcAccessMask = vk::AccessFlagBits::eNone,
+		.dstAccessMask = vk::AccessFlagBits::eTransferWrite,
+		.oldLayout = page.uploaded ? vk::ImageLayout::eShaderReadOnlyOptimal : vk::ImageLayout::eUndefined,
+		.newLayout = vk::ImageLayout::eTransferDstOptimal,
+		.srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED,
+		.dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED,
+		.image = page.texture->m_textureImage,
+		.subresourceRange{
+			.aspectMask = vk::ImageAspectFlagBits::eColor,
+			.baseMipLevel = 0,
+			.levelCount = m_mipLevels,
+			.baseArrayLayer = 0,
+			.layerCount = 1
+		}
+	};
+
+	// Frames that are still sampling the page have to finish before it is written
+	command_buffer.pipelineBarrier(vk::PipelineStageFlagBits::eFragmentShader, vk::PipelineStageFlagBits::eTransfer,
+	                               {}, 0, nullptr, 0, nullptr, 1, &barrier);
+
+	command_buffer.copyBufferToImage(staging_buffer, page.texture->m_textureImage,
+	                                 vk::ImageLayout::eTransferDstOptimal, static_cast<uint32_t>(regions.size()),
+	                                 regions.data());
+
+	barrier.srcAccessMask = vk::AccessFlagBits::eTransferWrite;
+	barrier.dstAccessMask = vk::AccessFlagBits::eShaderRead;
+	barrier.oldLayout = vk::ImageLayout::eTransferDstOptimal;
+	barrier.newLayout = vk::ImageLayout::eShaderReadOnlyOptimal;
+
+	command_buffer.pipelineBarrier(vk::PipelineStageFlagBits::eTransfer, vk::PipelineStageFlagBits::eFragmentShader,
+	                               {}, 0, nullptr, 0, nullptr, 1, &barrier);
+
+	Buffer::EndSingleTimeCommands(m_device, m_commandPool, m_graphicsQueue, command_buffer);
+
+	m_device.destroyBuffer(staging_buffer, nullptr);
+	m_device.freeMemory(staging_buffer_memory, nullptr);
+
+	VK_CORE_TRACE("Atlas {0}: uploaded {1}x{2} at ({3}, {4}), {5:.1f}% full", page.texture->m_filePath, width, height,
+	              x, y, page.packer.GetOccupancy() * 100.0f);
+}
+
+uint32_t TextureAtlas::Align(const uint32_t value) const
+{
+	return (value + m_alignment - 1) & ~(m_alignment - 1);
+}
@@ -0,0 +1,99 @@
+﻿#pragma once
+#include <memory>
+#include <string>
+#include <vector>
+#include <glm/glm.hpp>
+#include <vulkan/vulkan.hpp>
+
+#include "SkylinePacker.h"
+#include "Texture.h"
+
+// Where an image ended up inside the atlas
+struct AtlasRegion
+{
+	uint32_t page = 0;
+
+	glm::vec2 uvMin{0.0f};
+
+	glm::vec2 uvMax{0.0f};
+};
+
+/**
+ * \brief Packs many small images into a few large textures, so that sprites and UI images share images, memory and
+ * descriptors. Every image is surrounded by a gutter of its own edge pixels, and placed on a grid that the mip levels
+ * of the pages never filter across, so neighbours don't bleed into each other when minified.
+ */
+class TextureAtlas
+{
+public:
+	TextureAtlas(vk::Device device,
+	             vk::PhysicalDevice physical_device,
+	             vk::CommandPool command_pool,
+	             vk::Queue graphics_queue,
+	             uint32_t page_size = 2048,
+	             uint32_t padding = 4);
+
+	~TextureAtlas();
+
+	TextureAtlas(const TextureAtlas&) = delete;
+
+	TextureAtlas& operator=(const TextureAtlas&) = delete;
+
+	AtlasRegion Add(const uint8_t* pixels, uint32_t width, uint32_t height);
+
+	AtlasRegion Add(const std::string& file_path);
+
+	void Flush();
+
+	[[nodiscard]] size_t GetPageCount() const { return m_pages.size(); }
+
+	[[nodiscard]] const Texture& GetPage(const uint32_t page) const { return *m_pages[page].texture; }
+
+private:
+	struct Page
+	{
+		SkylinePacker packer;
+
+		// The CPU copy of the base level, which the dirty parts of the mip chain are rebuilt from
+		std::vector<uint8_t> pixels;
+
+		std::unique_ptr<Texture> texture;
+
+		// What changed since the last flush, empty while min isn't below max
+		uint32_t dirtyMinX = UINT32_MAX;
+
+		uint32_t dirtyMinY = UINT32_MAX;
+
+		uint32_t dirtyMaxX = 0;
+
+		uint32_t dirtyMaxY = 0;
+
+		bool uploaded = false;
+	};
+
+	Page& CreatePage();
+
+	void Upload(Page& page) const;
+
+	[[nodiscard]] uint32_t Align(uint32_t value) const;
+
+	vk::Device m_device;
+
+	vk::PhysicalDevice m_physicalDevice;
+
+	vk::CommandPool m_commandPool;
+
+	vk::Queue m_graphicsQueue;
+
+	uint32_t m_pageSize;
+
+	uint32_t m_padding;
+
+	// Each level halves the gutter, so there are only as many levels as it takes for the gutter to reach one pixel
+	uint32_t m_mipLevels;
+
+	// Images start and end on multiples of this, so each texel of every level only covers a single image
+	uint32_t m_alignment;
+
+	std::vector<Page> m_pages;
+};
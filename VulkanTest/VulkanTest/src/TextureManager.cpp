@@ -0,0 +1,225 @@
+﻿#define VULKAN_HPP_NO_CONSTRUCTORS
+
+#include "TextureManager.h"
+
+#include <algorithm>
+#include <filesystem>
+
+#include "TextureUploadBatch.h"
+#include "Core/Log.h"
+#include "Core/Timer.h"
+
+TextureManager::TextureManager(const vk::Device device,
+                               const vk::PhysicalDevice physical_device,
+                               const vk::CommandPool command_pool,
+                               const vk::Queue graphics_queue,
+                               const vk::DeviceSize memory_budget)
+	: m_device(device),
+	  m_physicalDevice(physical_device),
+	  m_commandPool(command_pool),
+	  m_graphicsQueue(graphics_queue),
+	  m_memoryBudget(memory_budget) {}
+
+/**
+ * \brief Destroys every texture, the device must be idle and no handle may be used afterwards.
+ */
+TextureManager::~TextureManager()
+{
+	for (const auto& [path, entry] : m_textures) {
+		if (entry.texture.use_count() > 1)
+			VK_CORE_WARN("Texture {0} is destroyed while it is still referenced", path);
+
+		entry.texture->Destroy(m_device);
+	}
+}
+
+/**
+ * \brief Gets the texture of a file, loading it only if it isn't resident already.
+ * Must be called from the thread that submits to the graphics queue.
+ * \param file_path The path of the image, relative to the textures folder.
+ * \return A handle shared by everyone who loaded the same file, which keeps the texture from being evicted.
+ */
+std::shared_ptr<Texture> TextureManager::Load(const std::string& file_path)
+{
+	const std::string canonical_path = GetCanonicalPath("assets/textures/" + file_path);
+
+	if (const auto it = m_textures.find(canonical_path); it != m_textures.end()) {
+		it->second.lastUsedFrame = m_frame;
+		return it->second.texture;
+	}
+
+	auto texture = std::make_shared<Texture>(file_path, m_device, m_physicalDevice, m_commandPool, m_graphicsQueue);
+
+	Add(canonical_path, texture);
+
+	return texture;
+}
+
+/**
+ * \brief Gets the textures of many files at once. Every file that isn't resident yet is uploaded in a single
+ * submission, so loading a whole material or level only waits on the queue once.
+ * Must be called from the thread that submits to the graphics queue.
+ * \param file_paths The paths of the images, relative to the textures folder.
+ * \return A handle for each path, in the same order.
+ */
+std::vector<std::shared_ptr<Texture>> TextureManager::Load(const std::vector<std::string>& file_paths)
+{
+	const Timer timer;
+
+	std::vector<std::shared_ptr<Texture>> textures(file_paths.size());
+	std::vector<std::pair<size_t, std::string>> loaded;
+
+	TextureUploadBatch batch(m_device, m_physicalDevice, m_commandPool, m_graphicsQueue);
+
+	for (size_t i = 0; i < file_paths.size(); i++) {
+		std::string canonical_path = GetCanonicalPath("assets/textures/" + file_paths[i]);
+
+		if (const auto it = m_textures.find(canonical_path); it != m_textures.end()) {
+			it->second.lastUsedFrame = m_frame;
+			textures[i] = it->second.texture;
+			continue;
+		}
+
+		// The same file can be asked for more than once within the batch
+		const auto duplicate = std::ranges::find(loaded, canonical_path, &std::pair<size_t, std::string>::second);
+
+		if (duplicate != loaded.end()) {
+			textures[i] = textures[duplicate->first];
+			continue;
+		}
+
+		try {
+			textures[i] = std::make_shared<Texture>(file_paths[i], batch);
+		} catch (...) {
+			// The batch frees the staging memory, but the images created so far are only owned here
+			for (const auto& [index, path] : loaded)
+				textures[index]->Destroy(m_device);
+
+			throw;
+		}
+
+		loaded.emplace_back(i, std::move(canonical_path));
+	}
+
+	batch.Submit();
+
+	uintmax_t loaded_size = 0;
+
+	for (const auto& [index, canonical_path] : loaded) {
+		std::error_code error;
+
+		if (const uintmax_t size = std::filesystem::file_size(canonical_path, error); !error)
+			loaded_size += size;
+
+		Add(canonical_path, textures[index]);
+	}
+
+	// From the files to sampleable images, which on a cold page cache is mostly bound by the disk
+	if (!loaded.empty()) {
+		const float seconds = timer.Elapsed();
+		const float megabytes = static_cast<float>(loaded_size) / (1024.0f * 1024.0f);
+
+		VK_CORE_INFO("Loaded {0} textures from {1:.1f} MiB of files in {2:.1f} ms ({3:.0f} MiB/s)", loaded.size(),
+		             megabytes, seconds * 1000.0f, megabytes / seconds);
+	}
+
+	return textures;
+}
+
+/**
+ * \brief Finishes a newly loaded texture, and starts tracking it.
+ */
+void TextureManager::Add(const std::string& canonical_path, const std::shared_ptr<Texture>& texture)
+{
+	texture->CreateTextureImageView(m_device);
+	texture->CreateTextureSampler(m_device, m_physicalDevice);
+
+	Entry entry{
+		.texture = texture,
+		.memorySize = texture->GetMemorySize(m_device),
+		.lastUsedFrame = m_frame
+	};
+
+	m_memoryUsage += entry.memorySize;
+	m_textures.emplace(canonical_path, std::move(entry));
+
+	// Make room right away rather than waiting for the next frame
+	if (m_memoryUsage > m_memoryBudget)
+		Evict();
+}
+
+/**
+ * \brief Advances the frame counter, refreshes which textures are still referenced,
+ * and evicts unreferenced ones while the budget is exceeded. Meant to be called once per frame.
+ */
+void TextureManager::Update()
+{
+	m_frame++;
+
+	for (auto& [path, entry] : m_textures)
+		if (entry.texture.use_count() > 1)
+			entry.lastUsedFrame = m_frame;
+
+	if (m_memoryUsage > m_memoryBudget)
+		Evict();
+}
+
+/**
+ * \brief Changes how much device memory the cached textures may occupy, evicting right away if it is now exceeded.
+ * \param memory_budget The budget in bytes.
+ */
+void TextureManager::SetMemoryBudget(const vk::DeviceSize memory_budget)
+{
+	m_memoryBudget = memory_budget;
+
+	if (m_memoryUsage > m_memoryBudget)
+		Evict();
+}
+
+/**
+ * \brief Turns a path into the same string for every way of spelling it, e.g. with "./", ".." or different separators.
+ * \param file_path The path of the file.
+ * \return The absolute, normalized path.
+ */
+std::string TextureManager::GetCanonicalPath(const std::string& file_path)
+{
+	std::error_code error;
+
+	std::filesystem::path path = std::filesystem::weakly_canonical(file_path, error);
+
+	if (error)
+		path = std::filesystem::absolute(file_path).lexically_normal();
+
+	return path.generic_string();
+}
+
+/**
+ * \brief Destroys unreferenced textures, least recently used first, until the usage fits the budget.
+ * Textures released within the last few frames are skipped, as frames in flight may still sample them.
+ */
+void TextureManager::Evict()
+{
+	std::vector<std::unordered_map<std::string, Entry>::iterator> candidates;
+
+	for (auto it = m_textures.begin(); it != m_textures.end(); ++it)
+		if (it->second.texture.use_count() == 1 && it->second.lastUsedFrame + s_evictionDelayFrames <= m_frame)
+			candidates.push_back(it);
+
+	std::ranges::sort(candidates, {}, [](const auto& it) { return it->second.lastUsedFrame; });
+
+	for (const auto& it : candidates) {
+		if (m_memoryUsage <= m_memoryBudget)
+			break;
+
+		VK_CORE_TRACE("Evicting texture {0} ({1} bytes)", it->first, it->second.memorySize);
+
+		it->second.texture->Destroy(m_device);
+
+		m_memoryUsage -= it->second.memorySize;
+		m_textures.erase(it);
+	}
+
+	if (m_memoryUsage > m_memoryBudget)
+		VK_CORE_WARN("Textures in use take {0} bytes, which is over the budget of {1} bytes", m_memoryUsage,
+		             m_memoryBudget);
+}
@@ -0,0 +1,79 @@
+﻿#pragma once
+#include <memory>
+#include <string>
+#include <unordered_map>
+#include <vector>
+#include <vulkan/vulkan.hpp>
+
+#include "Texture.h"
+
+/**
+ * \brief Owns every texture loaded through it, so that each file is only loaded once no matter how many materials use
+ * it. Textures that nobody holds a handle to anymore stay cached until the memory budget is exceeded, and are then
+ * evicted least recently used first.
+ */
+class TextureManager
+{
+public:
+	// Frames that can still be reading a texture after its last handle was released
+	static constexpr uint64_t s_evictionDelayFrames = 3;
+
+	TextureManager(vk::Device device,
+	               vk::PhysicalDevice physical_device,
+	               vk::CommandPool command_pool,
+	               vk::Queue graphics_queue,
+	               vk::DeviceSize memory_budget = 512ull * 1024 * 1024);
+
+	~TextureManager();
+
+	TextureManager(const TextureManager&) = delete;
+
+	TextureManager& operator=(const TextureManager&) = delete;
+
+	std::shared_ptr<Texture> Load(const std::string& file_path);
+
+	std::vector<std::shared_ptr<Texture>> Load(const std::vector<std::string>& file_paths);
+
+	void Update();
+
+	void SetMemoryBudget(vk::DeviceSize memory_budget);
+
+	[[nodiscard]] vk::DeviceSize GetMemoryBudget() const { return m_memoryBudget; }
+
+	[[nodiscard]] vk::DeviceSize GetMemoryUsage() const { return m_memoryUsage; }
+
+	[[nodiscard]] size_t GetSize() const { return m_textures.size(); }
+
+	static std::string GetCanonicalPath(const std::string& file_path);
+
+private:
+	struct Entry
+	{
+		std::shared_ptr<Texture> texture;
+
+		vk::DeviceSize memorySize = 0;
+
+		// The last frame in which anything outside of the manager held the texture
+		uint64_t lastUsedFrame = 0;
+	};
+
+	void Add(const std::string& canonical_path, const std::shared_ptr<Texture>& texture);
+
+	void Evict();
+
+	vk::Device m_device;
+
+	vk::PhysicalDevice m_physicalDevice;
+
+	vk::CommandPool m_commandPool;
+
+	vk::Queue m_graphicsQueue;
+
+	vk::DeviceSize m_memoryBudget;
+
+	vk::DeviceSize m_memoryUsage = 0;
+
+	uint64_t m_frame = 0;
+
+	std::unordered_map<std::string, Entry> m_textures;
+};
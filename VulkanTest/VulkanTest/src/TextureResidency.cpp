@@ -0,0 +1,523 @@
+﻿#define VULKAN_HPP_NO_CONSTRUCTORS
+
+#include "TextureResidency.h"
+
+#include <algorithm>
+#include <cstring>
+#include <numeric>
+#include <ranges>
+#include <stb_image.h>
+
+#include "Buffer.h"
+#include "Image.h"
+#include "ImageKernels.h"
+#include "TextureUploadBatch.h"
+#include "Core/Log.h"
+
+TextureResidency::TextureResidency(const vk::Device device,
+                                   const vk::PhysicalDevice physical_device,
+                                   const vk::CommandPool command_pool,
+                                   const vk::Queue graphics_queue,
+                                   const vk::DeviceSize memory_budget)
+	: m_device(device),
+	  m_physicalDevice(physical_device),
+	  m_commandPool(command_pool),
+	  m_graphicsQueue(graphics_queue),
+	  m_memoryBudget(memory_budget),
+	  m_memoryBudgetSupported(SupportsMemoryBudget(physical_device)) {}
+
+/**
+ * \brief Destroys every texture and every replaced image, the device must be idle.
+ */
+TextureResidency::~TextureResidency()
+{
+	for (const std::shared_ptr<ResidentTexture>& texture : m_textures) {
+		if (texture.use_count() > 1)
+			VK_CORE_WARN("Texture {0} is destroyed while it is still referenced", texture->m_filePath);
+
+		texture->m_texture.Destroy(m_device);
+	}
+
+	for (const RetiredImage& retired : m_retiredImages) {
+		m_device.destroyImageView(retired.view, nullptr);
+		m_device.destroyImage(retired.image, nullptr);
+		m_device.freeMemory(retired.memory, nullptr);
+	}
+}
+
+/**
+ * \brief Loads a texture at the highest resolution that fits into what is left of the budget.
+ * If the device still runs out of memory, lower resolutions are tried before giving up.
+ * Must be called from the thread that submits to the graphics queue.
+ * \param file_path The path of the image, relative to the textures folder.
+ * \return The texture, which starts out as used in the current frame.
+ */
+std::shared_ptr<ResidentTexture> TextureResidency::Load(const std::string& file_path)
+{
+	auto texture = std::make_shared<ResidentTexture>();
+
+	texture->m_filePath = "assets/textures/" + file_path;
+
+	int tex_width, tex_height, tex_channels;
+
+	if (!Texture::ReadImageInfo(texture->m_filePath, tex_width, tex_height, tex_channels))
+		throw std::runtime_error("Failed to load texture image!");
+
+	texture->m_width = static_cast<uint32_t>(tex_width);
+	texture->m_height = static_cast<uint32_t>(tex_height);
+	texture->m_fullMipLevels = ImageKernels::GetMipLevelCount(texture->m_width, texture->m_height);
+	texture->m_lastUsedFrame = m_frame;
+
+	const vk::DeviceSize budget = GetEffectiveBudget();
+	uint32_t first_level = 0;
+
+	while (first_level < GetMaxFirstLevel(*texture) && m_memoryUsage + GetChainSize(*texture, first_level) > budget)
+		first_level++;
+
+	TextureUploadBatch batch(m_device, m_physicalDevice, m_commandPool, m_graphicsQueue);
+
+	texture->m_firstLevel = Upload(*texture, first_level, texture->m_texture, batch);
+
+	batch.Submit();
+
+	texture->m_texture.CreateTextureImageView(m_device);
+	texture->m_texture.CreateTextureSampler(m_device, m_physicalDevice);
+
+	texture->m_memorySize = texture->m_texture.GetMemorySize(m_device);
+	m_memoryUsage += texture->m_memorySize;
+
+	if (texture->m_firstLevel > 0)
+		VK_CORE_WARN("Texture {0} loaded without its {1} highest mip levels to stay within the budget",
+		             texture->m_filePath, texture->m_firstLevel);
+
+	m_textures.push_back(texture);
+
+	return texture;
+}
+
+/**
+ * \brief Reports that a texture is drawn this frame, which keeps its resolution up.
+ * \param texture The texture being drawn.
+ * \param screen_extent The largest edge of the texture on screen in pixels, 0 when it isn't known.
+ * Levels larger than this are never sampled, so they are the first to go.
+ */
+void TextureResidency::Use(ResidentTexture& texture, const float screen_extent) const
+{
+	texture.m_screenExtent = texture.m_lastUsedFrame == m_frame
+		                         ? std::max(texture.m_screenExtent, screen_extent)
+		                         : screen_extent;
+
+	texture.m_lastUsedFrame = m_frame;
+}
+
+/**
+ * \brief Decides which levels every texture should have, and moves a few textures towards that.
+ * Drops happen before reloads so that the memory they free can be used right away.
+ * Meant to be called once per frame, after the fence of the frame being recorded was waited on.
+ * \return The textures whose image changed, whose descriptors have to be rewritten.
+ */
+std::vector<std::shared_ptr<ResidentTexture>> TextureResidency::Update()
+{
+	m_frame++;
+
+	std::erase_if(m_retiredImages, [this](const RetiredImage& retired)
+	{
+		if (retired.frame + s_retireDelayFrames > m_frame)
+			return false;
+
+		m_device.destroyImageView(retired.view, nullptr);
+		m_device.destroyImage(retired.image, nullptr);
+		m_device.freeMemory(retired.memory, nullptr);
+		return true;
+	});
+
+	std::vector<uint32_t> targets(m_textures.size());
+	vk::DeviceSize projected_usage = 0;
+
+	for (size_t i = 0; i < m_textures.size(); i++) {
+		targets[i] = GetWantedFirstLevel(*m_textures[i]);
+		projected_usage += GetChainSize(*m_textures[i], targets[i]);
+	}
+
+	// Lowest priority first: idle the longest, then smallest on screen
+	std::vector<size_t> order(m_textures.size());
+	std::iota(order.begin(), order.end(), 0);
+
+	std::ranges::sort(order, [this](const size_t a, const size_t b)
+	{
+		const ResidentTexture& texture_a = *m_textures[a];
+		const ResidentTexture& texture_b = *m_textures[b];
+
+		if (texture_a.m_lastUsedFrame != texture_b.m_lastUsedFrame)
+			return texture_a.m_lastUsedFrame < texture_b.m_lastUsedFrame;
+
+		return texture_a.m_screenExtent < texture_b.m_screenExtent;
+	});
+
+	const vk::DeviceSize budget = GetEffectiveBudget();
+
+	for (const size_t i : order) {
+		if (projected_usage <= budget)
+			break;
+
+		const ResidentTexture& texture = *m_textures[i];
+
+		while (targets[i] < GetMaxFirstLevel(texture) && projected_usage > budget) {
+			projected_usage -= GetChainSize(texture, targets[i]);
+			projected_usage += GetChainSize(texture, ++targets[i]);
+		}
+	}
+
+	std::vector<std::shared_ptr<ResidentTexture>> changed;
+
+	// Drops copy on the GPU, all of them in one submission that is waited on once
+	std::vector<std::pair<size_t, Texture>> drops;
+	vk::CommandBuffer drop_command_buffer;
+
+	for (const size_t i : order) {
+		ResidentTexture& texture = *m_textures[i];
+
+		if (targets[i] <= texture.m_firstLevel || drops.size() >= s_maxChangesPerUpdate)
+			continue;
+
+		if (!drop_command_buffer)
+			drop_command_buffer = Buffer::BeginSingleTimeCommands(m_device, m_commandPool);
+
+		Texture& replacement = drops.emplace_back(i, Texture()).second;
+
+		try {
+			RecordDropLevels(drop_command_buffer, texture, targets[i], replacement);
+		} catch (const std::runtime_error& error) {
+			VK_CORE_WARN("Failed to drop mip levels of texture {0}: {1}", texture.m_filePath, error.what());
+			drops.pop_back();
+		}
+	}
+
+	if (drop_command_buffer)
+		Buffer::EndSingleTimeCommands(m_device, m_commandPool, m_graphicsQueue, drop_command_buffer);
+
+	for (auto& [i, replacement] : drops) {
+		Replace(*m_textures[i], replacement, targets[i]);
+		changed.push_back(m_textures[i]);
+	}
+
+	// Reloads read the files again, highest priority first, and are uploaded together
+	std::vector<std::pair<size_t, Texture>> reloads;
+
+	TextureUploadBatch batch(m_device, m_physicalDevice, m_commandPool, m_graphicsQueue);
+
+	for (const size_t i : order | std::views::reverse) {
+		ResidentTexture& texture = *m_textures[i];
+
+		if (targets[i] >= texture.m_firstLevel || changed.size() + reloads.size() >= s_maxChangesPerUpdate)
+			continue;
+
+		Texture& replacement = reloads.emplace_back(i, Texture()).second;
+
+		try {
+			targets[i] = Upload(texture, targets[i], replacement, batch);
+		} catch (const std::runtime_error& error) {
+			VK_CORE_WARN("Failed to reload texture {0}: {1}", texture.m_filePath, error.what());
+			reloads.pop_back();
+		}
+	}
+
+	batch.Submit();
+
+	for (auto& [i, replacement] : reloads) {
+		Replace(*m_textures[i], replacement, targets[i]);
+		changed.push_back(m_textures[i]);
+	}
+
+	return changed;
+}
+
+/**
+ * \brief Gets the budget that textures are kept within: the configured one, lowered to what the device reports as
+ * still available when it supports VK_EXT_memory_budget. A tenth of what is available is left to other allocations.
+ */
+vk::DeviceSize TextureResidency::GetEffectiveBudget() const
+{
+	if (!m_memoryBudgetSupported)
+		return m_memoryBudget;
+
+	vk::PhysicalDeviceMemoryBudgetPropertiesEXT budget_properties{};
+
+	vk::PhysicalDeviceMemoryProperties2 memory_properties{
+		.pNext = &budget_properties
+	};
+
+	m_physicalDevice.getMemoryProperties2(&memory_properties);
+
+	const vk::PhysicalDeviceMemoryProperties& properties = memory_properties.memoryProperties;
+	vk::DeviceSize available = 0;
+
+	for (uint32_t i = 0; i < properties.memoryHeapCount; i++)
+		if (properties.memoryHeaps[i].flags & vk::MemoryHeapFlagBits::eDeviceLocal &&
+		    budget_properties.heapBudget[i] > budget_properties.heapUsage[i])
+			available += budget_properties.heapBudget[i] - budget_properties.heapUsage[i];
+
+	// What the textures already use counts as used by the heaps, but is still theirs to keep
+	return std::min(m_memoryBudget, m_memoryUsage + available / 10 * 9);
+}
+
+bool TextureResidency::SupportsMemoryBudget(const vk::PhysicalDevice physical_device)
+{
+	uint32_t extension_count;
+	physical_device.enumerateDeviceExtensionProperties(nullptr, &extension_count, nullptr);
+
+	std::vector<vk::ExtensionProperties> extensions(extension_count);
+	physical_device.enumerateDeviceExtensionProperties(nullptr, &extension_count, extensions.data());
+
+	return std::ranges::any_of(extensions, [](const vk::ExtensionProperties& extension)
+	{
+		return strcmp(extension.extensionName, VK_EXT_MEMORY_BUDGET_EXTENSION_NAME) == 0;
+	});
+}
+
+/**
+ * \brief Decodes a texture, builds its whole mip chain, and records the upload of the levels from the first one on.
+ * Lower resolutions are tried when the image can't be allocated.
+ * \param texture The texture to load.
+ * \param first_level The highest level to load.
+ * \param image Gets the image, which is ready once the batch was submitted.
+ * \param batch The batch that the upload is recorded into.
+ * \return The highest level that was actually loaded.
+ */
+uint32_t TextureResidency::Upload(const ResidentTexture& texture,
+                                  uint32_t first_level,
+                                  Texture& image,
+                                  TextureUploadBatch& batch) const
+{
+	int tex_width, tex_height, tex_channels;
+
+	stbi_uc* pixels = Texture::DecodeImageFile(texture.m_filePath, tex_width, tex_height, tex_channels);
+
+	if (!pixels)
+		throw std::runtime_error("Failed to load texture image!");
+
+	std::vector<vk::BufferImageCopy> regions;
+	std::vector<uint8_t> chain(Texture::GetMipChainRegions(texture.m_width, texture.m_height,
+	                                                       texture.m_fullMipLevels, regions));
+
+	ImageKernels::ExpandToRgba8(pixels, static_cast<uint32_t>(tex_channels),
+	                            static_cast<size_t>(texture.m_width) * texture.m_height, chain.data());
+
+	stbi_image_free(pixels);
+
+	for (uint32_t level = 1; level < texture.m_fullMipLevels; level++)
+		ImageKernels::DownsampleRgba8(chain.data() + regions[level - 1].bufferOffset,
+		                              regions[level - 1].imageExtent.width, regions[level - 1].imageExtent.height,
+		                              chain.data() + regions[level].bufferOffset);
+
+	for (;; first_level++) {
+		try {
+			Texture::CreateImage(m_device, m_physicalDevice, regions[first_level].imageExtent.width,
+			                     regions[first_level].imageExtent.height, texture.m_fullMipLevels - first_level,
+			                     image.m_format, vk::ImageTiling::eOptimal,
+			                     vk::ImageUsageFlagBits::eTransferSrc | vk::ImageUsageFlagBits::eTransferDst |
+			                     vk::ImageUsageFlagBits::eSampled, vk::MemoryPropertyFlagBits::eDeviceLocal,
+			                     image.m_textureImage, image.m_textureImageMemory);
+			break;
+		} catch (const std::runtime_error&) {
+			if (first_level >= GetMaxFirstLevel(texture))
+				throw;
+
+			VK_CORE_WARN("Out of memory for texture {0}, trying without mip level {1}", texture.m_filePath,
+			             first_level);
+		}
+	}
+
+	image.m_filePath = texture.m_filePath;
+	image.m_mipLevels = texture.m_fullMipLevels - first_level;
+
+	const vk::DeviceSize chain_offset = regions[first_level].bufferOffset;
+	const vk::DeviceSize size = chain.size() - chain_offset;
+
+	vk::Buffer staging_buffer;
+	vk::DeviceSize staging_offset;
+
+	// Until the batch holds the image, nothing else would destroy it
+	try {
+		memcpy(batch.Allocate(size, image.m_format, staging_offset, staging_buffer), chain.data() + chain_offset,
+		       size);
+
+		regions.erase(regions.begin(), regions.begin() + first_level);
+
+		for (vk::BufferImageCopy& region : regions) {
+			region.bufferOffset = region.bufferOffset - chain_offset + staging_offset;
+			region.imageSubresource.mipLevel -= first_level;
+		}
+
+		batch.Add(image.m_textureImage, image.m_mipLevels, 1, staging_buffer, std::move(regions));
+	} catch (...) {
+		m_device.destroyImage(image.m_textureImage, nullptr);
+		m_device.freeMemory(image.m_textureImageMemory, nullptr);
+
+		image.m_textureImage = nullptr;
+		image.m_textureImageMemory = nullptr;
+		throw;
+	}
+
+	return first_level;
+}
+
+/**
+ * \brief Creates a smaller image for a texture, and records copying the levels it keeps into it on the GPU, without
+ * touching the file again. The texture switches to the image with Replace, once the command buffer has finished.
+ * \param command_buffer The command buffer that the copy is recorded into.
+ * \param texture The texture to shrink.
+ * \param first_level The new highest level.
+ * \param replacement Gets the new image, left empty when it can't be allocated.
+ */
+void TextureResidency::RecordDropLevels(const vk::CommandBuffer command_buffer,
+                                        const ResidentTexture& texture,
+                                        const uint32_t first_level,
+                                        Texture& replacement) const
+{
+	const Texture& current = texture.m_texture;
+	const uint32_t dropped = first_level - texture.m_firstLevel;
+
+	replacement.m_mipLevels = current.m_mipLevels - dropped;
+
+	const uint32_t width = ImageKernels::GetMipExtent(texture.m_width, first_level);
+	const uint32_t height = ImageKernels::GetMipExtent(texture.m_height, first_level);
+
+	Texture::CreateImage(m_device, m_physicalDevice, width, height, replacement.m_mipLevels, replacement.m_format,
+	                     vk::ImageTiling::eOptimal,
+	                     vk::ImageUsageFlagBits::eTransferSrc | vk::ImageUsageFlagBits::eTransferDst |
+	                     vk::ImageUsageFlagBits::eSampled, vk::MemoryPropertyFlagBits::eDeviceLocal,
+	                     replacement.m_textureImage, replacement.m_textureImageMemory);
+
+	auto full_range = [](const uint32_t mip_levels)
+	{
+		return vk::ImageSubresourceRange{
+			.aspectMask = vk::ImageAspectFlagBits::eColor,
+			.baseMipLevel = 0,
+			.levelCount = mip_levels,
+			.baseArrayLayer = 0,
+			.layerCount = 1
+		};
+	};
+
+	std::vector<vk::ImageCopy> copies;
+
+	for (uint32_t level = 0; level < replacement.m_mipLevels; level++)
+		copies.push_back(vk::ImageCopy{
+			.srcSubresource{
+				.aspectMask = vk::ImageAspectFlagBits::eColor,
+				.mipLevel = level + dropped,
+				.baseArrayLayer = 0,
+				.layerCount = 1
+			},
+			.srcOffset = {0, 0, 0},
+			.dstSubresource{
+				.aspectMask = vk::ImageAspectFlagBits::eColor,
+				.mipLevel = level,
+				.baseArrayLayer = 0,
+				.layerCount = 1
+			},
+			.dstOffset = {0, 0, 0},
+			.extent = {ImageKernels::GetMipExtent(width, level), ImageKernels::GetMipExtent(height, level), 1}
+		});
+
+	Image::RecordLayoutTransition(command_buffer, current.m_textureImage, vk::ImageLayout::eShaderReadOnlyOptimal,
+	                              vk::ImageLayout::eTransferSrcOptimal, full_range(current.m_mipLevels));
+
+	Image::RecordLayoutTransition(command_buffer, replacement.m_textureImage, vk::ImageLayout::eUndefined,
+	                              vk::ImageLayout::eTransferDstOptimal, full_range(replacement.m_mipLevels));
+
+	command_buffer.copyImage(current.m_textureImage, vk::ImageLayout::eTransferSrcOptimal,
+	                         replacement.m_textureImage, vk::ImageLayout::eTransferDstOptimal,
+	                         static_cast<uint32_t>(copies.size()), copies.data());
+
+	// Frames recorded before the descriptors are rewritten still sample the old image
+	Image::RecordLayoutTransition(command_buffer, current.m_textureImage, vk::ImageLayout::eTransferSrcOptimal,
+	                              vk::ImageLayout::eShaderReadOnlyOptimal, full_range(current.m_mipLevels));
+
+	Image::RecordLayoutTransition(command_buffer, replacement.m_textureImage, vk::ImageLayout::eTransferDstOptimal,
+	                              vk::ImageLayout::eShaderReadOnlyOptimal, full_range(replacement.m_mipLevels));
+}
+
+/**
+ * \brief Swaps the image of a texture for a new one, and retires the old image until no frame can sample it anymore.
+ */
+void TextureResidency::Replace(ResidentTexture& texture, const Texture& replacement, const uint32_t first_level)
+{
+	Texture& current = texture.m_texture;
+
+	m_retiredImages.push_back(RetiredImage{
+		.image = current.m_textureImage,
+		.memory = current.m_textureImageMemory,
+		.view = current.m_textureImageView,
+		.frame = m_frame
+	});
+
+	current.m_textureImage = replacement.m_textureImage;
+	current.m_textureImageMemory = replacement.m_textureImageMemory;
+	current.m_mipLevels = replacement.m_mipLevels;
+
+	current.CreateTextureImageView(m_device);
+
+	m_memoryUsage -= texture.m_memorySize;
+	texture.m_memorySize = current.GetMemorySize(m_device);
+	m_memoryUsage += texture.m_memorySize;
+
+	VK_CORE_TRACE("Texture {0}: mip level {1} -> {2}, {3:.1f} of {4:.1f} MiB used", texture.m_filePath,
+	              texture.m_firstLevel, first_level, static_cast<float>(m_memoryUsage) / (1024.0f * 1024.0f),
+	              static_cast<float>(GetEffectiveBudget()) / (1024.0f * 1024.0f));
+
+	texture.m_firstLevel = first_level;
+}
+
+/**
+ * \brief Gets the highest level that a texture needs, ignoring the budget. Levels larger than the texture appears on
+ * screen are never sampled, and idle textures only need their smallest resident size.
+ */
+uint32_t TextureResidency::GetWantedFirstLevel(const ResidentTexture& texture) const
+{
+	const uint32_t max_first_level = GetMaxFirstLevel(texture);
+
+	if (m_frame - texture.m_lastUsedFrame > s_idleFrames)
+		return max_first_level;
+
+	if (texture.m_screenExtent <= 0.0f)
+		return 0;
+
+	const uint32_t extent = std::max(texture.m_width, texture.m_height);
+	uint32_t level = 0;
+
+	while (level < max_first_level &&
+	       static_cast<float>(ImageKernels::GetMipExtent(extent, level + 1)) >= texture.m_screenExtent)
+		level++;
+
+	return level;
+}
+
+/**
+ * \brief Gets the highest level that can be dropped to, where the texture is still at least the minimum resident size.
+ */
+uint32_t TextureResidency::GetMaxFirstLevel(const ResidentTexture& texture)
+{
+	const uint32_t extent = std::max(texture.m_width, texture.m_height);
+	uint32_t level = 0;
+
+	while (level + 1 < texture.m_fullMipLevels && (extent >> (level + 1)) >= s_minResidentExtent)
+		level++;
+
+	return level;
+}
+
+/**
+ * \brief Estimates the memory of the mip chain of a texture from a level on, without any padding of the driver.
+ */
+vk::DeviceSize TextureResidency::GetChainSize(const ResidentTexture& texture, const uint32_t first_level)
+{
+	vk::DeviceSize size = 0;
+
+	for (uint32_t level = first_level; level < texture.m_fullMipLevels; level++)
+		size += static_cast<vk::DeviceSize>(ImageKernels::GetMipExtent(texture.m_width, level)) *
+			ImageKernels::GetMipExtent(texture.m_height, level) * 4;
+
+	return size;
+}
@@ -0,0 +1,150 @@
+﻿#pragma once
+#include <memory>
+#include <string>
+#include <vector>
+#include <vulkan/vulkan.hpp>
+
+#include "Texture.h"
+
+class TextureUploadBatch;
+
+/**
+ * \brief A texture whose highest mip levels can be dropped under memory pressure and reloaded later.
+ * The texture object stays the same, but its image and view change, so descriptors have to be rewritten
+ * whenever the residency manager reports it as changed.
+ */
+class ResidentTexture
+{
+public:
+	[[nodiscard]] const Texture& Get() const { return m_texture; }
+
+	[[nodiscard]] const std::string& GetFilePath() const { return m_filePath; }
+
+	// The highest level that is resident, 0 when the texture is at full resolution
+	[[nodiscard]] uint32_t GetFirstLevel() const { return m_firstLevel; }
+
+	[[nodiscard]] uint32_t GetFullMipLevelCount() const { return m_fullMipLevels; }
+
+private:
+	Texture m_texture;
+
+	std::string m_filePath;
+
+	uint32_t m_width = 0;
+
+	uint32_t m_height = 0;
+
+	uint32_t m_fullMipLevels = 1;
+
+	uint32_t m_firstLevel = 0;
+
+	vk::DeviceSize m_memorySize = 0;
+
+	// The largest on-screen edge in pixels reported since the last update, 0 when the size isn't known
+	float m_screenExtent = 0.0f;
+
+	uint64_t m_lastUsedFrame = 0;
+
+	friend class TextureResidency;
+};
+
+/**
+ * \brief Keeps the textures it loads within a memory budget, which follows VK_EXT_memory_budget when the device
+ * reports it. Every texture is ranked by how recently and how large it was drawn; when the budget is exceeded, the
+ * lowest ranked textures lose their highest mip levels, and get them back once they rank higher and there is room.
+ * Large texture sets end up blurrier rather than failing to allocate.
+ */
+class TextureResidency
+{
+public:
+	// Textures are never reduced below this size, so that everything stays recognizable
+	static constexpr uint32_t s_minResidentExtent = 64;
+
+	// Frames that can still be sampling an image after it was replaced
+	static constexpr uint64_t s_retireDelayFrames = 3;
+
+	// Textures that weren't drawn for this many frames only keep their smallest resident size
+	static constexpr uint64_t s_idleFrames = 120;
+
+	// Caps how many textures one update rebuilds, so that reacting to pressure is spread over frames
+	static constexpr uint32_t s_maxChangesPerUpdate = 4;
+
+	TextureResidency(vk::Device device,
+	                 vk::PhysicalDevice physical_device,
+	                 vk::CommandPool command_pool,
+	                 vk::Queue graphics_queue,
+	                 vk::DeviceSize memory_budget = 512ull * 1024 * 1024);
+
+	~TextureResidency();
+
+	TextureResidency(const TextureResidency&) = delete;
+
+	TextureResidency& operator=(const TextureResidency&) = delete;
+
+	std::shared_ptr<ResidentTexture> Load(const std::string& file_path);
+
+	void Use(ResidentTexture& texture, float screen_extent = 0.0f) const;
+
+	std::vector<std::shared_ptr<ResidentTexture>> Update();
+
+	void SetMemoryBudget(vk::DeviceSize memory_budget) { m_memoryBudget = memory_budget; }
+
+	[[nodiscard]] vk::DeviceSize GetMemoryBudget() const { return m_memoryBudget; }
+
+	[[nodiscard]] vk::DeviceSize GetMemoryUsage() const { return m_memoryUsage; }
+
+	[[nodiscard]] vk::DeviceSize GetEffectiveBudget() const;
+
+	static bool SupportsMemoryBudget(vk::PhysicalDevice physical_device);
+
+private:
+	// An image that was replaced, and is destroyed once no frame in flight can sample it anymore
+	struct RetiredImage
+	{
+		vk::Image image;
+
+		vk::DeviceMemory memory;
+
+		vk::ImageView view;
+
+		uint64_t frame = 0;
+	};
+
+	uint32_t Upload(const ResidentTexture& texture,
+	                uint32_t first_level,
+	                Texture& image,
+	                TextureUploadBatch& batch) const;
+
+	void RecordDropLevels(vk::CommandBuffer command_buffer,
+	                      const ResidentTexture& texture,
+	                      uint32_t first_level,
+	                      Texture& replacement) const;
+
+	void Replace(ResidentTexture& texture, const Texture& replacement, uint32_t first_level);
+
+	[[nodiscard]] uint32_t GetWantedFirstLevel(const ResidentTexture& texture) const;
+
+	[[nodiscard]] static uint32_t GetMaxFirstLevel(const ResidentTexture& texture);
+
+	[[nodiscard]] static vk::DeviceSize GetChainSize(const ResidentTexture& texture, uint32_t first_level);
+
+	vk::Device m_device;
+
+	vk::PhysicalDevice m_physicalDevice;
+
+	vk::CommandPool m_commandPool;
+
+	vk::Queue m_graphicsQueue;
+
+	vk::DeviceSize m_memoryBudget;
+
+	vk::DeviceSize m_memoryUsage = 0;
+
+	bool m_memoryBudgetSupported;
+
+	uint64_t m_frame = 0;
+
+	std::vector<std::shared_ptr<ResidentTexture>> m_textures;
+
+	std::vector<RetiredImage> m_retiredImages;
+};
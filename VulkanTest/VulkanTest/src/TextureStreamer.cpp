@@ -0,0 +1,514 @@
+﻿#define VULKAN_HPP_NO_CONSTRUCTORS
+
+#include "TextureStreamer.h"
+
+#include <algorithm>
+#include <ranges>
+#include <stb_image.h>
+
+#include "Buffer.h"
+#include "ImageKernels.h"
+#include "PhysicalDevice.h"
+#include "TextureManager.h"
+#include "Core/Log.h"
+
+/**
+ * \brief Creates the command pools and the placeholder texture, and starts the decode workers.
+ * \param device The logical device.
+ * \param physical_device The physical device, used to find the queue families and memory for the images.
+ * \param graphics_queue The queue that takes over the images when uploads run on a separate transfer family.
+ * \param transfer_queue The queue that the uploads are submitted to.
+ * \param worker_count How many threads decode textures, 0 to use one less than the hardware threads.
+ */
+TextureStreamer::TextureStreamer(const vk::Device device,
+                                 const vk::PhysicalDevice physical_device,
+                                 const vk::Queue graphics_queue,
+                                 const vk::Queue transfer_queue,
+                                 uint32_t worker_count)
+	: m_device(device),
+	  m_physicalDevice(physical_device),
+	  m_graphicsQueue(graphics_queue),
+	  m_transferQueue(transfer_queue)
+{
+	const PhysicalDevice::QueueFamilyIndices indices = PhysicalDevice::FindQueueFamilies(physical_device);
+
+	m_graphicsFamily = indices.graphicsFamily.value();
+	m_transferFamily = indices.transferFamily.value();
+
+	vk::CommandPoolCreateInfo pool_info{
+		.flags = vk::CommandPoolCreateFlagBits::eTransient,
+		.queueFamilyIndex = m_graphicsFamily
+	};
+
+	if (device.createCommandPool(&pool_info, nullptr, &m_graphicsCommandPool) != vk::Result::eSuccess)
+		throw std::runtime_error("Failed to create texture streaming command pool!");
+
+	pool_info.queueFamilyIndex = m_transferFamily;
+
+	if (device.createCommandPool(&pool_info, nullptr, &m_transferCommandPool) != vk::Result::eSuccess)
+		throw std::runtime_error("Failed to create texture streaming command pool!");
+
+	m_placeholder = std::make_unique<Texture>(std::array<uint8_t, 4>{128, 128, 128, 255}, device, physical_device,
+	                                          m_graphicsCommandPool, graphics_queue);
+
+	m_placeholder->CreateTextureImageView(device);
+	m_placeholder->CreateTextureSampler(device, physical_device);
+
+	if (worker_count == 0)
+		worker_count = std::max(std::thread::hardware_concurrency(), 2u) - 1;
+
+	for (uint32_t i = 0; i < worker_count; i++)
+		m_workers.emplace_back(&TextureStreamer::RunWorker, this);
+}
+
+/**
+ * \brief Stops the workers, waits for the uploads in flight, and destroys every texture that was streamed.
+ */
+TextureStreamer::~TextureStreamer()
+{
+	{
+		std::scoped_lock lock(m_mutex);
+		m_stopping = true;
+	}
+
+	m_condition.notify_all();
+
+	for (std::thread& worker : m_workers)
+		worker.join();
+
+	for (UploadBatch& batch : m_batches) {
+		m_device.waitForFences(1, &batch.fence, true, UINT64_MAX);
+		Release(batch);
+	}
+
+	for (DecodedTexture& decoded : m_decoded)
+		DestroyStaging(decoded);
+
+	for (const auto& texture : m_textures | std::views::values)
+		if (texture->m_texture) {
+			texture->m_texture->Destroy(m_device);
+			texture->m_texture.reset();
+		}
+
+	m_placeholder->Destroy(m_device);
+
+	m_device.destroyCommandPool(m_transferCommandPool, nullptr);
+	m_device.destroyCommandPool(m_graphicsCommandPool, nullptr);
+}
+
+/**
+ * \brief Queues a texture to be read and decoded in the background, unless the same file was requested before.
+ * Must be called from the main thread.
+ * \param file_path The path of the image, relative to the textures folder.
+ * \return The texture, which shows the placeholder until Update reports it as resident.
+ */
+std::shared_ptr<StreamedTexture> TextureStreamer::Load(const std::string& file_path)
+{
+	const std::string root_path = "assets/textures/" + file_path;
+
+	auto& texture = m_textures[TextureManager::GetCanonicalPath(root_path)];
+
+	if (texture)
+		return texture;
+
+	texture = std::make_shared<StreamedTexture>();
+	texture->m_filePath = root_path;
+	texture->m_placeholder = m_placeholder.get();
+
+	{
+		std::scoped_lock lock(m_mutex);
+		m_requests.push_back(texture);
+	}
+
+	m_condition.notify_one();
+
+	return texture;
+}
+
+/**
+ * \brief Finishes the uploads that completed, and submits everything decoded since the last call as one batch.
+ * Meant to be called once per frame from the main thread, which is also the only thread submitting to the queues.
+ * \return The textures that became resident, whose descriptors should now be pointed at the real images.
+ */
+std::vector<std::shared_ptr<StreamedTexture>> TextureStreamer::Update()
+{
+	std::vector<std::shared_ptr<StreamedTexture>> resident;
+
+	std::erase_if(m_batches, [this, &resident](UploadBatch& batch)
+	{
+		if (m_device.getFenceStatus(batch.fence) != vk::Result::eSuccess)
+			return false;
+
+		for (const DecodedTexture& decoded : batch.textures)
+			resident.push_back(decoded.texture);
+
+		Release(batch);
+
+		return true;
+	});
+
+	std::vector<DecodedTexture> textures;
+
+	{
+		std::scoped_lock lock(m_mutex);
+
+		vk::DeviceSize size = 0;
+
+		// At least one texture goes out every time, even one that is bigger than the whole budget
+		while (!m_decoded.empty() &&
+		       (textures.empty() || size + m_decoded.front().stagingSize <= s_maxUploadBytesPerUpdate)) {
+			size += m_decoded.front().stagingSize;
+			textures.push_back(std::move(m_decoded.front()));
+			m_decoded.pop_front();
+		}
+	}
+
+	if (!textures.empty())
+		Submit(std::move(textures));
+
+	return resident;
+}
+
+/**
+ * \brief Counts the textures that were requested but are not resident yet.
+ * \return How many textures are still being decoded or uploaded.
+ */
+size_t TextureStreamer::GetPendingCount() const
+{
+	size_t uploading = 0;
+
+	for (const UploadBatch& batch : m_batches)
+		uploading += batch.textures.size();
+
+	std::scoped_lock lock(m_mutex);
+
+	return m_requests.size() + m_decoding + m_decoded.size() + uploading;
+}
+
+void TextureStreamer::RunWorker()
+{
+	while (true) {
+		DecodedTexture decoded;
+
+		{
+			std::unique_lock lock(m_mutex);
+
+			m_condition.wait(lock, [this] { return m_stopping || !m_requests.empty(); });
+
+			if (m_stopping)
+				return;
+
+			decoded.texture = std::move(m_requests.front());
+			m_requests.pop_front();
+			m_decoding++;
+		}
+
+		const bool success = Decode(decoded);
+
+		std::scoped_lock lock(m_mutex);
+
+		m_decoding--;
+
+		if (success)
+			m_decoded.push_back(std::move(decoded));
+	}
+}
+
+/**
+ * \brief Reads and decodes an image file, expands it to RGBA8 in a staging buffer of its own, and filters its whole mip
+ * chain there. The transfer queue can't blit, so unlike the synchronous path the levels are always built on the CPU.
+ * \param decoded The texture to decode, which gets the staging buffer and copy regions of every level.
+ * \return Whether the file could be decoded, failures are logged and leave the placeholder in place.
+ */
+bool TextureStreamer::Decode(DecodedTexture& decoded) const
+{
+	int tex_width, tex_height, tex_channels;
+
+	stbi_uc* pixels = Texture::DecodeImageFile(decoded.texture->m_filePath, tex_width, tex_height, tex_channels);
+
+	if (!pixels) {
+		VK_CORE_ERROR("Failed to stream texture {0}: {1}", decoded.texture->m_filePath, stbi_failure_reason());
+		return false;
+	}
+
+	decoded.width = static_cast<uint32_t>(tex_width);
+	decoded.height = static_cast<uint32_t>(tex_height);
+
+	const uint32_t mip_levels = ImageKernels::GetMipLevelCount(decoded.width, decoded.height);
+
+	decoded.stagingSize = Texture::GetMipChainRegions(decoded.width, decoded.height, mip_levels, decoded.regions);
+
+	// Creating buffers and mapping memory that no other thread uses needs no synchronization with the main thread
+	try {
+		Buffer::CreateBuffer(m_device, m_physicalDevice, decoded.stagingSize, vk::BufferUsageFlagBits::eTransferSrc,
+		                     vk::MemoryPropertyFlagBits::eHostVisible | vk::MemoryPropertyFlagBits::eHostCoherent,
+		                     decoded.stagingBuffer, decoded.stagingBufferMemory);
+
+		void* data;
+
+		if (m_device.mapMemory(decoded.stagingBufferMemory, 0, decoded.stagingSize, {}, &data) != vk::Result::eSuccess)
+			throw std::runtime_error("Failed to map texture staging memory!");
+
+		auto* staging = static_cast<uint8_t*>(data);
+
+		ImageKernels::ExpandToRgba8(pixels, static_cast<uint32_t>(tex_channels),
+		                            static_cast<size_t>(decoded.width) * decoded.height, staging);
+
+		for (uint32_t level = 1; level < mip_levels; level++)
+			ImageKernels::DownsampleRgba8(staging + decoded.regions[level - 1].bufferOffset,
+			                              decoded.regions[level - 1].imageExtent.width,
+			                              decoded.regions[level - 1].imageExtent.height,
+			                              staging + decoded.regions[level].bufferOffset);
+
+		m_device.unmapMemory(decoded.stagingBufferMemory);
+	} catch (const std::exception& e) {
+		stbi_image_free(pixels);
+		DestroyStaging(decoded);
+
+		VK_CORE_ERROR("Failed to stream texture {0}: {1}", decoded.texture->m_filePath, e.what());
+		return false;
+	}
+
+	stbi_image_free(pixels);
+
+	return true;
+}
+
+/**
+ * \brief Uploads the given textures as one batch, and frees everything the batch holds if that fails.
+ * \param textures The decoded textures to upload.
+ */
+void TextureStreamer::Submit(std::vector<DecodedTexture>&& textures)
+{
+	UploadBatch batch{.textures = std::move(textures)};
+
+	try {
+		Upload(batch);
+		m_batches.push_back(std::move(batch));
+	} catch (...) {
+		Discard(batch);
+		throw;
+	}
+}
+
+/**
+ * \brief Records the uploads of all the textures of a batch into one command buffer, with one barrier call before and
+ * one after all the copies. When the transfer family is separate, the images are then released to the graphics family,
+ * and acquired there by a second submission that waits on the first.
+ * \param batch The batch, which gets the images, command buffers and synchronization objects of the upload.
+ */
+void TextureStreamer::Upload(UploadBatch& batch) const
+{
+	vk::DeviceSize staging_size = 0;
+
+	for (DecodedTexture& decoded : batch.textures) {
+		staging_size += decoded.stagingSize;
+
+		decoded.image.reset(new Texture());
+
+		Texture& image = *decoded.image;
+
+		image.m_filePath = decoded.texture->m_filePath;
+		image.m_mipLevels = static_cast<uint32_t>(decoded.regions.size());
+
+		Texture::CreateImage(m_device, m_physicalDevice, decoded.width, decoded.height, image.m_mipLevels,
+		                     image.m_format, vk::ImageTiling::eOptimal,
+		                     vk::ImageUsageFlagBits::eTransferDst | vk::ImageUsageFlagBits::eSampled,
+		                     vk::MemoryPropertyFlagBits::eDeviceLocal, image.m_textureImage,
+		                     image.m_textureImageMemory);
+
+		image.CreateTextureImageView(m_device);
+		image.CreateTextureSampler(m_device, m_physicalDevice);
+	}
+
+	const bool transfer_ownership = m_transferFamily != m_graphicsFamily;
+
+	vk::CommandBufferAllocateInfo alloc_info{
+		.commandPool = m_transferCommandPool,
+		.level = vk::CommandBufferLevel::ePrimary,
+		.commandBufferCount = 1
+	};
+
+	if (m_device.allocateCommandBuffers(&alloc_info, &batch.transferCommandBuffer) != vk::Result::eSuccess)
+		throw std::runtime_error("Failed to allocate texture upload command buffer!");
+
+	vk::CommandBufferBeginInfo begin_info{
+		.flags = vk::CommandBufferUsageFlagBits::eOneTimeSubmit
+	};
+
+	batch.transferCommandBuffer.begin(&begin_info);
+
+	std::vector<vk::ImageMemoryBarrier> barriers;
+
+	for (const DecodedTexture& decoded : batch.textures)
+		barriers.push_back(vk::ImageMemoryBarrier{
+			.srcAccessMask = vk::AccessFlagBits::eNone,
+			.dstAccessMask = vk::AccessFlagBits::eTransferWrite,
+			.oldLayout = vk::ImageLayout::eUndefined,
+			.newLayout = vk::ImageLayout::eTransferDstOptimal,
+			.srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED,
+			.dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED,
+			.image = decoded.image->m_textureImage,
+			.subresourceRange{
+				.aspectMask = vk::ImageAspectFlagBits::eColor,
+				.baseMipLevel = 0,
+				.levelCount = decoded.image->m_mipLevels,
+				.baseArrayLayer = 0,
+				.layerCount = 1
+			}
+		});
+
+	batch.transferCommandBuffer.pipelineBarrier(vk::PipelineStageFlagBits::eTopOfPipe,
+	                                            vk::PipelineStageFlagBits::eTransfer, {}, 0, nullptr, 0, nullptr,
+	                                            static_cast<uint32_t>(barriers.size()), barriers.data());
+
+	for (const DecodedTexture& decoded : batch.textures)
+		batch.transferCommandBuffer.copyBufferToImage(decoded.stagingBuffer, decoded.image->m_textureImage,
+		                                              vk::ImageLayout::eTransferDstOptimal,
+		                                              static_cast<uint32_t>(decoded.regions.size()),
+		                                              decoded.regions.data());
+
+	// The same barriers hand the images over to the shaders, through the graphics family if it is a different one
+	for (vk::ImageMemoryBarrier& barrier : barriers) {
+		barrier.srcAccessMask = vk::AccessFlagBits::eTransferWrite;
+		barrier.dstAccessMask = transfer_ownership ? vk::AccessFlagBits::eNone : vk::AccessFlagBits::eShaderRead;
+		barrier.oldLayout = vk::ImageLayout::eTransferDstOptimal;
+		barrier.newLayout = vk::ImageLayout::eShaderReadOnlyOptimal;
+
+		if (transfer_ownership) {
+			barrier.srcQueueFamilyIndex = m_transferFamily;
+			barrier.dstQueueFamilyIndex = m_graphicsFamily;
+		}
+	}
+
+	batch.transferCommandBuffer.pipelineBarrier(vk::PipelineStageFlagBits::eTransfer,
+	                                            transfer_ownership
+		                                            ? vk::PipelineStageFlagBits::eBottomOfPipe
+		                                            : vk::PipelineStageFlagBits::eFragmentShader,
+	                                            {}, 0, nullptr, 0, nullptr,
+	                                            static_cast<uint32_t>(barriers.size()), barriers.data());
+
+	batch.transferCommandBuffer.end();
+
+	vk::FenceCreateInfo fence_info{};
+
+	if (m_device.createFence(&fence_info, nullptr, &batch.fence) != vk::Result::eSuccess)
+		throw std::runtime_error("Failed to create texture upload fence!");
+
+	vk::SubmitInfo transfer_submit_info{
+		.commandBufferCount = 1,
+		.pCommandBuffers = &batch.transferCommandBuffer
+	};
+
+	if (!transfer_ownership) {
+		if (m_transferQueue.submit(1, &transfer_submit_info, batch.fence) != vk::Result::eSuccess)
+			throw std::runtime_error("Failed to submit texture upload!");
+	} else {
+		vk::SemaphoreCreateInfo semaphore_info{};
+
+		if (m_device.createSemaphore(&semaphore_info, nullptr, &batch.ownershipSemaphore) != vk::Result::eSuccess)
+			throw std::runtime_error("Failed to create texture upload semaphore!");
+
+		transfer_submit_info.signalSemaphoreCount = 1;
+		transfer_submit_info.pSignalSemaphores = &batch.ownershipSemaphore;
+
+		if (m_transferQueue.submit(1, &transfer_submit_info, VK_NULL_HANDLE) != vk::Result::eSuccess)
+			throw std::runtime_error("Failed to submit texture upload!");
+
+		alloc_info.commandPool = m_graphicsCommandPool;
+
+		if (m_device.allocateCommandBuffers(&alloc_info, &batch.graphicsCommandBuffer) != vk::Result::eSuccess)
+			throw std::runtime_error("Failed to allocate texture upload command buffer!");
+
+		batch.graphicsCommandBuffer.begin(&begin_info);
+
+		for (vk::ImageMemoryBarrier& barrier : barriers) {
+			barrier.srcAccessMask = vk::AccessFlagBits::eNone;
+			barrier.dstAccessMask = vk::AccessFlagBits::eShaderRead;
+		}
+
+		// Chained to the semaphore wait below through the fragment shader stage
+		batch.graphicsCommandBuffer.pipelineBarrier(vk::PipelineStageFlagBits::eFragmentShader,
+		                                            vk::PipelineStageFlagBits::eFragmentShader, {}, 0, nullptr, 0,
+		                                            nullptr, static_cast<uint32_t>(barriers.size()), barriers.data());
+
+		batch.graphicsCommandBuffer.end();
+
+		vk::PipelineStageFlags wait_stage = vk::PipelineStageFlagBits::eFragmentShader;
+
+		vk::SubmitInfo graphics_submit_info{
+			.waitSemaphoreCount = 1,
+			.pWaitSemaphores = &batch.ownershipSemaphore,
+			.pWaitDstStageMask = &wait_stage,
+			.commandBufferCount = 1,
+			.pCommandBuffers = &batch.graphicsCommandBuffer
+		};
+
+		if (m_graphicsQueue.submit(1, &graphics_submit_info, batch.fence) != vk::Result::eSuccess)
+			throw std::runtime_error("Failed to submit texture ownership transfer!");
+	}
+
+	VK_CORE_TRACE("Streaming {0} textures ({1} bytes) in one upload{2}", batch.textures.size(), staging_size,
+	              transfer_ownership ? " on the transfer family" : "");
+}
+
+/**
+ * \brief Frees everything a completed batch used, and makes its textures resident.
+ * \param batch The batch, whose fence has been signaled.
+ */
+void TextureStreamer::Release(UploadBatch& batch) const
+{
+	for (DecodedTexture& decoded : batch.textures) {
+		decoded.texture->m_texture = std::move(decoded.image);
+		DestroyStaging(decoded);
+	}
+
+	m_device.freeCommandBuffers(m_transferCommandPool, 1, &batch.transferCommandBuffer);
+
+	if (batch.graphicsCommandBuffer) {
+		m_device.freeCommandBuffers(m_graphicsCommandPool, 1, &batch.graphicsCommandBuffer);
+		m_device.destroySemaphore(batch.ownershipSemaphore, nullptr);
+	}
+
+	m_device.destroyFence(batch.fence, nullptr);
+}
+
+/**
+ * \brief Frees everything a batch that failed to upload holds, including its images, whose textures keep showing the
+ * placeholder.
+ * \param batch The batch, which may have been submitted in part.
+ */
+void TextureStreamer::Discard(UploadBatch& batch) const
+{
+	// The transfer may have been submitted before the ownership transfer failed
+	if (batch.transferCommandBuffer) {
+		m_transferQueue.waitIdle();
+		m_graphicsQueue.waitIdle();
+	}
+
+	for (DecodedTexture& decoded : batch.textures) {
+		if (decoded.image)
+			decoded.image->Destroy(m_device);
+
+		decoded.image.reset();
+		DestroyStaging(decoded);
+	}
+
+	if (batch.transferCommandBuffer)
+		m_device.freeCommandBuffers(m_transferCommandPool, 1, &batch.transferCommandBuffer);
+
+	if (batch.graphicsCommandBuffer)
+		m_device.freeCommandBuffers(m_graphicsCommandPool, 1, &batch.graphicsCommandBuffer);
+
+	m_device.destroySemaphore(batch.ownershipSemaphore, nullptr);
+	m_device.destroyFence(batch.fence, nullptr);
+}
+
+void TextureStreamer::DestroyStaging(DecodedTexture& decoded) const
+{
+	m_device.destroyBuffer(decoded.stagingBuffer, nullptr);
+	m_device.freeMemory(decoded.stagingBufferMemory, nullptr);
+
+	decoded.stagingBuffer = nullptr;
+	decoded.stagingBufferMemory = nullptr;
+}
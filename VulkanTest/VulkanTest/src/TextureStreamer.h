@@ -0,0 +1,156 @@
+﻿#pragma once
+#include <condition_variable>
+#include <deque>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <unordered_map>
+#include <vector>
+#include <vulkan/vulkan.hpp>
+
+#include "Texture.h"
+
+/**
+ * \brief A texture that is loaded in the background. Until it is resident it hands out the placeholder of its streamer,
+ * so it can be bound from the moment it is requested.
+ */
+class StreamedTexture
+{
+public:
+	[[nodiscard]] bool IsResident() const { return m_texture != nullptr; }
+
+	[[nodiscard]] const Texture& Get() const { return m_texture ? *m_texture : *m_placeholder; }
+
+	[[nodiscard]] const std::string& GetFilePath() const { return m_filePath; }
+
+private:
+	std::string m_filePath;
+
+	const Texture* m_placeholder = nullptr;
+
+	// Only set by the streamer on the main thread, once the upload has completed
+	std::unique_ptr<Texture> m_texture;
+
+	friend class TextureStreamer;
+};
+
+/**
+ * \brief Loads textures without blocking the main thread. Worker threads read and decode the files and build their mip
+ * chains straight in staging memory, and Update uploads everything decoded so far in a single submission on the
+ * transfer queue.
+ */
+class TextureStreamer
+{
+public:
+	// Caps how much one Update uploads, so a burst of finished decodes is spread over several frames
+	static constexpr vk::DeviceSize s_maxUploadBytesPerUpdate = 64ull * 1024 * 1024;
+
+	TextureStreamer(vk::Device device,
+	                vk::PhysicalDevice physical_device,
+	                vk::Queue graphics_queue,
+	                vk::Queue transfer_queue,
+	                uint32_t worker_count = 0);
+
+	~TextureStreamer();
+
+	TextureStreamer(const TextureStreamer&) = delete;
+
+	TextureStreamer& operator=(const TextureStreamer&) = delete;
+
+	std::shared_ptr<StreamedTexture> Load(const std::string& file_path);
+
+	std::vector<std::shared_ptr<StreamedTexture>> Update();
+
+	[[nodiscard]] const Texture& GetPlaceholder() const { return *m_placeholder; }
+
+	[[nodiscard]] size_t GetPendingCount() const;
+
+private:
+	// The whole mip chain of a texture, decoded by a worker and waiting to be uploaded
+	struct DecodedTexture
+	{
+		std::shared_ptr<StreamedTexture> texture;
+
+		// Holds the mip chain, filled by the worker so that nothing is copied again before the upload
+		vk::Buffer stagingBuffer;
+
+		vk::DeviceMemory stagingBufferMemory;
+
+		vk::DeviceSize stagingSize = 0;
+
+		// Created when the upload is recorded, and handed to the texture once it completed
+		std::unique_ptr<Texture> image;
+
+		std::vector<vk::BufferImageCopy> regions;
+
+		uint32_t width = 0;
+
+		uint32_t height = 0;
+	};
+
+	// Uploads that were submitted together, and are released together once their fence is signaled
+	struct UploadBatch
+	{
+		std::vector<DecodedTexture> textures;
+
+		vk::CommandBuffer transferCommandBuffer;
+
+		vk::CommandBuffer graphicsCommandBuffer;
+
+		vk::Semaphore ownershipSemaphore;
+
+		vk::Fence fence;
+	};
+
+	void RunWorker();
+
+	bool Decode(DecodedTexture& decoded) const;
+
+	void Submit(std::vector<DecodedTexture>&& textures);
+
+	void Upload(UploadBatch& batch) const;
+
+	void Release(UploadBatch& batch) const;
+
+	void Discard(UploadBatch& batch) const;
+
+	void DestroyStaging(DecodedTexture& decoded) const;
+
+	vk::Device m_device;
+
+	vk::PhysicalDevice m_physicalDevice;
+
+	vk::Queue m_graphicsQueue;
+
+	vk::Queue m_transferQueue;
+
+	uint32_t m_graphicsFamily;
+
+	uint32_t m_transferFamily;
+
+	vk::CommandPool m_graphicsCommandPool;
+
+	vk::CommandPool m_transferCommandPool;
+
+	std::unique_ptr<Texture> m_placeholder;
+
+	// Every texture ever requested by canonical path, so that each file is streamed once
+	std::unordered_map<std::string, std::shared_ptr<StreamedTexture>> m_textures;
+
+	std::vector<UploadBatch> m_batches;
+
+	mutable std::mutex m_mutex;
+
+	std::condition_variable m_condition;
+
+	std::deque<std::shared_ptr<StreamedTexture>> m_requests;
+
+	std::deque<DecodedTexture> m_decoded;
+
+	size_t m_decoding = 0;
+
+	bool m_stopping = false;
+
+	std::vector<std::thread> m_workers;
+};
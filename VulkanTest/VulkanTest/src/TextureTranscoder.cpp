@@ -0,0 +1,528 @@
+﻿#include "TextureTranscoder.h"
+
+#include <algorithm>
+#include <cstring>
+
+namespace
+{
+	// ETC1 / ETC2 individual and differential mode intensity modifiers
+	constexpr int s_etcModifierTables[8][4] = {
+		{2, 8, -2, -8},
+		{5, 17, -5, -17},
+		{9, 29, -9, -29},
+		{13, 42, -13, -42},
+		{18, 60, -18, -60},
+		{24, 80, -24, -80},
+		{33, 106, -33, -106},
+		{47, 183, -47, -183}
+	};
+
+	// ETC2 T and H mode paint color distances
+	constexpr int s_etcDistanceTable[8] = {3, 6, 11, 16, 23, 32, 41, 64};
+
+	// EAC alpha modifiers
+	constexpr int s_eacModifierTables[16][8] = {
+		{-3, -6, -9, -15, 2, 5, 8, 14},
+		{-3, -7, -10, -13, 2, 6, 9, 12},
+		{-2, -5, -8, -13, 1, 4, 7, 12},
+		{-2, -4, -6, -13, 1, 3, 5, 12},
+		{-3, -6, -8, -12, 2, 5, 7, 11},
+		{-3, -7, -9, -11, 2, 6, 8, 10},
+		{-4, -7, -8, -11, 3, 6, 7, 10},
+		{-3, -5, -8, -11, 2, 4, 7, 10},
+		{-2, -6, -8, -10, 1, 5, 7, 9},
+		{-2, -5, -8, -10, 1, 4, 7, 9},
+		{-2, -4, -8, -10, 1, 3, 7, 9},
+		{-2, -5, -7, -10, 1, 4, 6, 9},
+		{-3, -4, -7, -10, 2, 3, 6, 9},
+		{-1, -2, -3, -10, 0, 1, 2, 9},
+		{-4, -6, -8, -9, 3, 5, 7, 8},
+		{-3, -5, -7, -9, 2, 4, 6, 8}
+	};
+
+	uint8_t Clamp(const int value)
+	{
+		return static_cast<uint8_t>(std::clamp(value, 0, 255));
+	}
+
+	uint8_t Extend4(const uint32_t value)
+	{
+		return static_cast<uint8_t>((value << 4) | value);
+	}
+
+	uint8_t Extend5(const uint32_t value)
+	{
+		return static_cast<uint8_t>((value << 3) | (value >> 2));
+	}
+
+	uint8_t Extend6(const uint32_t value)
+	{
+		return static_cast<uint8_t>((value << 2) | (value >> 4));
+	}
+
+	uint8_t Extend7(const uint32_t value)
+	{
+		return static_cast<uint8_t>((value << 1) | (value >> 6));
+	}
+
+	uint16_t ReadLittle16(const uint8_t* data)
+	{
+		return static_cast<uint16_t>(data[0] | (data[1] << 8));
+	}
+
+	void Rgb565(const uint16_t color, uint8_t* rgb)
+	{
+		rgb[0] = Extend5((color >> 11) & 31);
+		rgb[1] = Extend6((color >> 5) & 63);
+		rgb[2] = Extend5(color & 31);
+	}
+
+	/**
+	 * \brief Decodes the color half of a BC1, BC2 or BC3 block. Texels are written as 16 RGBA values.
+	 * BC2 and BC3 always use four colors, only BC1 has the three color mode with a transparent texel.
+	 */
+	void DecodeBc1Colors(const uint8_t* block, const bool allow_transparent, uint8_t texels[16][4])
+	{
+		const uint16_t color_0 = ReadLittle16(block);
+		const uint16_t color_1 = ReadLittle16(block + 2);
+
+		uint8_t palette[4][4] = {};
+
+		Rgb565(color_0, palette[0]);
+		Rgb565(color_1, palette[1]);
+		palette[0][3] = palette[1][3] = palette[2][3] = palette[3][3] = 255;
+
+		for (int channel = 0; channel < 3; channel++) {
+			if (color_0 > color_1 || !allow_transparent) {
+				palette[2][channel] = static_cast<uint8_t>((2 * palette[0][channel] + palette[1][channel]) / 3);
+				palette[3][channel] = static_cast<uint8_t>((palette[0][channel] + 2 * palette[1][channel]) / 3);
+			} else
+				palette[2][channel] = static_cast<uint8_t>((palette[0][channel] + palette[1][channel]) / 2);
+		}
+
+		if (color_0 <= color_1 && allow_transparent)
+			palette[3][3] = 0;
+
+		uint32_t indices;
+		std::memcpy(&indices, block + 4, sizeof(indices));
+
+		for (int texel = 0; texel < 16; texel++)
+			std::memcpy(texels[texel], palette[(indices >> (texel * 2)) & 3], 4);
+	}
+
+	/**
+	 * \brief Decodes a BC3 alpha / BC4 / BC5 channel block into one channel of 16 RGBA texels.
+	 */
+	void DecodeBc4Channel(const uint8_t* block, uint8_t texels[16][4], const int channel)
+	{
+		const int value_0 = block[0];
+		const int value_1 = block[1];
+
+		int palette[8] = {value_0, value_1};
+
+		if (value_0 > value_1) {
+			for (int i = 1; i < 7; i++)
+				palette[i + 1] = ((7 - i) * value_0 + i * value_1) / 7;
+		} else {
+			for (int i = 1; i < 5; i++)
+				palette[i + 1] = ((5 - i) * value_0 + i * value_1) / 5;
+
+			palette[6] = 0;
+			palette[7] = 255;
+		}
+
+		uint64_t indices = 0;
+
+		for (int i = 0; i < 6; i++)
+			indices |= static_cast<uint64_t>(block[2 + i]) << (8 * i);
+
+		for (int texel = 0; texel < 16; texel++)
+			texels[texel][channel] = static_cast<uint8_t>(palette[(indices >> (texel * 3)) & 7]);
+	}
+
+	/**
+	 * \brief Decodes an ETC2 RGB block (which includes every ETC1 block) into 16 RGBA texels, in row order.
+	 */
+	void DecodeEtc2Colors(const uint8_t* block, uint8_t texels[16][4])
+	{
+		// Sign extension of the 3 bit differential color deltas
+		constexpr int delta[8] = {0, 1, 2, 3, -4, -3, -2, -1};
+
+		const uint32_t pixel_indices = (block[4] << 24) | (block[5] << 16) | (block[6] << 8) | block[7];
+
+		const bool differential = block[3] & 2;
+		const int red = (block[0] >> 3) + delta[block[0] & 7];
+		const int green = (block[1] >> 3) + delta[block[1] & 7];
+		const int blue = (block[2] >> 3) + delta[block[2] & 7];
+
+		uint8_t base[3][3] = {};
+		uint8_t paint[4][3] = {};
+
+		enum class Mode { Etc1, T, H, Planar } mode = Mode::Etc1;
+
+		if (!differential) {
+			for (int channel = 0; channel < 3; channel++) {
+				base[0][channel] = Extend4(block[channel] >> 4);
+				base[1][channel] = Extend4(block[channel] & 15);
+			}
+		} else if (red < 0 || red > 31) {
+			mode = Mode::T;
+
+			base[0][0] = Extend4((((block[0] >> 3) & 3) << 2) | (block[0] & 3));
+			base[0][1] = Extend4(block[1] >> 4);
+			base[0][2] = Extend4(block[1] & 15);
+			base[1][0] = Extend4(block[2] >> 4);
+			base[1][1] = Extend4(block[2] & 15);
+			base[1][2] = Extend4(block[3] >> 4);
+
+			const int distance = s_etcDistanceTable[(((block[3] >> 2) & 3) << 1) | (block[3] & 1)];
+
+			for (int channel = 0; channel < 3; channel++) {
+				paint[0][channel] = base[0][channel];
+				paint[1][channel] = Clamp(base[1][channel] + distance);
+				paint[2][channel] = base[1][channel];
+				paint[3][channel] = Clamp(base[1][channel] - distance);
+			}
+		} else if (green < 0 || green > 31) {
+			mode = Mode::H;
+
+			base[0][0] = Extend4((block[0] >> 3) & 15);
+			base[0][1] = Extend4(((block[0] & 7) << 1) | ((block[1] >> 4) & 1));
+			base[0][2] = Extend4((block[1] & 8) | ((block[1] & 3) << 1) | ((block[2] >> 7) & 1));
+			base[1][0] = Extend4((block[2] >> 3) & 15);
+			base[1][1] = Extend4(((block[2] & 7) << 1) | ((block[3] >> 7) & 1));
+			base[1][2] = Extend4((block[3] >> 3) & 15);
+
+			const uint32_t value_0 = (base[0][0] << 16) | (base[0][1] << 8) | base[0][2];
+			const uint32_t value_1 = (base[1][0] << 16) | (base[1][1] << 8) | base[1][2];
+
+			const int distance = s_etcDistanceTable[(block[3] & 4) | ((block[3] & 1) << 1) |
+			                                        (value_0 >= value_1 ? 1 : 0)];
+
+			for (int channel = 0; channel < 3; channel++) {
+				paint[0][channel] = Clamp(base[0][channel] + distance);
+				paint[1][channel] = Clamp(base[0][channel] - distance);
+				paint[2][channel] = Clamp(base[1][channel] + distance);
+				paint[3][channel] = Clamp(base[1][channel] - distance);
+			}
+		} else if (blue < 0 || blue > 31) {
+			mode = Mode::Planar;
+
+			// Origin, horizontal and vertical colors
+			base[0][0] = Extend6((block[0] >> 1) & 63);
+			base[0][1] = Extend7(((block[0] & 1) << 6) | ((block[1] >> 1) & 63));
+			base[0][2] = Extend6(((block[1] & 1) << 5) | (block[2] & 24) | ((block[2] & 3) << 1) | ((block[3] >> 7) & 1));
+			base[1][0] = Extend6(((block[3] & 124) >> 1) | (block[3] & 1));
+			base[1][1] = Extend7((block[4] >> 1) & 127);
+			base[1][2] = Extend6(((block[4] & 1) << 5) | ((block[5] >> 3) & 31));
+			base[2][0] = Extend6(((block[5] & 7) << 3) | ((block[6] >> 5) & 7));
+			base[2][1] = Extend7(((block[6] & 31) << 2) | ((block[7] >> 6) & 3));
+			base[2][2] = Extend6(block[7] & 63);
+		} else {
+			for (int channel = 0; channel < 3; channel++) {
+				base[0][channel] = Extend5(block[channel] >> 3);
+				base[1][channel] = Extend5((block[channel] >> 3) + delta[block[channel] & 7]);
+			}
+		}
+
+		const bool flipped = block[3] & 1;
+		const int* tables[2] = {s_etcModifierTables[(block[3] >> 5) & 7], s_etcModifierTables[(block[3] >> 2) & 7]};
+
+		for (int y = 0; y < 4; y++) {
+			for (int x = 0; x < 4; x++) {
+				uint8_t* texel = texels[y * 4 + x];
+				texel[3] = 255;
+
+				if (mode == Mode::Planar) {
+					for (int channel = 0; channel < 3; channel++)
+						texel[channel] = Clamp((x * (base[1][channel] - base[0][channel]) +
+						                        y * (base[2][channel] - base[0][channel]) +
+						                        4 * base[0][channel] + 2) >> 2);
+					continue;
+				}
+
+				// Indices are stored column by column, with the high bits of all texels first
+				const int bit = y + x * 4;
+				const uint32_t index = ((pixel_indices >> (15 + bit)) & 2) | ((pixel_indices >> bit) & 1);
+
+				if (mode == Mode::T || mode == Mode::H) {
+					std::memcpy(texel, paint[index], 3);
+					continue;
+				}
+
+				const int sub_block = flipped ? (y >= 2) : (x >= 2);
+
+				for (int channel = 0; channel < 3; channel++)
+					texel[channel] = Clamp(base[sub_block][channel] + tables[sub_block][index]);
+			}
+		}
+	}
+
+	/**
+	 * \brief Decodes an EAC block into the alpha of 16 RGBA texels.
+	 */
+	void DecodeEacAlpha(const uint8_t* block, uint8_t texels[16][4])
+	{
+		const int base = block[0];
+		const int multiplier = block[1] >> 4;
+		const int* table = s_eacModifierTables[block[1] & 15];
+
+		uint64_t indices = 0;
+
+		for (int i = 2; i < 8; i++)
+			indices = (indices << 8) | block[i];
+
+		for (int y = 0; y < 4; y++)
+			for (int x = 0; x < 4; x++)
+				texels[y * 4 + x][3] = Clamp(base + table[(indices >> (((3 - y) + (3 - x) * 4) * 3)) & 7] * multiplier);
+	}
+}
+
+/**
+ * \brief Gets the block dimensions and size of the formats that textures can be loaded in.
+ * \param format A vulkan format.
+ * \return The block info, with zero bytes if the format is not supported.
+ */
+TextureBlockInfo TextureTranscoder::GetBlockInfo(const vk::Format format)
+{
+	switch (format) {
+		case vk::Format::eR8G8B8A8Unorm:
+		case vk::Format::eR8G8B8A8Srgb:
+		case vk::Format::eB8G8R8A8Unorm:
+		case vk::Format::eB8G8R8A8Srgb:
+			return {1, 1, 4};
+
+		case vk::Format::eBc1RgbUnormBlock:
+		case vk::Format::eBc1RgbSrgbBlock:
+		case vk::Format::eBc1RgbaUnormBlock:
+		case vk::Format::eBc1RgbaSrgbBlock:
+		case vk::Format::eBc4UnormBlock:
+		case vk::Format::eBc4SnormBlock:
+		case vk::Format::eEtc2R8G8B8UnormBlock:
+		case vk::Format::eEtc2R8G8B8SrgbBlock:
+		case vk::Format::eEtc2R8G8B8A1UnormBlock:
+		case vk::Format::eEtc2R8G8B8A1SrgbBlock:
+		case vk::Format::eEacR11UnormBlock:
+		case vk::Format::eEacR11SnormBlock:
+			return {4, 4, 8};
+
+		case vk::Format::eBc2UnormBlock:
+		case vk::Format::eBc2SrgbBlock:
+		case vk::Format::eBc3UnormBlock:
+		case vk::Format::eBc3SrgbBlock:
+		case vk::Format::eBc5UnormBlock:
+		case vk::Format::eBc5SnormBlock:
+		case vk::Format::eBc6HUfloatBlock:
+		case vk::Format::eBc6HSfloatBlock:
+		case vk::Format::eBc7UnormBlock:
+		case vk::Format::eBc7SrgbBlock:
+		case vk::Format::eEtc2R8G8B8A8UnormBlock:
+		case vk::Format::eEtc2R8G8B8A8SrgbBlock:
+		case vk::Format::eEacR11G11UnormBlock:
+		case vk::Format::eEacR11G11SnormBlock:
+			return {4, 4, 16};
+
+		case vk::Format::eAstc4x4UnormBlock:
+		case vk::Format::eAstc4x4SrgbBlock:
+			return {4, 4, 16};
+
+		case vk::Format::eAstc5x4UnormBlock:
+		case vk::Format::eAstc5x4SrgbBlock:
+			return {5, 4, 16};
+
+		case vk::Format::eAstc5x5UnormBlock:
+		case vk::Format::eAstc5x5SrgbBlock:
+			return {5, 5, 16};
+
+		case vk::Format::eAstc6x5UnormBlock:
+		case vk::Format::eAstc6x5SrgbBlock:
+			return {6, 5, 16};
+
+		case vk::Format::eAstc6x6UnormBlock:
+		case vk::Format::eAstc6x6SrgbBlock:
+			return {6, 6, 16};
+
+		case vk::Format::eAstc8x5UnormBlock:
+		case vk::Format::eAstc8x5SrgbBlock:
+			return {8, 5, 16};
+
+		case vk::Format::eAstc8x6UnormBlock:
+		case vk::Format::eAstc8x6SrgbBlock:
+			return {8, 6, 16};
+
+		case vk::Format::eAstc8x8UnormBlock:
+		case vk::Format::eAstc8x8SrgbBlock:
+			return {8, 8, 16};
+
+		case vk::Format::eAstc10x5UnormBlock:
+		case vk::Format::eAstc10x5SrgbBlock:
+			return {10, 5, 16};
+
+		case vk::Format::eAstc10x6UnormBlock:
+		case vk::Format::eAstc10x6SrgbBlock:
+			return {10, 6, 16};
+
+		case vk::Format::eAstc10x8UnormBlock:
+		case vk::Format::eAstc10x8SrgbBlock:
+			return {10, 8, 16};
+
+		case vk::Format::eAstc10x10UnormBlock:
+		case vk::Format::eAstc10x10SrgbBlock:
+			return {10, 10, 16};
+
+		case vk::Format::eAstc12x10UnormBlock:
+		case vk::Format::eAstc12x10SrgbBlock:
+			return {12, 10, 16};
+
+		case vk::Format::eAstc12x12UnormBlock:
+		case vk::Format::eAstc12x12SrgbBlock:
+			return {12, 12, 16};
+
+		default:
+			return {1, 1, 0};
+	}
+}
+
+/**
+ * \brief Gets the size of a single mip level in bytes, rounding up to whole blocks.
+ */
+vk::DeviceSize TextureTranscoder::GetLevelSize(const vk::Format format, const uint32_t width, const uint32_t height)
+{
+	const TextureBlockInfo block = GetBlockInfo(format);
+
+	return static_cast<vk::DeviceSize>((width + block.width - 1) / block.width) *
+	       ((height + block.height - 1) / block.height) * block.bytes;
+}
+
+/**
+ * \brief Checks whether a format can be decoded on the CPU. BC6H, BC7, ASTC, signed
+ * and punch-through alpha formats can only be sampled directly by the GPU.
+ */
+bool TextureTranscoder::CanDecode(const vk::Format format)
+{
+	switch (format) {
+		case vk::Format::eBc1RgbUnormBlock:
+		case vk::Format::eBc1RgbSrgbBlock:
+		case vk::Format::eBc1RgbaUnormBlock:
+		case vk::Format::eBc1RgbaSrgbBlock:
+		case vk::Format::eBc2UnormBlock:
+		case vk::Format::eBc2SrgbBlock:
+		case vk::Format::eBc3UnormBlock:
+		case vk::Format::eBc3SrgbBlock:
+		case vk::Format::eBc4UnormBlock:
+		case vk::Format::eBc5UnormBlock:
+		case vk::Format::eEtc2R8G8B8UnormBlock:
+		case vk::Format::eEtc2R8G8B8SrgbBlock:
+		case vk::Format::eEtc2R8G8B8A8UnormBlock:
+		case vk::Format::eEtc2R8G8B8A8SrgbBlock:
+			return true;
+
+		default:
+			return false;
+	}
+}
+
+/**
+ * \brief Gets the uncompressed format that Decode produces, keeping the color space of the compressed format.
+ */
+vk::Format TextureTranscoder::GetDecodedFormat(const vk::Format format)
+{
+	switch (format) {
+		case vk::Format::eBc1RgbSrgbBlock:
+		case vk::Format::eBc1RgbaSrgbBlock:
+		case vk::Format::eBc2SrgbBlock:
+		case vk::Format::eBc3SrgbBlock:
+		case vk::Format::eEtc2R8G8B8SrgbBlock:
+		case vk::Format::eEtc2R8G8B8A8SrgbBlock:
+			return vk::Format::eR8G8B8A8Srgb;
+
+		default:
+			return vk::Format::eR8G8B8A8Unorm;
+	}
+}
+
+/**
+ * \brief Decodes a whole mip level into tightly packed RGBA8 texels.
+ * \param format A format that CanDecode accepts.
+ * \param blocks The compressed blocks of the level, in row order.
+ * \param width The width of the level in texels.
+ * \param height The height of the level in texels.
+ * \param rgba Gets width * height * 4 bytes.
+ */
+void TextureTranscoder::Decode(const vk::Format format,
+                               const uint8_t* blocks,
+                               const uint32_t width,
+                               const uint32_t height,
+                               uint8_t* rgba)
+{
+	const TextureBlockInfo info = GetBlockInfo(format);
+	const uint32_t blocks_x = (width + 3) / 4;
+	const uint32_t blocks_y = (height + 3) / 4;
+
+	for (uint32_t block_y = 0; block_y < blocks_y; block_y++) {
+		for (uint32_t block_x = 0; block_x < blocks_x; block_x++) {
+
+			const uint8_t* block = blocks + (static_cast<size_t>(block_y) * blocks_x + block_x) * info.bytes;
+
+			uint8_t texels[16][4] = {};
+
+			for (auto& texel : texels)
+				texel[3] = 255;
+
+			switch (format) {
+				case vk::Format::eBc1RgbUnormBlock:
+				case vk::Format::eBc1RgbSrgbBlock:
+					DecodeBc1Colors(block, false, texels);
+					break;
+
+				case vk::Format::eBc1RgbaUnormBlock:
+				case vk::Format::eBc1RgbaSrgbBlock:
+					DecodeBc1Colors(block, true, texels);
+					break;
+
+				case vk::Format::eBc2UnormBlock:
+				case vk::Format::eBc2SrgbBlock:
+					DecodeBc1Colors(block + 8, false, texels);
+
+					for (int texel = 0; texel < 16; texel++)
+						texels[texel][3] = Extend4((block[texel / 2] >> ((texel % 2) * 4)) & 15);
+					break;
+
+				case vk::Format::eBc3UnormBlock:
+				case vk::Format::eBc3SrgbBlock:
+					DecodeBc1Colors(block + 8, false, texels);
+					DecodeBc4Channel(block, texels, 3);
+					break;
+
+				case vk::Format::eBc4UnormBlock:
+					DecodeBc4Channel(block, texels, 0);
+					break;
+
+				case vk::Format::eBc5UnormBlock:
+					DecodeBc4Channel(block, texels, 0);
+					DecodeBc4Channel(block + 8, texels, 1);
+					break;
+
+				case vk::Format::eEtc2R8G8B8UnormBlock:
+				case vk::Format::eEtc2R8G8B8SrgbBlock:
+					DecodeEtc2Colors(block, texels);
+					break;
+
+				case vk::Format::eEtc2R8G8B8A8UnormBlock:
+				case vk::Format::eEtc2R8G8B8A8SrgbBlock:
+					DecodeEtc2Colors(block + 8, texels);
+					DecodeEacAlpha(block, texels);
+					break;
+
+				default:
+					throw std::runtime_error("Texture format can't be decoded on the CPU!");
+			}
+
+			// Blocks at the right and bottom edges can reach past the level
+			for (uint32_t y = 0; y < 4 && block_y * 4 + y < height; y++)
+				for (uint32_t x = 0; x < 4 && block_x * 4 + x < width; x++)
+					std::memcpy(rgba + ((static_cast<size_t>(block_y) * 4 + y) * width + block_x * 4 + x) * 4,
+					            texels[y * 4 + x], 4);
+		}
+	}
+}
@@ -0,0 +1,33 @@
+﻿#pragma once
+#include <cstdint>
+#include <vulkan/vulkan.hpp>
+
+/**
+ * \brief Size of a single block of a block compressed format. Uncompressed formats have 1x1 blocks.
+ */
+struct TextureBlockInfo
+{
+	uint32_t width = 1;
+
+	uint32_t height = 1;
+
+	// Zero for formats that are not known
+	uint32_t bytes = 0;
+};
+
+/**
+ * \brief Decodes block compressed textures into RGBA8 on the CPU, for devices that can't sample the format.
+ */
+class TextureTranscoder
+{
+public:
+	static TextureBlockInfo GetBlockInfo(vk::Format format);
+
+	static vk::DeviceSize GetLevelSize(vk::Format format, uint32_t width, uint32_t height);
+
+	static bool CanDecode(vk::Format format);
+
+	static vk::Format GetDecodedFormat(vk::Format format);
+
+	static void Decode(vk::Format format, const uint8_t* blocks, uint32_t width, uint32_t height, uint8_t* rgba);
+};
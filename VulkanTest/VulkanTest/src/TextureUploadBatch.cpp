@@ -0,0 +1,341 @@
+﻿#define VULKAN_HPP_NO_CONSTRUCTORS
+
+#include "TextureUploadBatch.h"
+
+#include <algorithm>
+#include <numeric>
+#include <vulkan/vulkan_format_traits.hpp>
+
+#include "Buffer.h"
+#include "ImageKernels.h"
+#include "Core/Log.h"
+#include "Core/Timer.h"
+
+TextureUploadBatch::TextureUploadBatch(const vk::Device device,
+                                       const vk::PhysicalDevice physical_device,
+                                       const vk::CommandPool command_pool,
+                                       const vk::Queue queue)
+	: m_device(device),
+	  m_physicalDevice(physical_device),
+	  m_commandPool(command_pool),
+	  m_queue(queue) {}
+
+TextureUploadBatch::~TextureUploadBatch()
+{
+	if (!m_uploads.empty())
+		VK_CORE_WARN("TextureUploadBatch - {0} images were never submitted", m_uploads.size());
+
+	FreeChunks();
+}
+
+/**
+ * \brief Reserves staging memory for an image, which stays mapped until the batch is submitted.
+ * \param size The size of the data in bytes.
+ * \param format The format of the image, whose texel block size the offset is aligned to.
+ * \param offset Gets the offset of the memory inside the buffer, which the copy regions have to add.
+ * \param buffer Gets the staging buffer that the memory belongs to.
+ * \return Where to write the data.
+ */
+uint8_t* TextureUploadBatch::Allocate(const vk::DeviceSize size,
+                                      const vk::Format format,
+                                      vk::DeviceSize& offset,
+                                      vk::Buffer& buffer)
+{
+	const vk::DeviceSize alignment = GetOffsetAlignment(format);
+
+	auto aligned_offset = [alignment](const Chunk& chunk)
+	{
+		return (chunk.used + alignment - 1) / alignment * alignment;
+	};
+
+	auto fits = [size, &aligned_offset](const Chunk& chunk)
+	{
+		return aligned_offset(chunk) + size <= chunk.size;
+	};
+
+	if (m_chunks.empty() || !fits(m_chunks.back())) {
+		Chunk chunk{.size = std::max(size, s_chunkSize)};
+
+		Buffer::CreateBuffer(m_device, m_physicalDevice, chunk.size, vk::BufferUsageFlagBits::eTransferSrc,
+		                     vk::MemoryPropertyFlagBits::eHostVisible | vk::MemoryPropertyFlagBits::eHostCoherent,
+		                     chunk.buffer, chunk.memory);
+
+		void* data;
+		m_device.mapMemory(chunk.memory, 0, chunk.size, {}, &data);
+
+		chunk.data = static_cast<uint8_t*>(data);
+
+		m_chunks.push_back(chunk);
+	}
+
+	Chunk& chunk = m_chunks.back();
+
+	offset = aligned_offset(chunk);
+	buffer = chunk.buffer;
+
+	chunk.used = offset + size;
+
+	m_stagingSize += size;
+
+	return chunk.data + offset;
+}
+
+/**
+ * \brief Gets the alignment that buffer offsets of copies into images of a format need: a multiple of the texel
+ * block size, and of 4 bytes. Formats with 3, 6 or 12 byte texels are therefore not aligned to a power of two.
+ * \param format The format of the image.
+ * \return The alignment in bytes.
+ */
+vk::DeviceSize TextureUploadBatch::GetOffsetAlignment(const vk::Format format)
+{
+	return std::lcm(std::max<vk::DeviceSize>(vk::blockSize(format), 1), 4);
+}
+
+/**
+ * \brief Queues the upload of an image, which has to be in the undefined layout.
+ * Once the batch is submitted, every level and layer of the image is ready to be sampled.
+ * \param image The image to upload to.
+ * \param mip_levels The number of levels of the image.
+ * \param layer_count The number of array layers of the image.
+ * \param buffer The staging buffer that the regions copy from.
+ * \param regions The copies into the image, offset by where the data was allocated.
+ * \param generate_mipmaps Whether the levels below the base are blitted from it, which needs a graphics queue and
+ * an image that is also a transfer source.
+ */
+void TextureUploadBatch::Add(const vk::Image image,
+                             const uint32_t mip_levels,
+                             const uint32_t layer_count,
+                             const vk::Buffer buffer,
+                             std::vector<vk::BufferImageCopy> regions,
+                             const bool generate_mipmaps)
+{
+	m_uploads.push_back(Upload{
+		.image = image,
+		.mipLevels = mip_levels,
+		.layerCount = layer_count,
+		.buffer = buffer,
+		.regions = std::move(regions),
+		.generateMipmaps = generate_mipmaps && mip_levels > 1
+	});
+}
+
+/**
+ * \brief Records every queued upload into one command buffer, submits it and waits for it to finish.
+ * The layout transitions of all images are batched into a single barrier before and after the copies.
+ */
+void TextureUploadBatch::Submit()
+{
+	if (m_uploads.empty()) {
+		FreeChunks();
+		return;
+	}
+
+	Timer timer;
+
+	vk::CommandBuffer command_buffer = Buffer::BeginSingleTimeCommands(m_device, m_commandPool);
+
+	std::vector<vk::ImageMemoryBarrier> barriers;
+	barriers.reserve(m_uploads.size());
+
+	for (const Upload& upload : m_uploads)
+		barriers.push_back(vk::ImageMemoryBarrier{
+			.srcAccessMask = vk::AccessFlagBits::eNone,
+			.dstAccessMask = vk::AccessFlagBits::eTransferWrite,
+			.oldLayout = vk::ImageLayout::eUndefined,
+			.newLayout = vk::ImageLayout::eTransferDstOptimal,
+			.srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED,
+			.dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED,
+			.image = upload.image,
+			.subresourceRange{
+				.aspectMask = vk::ImageAspectFlagBits::eColor,
+				.baseMipLevel = 0,
+				.levelCount = upload.mipLevels,
+				.baseArrayLayer = 0,
+				.layerCount = upload.layerCount
+			}
+		});
+
+	command_buffer.pipelineBarrier(vk::PipelineStageFlagBits::eTopOfPipe, vk::PipelineStageFlagBits::eTransfer, {},
+	                               0, nullptr, 0, nullptr, static_cast<uint32_t>(barriers.size()), barriers.data());
+
+	for (const Upload& upload : m_uploads)
+		command_buffer.copyBufferToImage(upload.buffer, upload.image, vk::ImageLayout::eTransferDstOptimal,
+		                                 static_cast<uint32_t>(upload.regions.size()), upload.regions.data());
+
+	// Images with generated mips are handed over level by level while blitting, the rest all at once
+	barriers.clear();
+
+	std::vector<const Upload*> mipmapped_uploads;
+
+	for (const Upload& upload : m_uploads) {
+		if (upload.generateMipmaps) {
+			mipmapped_uploads.push_back(&upload);
+			continue;
+		}
+
+		barriers.push_back(vk::ImageMemoryBarrier{
+			.srcAccessMask = vk::AccessFlagBits::eTransferWrite,
+			.dstAccessMask = vk::AccessFlagBits::eShaderRead,
+			.oldLayout = vk::ImageLayout::eTransferDstOptimal,
+			.newLayout = vk::ImageLayout::eShaderReadOnlyOptimal,
+			.srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED,
+			.dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED,
+			.image = upload.image,
+			.subresourceRange{
+				.aspectMask = vk::ImageAspectFlagBits::eColor,
+				.baseMipLevel = 0,
+				.levelCount = upload.mipLevels,
+				.baseArrayLayer = 0,
+				.layerCount = upload.layerCount
+			}
+		});
+	}
+
+	if (!barriers.empty())
+		command_buffer.pipelineBarrier(vk::PipelineStageFlagBits::eTransfer,
+		                               vk::PipelineStageFlagBits::eFragmentShader, {}, 0, nullptr, 0, nullptr,
+		                               static_cast<uint32_t>(barriers.size()), barriers.data());
+
+	if (!mipmapped_uploads.empty())
+		RecordMipmapBlits(command_buffer, mipmapped_uploads);
+
+	Buffer::EndSingleTimeCommands(m_device, m_commandPool, m_queue, command_buffer);
+
+	VK_CORE_TRACE("TextureUploadBatch - uploaded {0} images, {1} bytes in {2:.2f} ms", m_uploads.size(),
+	              m_stagingSize, timer.ElapsedMillis());
+
+	m_uploads.clear();
+	FreeChunks();
+}
+
+/**
+ * \brief Fills every level below the base by blitting each level down from the one above it, for all layers at once.
+ * Each level is done for every image together, so that one barrier before and one after the blits cover all of them.
+ * Expects all the levels in the transfer destination layout, and leaves them all ready to be sampled.
+ * \param command_buffer The command buffer that is being recorded.
+ * \param uploads The uploads with generated mipmaps, whose base levels were just copied.
+ */
+void TextureUploadBatch::RecordMipmapBlits(const vk::CommandBuffer command_buffer,
+                                           const std::vector<const Upload*>& uploads)
+{
+	uint32_t max_mip_levels = 0;
+
+	for (const Upload* upload : uploads)
+		max_mip_levels = std::max(max_mip_levels, upload->mipLevels);
+
+	auto level_barrier = [](const Upload& upload,
+	                        const uint32_t level,
+	                        const vk::ImageLayout old_layout,
+	                        const vk::ImageLayout new_layout,
+	                        const vk::AccessFlags src_access,
+	                        const vk::AccessFlags dst_access)
+	{
+		return vk::ImageMemoryBarrier{
+			.srcAccessMask = src_access,
+			.dstAccessMask = dst_access,
+			.oldLayout = old_layout,
+			.newLayout = new_layout,
+			.srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED,
+			.dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED,
+			.image = upload.image,
+			.subresourceRange{
+				.aspectMask = vk::ImageAspectFlagBits::eColor,
+				.baseMipLevel = level,
+				.levelCount = 1,
+				.baseArrayLayer = 0,
+				.layerCount = upload.layerCount
+			}
+		};
+	};
+
+	auto level_extent = [](const vk::Extent3D& extent, const uint32_t level)
+	{
+		return vk::Offset3D{
+			static_cast<int32_t>(ImageKernels::GetMipExtent(extent.width, level)),
+			static_cast<int32_t>(ImageKernels::GetMipExtent(extent.height, level)),
+			static_cast<int32_t>(ImageKernels::GetMipExtent(extent.depth, level))
+		};
+	};
+
+	std::vector<vk::ImageMemoryBarrier> barriers;
+	barriers.reserve(uploads.size() * 2);
+
+	for (uint32_t level = 1; level < max_mip_levels; level++) {
+
+		// The previous level was just written, and becomes the source of this one
+		barriers.clear();
+
+		for (const Upload* upload : uploads)
+			if (level < upload->mipLevels)
+				barriers.push_back(level_barrier(*upload, level - 1, vk::ImageLayout::eTransferDstOptimal,
+				                                 vk::ImageLayout::eTransferSrcOptimal,
+				                                 vk::AccessFlagBits::eTransferWrite,
+				                                 vk::AccessFlagBits::eTransferRead));
+
+		command_buffer.pipelineBarrier(vk::PipelineStageFlagBits::eTransfer, vk::PipelineStageFlagBits::eTransfer,
+		                               {}, 0, nullptr, 0, nullptr, static_cast<uint32_t>(barriers.size()),
+		                               barriers.data());
+
+		for (const Upload* upload : uploads) {
+			if (level >= upload->mipLevels)
+				continue;
+
+			const vk::Extent3D extent = upload->regions.front().imageExtent;
+
+			vk::ImageBlit blit{
+				.srcSubresource{
+					.aspectMask = vk::ImageAspectFlagBits::eColor,
+					.mipLevel = level - 1,
+					.baseArrayLayer = 0,
+					.layerCount = upload->layerCount
+				},
+				.srcOffsets = std::array{vk::Offset3D{0, 0, 0}, level_extent(extent, level - 1)},
+				.dstSubresource{
+					.aspectMask = vk::ImageAspectFlagBits::eColor,
+					.mipLevel = level,
+					.baseArrayLayer = 0,
+					.layerCount = upload->layerCount
+				},
+				.dstOffsets = std::array{vk::Offset3D{0, 0, 0}, level_extent(extent, level)}
+			};
+
+			command_buffer.blitImage(upload->image, vk::ImageLayout::eTransferSrcOptimal, upload->image,
+			                         vk::ImageLayout::eTransferDstOptimal, 1, &blit, vk::Filter::eLinear);
+		}
+
+		// The source levels are done, so they can already be handed over to the shaders, and so can the last levels
+		barriers.clear();
+
+		for (const Upload* upload : uploads) {
+			if (level >= upload->mipLevels)
+				continue;
+
+			barriers.push_back(level_barrier(*upload, level - 1, vk::ImageLayout::eTransferSrcOptimal,
+			                                 vk::ImageLayout::eShaderReadOnlyOptimal,
+			                                 vk::AccessFlagBits::eTransferRead, vk::AccessFlagBits::eShaderRead));
+
+			// The last level is only ever written to
+			if (level == upload->mipLevels - 1)
+				barriers.push_back(level_barrier(*upload, level, vk::ImageLayout::eTransferDstOptimal,
+				                                 vk::ImageLayout::eShaderReadOnlyOptimal,
+				                                 vk::AccessFlagBits::eTransferWrite,
+				                                 vk::AccessFlagBits::eShaderRead));
+		}
+
+		command_buffer.pipelineBarrier(vk::PipelineStageFlagBits::eTransfer,
+		                               vk::PipelineStageFlagBits::eFragmentShader, {}, 0, nullptr, 0, nullptr,
+		                               static_cast<uint32_t>(barriers.size()), barriers.data());
+	}
+}
+
+void TextureUploadBatch::FreeChunks()
+{
+	for (const Chunk& chunk : m_chunks) {
+		m_device.unmapMemory(chunk.memory);
+		m_device.destroyBuffer(chunk.buffer, nullptr);
+		m_device.freeMemory(chunk.memory, nullptr);
+	}
+
+	m_chunks.clear();
+	m_stagingSize = 0;
+}
@@ -0,0 +1,95 @@
+﻿#pragma once
+#include <vector>
+#include <vulkan/vulkan.hpp>
+
+/**
+ * \brief Collects the uploads of many images, and records all of their layout transitions, copies and mip blits into a
+ * single command buffer with one submission. The staging data of every image is written into large mapped chunks,
+ * so loading a set of textures costs one wait on the queue instead of several per texture.
+ */
+class TextureUploadBatch
+{
+public:
+	TextureUploadBatch(vk::Device device,
+	                   vk::PhysicalDevice physical_device,
+	                   vk::CommandPool command_pool,
+	                   vk::Queue queue);
+
+	~TextureUploadBatch();
+
+	TextureUploadBatch(const TextureUploadBatch&) = delete;
+
+	TextureUploadBatch& operator=(const TextureUploadBatch&) = delete;
+
+	uint8_t* Allocate(vk::DeviceSize size, vk::Format format, vk::DeviceSize& offset, vk::Buffer& buffer);
+
+	void Add(vk::Image image,
+	         uint32_t mip_levels,
+	         uint32_t layer_count,
+	         vk::Buffer buffer,
+	         std::vector<vk::BufferImageCopy> regions,
+	         bool generate_mipmaps = false);
+
+	void Submit();
+
+	[[nodiscard]] vk::Device GetDevice() const { return m_device; }
+
+	[[nodiscard]] vk::PhysicalDevice GetPhysicalDevice() const { return m_physicalDevice; }
+
+	[[nodiscard]] size_t GetImageCount() const { return m_uploads.size(); }
+
+	[[nodiscard]] vk::DeviceSize GetStagingSize() const { return m_stagingSize; }
+
+	static vk::DeviceSize GetOffsetAlignment(vk::Format format);
+
+	// Staging chunks are allocated at least this big, so that small textures share them
+	static constexpr vk::DeviceSize s_chunkSize = 64ull * 1024 * 1024;
+
+private:
+	struct Chunk
+	{
+		vk::Buffer buffer;
+
+		vk::DeviceMemory memory;
+
+		uint8_t* data = nullptr;
+
+		vk::DeviceSize size = 0;
+
+		vk::DeviceSize used = 0;
+	};
+
+	struct Upload
+	{
+		vk::Image image;
+
+		uint32_t mipLevels = 1;
+
+		uint32_t layerCount = 1;
+
+		vk::Buffer buffer;
+
+		// Only the levels that come from the buffer, the rest is blitted when mipmaps are generated
+		std::vector<vk::BufferImageCopy> regions;
+
+		bool generateMipmaps = false;
+	};
+
+	static void RecordMipmapBlits(vk::CommandBuffer command_buffer, const std::vector<const Upload*>& uploads);
+
+	void FreeChunks();
+
+	vk::Device m_device;
+
+	vk::PhysicalDevice m_physicalDevice;
+
+	vk::CommandPool m_commandPool;
+
+	vk::Queue m_queue;
+
+	std::vector<Chunk> m_chunks;
+
+	std::vector<Upload> m_uploads;
+
+	vk::DeviceSize m_stagingSize = 0;
+};
@@ -3,7 +3,9 @@
 #pragma once
 #include <array>
 #include <glm/glm.hpp>
-#include <vulkan/vulkan.hpp>
+
+#include "VertexLayout.h"
+#include "VertexQuantization.h"
 
 struct Vertex
 {
@@ -13,35 +15,98 @@ struct Vertex
 
 	glm::vec2 texCoord;
 
-	static vk::VertexInputBindingDescription GetBindingDescription()
+	static constexpr auto GetFields()
 	{
-		vk::VertexInputBindingDescription binding_description;
-		binding_description.binding = 0;
-		binding_description.stride = sizeof(Vertex);
-		binding_description.inputRate = vk::VertexInputRate::eVertex;
+		return std::array{
+			VERTEX_FIELD(Vertex, pos),
+			VERTEX_FIELD(Vertex, color),
+			VERTEX_FIELD(Vertex, texCoord)
+		};
+	}
+};
+
+// A vertex of a loaded model, in model space
+struct MeshVertex
+{
+	glm::vec3 position;
+
+	glm::vec3 normal;
+
+	glm::vec2 texCoord;
+
+	static constexpr auto GetFields()
+	{
+		return std::array{
+			VERTEX_FIELD(MeshVertex, position),
+			VERTEX_FIELD(MeshVertex, normal),
+			VERTEX_FIELD(MeshVertex, texCoord)
+		};
+	}
+};
+
+/**
+ * \brief Vertex in 12 bytes instead of 28, read by the same shader since the vertex input converts every field
+ * back to floats.
+ */
+struct QuantizedVertex
+{
+	using Source = Vertex;
+
+	Half2 pos;
+
+	Unorm8x4 color;
+
+	Unorm16x2 texCoord;
 
-		return binding_description;
+	static constexpr auto GetFields()
+	{
+		return std::array{
+			VERTEX_FIELD(QuantizedVertex, pos),
+			VERTEX_FIELD(QuantizedVertex, color),
+			VERTEX_FIELD(QuantizedVertex, texCoord)
+		};
 	}
 
-	static std::array<vk::VertexInputAttributeDescription, 3> GetAttributeDescriptions()
+	// Colors within half a step of 8 bit output, and texture coordinates within a tenth of a texel at 1024 texels
+	static constexpr auto GetEncoding()
 	{
-		std::array<vk::VertexInputAttributeDescription, 3> attribute_descriptions{};
+		return std::tuple{
+			MakeQuantizedField(&Vertex::pos, &QuantizedVertex::pos, false, 1e-3f),
+			MakeQuantizedField(&Vertex::color, &QuantizedVertex::color, false, 0.5f / 255.0f),
+			MakeQuantizedField(&Vertex::texCoord, &QuantizedVertex::texCoord, false, 1e-4f)
+		};
+	}
+};
 
-		attribute_descriptions[0].location = 0;
-		attribute_descriptions[0].binding = 0;
-		attribute_descriptions[0].format = vk::Format::eR32G32Sfloat;
-		attribute_descriptions[0].offset = offsetof(Vertex, pos);
+/**
+ * \brief MeshVertex in 16 bytes instead of 32. Positions and texture coordinates are fitted to the bounds of the mesh,
+ * which the shader undoes with the remaps of the mesh, and normals are octahedral (see OctahedralNormal).
+ */
+struct QuantizedMeshVertex
+{
+	using Source = MeshVertex;
+
+	Snorm16x4 position;
+
+	OctahedralNormal normal;
 
-		attribute_descriptions[1].location = 1;
-		attribute_descriptions[1].binding = 0;
-		attribute_descriptions[1].format = vk::Format::eR32G32B32Sfloat;
-		attribute_descriptions[1].offset = offsetof(Vertex, color);
+	Unorm16x2 texCoord;
 
-		attribute_descriptions[2].location = 2;
-		attribute_descriptions[2].binding = 0;
-		attribute_descriptions[2].format = vk::Format::eR32G32Sfloat;
-		attribute_descriptions[2].offset = offsetof(Vertex, texCoord);
+	static constexpr auto GetFields()
+	{
+		return std::array{
+			VERTEX_FIELD(QuantizedMeshVertex, position),
+			VERTEX_FIELD(QuantizedMeshVertex, normal),
+			VERTEX_FIELD(QuantizedMeshVertex, texCoord)
+		};
+	}
 
-		return attribute_descriptions;
+	static constexpr auto GetEncoding()
+	{
+		return std::tuple{
+			MakeQuantizedField(&MeshVertex::position, &QuantizedMeshVertex::position, true, 1e-4f),
+			MakeQuantizedField(&MeshVertex::normal, &QuantizedMeshVertex::normal, false, 1e-3f),
+			MakeQuantizedField(&MeshVertex::texCoord, &QuantizedMeshVertex::texCoord, true, 1e-4f)
+		};
 	}
 };
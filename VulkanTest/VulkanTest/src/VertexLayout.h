@@ -0,0 +1,229 @@
+﻿#define VULKAN_HPP_NO_CONSTRUCTORS
+
+#pragma once
+#include <array>
+#include <concepts>
+#include <cstddef>
+#include <cstdint>
+#include <glm/glm.hpp>
+#include <glm/gtc/type_precision.hpp>
+#include <vulkan/vulkan.hpp>
+
+/**
+ * \brief The Vulkan format of a vertex attribute type. Specialized for every type that a vertex field can have,
+ * so that a field of any other type fails to compile instead of getting a wrong format.
+ */
+template < typename T >
+struct VertexFormat;
+
+// Attributes wider than a location (16 bytes) take one location per column, e.g. instance transforms
+template < typename T >
+struct VertexLocations
+{
+	static constexpr uint32_t value = 1;
+};
+
+#define VERTEX_FORMAT(type, vk_format) \
+	template <> \
+	struct VertexFormat<type> \
+	{ \
+		static constexpr vk::Format value = vk::Format::vk_format; \
+	}
+
+VERTEX_FORMAT(float, eR32Sfloat);
+VERTEX_FORMAT(glm::vec2, eR32G32Sfloat);
+VERTEX_FORMAT(glm::vec3, eR32G32B32Sfloat);
+VERTEX_FORMAT(glm::vec4, eR32G32B32A32Sfloat);
+
+VERTEX_FORMAT(int32_t, eR32Sint);
+VERTEX_FORMAT(glm::ivec2, eR32G32Sint);
+VERTEX_FORMAT(glm::ivec3, eR32G32B32Sint);
+VERTEX_FORMAT(glm::ivec4, eR32G32B32A32Sint);
+
+VERTEX_FORMAT(uint32_t, eR32Uint);
+VERTEX_FORMAT(glm::uvec2, eR32G32Uint);
+VERTEX_FORMAT(glm::uvec3, eR32G32B32Uint);
+VERTEX_FORMAT(glm::uvec4, eR32G32B32A32Uint);
+
+VERTEX_FORMAT(glm::i16vec2, eR16G16Sint);
+VERTEX_FORMAT(glm::i16vec4, eR16G16B16A16Sint);
+VERTEX_FORMAT(glm::u16vec2, eR16G16Uint);
+VERTEX_FORMAT(glm::u16vec4, eR16G16B16A16Uint);
+
+VERTEX_FORMAT(glm::i8vec4, eR8G8B8A8Sint);
+VERTEX_FORMAT(glm::u8vec4, eR8G8B8A8Uint);
+
+VERTEX_FORMAT(glm::mat4, eR32G32B32A32Sfloat);
+
+template <>
+struct VertexLocations<glm::mat4>
+{
+	static constexpr uint32_t value = 4;
+};
+
+template < typename T >
+concept vertex_attribute = requires { { VertexFormat<T>::value } -> std::convertible_to<vk::Format>; };
+
+// One field of a vertex struct
+struct VertexField
+{
+	vk::Format format = vk::Format::eUndefined;
+
+	uint32_t offset = 0;
+
+	uint32_t locations = 1;
+
+	// The bytes between two columns of an attribute that takes more than one location
+	uint32_t columnSize = 0;
+};
+
+template < vertex_attribute T >
+constexpr VertexField MakeVertexField(const size_t offset)
+{
+	return VertexField{
+		.format = VertexFormat<T>::value,
+		.offset = static_cast<uint32_t>(offset),
+		.locations = VertexLocations<T>::value,
+		.columnSize = static_cast<uint32_t>(sizeof(T) / VertexLocations<T>::value)
+	};
+}
+
+/**
+ * \brief Describes a member of a vertex struct, with the format following from its type.
+ * Meant for the field list of a vertex, see VertexLayout.
+ */
+#define VERTEX_FIELD(vertex, member) MakeVertexField<decltype(vertex::member)>(offsetof(vertex, member))
+
+// A vertex struct that lists its fields through a static constexpr GetFields()
+template < typename T >
+concept vertex_struct = std::is_trivially_copyable_v<T> && requires
+{
+	{ T::GetFields() };
+	{ T::GetFields().size() } -> std::convertible_to<size_t>;
+	{ T::GetFields()[0] } -> std::convertible_to<VertexField>;
+};
+
+// Makes a vertex struct advance once per instance instead of once per vertex
+template < vertex_struct T >
+struct PerInstance
+{
+	using Type = T;
+};
+
+template < typename T >
+struct VertexStream
+{
+	using Type = T;
+
+	static constexpr vk::VertexInputRate s_inputRate = vk::VertexInputRate::eVertex;
+};
+
+template < vertex_struct T >
+struct VertexStream<PerInstance<T>>
+{
+	using Type = T;
+
+	static constexpr vk::VertexInputRate s_inputRate = vk::VertexInputRate::eInstance;
+};
+
+template < typename T >
+concept vertex_stream = vertex_struct<typename VertexStream<T>::Type>;
+
+// The locations that the fields of a vertex struct take up
+template < vertex_struct T >
+constexpr uint32_t GetVertexLocationCount()
+{
+	uint32_t count = 0;
+
+	for (const VertexField& field : T::GetFields())
+		count += field.locations;
+
+	return count;
+}
+
+/**
+ * \brief Derives the binding and attribute descriptions of a pipeline from vertex structs at compile time.
+ * Every stream is a binding in the order given, so one struct is an interleaved layout, and several structs are
+ * split streams in separate buffers (e.g. positions on their own for depth passes). Locations are numbered across
+ * all streams in field order, which is the order the shader declares its inputs in.
+ *
+ * A vertex lists its fields once:
+ *   static constexpr auto GetFields() { return std::array{VERTEX_FIELD(Vertex, pos), VERTEX_FIELD(Vertex, color)}; }
+ * \tparam TStreams The vertex struct of each binding, wrapped in PerInstance for instance data.
+ */
+template < vertex_stream... TStreams >
+class VertexLayout
+{
+public:
+	static constexpr uint32_t s_bindingCount = sizeof...(TStreams);
+
+	static constexpr uint32_t s_attributeCount = (GetVertexLocationCount<typename VertexStream<TStreams>::Type>() + ...);
+
+	static constexpr std::array<vk::VertexInputBindingDescription, s_bindingCount> GetBindingDescriptions()
+	{
+		std::array<vk::VertexInputBindingDescription, s_bindingCount> bindings{};
+		uint32_t binding = 0;
+
+		((bindings[binding] = vk::VertexInputBindingDescription{
+			.binding = binding,
+			.stride = static_cast<uint32_t>(sizeof(typename VertexStream<TStreams>::Type)),
+			.inputRate = VertexStream<TStreams>::s_inputRate
+		}, binding++), ...);
+
+		return bindings;
+	}
+
+	static constexpr std::array<vk::VertexInputAttributeDescription, s_attributeCount> GetAttributeDescriptions()
+	{
+		std::array<vk::VertexInputAttributeDescription, s_attributeCount> attributes{};
+		uint32_t binding = 0;
+		uint32_t location = 0;
+
+		auto add_stream = [&attributes, &binding, &location](const auto& fields)
+		{
+			for (const VertexField& field : fields)
+				for (uint32_t column = 0; column < field.locations; column++) {
+					attributes[location] = vk::VertexInputAttributeDescription{
+						.location = location,
+						.binding = binding,
+						.format = field.format,
+						.offset = field.offset + column * field.columnSize
+					};
+
+					location++;
+				}
+
+			binding++;
+		};
+
+		(add_stream(VertexStream<TStreams>::Type::GetFields()), ...);
+
+		return attributes;
+	}
+
+	/**
+	 * \brief Gets the vertex input state of a pipeline, which points into descriptions that live for the whole program.
+	 */
+	static vk::PipelineVertexInputStateCreateInfo GetInputState()
+	{
+		static constexpr auto bindings = GetBindingDescriptions();
+		static constexpr auto attributes = GetAttributeDescriptions();
+
+		return vk::PipelineVertexInputStateCreateInfo{
+			.vertexBindingDescriptionCount = s_bindingCount,
+			.pVertexBindingDescriptions = bindings.data(),
+			.vertexAttributeDescriptionCount = s_attributeCount,
+			.pVertexAttributeDescriptions = attributes.data()
+		};
+	}
+};
+
+template < typename T >
+concept index_type = std::same_as<T, uint16_t> || std::same_as<T, uint32_t>;
+
+// The index type of an index buffer with elements of type T
+template < index_type T >
+constexpr vk::IndexType GetIndexType()
+{
+	return std::same_as<T, uint16_t> ? vk::IndexType::eUint16 : vk::IndexType::eUint32;
+}
@@ -0,0 +1,214 @@
+﻿#define VULKAN_HPP_NO_CONSTRUCTORS
+
+#pragma once
+#include <algorithm>
+#include <cmath>
+#include <tuple>
+#include <glm/glm.hpp>
+#include <glm/gtc/packing.hpp>
+
+#include "VertexLayout.h"
+
+/**
+ * \brief Components stored as unsigned integers that the vertex input reads back as floats in [0, 1].
+ * \tparam TInteger uint8_t or uint16_t.
+ */
+template < typename TInteger, glm::length_t L >
+struct Unorm
+{
+	using Value = glm::vec<L, float>;
+
+	// The range that values are remapped into when a field is fitted to its data
+	static constexpr float s_rangeMin = 0.0f;
+	static constexpr float s_rangeMax = 1.0f;
+
+	glm::vec<L, TInteger> value;
+
+	static Unorm Encode(const Value& v) { return Unorm{glm::packUnorm<TInteger>(v)}; }
+
+	[[nodiscard]] Value Decode() const { return glm::unpackUnorm<float>(value); }
+};
+
+/**
+ * \brief Components stored as signed integers that the vertex input reads back as floats in [-1, 1].
+ * \tparam TInteger int8_t or int16_t.
+ */
+template < typename TInteger, glm::length_t L >
+struct Snorm
+{
+	using Value = glm::vec<L, float>;
+
+	static constexpr float s_rangeMin = -1.0f;
+	static constexpr float s_rangeMax = 1.0f;
+
+	glm::vec<L, TInteger> value;
+
+	static Snorm Encode(const Value& v) { return Snorm{glm::packSnorm<TInteger>(v)}; }
+
+	[[nodiscard]] Value Decode() const { return glm::unpackSnorm<float>(value); }
+};
+
+// Components stored as 16 bit floats, which keep about three significant digits at any scale
+template < glm::length_t L >
+struct Half
+{
+	using Value = glm::vec<L, float>;
+
+	static constexpr float s_rangeMin = -1.0f;
+	static constexpr float s_rangeMax = 1.0f;
+
+	glm::vec<L, uint16_t> value;
+
+	static Half Encode(const Value& v) { return Half{glm::packHalf(v)}; }
+
+	[[nodiscard]] Value Decode() const { return glm::unpackHalf(value); }
+};
+
+/**
+ * \brief A unit vector in two snorm16 components: the sphere is projected onto an octahedron, whose lower half is
+ * folded over the upper one so that it unfolds into a square. The error is spread evenly over all directions,
+ * unlike with spherical coordinates. The vertex shader unfolds it again:
+ *   vec3 n = vec3(e, 1.0 - abs(e.x) - abs(e.y)); float t = max(-n.z, 0.0);
+ *   n.xy += mix(vec2(t), vec2(-t), greaterThanEqual(n.xy, vec2(0.0))); n = normalize(n);
+ */
+struct OctahedralNormal
+{
+	using Value = glm::vec3;
+
+	static constexpr float s_rangeMin = -1.0f;
+	static constexpr float s_rangeMax = 1.0f;
+
+	glm::i16vec2 value;
+
+	static OctahedralNormal Encode(const Value& v)
+	{
+		const float length = std::abs(v.x) + std::abs(v.y) + std::abs(v.z);
+
+		if (length == 0.0f)
+			return OctahedralNormal{glm::i16vec2(0)};
+
+		glm::vec2 folded = glm::vec2(v) / length;
+
+		if (v.z < 0.0f)
+			folded = (1.0f - glm::abs(glm::vec2(folded.y, folded.x))) * SignNotZero(folded);
+
+		// Rounding each component on its own isn't always the closest direction, so try all four neighbours
+		const glm::vec2 scaled = glm::clamp(folded, -1.0f, 1.0f) * 32767.0f;
+		const glm::vec3 direction = glm::normalize(v);
+
+		OctahedralNormal best{};
+		float best_dot = -2.0f;
+
+		for (int corner = 0; corner < 4; corner++) {
+			const OctahedralNormal candidate{
+				glm::i16vec2((corner & 1) ? std::ceil(scaled.x) : std::floor(scaled.x),
+				             (corner & 2) ? std::ceil(scaled.y) : std::floor(scaled.y))
+			};
+
+			if (const float dot = glm::dot(candidate.Decode(), direction); dot > best_dot) {
+				best = candidate;
+				best_dot = dot;
+			}
+		}
+
+		return best;
+	}
+
+	[[nodiscard]] Value Decode() const
+	{
+		const glm::vec2 folded = glm::unpackSnorm<float>(value);
+		glm::vec3 n(folded, 1.0f - std::abs(folded.x) - std::abs(folded.y));
+
+		const float t = std::max(-n.z, 0.0f);
+		n.x += n.x >= 0.0f ? -t : t;
+		n.y += n.y >= 0.0f ? -t : t;
+
+		return glm::normalize(n);
+	}
+
+private:
+	static glm::vec2 SignNotZero(const glm::vec2 v)
+	{
+		return {v.x >= 0.0f ? 1.0f : -1.0f, v.y >= 0.0f ? 1.0f : -1.0f};
+	}
+};
+
+using Unorm8x2 = Unorm<uint8_t, 2>;
+using Unorm8x4 = Unorm<uint8_t, 4>;
+using Unorm16x2 = Unorm<uint16_t, 2>;
+using Unorm16x4 = Unorm<uint16_t, 4>;
+
+using Snorm8x2 = Snorm<int8_t, 2>;
+using Snorm8x4 = Snorm<int8_t, 4>;
+using Snorm16x2 = Snorm<int16_t, 2>;
+using Snorm16x4 = Snorm<int16_t, 4>;
+
+using Half2 = Half<2>;
+using Half4 = Half<4>;
+
+// Only formats that every Vulkan device can read as vertex input, which leaves out three component 8 and 16 bit ones
+VERTEX_FORMAT(Unorm8x2, eR8G8Unorm);
+VERTEX_FORMAT(Unorm8x4, eR8G8B8A8Unorm);
+VERTEX_FORMAT(Unorm16x2, eR16G16Unorm);
+VERTEX_FORMAT(Unorm16x4, eR16G16B16A16Unorm);
+
+VERTEX_FORMAT(Snorm8x2, eR8G8Snorm);
+VERTEX_FORMAT(Snorm8x4, eR8G8B8A8Snorm);
+VERTEX_FORMAT(Snorm16x2, eR16G16Snorm);
+VERTEX_FORMAT(Snorm16x4, eR16G16B16A16Snorm);
+
+VERTEX_FORMAT(Half2, eR16G16Sfloat);
+VERTEX_FORMAT(Half4, eR16G16B16A16Sfloat);
+
+VERTEX_FORMAT(OctahedralNormal, eR16G16Snorm);
+
+template < typename T >
+concept packed_attribute = vertex_attribute<T> && requires(const T packed, const typename T::Value value)
+{
+	{ T::Encode(value) } -> std::same_as<T>;
+	{ packed.Decode() } -> std::same_as<typename T::Value>;
+	{ T::s_rangeMin } -> std::convertible_to<float>;
+	{ T::s_rangeMax } -> std::convertible_to<float>;
+};
+
+/**
+ * \brief Maps a float member of a vertex onto a packed member of its quantized vertex.
+ * A packed type with more components than the source is padded with ones, e.g. the w of a position.
+ */
+template < typename TSource, glm::length_t L, typename TQuantized, packed_attribute TPacked >
+struct QuantizedField
+{
+	using Value = glm::vec<L, float>;
+
+	using Packed = TPacked;
+
+	Value TSource::* source;
+
+	TPacked TQuantized::* target;
+
+	// Fits the values to the range of the packed type, which the shader undoes with a scale and offset
+	bool remap;
+
+	// The largest error allowed, in source units, or as a fraction of the extent of the values if they are remapped
+	float tolerance;
+};
+
+template < typename TSource, glm::length_t L, typename TQuantized, packed_attribute TPacked >
+constexpr QuantizedField<TSource, L, TQuantized, TPacked> MakeQuantizedField(glm::vec<L, float> TSource::* source,
+                                                                            TPacked TQuantized::* target,
+                                                                            const bool remap,
+                                                                            const float tolerance)
+{
+	return {source, target, remap, tolerance};
+}
+
+/**
+ * \brief A vertex struct with packed fields, which names the float vertex it quantizes and lists how every field
+ * is encoded, see VertexQuantizer.
+ */
+template < typename T >
+concept quantized_vertex = vertex_struct<T> && requires
+{
+	typename T::Source;
+	{ std::tuple_size<decltype(T::GetEncoding())>::value } -> std::convertible_to<size_t>;
+};
@@ -0,0 +1,72 @@
+﻿#include "VertexQuantizer.h"
+
+#include <random>
+
+#include "MeshLoader.h"
+#include "Core/Log.h"
+#include "Core/Timer.h"
+
+/**
+ * \brief Reports the memory and error of quantizing random vertices: positions in a large box, unit normals in
+ * every direction, and tiling texture coordinates.
+ * \param vertex_count How many vertices to generate.
+ */
+void VertexQuantizer::Benchmark(const uint32_t vertex_count)
+{
+	std::mt19937 random(1);
+	std::uniform_real_distribution position(-100.0f, 100.0f);
+	std::uniform_real_distribution direction(-1.0f, 1.0f);
+	std::uniform_real_distribution tiling(-4.0f, 4.0f);
+
+	MeshData mesh;
+	mesh.vertices.reserve(vertex_count);
+
+	while (mesh.vertices.size() < vertex_count) {
+		const glm::vec3 normal(direction(random), direction(random), direction(random));
+		const float length = glm::length(normal);
+
+		// Only directions from inside the unit sphere, so that they are spread evenly
+		if (length > 1.0f || length < 1e-3f)
+			continue;
+
+		mesh.vertices.push_back(MeshVertex{
+			.position = {position(random), position(random), position(random)},
+			.normal = normal / length,
+			.texCoord = {tiling(random), tiling(random)}
+		});
+	}
+
+	VK_CORE_INFO("Vertex quantization:");
+	Report("Random", mesh);
+}
+
+/**
+ * \brief Reports the memory and error of quantizing the vertices of a model.
+ * \param file_path The path of the model, relative to the models folder.
+ */
+void VertexQuantizer::Benchmark(const std::string& file_path)
+{
+	const MeshData mesh = MeshLoader::Load(file_path);
+
+	VK_CORE_INFO("Vertex quantization:");
+	Report(file_path.c_str(), mesh);
+}
+
+void VertexQuantizer::Report(const char* name, const MeshData& mesh)
+{
+	const Timer timer;
+	const QuantizedVertices<QuantizedMeshVertex> quantized = Quantize<QuantizedMeshVertex>(mesh.vertices);
+	const float milliseconds = timer.ElapsedMillis();
+
+	const float float_mib = static_cast<float>(mesh.vertices.size() * sizeof(MeshVertex)) / (1024.0f * 1024.0f);
+	const float quantized_mib = static_cast<float>(quantized.vertices.size() * sizeof(QuantizedMeshVertex)) /
+		(1024.0f * 1024.0f);
+
+	VK_CORE_INFO("  {0}: {1} vertices, {2:.1f} -> {3:.1f} MiB, quantized in {4:.1f} ms ({5:.1f} M vertices/s)",
+	             name, mesh.vertices.size(), float_mib, quantized_mib, milliseconds,
+	             static_cast<float>(mesh.vertices.size()) / (milliseconds * 1000.0f));
+
+	VK_CORE_INFO("  Error of the tolerance: position {0:.3f}, normal {1:.3f}, texture coordinates {2:.3f}, {3}",
+	             quantized.errors[0], quantized.errors[1], quantized.errors[2],
+	             quantized.IsWithinBounds() ? "within bounds" : "over the bounds");
+}
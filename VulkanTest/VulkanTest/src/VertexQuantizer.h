@@ -0,0 +1,191 @@
+﻿#pragma once
+#include <algorithm>
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <limits>
+#include <string>
+#include <tuple>
+#include <utility>
+#include <vector>
+
+#include "VertexQuantization.h"
+
+struct MeshData;
+
+// How the shader undoes the remapping of a field: value = offset + scale * attribute
+struct VertexRemap
+{
+	glm::vec4 offset = glm::vec4(0.0f);
+
+	glm::vec4 scale = glm::vec4(1.0f);
+};
+
+template < quantized_vertex T >
+struct QuantizedVertices
+{
+	static constexpr size_t s_fieldCount = std::tuple_size_v<decltype(T::GetEncoding())>;
+
+	using Remaps = std::array<VertexRemap, s_fieldCount>;
+
+	std::vector<T> vertices;
+
+	// One per field, in the order of the encoding, the identity for fields that aren't remapped
+	Remaps remaps{};
+
+	// The largest error of every field as a fraction of its tolerance
+	std::array<float, s_fieldCount> errors{};
+
+	[[nodiscard]] bool IsWithinBounds() const
+	{
+		return std::ranges::all_of(errors, [](const float error) { return error <= 1.0f; });
+	}
+};
+
+/**
+ * \brief Encodes float vertices into their quantized layout and back, following the field list of the quantized
+ * vertex (see QuantizedVertex), so a new layout only has to declare its fields. Every field is checked against
+ * its tolerance while encoding, which lets the importer keep the float layout for meshes that don't fit.
+ */
+class VertexQuantizer
+{
+public:
+	template < quantized_vertex T >
+	static QuantizedVertices<T> Quantize(const std::vector<typename T::Source>& vertices);
+
+	template < quantized_vertex T >
+	static typename T::Source Dequantize(const T& vertex, const typename QuantizedVertices<T>::Remaps& remaps);
+
+	static void Benchmark(uint32_t vertex_count);
+
+	static void Benchmark(const std::string& file_path);
+
+private:
+	template < typename TField, typename TSource, typename TQuantized >
+	static void QuantizeField(const TField& field,
+	                          const std::vector<TSource>& vertices,
+	                          std::vector<TQuantized>& quantized,
+	                          VertexRemap& remap,
+	                          float& error);
+
+	template < typename TField, typename TQuantized >
+	static typename TField::Value DequantizeField(const TField& field, const TQuantized& vertex, const VertexRemap& remap)
+	{
+		using Value = typename TField::Value;
+
+		return Resize<Value>((vertex.*field.target).Decode(), 0.0f) * Resize<Value>(remap.scale, 1.0f) +
+		       Resize<Value>(remap.offset, 0.0f);
+	}
+
+	// Copies the components that both vectors have, and fills the rest
+	template < typename TVector, glm::length_t L >
+	static TVector Resize(const glm::vec<L, float>& v, const float fill)
+	{
+		TVector resized(fill);
+
+		for (glm::length_t i = 0; i < std::min(L, TVector::length()); i++)
+			resized[i] = v[i];
+
+		return resized;
+	}
+
+	static void Report(const char* name, const MeshData& mesh);
+};
+
+/**
+ * \brief Quantizes vertices, fitting remapped fields to the range of their values.
+ * \tparam T The quantized vertex, whose source is the float vertex.
+ * \param vertices The float vertices.
+ * \return The quantized vertices, with the remaps the shader needs and the error of every field.
+ */
+template < quantized_vertex T >
+QuantizedVertices<T> VertexQuantizer::Quantize(const std::vector<typename T::Source>& vertices)
+{
+	constexpr auto encoding = T::GetEncoding();
+
+	QuantizedVertices<T> result;
+	result.vertices.resize(vertices.size());
+
+	[&]<size_t... TFields>(std::index_sequence<TFields...>)
+	{
+		(QuantizeField(std::get<TFields>(encoding), vertices, result.vertices, result.remaps[TFields],
+		               result.errors[TFields]), ...);
+	}(std::make_index_sequence<QuantizedVertices<T>::s_fieldCount>{});
+
+	return result;
+}
+
+/**
+ * \brief Decodes a quantized vertex the way the vertex shader does, for checking or reading meshes back.
+ */
+template < quantized_vertex T >
+typename T::Source VertexQuantizer::Dequantize(const T& vertex, const typename QuantizedVertices<T>::Remaps& remaps)
+{
+	constexpr auto encoding = T::GetEncoding();
+
+	typename T::Source source{};
+
+	[&]<size_t... TFields>(std::index_sequence<TFields...>)
+	{
+		((source.*std::get<TFields>(encoding).source =
+			DequantizeField(std::get<TFields>(encoding), vertex, remaps[TFields])), ...);
+	}(std::make_index_sequence<QuantizedVertices<T>::s_fieldCount>{});
+
+	return source;
+}
+
+template < typename TField, typename TSource, typename TQuantized >
+void VertexQuantizer::QuantizeField(const TField& field,
+                                    const std::vector<TSource>& vertices,
+                                    std::vector<TQuantized>& quantized,
+                                    VertexRemap& remap,
+                                    float& error)
+{
+	using Value = typename TField::Value;
+	using Packed = typename TField::Packed;
+
+	Value min(std::numeric_limits<float>::max());
+	Value max(std::numeric_limits<float>::lowest());
+
+	for (const TSource& vertex : vertices) {
+		min = glm::min(min, vertex.*field.source);
+		max = glm::max(max, vertex.*field.source);
+	}
+
+	Value offset(0.0f);
+	Value scale(1.0f);
+	float extent = 0.0f;
+
+	for (glm::length_t i = 0; i < Value::length(); i++)
+		extent = std::max(extent, max[i] - min[i]);
+
+	if (field.remap && !vertices.empty()) {
+		scale = (max - min) / (Packed::s_rangeMax - Packed::s_rangeMin);
+
+		// Components with one value for every vertex are stored exactly as the offset
+		for (glm::length_t i = 0; i < Value::length(); i++)
+			if (scale[i] == 0.0f)
+				scale[i] = 1.0f;
+
+		offset = min - Packed::s_rangeMin * scale;
+	}
+
+	float max_error = 0.0f;
+
+	for (size_t i = 0; i < vertices.size(); i++) {
+		const Value& value = vertices[i].*field.source;
+		const Packed packed = Packed::Encode(Resize<typename Packed::Value>((value - offset) / scale, 1.0f));
+		const Value decoded = Resize<Value>(packed.Decode(), 0.0f) * scale + offset;
+
+		for (glm::length_t component = 0; component < Value::length(); component++)
+			max_error = std::max(max_error, std::abs(decoded[component] - value[component]));
+
+		quantized[i].*field.target = packed;
+	}
+
+	const float bound = field.remap ? field.tolerance * extent : field.tolerance;
+
+	error = max_error == 0.0f ? 0.0f : max_error / bound;
+	remap.offset = Resize<glm::vec4>(offset, 0.0f);
+	remap.scale = Resize<glm::vec4>(scale, 1.0f);
+}
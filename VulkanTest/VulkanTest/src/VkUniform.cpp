@@ -10,7 +10,16 @@
 #include "HelloTriangleApplication.h"
 #include "UniformBufferObject.h"
 
-void VkUniform::CreateDescriptorSetLayout(const vk::Device device, vk::DescriptorSetLayout& descriptor_set_layout)
+/**
+ * \brief Creates the layout of the uniform buffer and the texture of the triangle shader.
+ * \param device The logical device.
+ * \param descriptor_set_layout Gets the created layout.
+ * \param immutable_sampler A sampler that is baked into the layout, so the driver can embed it in the shader and
+ * descriptor writes only have to provide the image. Leave empty to write the sampler together with each texture.
+ */
+void VkUniform::CreateDescriptorSetLayout(const vk::Device device,
+                                          vk::DescriptorSetLayout& descriptor_set_layout,
+                                          const vk::Sampler immutable_sampler)
 {
 	vk::DescriptorSetLayoutBinding ubo_layout_binding{
 		.binding = 0,
@@ -26,7 +35,7 @@ void VkUniform::CreateDescriptorSetLayout(const vk::Device device, vk::Descripto
 		.descriptorType = vk::DescriptorType::eCombinedImageSampler,
 		.descriptorCount = 1,
 		.stageFlags = vk::ShaderStageFlagBits::eFragment,
-		.pImmutableSamplers = nullptr,
+		.pImmutableSamplers = immutable_sampler ? &immutable_sampler : nullptr,
 	};
 
 	std::array bindings = {ubo_layout_binding, sample_layout_binding};
@@ -113,11 +122,62 @@ void VkUniform::CreateDescriptorSets(const vk::Device device,
 	}
 }
 
-void VkUniform::UpdateUniformBuffer(const vk::Device device,
-                                    const uint32_t current_image,
+/**
+ * \brief Points the texture binding of a descriptor set at another texture, e.g. once a streamed texture is resident.
+ * The set must not be in use by a command buffer that is still executing.
+ * \param device The logical device.
+ * \param descriptor_set The descriptor set to update.
+ * \param texture The texture that gets sampled from now on.
+ */
+void VkUniform::UpdateTextureDescriptor(const vk::Device device,
+                                        const vk::DescriptorSet descriptor_set,
+                                        const Texture& texture)
+{
+	vk::DescriptorImageInfo image_info{
+		.sampler = texture.m_textureSampler,
+		.imageView = texture.m_textureImageView,
+		.imageLayout = vk::ImageLayout::eShaderReadOnlyOptimal,
+	};
+
+	vk::WriteDescriptorSet descriptor_write{
+		.dstSet = descriptor_set,
+		.dstBinding = 1,
+		.dstArrayElement = 0,
+		.descriptorCount = 1,
+		.descriptorType = vk::DescriptorType::eCombinedImageSampler,
+		.pImageInfo = &image_info
+	};
+
+	device.updateDescriptorSets(1, &descriptor_write, 0, nullptr);
+}
+
+/**
+ * \brief Looks up the transform matrices once, so that updating them every frame does no name lookups.
+ * \param shader The shader with the "ubo" uniform block.
+ * \return The handles of the model, view and projection matrices.
+ */
+VkUniform::TransformHandles VkUniform::GetTransformHandles(const Shader& shader)
+{
+	return {
+		.model = shader.GetUniformHandle("ubo.model"),
+		.view = shader.GetUniformHandle("ubo.view"),
+		.proj = shader.GetUniformHandle("ubo.proj")
+	};
+}
+
+/**
+ * \brief Sets the transform matrices of the current frame, and flushes the ones that changed into its uniform buffer.
+ * \param current_image The frame in flight whose uniform buffer is written.
+ * \param swap_chain_extent The extents of the current screen, for the aspect ratio of the projection.
+ * \param shader The shader that holds the CPU copy of the uniform block.
+ * \param handles The handles of the transform matrices.
+ * \param uniform_buffers_mapped The persistently mapped uniform buffer of every frame in flight.
+ */
+void VkUniform::UpdateUniformBuffer(const uint32_t current_image,
                                     const vk::Extent2D swap_chain_extent,
-                                    const std::vector<vk::DeviceMemory>&
-                                    uniform_buffers_memory)
+                                    OpenGLShader& shader,
+                                    const TransformHandles& handles,
+                                    const std::vector<void*>& uniform_buffers_mapped)
 {
 	static auto start_time = std::chrono::high_resolution_clock::now();
 
@@ -125,22 +185,38 @@ void VkUniform::UpdateUniformBuffer(const vk::Device device,
 
 	float time = std::chrono::duration<float, std::chrono::seconds::period>(current_time - start_time).count();
 
-	UniformBufferObject ubo{};
-
-	ubo.model = rotate(glm::mat4(1.0f), time * glm::radians(90.0f), glm::vec3(0.0f, 0.0f, 1.0f));
+	shader.SetMat4(handles.model, rotate(glm::mat4(1.0f), time * glm::radians(90.0f), glm::vec3(0.0f, 0.0f, 1.0f)));
 
-	ubo.view = lookAt(glm::vec3(2.0f, 2.0f, 2.0f), glm::vec3(0.0f, 0.0f, 0.0f), glm::vec3(0.0f, 0.0f, 1.0f));
+	// The view and projection only get flushed again when they actually change, e.g. after a resize
+	shader.SetMat4(handles.view,
+	               lookAt(glm::vec3(2.0f, 2.0f, 2.0f), glm::vec3(0.0f, 0.0f, 0.0f), glm::vec3(0.0f, 0.0f, 1.0f)));
 
-	ubo.proj = glm::perspective(glm::radians(45.0f),
-	                            swap_chain_extent.width / static_cast<float>(swap_chain_extent.height), 0.1f, 10.0f);
+	glm::mat4 proj = glm::perspective(glm::radians(45.0f),
+	                                  swap_chain_extent.width / static_cast<float>(swap_chain_extent.height), 0.1f,
+	                                  10.0f);
 
-	ubo.proj[1][1] *= -1;
+	proj[1][1] *= -1;
 
-	void* data;
+	shader.SetMat4(handles.proj, proj);
 
-	device.mapMemory(uniform_buffers_memory[current_image], 0, sizeof(ubo), {}, &data);
+	shader.GetUniforms().Flush(current_image, 0, 0, uniform_buffers_mapped[current_image]);
+}
 
-	memcpy(data, &ubo, sizeof(ubo));
+/**
+ * \brief Maps the uniform buffers of every frame in flight for the whole lifetime of the buffers.
+ * The memory is host coherent, so writes become visible without flushing them.
+ * \param device The logical device that owns the memory.
+ * \param uniform_buffers_memory The memory of every uniform buffer.
+ * \param uniform_buffers_mapped Gets the mapped pointer of every uniform buffer.
+ */
+void VkUniform::MapUniformBuffers(const vk::Device device,
+                                  const std::vector<vk::DeviceMemory>& uniform_buffers_memory,
+                                  std::vector<void*>& uniform_buffers_mapped)
+{
+	uniform_buffers_mapped.resize(uniform_buffers_memory.size());
 
-	device.unmapMemory(uniform_buffers_memory[current_image]);
+	for (size_t i = 0; i < uniform_buffers_memory.size(); i++)
+		if (device.mapMemory(uniform_buffers_memory[i], 0, VK_WHOLE_SIZE, {}, &uniform_buffers_mapped[i]) !=
+		    vk::Result::eSuccess)
+			throw std::runtime_error("Failed to map uniform buffer memory!");
 }
@@ -1,12 +1,15 @@
 ﻿#pragma once
 #include <vulkan/vulkan.hpp>
 
+#include "OpenGLShader.h"
 #include "Texture.h"
 
 class VkUniform
 {
 public:
-	static void CreateDescriptorSetLayout(vk::Device device, vk::DescriptorSetLayout& descriptor_set_layout);
+	static void CreateDescriptorSetLayout(vk::Device device,
+	                                      vk::DescriptorSetLayout& descriptor_set_layout,
+	                                      vk::Sampler immutable_sampler = nullptr);
 
 	static void CreateDescriptorPool(vk::Device device, vk::DescriptorPool& descriptor_pool);
 
@@ -17,9 +20,27 @@ public:
 	                                 vk::DescriptorPool descriptor_pool,
 	                                 const std::vector<vk::Buffer>& uniform_buffers);
 
-	static void UpdateUniformBuffer(vk::Device device,
-	                                uint32_t current_image,
+	static void UpdateTextureDescriptor(vk::Device device, vk::DescriptorSet descriptor_set, const Texture& texture);
+
+	// Handles of the transform matrices inside the uniform block of the triangle shader
+	struct TransformHandles
+	{
+		ShaderUniformHandle model = ShaderUniforms::s_invalidHandle;
+
+		ShaderUniformHandle view = ShaderUniforms::s_invalidHandle;
+
+		ShaderUniformHandle proj = ShaderUniforms::s_invalidHandle;
+	};
+
+	static TransformHandles GetTransformHandles(const Shader& shader);
+
+	static void UpdateUniformBuffer(uint32_t current_image,
 	                                vk::Extent2D swap_chain_extent,
-	                                const std::vector<vk::DeviceMemory>&
-	                                uniform_buffers_memory);
+	                                OpenGLShader& shader,
+	                                const TransformHandles& handles,
+	                                const std::vector<void*>& uniform_buffers_mapped);
+
+	static void MapUniformBuffers(vk::Device device,
+	                              const std::vector<vk::DeviceMemory>& uniform_buffers_memory,
+	                              std::vector<void*>& uniform_buffers_mapped);
 };
@@ -1,19 +1,128 @@
-// Base needed libraries
+﻿// Base needed libraries
 #include <cstdlib>
+#include <cstring>
 #include <iostream>
+#include <string>
 
+#include "HostImageCopy.h"
+#include "ImageKernels.h"
+#include "MeshLoader.h"
+#include "MeshOptimizer.h"
+#include "OpenGLShader.h"
+#include "PrefixSum.h"
+#include "Texture.h"
+#include "VertexQuantizer.h"
 #include "Core/Log.h"
 
 // Custom Vulkan Application class
 #include"HelloTriangleApplication.h"
 
-int main()
+namespace
 {
-	Log::Init();
+	// Measures part of the engine on this machine instead of running the application
+	struct BenchmarkMode
+	{
+		const char* name;
+
+		// Gets the argument after the name, or nullptr if there is none
+		void (*run)(const char* argument);
+	};
 
-	HelloTriangleApplication app;
+	const BenchmarkMode s_benchmarkModes[] = {
+		// The texture ingestion kernels on this CPU
+		{
+			"--benchmark-image-kernels", [](const char*)
+			{
+				ImageKernels::Benchmark(4096, 4096);
+			}
+		},
+		// The mesh parsers on a generated model with two million triangles, or on a model from the assets
+		{
+			"--benchmark-mesh-loading", [](const char* file_path)
+			{
+				if (file_path)
+					MeshLoader::Benchmark(std::string(file_path));
+				else
+					MeshLoader::Benchmark(1000);
+			}
+		},
+		// The vertex cache of generated meshes or of a model from the assets, before and after optimizing them
+		{
+			"--benchmark-mesh-optimization", [](const char* file_path)
+			{
+				if (file_path)
+					MeshOptimizer::Benchmark(std::string(file_path));
+				else
+					MeshOptimizer::Benchmark();
+			}
+		},
+		// The memory saved and the error of quantizing random vertices, or the vertices of a model from the assets
+		{
+			"--benchmark-vertex-quantization", [](const char* file_path)
+			{
+				if (file_path)
+					VertexQuantizer::Benchmark(std::string(file_path));
+				else
+					VertexQuantizer::Benchmark(1000000);
+			}
+		},
+		// Reading and splitting shader files into copies, against mapping them and taking views
+		{
+			"--benchmark-shader-preprocess", [](const char* file_path)
+			{
+				if (file_path)
+					OpenGLShader::BenchmarkPreProcess(std::string(file_path));
+				else
+					OpenGLShader::BenchmarkPreProcess();
+			}
+		},
+		// Creating a shader from the assets or a given file, with nothing, only its SPIR-V, or everything cached
+		{
+			"--benchmark-shader-creation", [](const char* file_path)
+			{
+				OpenGLShader::BenchmarkCreation(file_path ? file_path : "assets/shaders/Triangle.glsl");
+			}
+		},
+		// Decoding a generated image or an image from the assets from a cold page cache, with and without read hints
+		{
+			"--benchmark-texture-decode", [](const char* file_path)
+			{
+				if (file_path)
+					Texture::BenchmarkDecode(std::string(file_path));
+				else
+					Texture::BenchmarkDecode(4096, 4096);
+			}
+		},
+		// Uploading textures through staging buffers against writing them from the host, where the device can
+		{
+			"--benchmark-texture-upload", [](const char*)
+			{
+				HostImageCopy::Benchmark(2048, 2048, 16);
+			}
+		},
+		// The GPU prefix sum against std::inclusive_scan, on the block boundaries and on a count that is given
+		{
+			"--test-prefix-sum", [](const char* count)
+			{
+				PrefixSum::Test(count ? static_cast<uint32_t>(std::stoul(count)) : 10000000);
+			}
+		}
+	};
+}
+
+int main(const int argc, char** argv)
+{
+	Log::Init();
 
 	try {
+		if (argc > 1)
+			for (const BenchmarkMode& mode : s_benchmarkModes)
+				if (strcmp(argv[1], mode.name) == 0) {
+					mode.run(argc > 2 ? argv[2] : nullptr);
+					return EXIT_SUCCESS;
+				}
+
+		HelloTriangleApplication app;
 		app.Run();
 	} catch (const std::exception& e) {
 		std::cerr << e.what() << std::endl;